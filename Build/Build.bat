@@ -1,3 +1,4 @@
+rem Set OPUS_DIR to a libopus build (include\opus.h, lib\opus.lib) to build in the Opus voice codec.
 msbuild ..\Floe.Net\Floe.Net.csproj /p:Configuration=Release
 msbuild ..\Floe.Configuration\Floe.Configuration.csproj /P:Configuration=Release
 msbuild ..\Floe.UI\Floe.UI.csproj /P:Configuration=Release
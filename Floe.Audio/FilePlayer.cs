@@ -8,9 +8,11 @@ namespace Floe.Audio
 	public class FilePlayer : IDisposable
 	{
 		private const int WavBufferSamples = 3000;
+		private const int Mp3BufferLength = 200; // milliseconds
 		private static readonly byte[] WavFileSignature = { 0x52, 0x49, 0x46, 0x46 }; // RIFF
 		private static readonly byte[] Mp3FileSignature = { 0x49, 0x44, 0x33 }; // ID3
 
+		private Stream _stream;
 		private WaveOut _waveOut;
 
 		public event EventHandler Done;
@@ -25,13 +27,21 @@ namespace Floe.Audio
 				fileStream.Seek(0, SeekOrigin.Begin);
 				if (WavFileSignature.SequenceEqual(sig.Take(WavFileSignature.Length)))
 				{
-					var wavStream = new WavFileStream(fileStream);
-					_waveOut = new WaveOut(wavStream, wavStream.Format, WavBufferSamples * wavStream.Format.FrameSize);
+					// The file is mapped too, and converted to 16-bit PCM straight into each buffer, so that the device
+					// never has to open the file's own format.
+					fileStream.Dispose();
+					var wavStream = new WavFileStream(fileName);
+					_stream = wavStream;
+					_waveOut = new WaveOut((IWaveSource)wavStream, wavStream.Format, WavBufferSamples * wavStream.Format.FrameSize);
 				}
-				else if (Mp3FileSignature.SequenceEqual(sig.Take(Mp3FileSignature.Length)))
+				else if (Mp3FileSignature.SequenceEqual(sig.Take(Mp3FileSignature.Length)) ||
+					(sig[0] == 0xff && (sig[1] & 0xe0) == 0xe0))
 				{
-					var mp3Stream = new Mp3FileStream(fileStream);
-					_waveOut = new WaveOut(mp3Stream, mp3Stream.Format, mp3Stream.Format.BlockSize + 1);
+					// The file is mapped rather than read through the stream, and each buffer holds many frames.
+					fileStream.Dispose();
+					var mp3Stream = new Mp3FileStream(fileName);
+					_stream = mp3Stream;
+					_waveOut = new WaveOut((IWaveSource)mp3Stream, mp3Stream.Format, mp3Stream.GetBufferSize(Mp3BufferLength));
 				}
 				else
 				{
@@ -65,20 +75,16 @@ namespace Floe.Audio
 		public void Dispose()
 		{
 			_waveOut.Dispose();
+			_stream.Dispose();
 		}
 
+		/// <summary>
+		/// Plays a sound through the shared SoundCache, which decodes each file once and keeps one output device open
+		/// for all of them, rather than opening a device for every sound.
+		/// </summary>
 		public static void PlayAsync(string fileName, Action<object> callback = null, object state = null)
 		{
-			var player = new FilePlayer(fileName);
-			player.Done += (sender, e) =>
-				{
-					if (callback != null)
-					{
-						callback(state);
-					}
-					player.Close();
-				};
-			player.Start();
+			SoundCache.Default.Play(fileName, 1f, callback, state);
 		}
 	}
 }
@@ -1,69 +1,62 @@
 ﻿using System;
 using System.IO;
+using System.Runtime.InteropServices;
 
 using Floe.Interop;
 
 namespace Floe.Audio
 {
-	public class Mp3FileStream : Stream
+	/// <summary>
+	/// Reads the frames of an MP3 file, for playback through a WaveOut that decodes them. The frames are found and
+	/// indexed once, when the stream is opened; reads then hand out as many whole frames as fit in the buffer.
+	/// </summary>
+	public class Mp3FileStream : Stream, IWaveSource
 	{
-		private static readonly short[, ,] MpegBitRates = new short[2, 3, 16]
-		{
-			{
-				{ 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },
-				{ 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },
-				{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 }
-			},
-			{
-				{ 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
-				{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
-				{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 }
-			}
-		};
+		private Mp3Reader _reader;
 
-		private static readonly int[,] MpegSampleRates = new int[3, 4]
+		/// <summary>
+		/// Opens a file. The file is mapped into memory rather than read through a stream.
+		/// </summary>
+		public Mp3FileStream(string fileName)
 		{
+			try
 			{
-				44100, 48000, 32000, 0
-			},
-			{
-				22050, 24000, 16000, 0
-			},
+				_reader = new Mp3Reader(fileName);
+			}
+			catch (InteropException ex)
 			{
-				11025, 12000, 8000, 0
+				throw new FileFormatException(ex.Message);
 			}
-		};
-
-		private Stream _stream;
-		private WaveFormatMp3 _format;
-
-		public Mp3FileStream(string fileName)
-			: this(new FileStream(fileName, FileMode.Open, FileAccess.Read, FileShare.Read))
-		{
 		}
 
+		/// <summary>
+		/// Reads the rest of a stream into memory and opens it.
+		/// </summary>
 		public Mp3FileStream(Stream stream)
 		{
-			_stream = stream;
-			var bytes = new byte[10];
-			_stream.Read(bytes, 0, 10);
-			if (bytes[3] != 0x03 || bytes[4] != 0x00) // v2.3.0
+			try
 			{
-				throw new FileFormatException("Unsupported ID3 version.");
+				_reader = new Mp3Reader(stream);
 			}
-			if (bytes[5] != 0x00)
+			catch (InteropException ex)
 			{
-				throw new FileFormatException(string.Format("Unsupported ID3 flags ({0})", bytes[5]));
+				throw new FileFormatException(ex.Message);
 			}
+		}
 
-			_stream.Seek((bytes[6] << 21) | (bytes[7] << 14) | (bytes[8] << 7) | bytes[9], SeekOrigin.Current);
+		public WaveFormatMp3 Format { get { return _reader.Format; } }
 
-			int channels, bitRate, sampleRate;
-			int size = this.ReadFrameHeader(out channels, out sampleRate, out bitRate);
-			_format = new WaveFormatMp3((short)channels, sampleRate, bitRate * 1000);
-		}
+		/// <summary>
+		/// Gets the length of the audio.
+		/// </summary>
+		public TimeSpan Duration { get { return _reader.Duration; } }
+
+		/// <summary>
+		/// Gets or sets the time of the next frame to be read. Setting it seeks straight to the frame that holds the
+		/// given time.
+		/// </summary>
+		public TimeSpan CurrentTime { get { return _reader.Position; } set { _reader.Position = value; } }
 
-		public WaveFormatMp3 Format { get { return _format; } }
 		public override bool CanRead { get { return true; } }
 		public override bool CanSeek { get { return false; } }
 		public override bool CanWrite { get { return false; } }
@@ -74,116 +67,48 @@ namespace Floe.Audio
 		public override void SetLength(long value) { throw new NotImplementedException(); }
 		public override void Write(byte[] buffer, int offset, int count) { throw new NotImplementedException(); }
 
-		public override int Read(byte[] buffer, int offset, int count)
+		/// <summary>
+		/// Gets a buffer size that holds at least the given length of audio in whole frames.
+		/// </summary>
+		/// <param name="milliseconds">The length of audio, in milliseconds.</param>
+		public int GetBufferSize(int milliseconds)
 		{
-			int blockSize = this.ReadFrameHeader();
-			int numRead = _stream.Read(buffer, offset, Math.Min(count, blockSize));
-			if (blockSize > count)
-			{
-				_stream.Seek(blockSize - count, SeekOrigin.Current);
-			}
-			return numRead;
+			return _reader.GetBufferSize(milliseconds);
 		}
 
-		public override void Close()
+		/// <summary>
+		/// Reads as many whole frames as fit. The count must be at least the size of the largest frame in the file, which
+		/// a buffer from GetBufferSize always is.
+		/// </summary>
+		public override int Read(byte[] buffer, int offset, int count)
 		{
-			_stream.Close();
+			if (offset < 0 || count < 0 || offset + count > buffer.Length)
+			{
+				throw new ArgumentOutOfRangeException("count");
+			}
+			var handle = GCHandle.Alloc(buffer, GCHandleType.Pinned);
+			try
+			{
+				return _reader.Read(handle.AddrOfPinnedObject() + offset, count);
+			}
+			finally
+			{
+				handle.Free();
+			}
 		}
 
-		private int ReadFrameHeader()
+		int IWaveSource.Read(IntPtr buffer, int count)
 		{
-			int channels, sampleRate, bitRate;
-			return this.ReadFrameHeader(out channels, out sampleRate, out bitRate);
+			return _reader.Read(buffer, count);
 		}
 
-		private int ReadFrameHeader(out int channels, out int sampleRate, out int bitRate)
+		protected override void Dispose(bool disposing)
 		{
-			channels = 0;
-			sampleRate = 0;
-			bitRate = 0;
-
-			int b;
-			while (true)
+			if (disposing)
 			{
-				if ((b = _stream.ReadByte()) == -1)
-				{
-					return 0;
-				}
-				else if (b != 0xff)
-				{
-					continue;
-				}
-
-				if ((b = _stream.ReadByte()) == -1)
-				{
-					return 0;
-				}
-				if ((b & 0xe0) != 0xe0)
-				{
-					continue;
-				}
-
-				int version = (b & 0x18) >> 3;
-				if (version == 1)
-				{
-					continue;
-				}
-				switch (version)
-				{
-					case 0:
-						version = 2;
-						break;
-					case 2:
-						version = 1;
-						break;
-					case 3:
-						version = 0;
-						break;
-				}
-				int layer = (b & 0x6) >> 1;
-				if (layer == 0)
-				{
-					continue;
-				}
-				switch (layer)
-				{
-					case 1:
-						layer = 2;
-						break;
-					case 2:
-						layer = 1;
-						break;
-					case 3:
-						layer = 0;
-						break;
-				}
-
-				if ((b = _stream.ReadByte()) == -1)
-				{
-					return 0;
-				}
-				bitRate = MpegBitRates[version > 0 ? 1 : 0, layer, (b >> 4)];
-				if (bitRate == 0)
-				{
-					continue;
-				}
-
-				sampleRate = MpegSampleRates[version, (b & 0xc) >> 2];
-				if (sampleRate == 0)
-				{
-					continue;
-				}
-				int padding = (b & 0x2) > 0 ? 1 : 0;
-
-				if ((b = _stream.ReadByte()) == -1)
-				{
-					return 0;
-				}
-				channels = ((b & 0xc0) >> 6) == 3 ? 1 : 2;
-
-				_stream.Seek(-4, SeekOrigin.Current);
-				return 144 * bitRate * 1000 / sampleRate + padding;
+				_reader.Dispose();
 			}
+			base.Dispose(disposing);
 		}
 	}
 }
@@ -1,5 +1,6 @@
 ﻿using System;
 using System.Reflection;
+using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
 
 [assembly: AssemblyTitle("Floe.Audio")]
@@ -18,3 +19,6 @@ using System.Runtime.InteropServices;
 [assembly: AssemblyVersion("1.6.0.0")]
 [assembly: AssemblyFileVersion("1.6.0.0")]
 [assembly: CLSCompliant(true)]
+
+// The test harnesses drive JitterBuffer and the other internal parts of a voice session directly.
+[assembly: InternalsVisibleTo("test, PublicKey=00240000048000009400000006020000002400005253413100040000010001002df70db90e46da06a8199a1e235ea4a0155cb8ca4d0a1f304bfb30785c9904073fc4757ef549a957d490d0d0a0b54d410a608c3f5975e13afa8d13af80665a09eaf8c20d41a26d1d48df1a162edad49f66bbdfcce701ccdf51d13a3699682ab35434c043a1776e9383a0048c7c37c925ea134268ca7281475873f23a7dc8228c")]
@@ -0,0 +1,389 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+using Floe.Interop;
+
+namespace Floe.Audio
+{
+	/// <summary>
+	/// Plays short sounds, such as notifications, from files that are decoded once and kept in memory. All sounds play
+	/// through one output device, mixed together, which stays open while sounds are being played and is closed after
+	/// a while without any. Playing a sound that is already loaded only queues it for the next output buffer.
+	/// </summary>
+	public sealed class SoundCache : IDisposable
+	{
+		private const int SampleRate = 44100;
+		private const int Channels = 2;
+		private const int DefaultMaxBytes = 16 * 1024 * 1024; // about 95 seconds
+		private const int BufferLength = 20; // milliseconds
+		private const int BufferCount = 3;
+		private const int IdleTimeout = 30000; // milliseconds
+		private const int DecodeBlockSize = 65536;
+		private static readonly byte[] WavFileSignature = { 0x52, 0x49, 0x46, 0x46 }; // RIFF
+		private static readonly byte[] Mp3FileSignature = { 0x49, 0x44, 0x33 }; // ID3
+		private static readonly object _defaultSync = new object();
+		private static SoundCache _default;
+
+		private object _sync;
+		private SoundMixer _mixer;
+		private WaveFormat _format;
+		private WaveOut _waveOut;
+		private Dictionary<string, int> _sounds;
+		private Dictionary<long, Tuple<Action<object>, object>> _callbacks;
+		private Timer _idleTimer;
+		private int _lastPlay;
+		private bool _isDisposed;
+
+		/// <summary>
+		/// Construct a new sound cache.
+		/// </summary>
+		/// <param name="maxBytes">The most memory that decoded sounds may take up. When a new sound does not fit, the
+		/// sounds played least recently are dropped, and decoded again if they are played later.</param>
+		public SoundCache(int maxBytes = DefaultMaxBytes)
+		{
+			_sync = new object();
+			_format = new WaveFormatPcm(SampleRate, 16, Channels);
+			_mixer = new SoundMixer(Channels, maxBytes, this.BufferSize);
+			_mixer.Finished += new EventHandler<SoundEventArgs>(this.OnFinished);
+			_sounds = new Dictionary<string, int>(StringComparer.OrdinalIgnoreCase);
+			_callbacks = new Dictionary<long, Tuple<Action<object>, object>>();
+			_idleTimer = new Timer(this.OnIdleTimer);
+		}
+
+		/// <summary>
+		/// Gets the cache shared by FilePlayer.PlayAsync.
+		/// </summary>
+		public static SoundCache Default
+		{
+			get
+			{
+				lock (_defaultSync)
+				{
+					if (_default == null)
+					{
+						_default = new SoundCache();
+					}
+					return _default;
+				}
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of sounds in memory.
+		/// </summary>
+		public int Count { get { return _mixer.Count; } }
+
+		/// <summary>
+		/// Gets the memory taken up by the sounds, in bytes.
+		/// </summary>
+		public long Bytes { get { return _mixer.Bytes; } }
+
+		/// <summary>
+		/// Gets the number of sounds that were dropped to make room for others.
+		/// </summary>
+		public int Evictions { get { return _mixer.Evictions; } }
+
+		/// <summary>
+		/// Gets the time from the last call to Play until its first sample was mixed into an output buffer, in
+		/// milliseconds. The buffers already queued on the device add up to another 40 ms before it is heard.
+		/// </summary>
+		public float LastLatency { get { return _mixer.LastLatency; } }
+
+		/// <summary>
+		/// Gets the longest time from a call to Play until its first sample was mixed into an output buffer, in
+		/// milliseconds.
+		/// </summary>
+		public float MaxLatency { get { return _mixer.MaxLatency; } }
+
+		private int BufferSize { get { return SampleRate * BufferLength / 1000 * _format.FrameSize; } }
+
+		/// <summary>
+		/// Decodes a file into memory ahead of time, so that the first time it is played is as quick as any other.
+		/// </summary>
+		/// <param name="fileName">The path to a WAV or MP3 file.</param>
+		public void Load(string fileName)
+		{
+			lock (_sync)
+			{
+				this.GetSound(fileName);
+			}
+		}
+
+		/// <summary>
+		/// Plays a sound, decoding the file first if it is not in memory. Any number of sounds may play at once.
+		/// </summary>
+		/// <param name="fileName">The path to a WAV or MP3 file.</param>
+		/// <param name="gain">The linear gain to play the sound at.</param>
+		/// <param name="callback">An optional callback to invoke on a thread pool thread when the sound has played.</param>
+		/// <param name="state">The state to pass to the callback.</param>
+		public void Play(string fileName, float gain = 1f, Action<object> callback = null, object state = null)
+		{
+			lock (_sync)
+			{
+				if (_isDisposed)
+				{
+					throw new ObjectDisposedException("SoundCache");
+				}
+
+				// The sound may have been dropped since it was last played, in which case it is decoded again.
+				long token;
+				lock (_callbacks)
+				{
+					token = _mixer.Play(this.GetSound(fileName), gain);
+					if (token == 0)
+					{
+						_sounds.Remove(fileName);
+						token = _mixer.Play(this.GetSound(fileName), gain);
+					}
+					if (token != 0 && callback != null)
+					{
+						_callbacks.Add(token, Tuple.Create(callback, state));
+					}
+				}
+				if (token == 0)
+				{
+					throw new InvalidOperationException("The sound does not fit in the cache.");
+				}
+
+				_lastPlay = Environment.TickCount;
+				if (_waveOut == null)
+				{
+					_waveOut = new WaveOut(_mixer, _format, this.BufferSize, BufferCount);
+					_waveOut.Start();
+					_idleTimer.Change(IdleTimeout, IdleTimeout);
+				}
+			}
+		}
+
+		public void Dispose()
+		{
+			lock (_sync)
+			{
+				if (_isDisposed)
+				{
+					return;
+				}
+				_isDisposed = true;
+				_idleTimer.Dispose();
+				this.CloseDevice();
+				_mixer.Dispose();
+			}
+		}
+
+		private int GetSound(string fileName)
+		{
+			int id;
+			if (_sounds.TryGetValue(fileName, out id) && _mixer.Contains(id))
+			{
+				return id;
+			}
+
+			var samples = Decode(fileName);
+			id = _mixer.Add(samples, samples.Length);
+			if (id == 0)
+			{
+				throw new InvalidOperationException("The sound does not fit in the cache.");
+			}
+			_sounds[fileName] = id;
+			return id;
+		}
+
+		private void OnFinished(object sender, SoundEventArgs e)
+		{
+			Tuple<Action<object>, object> callback;
+			lock (_callbacks)
+			{
+				if (!_callbacks.TryGetValue(e.Token, out callback))
+				{
+					return;
+				}
+				_callbacks.Remove(e.Token);
+			}
+			ThreadPool.QueueUserWorkItem((state) => callback.Item1(callback.Item2));
+		}
+
+		private void OnIdleTimer(object state)
+		{
+			lock (_sync)
+			{
+				if (_waveOut != null && _mixer.Active == 0 && Environment.TickCount - _lastPlay > IdleTimeout)
+				{
+					this.CloseDevice();
+				}
+			}
+		}
+
+		private void CloseDevice()
+		{
+			if (_waveOut != null)
+			{
+				_waveOut.Dispose();
+				_waveOut = null;
+			}
+			_idleTimer.Change(Timeout.Infinite, Timeout.Infinite);
+		}
+
+		private static byte[] Decode(string fileName)
+		{
+			var sig = new byte[4];
+			using (var fileStream = new FileStream(fileName, FileMode.Open, FileAccess.Read, FileShare.Read))
+			{
+				fileStream.Read(sig, 0, sig.Length);
+			}
+			if (WavFileSignature.SequenceEqual(sig.Take(WavFileSignature.Length)))
+			{
+				// WAV files of any sample format are converted to the output format natively as they are read.
+				using (var wavStream = new WavFileStream(fileName))
+				{
+					wavStream.SetOutputFormat(SampleRate, Channels, ResamplerQuality.High);
+					return ReadAll(wavStream);
+				}
+			}
+			if (Mp3FileSignature.SequenceEqual(sig.Take(Mp3FileSignature.Length)) || (sig[0] == 0xff && (sig[1] & 0xe0) == 0xe0))
+			{
+				using (var mp3Stream = new Mp3FileStream(fileName))
+				{
+					var format = mp3Stream.Format;
+					var data = DecodeMp3(mp3Stream);
+					return Resample(ToPcm16(data), format.Channels, format.SampleRate);
+				}
+			}
+			throw new FileFormatException("Unrecognized file format.");
+		}
+
+		private static byte[] ReadAll(Stream stream)
+		{
+			var output = new MemoryStream();
+			var block = new byte[DecodeBlockSize];
+			int count;
+			while ((count = stream.Read(block, 0, block.Length)) > 0)
+			{
+				output.Write(block, 0, count);
+			}
+			return output.ToArray();
+		}
+
+		private static byte[] DecodeMp3(Mp3FileStream mp3Stream)
+		{
+			// The wave mapper decodes MP3 for playback, so the same ACM decoder is used here, many frames at a time.
+			var format = mp3Stream.Format;
+			int srcSize = mp3Stream.GetBufferSize(250);
+			var output = new MemoryStream();
+			var src = Marshal.AllocHGlobal(srcSize);
+			try
+			{
+				using (var converter = new AudioConverter(srcSize, format, new WaveFormatPcm(format.SampleRate, 16, format.Channels)))
+				{
+					var dst = new byte[converter.DestBufferSize];
+					int count;
+					while ((count = ((IWaveSource)mp3Stream).Read(src, srcSize)) > 0)
+					{
+						IntPtr converted;
+						int size = converter.Convert(src, count, out converted);
+						if (size > dst.Length)
+						{
+							dst = new byte[size];
+						}
+						Marshal.Copy(converted, dst, 0, size);
+						output.Write(dst, 0, size);
+					}
+				}
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(src);
+			}
+			return output.ToArray();
+		}
+
+		private static short[] ToPcm16(byte[] data)
+		{
+			var samples = new short[data.Length / 2];
+			Buffer.BlockCopy(data, 0, samples, 0, samples.Length * 2);
+			return samples;
+		}
+
+		private static byte[] Resample(short[] samples, int channels, int sampleRate)
+		{
+			// Each output channel is converted on its own; mono is played on both, and channels past the second are
+			// left out.
+			int frames = samples.Length / channels;
+			byte[][] outputs = new byte[Channels][];
+			for (int c = 0; c < Channels; c++)
+			{
+				var input = new byte[frames * 2];
+				int source = Math.Min(c, channels - 1);
+				for (int i = 0; i < frames; i++)
+				{
+					short sample = samples[i * channels + source];
+					input[i * 2] = (byte)sample;
+					input[i * 2 + 1] = (byte)(sample >> 8);
+				}
+				outputs[c] = sampleRate == SampleRate ? input : ConvertRate(input, sampleRate);
+			}
+
+			int length = outputs.Min((o) => o.Length) / 2;
+			var output = new byte[length * Channels * 2];
+			for (int i = 0; i < length; i++)
+			{
+				for (int c = 0; c < Channels; c++)
+				{
+					output[(i * Channels + c) * 2] = outputs[c][i * 2];
+					output[(i * Channels + c) * 2 + 1] = outputs[c][i * 2 + 1];
+				}
+			}
+			return output;
+		}
+
+		private static byte[] ConvertRate(byte[] input, int sampleRate)
+		{
+			int blockSize = DecodeBlockSize;
+			using (var converter = new SampleRateConverter(sampleRate, SampleRate, ResamplerQuality.High, blockSize))
+			{
+				// The output lines up with the input, but the filter needs input from past the end of the sound to make
+				// its last samples, so silence is fed in after it and the output is then cut to the sound's length.
+				int flush = ((int)((long)converter.Delay * sampleRate / SampleRate) + 2) * 2;
+				var src = Marshal.AllocHGlobal(blockSize);
+				int dstSize = converter.GetMaxDestSize(blockSize);
+				var dst = Marshal.AllocHGlobal(dstSize);
+				var block = new byte[dstSize];
+				var output = new MemoryStream();
+				try
+				{
+					int total = input.Length + flush;
+					for (int offset = 0; offset < total; offset += blockSize)
+					{
+						int count = Math.Min(blockSize, total - offset);
+						int copied = Math.Max(0, Math.Min(count, input.Length - offset));
+						if (copied > 0)
+						{
+							Marshal.Copy(input, offset, src, copied);
+						}
+						for (int i = copied; i < count; i++)
+						{
+							Marshal.WriteByte(src, i, 0);
+						}
+						int size = converter.Convert(src, count, dst, dstSize);
+						Marshal.Copy(dst, block, 0, size);
+						output.Write(block, 0, size);
+					}
+				}
+				finally
+				{
+					Marshal.FreeHGlobal(src);
+					Marshal.FreeHGlobal(dst);
+				}
+
+				var converted = output.ToArray();
+				int length = (int)((long)input.Length / 2 * SampleRate / sampleRate) * 2;
+				var trimmed = new byte[Math.Min(length, converted.Length)];
+				Array.Copy(converted, trimmed, trimmed.Length);
+				return trimmed;
+			}
+		}
+	}
+}
@@ -7,33 +7,61 @@ using Floe.Interop;
 namespace Floe.Audio
 {
 	/// <summary>
-	/// Specifies a codec to use for transmitting voice. Currently, only GSM 6.10 is supported.
+	/// Specifies a codec to use for transmitting voice.
 	/// </summary>
 	public enum VoiceCodec
 	{
 		/// <summary>
 		/// Use the GSM 6.10 codec.
 		/// </summary>
-		Gsm610
+		Gsm610,
+
+		/// <summary>
+		/// Use the Opus codec, with variable bit rate, forward error correction and discontinuous transmission. The
+		/// quality must be one of the sample rates 8000, 12000, 16000, 24000 or 48000. Only available when Floe.Interop
+		/// is built with Opus support.
+		/// </summary>
+		Opus
 	}
 
 	public class CodecInfo
 	{
+		internal const int ComfortNoisePayloadType = 13; // RFC 3389
 		private const int Gsm610PayloadType = 3;
-		private const int Gsm610SamplesPerBlock = 320;
-		private const int Gsm610BytesPerBlock = 65;
+		private const int OpusPayloadType = 111;
+		private const int OpusFramesPerSecond = 50;
+		private const int OpusMaxPayloadSize = 512;
+		private const int OpusExpectedPacketLoss = 10; // percent
 		private const int MinBufferLength = 25; // milliseconds
+		private const int MinDeviceLength = 60; // milliseconds
+		private const int DefaultCaptureRate = 48000;
+		private static readonly int[] DeviceSampleRates = { 8000, 11025, 16000, 22050, 32000, 44100, 48000 };
 
+		public VoiceCodec Codec { get; private set; }
 		public int PayloadType { get; private set; }
 		public int EncodedBufferSize { get; private set; }
 		public int DecodedBufferSize { get; private set; }
 		public int SampleRate { get; private set; }
 		public int SamplesPerPacket { get; private set; }
+
+		/// <summary>
+		/// Gets the rate at which audio is recorded. This is the codec's sample rate when sound devices commonly support
+		/// it natively; otherwise audio is recorded at 48 kHz and converted once, rather than leaving the conversion to
+		/// the wave mapper.
+		/// </summary>
+		public int CaptureRate { get; private set; }
 		public WaveFormat EncodedFormat { get; private set; }
 		public WaveFormat DecodedFormat { get; private set; }
 
+		/// <summary>
+		/// Gets the number of packet-sized buffers to queue at a sound device, enough to hold 60 ms of audio, so that a
+		/// playback or capture thread that is held up for a moment does not leave the device without a buffer.
+		/// </summary>
+		public int DeviceBufferCount { get; private set; }
+
 		public CodecInfo(VoiceCodec codec, int sampleRate)
 		{
+			this.Codec = codec;
 			switch (codec)
 			{
 				case VoiceCodec.Gsm610:
@@ -41,30 +69,83 @@ namespace Floe.Audio
 					this.SampleRate = sampleRate;
 
 					int blocksPerPacket = 1;
-					while ((blocksPerPacket * Gsm610SamplesPerBlock * 1000) / sampleRate <= MinBufferLength)
+					while ((blocksPerPacket * Gsm610Codec.SamplesPerBlock * 1000) / sampleRate <= MinBufferLength)
 					{
 						blocksPerPacket++;
 					}
 
-					this.SamplesPerPacket = Gsm610SamplesPerBlock * blocksPerPacket;
-					this.EncodedBufferSize = Gsm610BytesPerBlock * blocksPerPacket;
+					this.SamplesPerPacket = Gsm610Codec.SamplesPerBlock * blocksPerPacket;
+					this.EncodedBufferSize = Gsm610Codec.BytesPerBlock * blocksPerPacket;
 					this.DecodedBufferSize = this.SamplesPerPacket * 2;
 					this.EncodedFormat = new WaveFormatGsm610(sampleRate);
 					this.DecodedFormat = new WaveFormatPcm(sampleRate, 16, 1);
 					break;
+				case VoiceCodec.Opus:
+					if (!OpusCodec.IsAvailable)
+					{
+						throw new ArgumentException("Opus is not supported by this build.");
+					}
+					if (sampleRate != 8000 && sampleRate != 12000 && sampleRate != 16000 && sampleRate != 24000 && sampleRate != 48000)
+					{
+						throw new ArgumentException("Unsupported sample rate for Opus.");
+					}
+					this.PayloadType = OpusPayloadType;
+					this.SampleRate = sampleRate;
+
+					// Opus packets vary in size, so the encoded buffer size is only an upper bound.
+					this.SamplesPerPacket = sampleRate / OpusFramesPerSecond;
+					this.EncodedBufferSize = OpusMaxPayloadSize;
+					this.DecodedBufferSize = this.SamplesPerPacket * 2;
+					this.DecodedFormat = new WaveFormatPcm(sampleRate, 16, 1);
+					break;
 				default:
 					throw new ArgumentException("Unsupported codec.");
 			}
+			this.CaptureRate = Array.IndexOf(DeviceSampleRates, this.SampleRate) >= 0 ? this.SampleRate : DefaultCaptureRate;
+			int packetsPerDevice = (int)(((long)MinDeviceLength * this.SampleRate + this.SamplesPerPacket * 1000L - 1) /
+				(this.SamplesPerPacket * 1000L));
+			this.DeviceBufferCount = Math.Max(2, packetsPerDevice);
+		}
+
+		/// <summary>
+		/// Creates a codec instance, which encodes and decodes without going through ACM.
+		/// </summary>
+		public IAudioCodec GetCodec()
+		{
+			switch (this.Codec)
+			{
+				case VoiceCodec.Opus:
+					var opus = new OpusCodec(this.SampleRate, this.SamplesPerPacket);
+					opus.BitRate = GetOpusBitRate(this.SampleRate);
+					opus.ForwardErrorCorrection = true;
+					opus.ExpectedPacketLoss = OpusExpectedPacketLoss;
+					opus.DiscontinuousTransmission = true;
+					return opus;
+				default:
+					return new Gsm610Codec();
+			}
 		}
 
+		/// <summary>
+		/// Creates an ACM encoder. This is only supported for GSM 6.10.
+		/// </summary>
 		public AudioConverter GetEncoder()
 		{
 			return new AudioConverter(this.DecodedBufferSize, this.DecodedFormat, this.EncodedFormat);
 		}
 
+		/// <summary>
+		/// Creates an ACM decoder. This is only supported for GSM 6.10.
+		/// </summary>
 		public AudioConverter GetDecoder()
 		{
 			return new AudioConverter(this.EncodedBufferSize, this.EncodedFormat, this.DecodedFormat);
 		}
+
+		private static int GetOpusBitRate(int sampleRate)
+		{
+			// Enough for transparent speech at each bandwidth; the in-band FEC takes its share out of this.
+			return sampleRate <= 8000 ? 12000 : sampleRate <= 16000 ? 20000 : 28000;
+		}
 	}
 }
@@ -1,175 +1,185 @@
 ﻿using System;
-using System.Collections.Concurrent;
-using System.Collections.Generic;
-using System.IO;
 using System.Threading;
 
 using Floe.Interop;
 
 namespace Floe.Audio
 {
-	class JitterBuffer : Stream
+	class JitterBuffer : IWaveSource, IDisposable
 	{
-		private const int MaxBufferSize = 200;
-		private const int Delay = 2; // number of spans
-
-		private AudioConverter _decoder;
-		private ConcurrentQueue<VoicePacket> _incoming;
-		private LinkedList<VoicePacket> _buffer;
-		private int _timestamp, _span, _lostCount, _delay;
-		private bool _reset;
+		private const int Capacity = 256;
+		private const int FixedDelay = 2; // number of spans
+		private const int ComfortNoiseHold = 25; // packets
+
+		private IAudioCodec _decoder;
+		private JitterRing _ring;
+		private LossConcealer _concealer;
+		private DriftCorrector _corrector;
+		private int _packetSize;
+		private volatile bool _driftCompensation;
+		private bool _correcting;
+		private int _recovered;
+		private int _noiseLevel = -1, _noiseLeft;
 
 		public JitterBuffer(CodecInfo codec)
 		{
-			_span = codec.SamplesPerPacket;
-			_decoder = codec.GetDecoder();
-			_incoming = new ConcurrentQueue<VoicePacket>();
-			_buffer = new LinkedList<VoicePacket>();
-
-			this.Reset();
+			_decoder = codec.GetCodec();
+			_ring = new JitterRing(codec.SamplesPerPacket, codec.SampleRate, codec.EncodedBufferSize, Capacity, FixedDelay);
+			_concealer = new LossConcealer(codec.SampleRate);
+			_packetSize = codec.DecodedBufferSize;
+			_corrector = new DriftCorrector(_packetSize);
 		}
 
-		public float Gain { get; set; }
+		/// <summary>
+		/// Gets or sets a value indicating whether the playout delay adapts to the measured network jitter.
+		/// </summary>
+		public bool Adaptive { get { return _ring.Adaptive; } set { _ring.Adaptive = value; } }
+
+		/// <summary>
+		/// Gets or sets a value indicating whether playback is resampled to follow the sender's clock, so that drift between
+		/// it and the local device neither builds up delay nor runs the buffer dry.
+		/// </summary>
+		public bool DriftCompensation { get { return _driftCompensation; } set { _driftCompensation = value; } }
+
+		public float Jitter { get { return _ring.Jitter; } }
+		public float Delay { get { return _ring.Delay; } }
+		public int LatePackets { get { return _ring.LatePackets; } }
+		public int Underruns { get { return _ring.Underruns; } }
+		public int Resets { get { return _ring.Resets; } }
+		public int RecoveredPackets { get { return _recovered; } }
+		public int ConcealedPackets { get { return _concealer.ConcealedFrames; } }
+		public float Drift { get { return _ring.Drift; } }
+		public int Count { get { return _ring.Count; } }
+
+		/// <summary>
+		/// Adds a received packet to the buffer, copying it straight out of the receive buffer. This must only be called from
+		/// a single (network) thread.
+		/// </summary>
+		public void Enqueue(int timeStamp, byte[] payload, int offset, int count)
+		{
+			_ring.Insert(timeStamp, payload, offset, count);
+		}
 
-		public void Enqueue(VoicePacket packet)
+		/// <summary>
+		/// Sets the level of the peer's background noise from a comfort noise packet, in -dBov. Gaps are filled with noise
+		/// of this level for a while, until the next such packet. This must only be called from a single (network) thread.
+		/// </summary>
+		public void SetComfortNoise(int level)
 		{
-			_incoming.Enqueue(packet);
+			Interlocked.Exchange(ref _noiseLevel, level);
 		}
 
-		public VoicePacket Dequeue()
+		/// <summary>
+		/// Replaces the performance counter with a simulated clock, in seconds. See JitterRing.SetClock.
+		/// </summary>
+		public void SetClock(double seconds)
 		{
-			VoicePacket packet;
-			while (_incoming.TryDequeue(out packet))
-			{
-				this.Insert(packet);
-			}
+			_ring.SetClock(seconds);
+		}
 
-			return this.GetPacket();
+		/// <summary>
+		/// Discards all buffered packets. This must only be called from the playback thread.
+		/// </summary>
+		public void Reset()
+		{
+			_ring.Reset();
+			_concealer.Reset();
+			_corrector.Reset();
 		}
 
-		private void Insert(VoicePacket packet)
+		/// <summary>
+		/// Decodes the next packet directly into the playback buffer, or conceals its loss. This must only be called from the
+		/// playback thread.
+		/// </summary>
+		/// <returns>Returns the number of bytes written, or zero if there is nothing to play.</returns>
+		public int Read(IntPtr buffer, int count)
 		{
-			if (!_reset)
+			_ring.AdvanceClock(count / 2);
+			bool correct = _driftCompensation;
+			if (correct != _correcting)
 			{
-				var node = _buffer.First;
-				while (node != null)
-				{
-					if (packet.TimeStamp + _span <= _timestamp)
-					{
-						node.Value.Dispose();
-						_buffer.RemoveFirst();
-					}
-					node = node.Next;
-				}
+				_corrector.Reset();
+				_correcting = correct;
 			}
-
-			if (_lostCount > 20)
+			if (!correct || count > _packetSize)
 			{
-				this.Reset();
+				return this.ReadPacket(buffer, count);
 			}
 
-			if (_reset || packet.TimeStamp + _span >= _timestamp)
+			// Packets are decoded into the corrector for as long as it needs more to fill the buffer, which is usually
+			// once per buffer, and now and then twice or not at all.
+			_corrector.Drift = _ring.Drift;
+			while (_corrector.Needed(count) > 0)
 			{
-				if (_buffer.Count == MaxBufferSize)
-				{
-					_buffer.First.Value.Dispose();
-					_buffer.RemoveFirst();
-				}
-				var node = _buffer.First;
-				while (node != null && node.Value.TimeStamp <= packet.TimeStamp)
-				{
-					node = node.Next;
-				}
-				if (node == null)
+				int size = this.ReadPacket(_corrector.AcquireWrite(_packetSize), _packetSize);
+				_corrector.CommitWrite(size);
+				if (size == 0)
 				{
-					_buffer.AddLast(packet);
-				}
-				else
-				{
-					_buffer.AddBefore(node, packet);
+					break;
 				}
 			}
+			return _corrector.Read(buffer, count);
 		}
 
-		private VoicePacket GetPacket()
+		private int ReadPacket(IntPtr buffer, int count)
 		{
-			if (_reset)
+			int level = Interlocked.Exchange(ref _noiseLevel, -1);
+			if (level >= 0)
 			{
-				var oldest = _buffer.First;
-				if (oldest == null)
-				{
-					return null;
-				}
-				else
-				{
-					_reset = false;
-					_timestamp = oldest.Value.TimeStamp;
-				}
+				_concealer.SetComfortNoise((float)Math.Pow(10, -level / 20.0));
+				_noiseLeft = ComfortNoiseHold;
 			}
-
-			if (_buffer.Count > 0 && _delay > 0)
+			else if (_noiseLeft > 0 && --_noiseLeft == 0)
 			{
-				_delay--;
-				return null;
+				_concealer.SetComfortNoise(0f);
 			}
 
-			var node = _buffer.First;
-			if (node != null && node.Value.TimeStamp > _timestamp + _span)
+			int size;
+			bool recovery;
+			var data = _ring.Acquire(out size, out recovery);
+			if (data != IntPtr.Zero)
 			{
-				node = null;
-			}
+				try
+				{
+					if (recovery)
+					{
+						// The packet is missing; the next one is on loan so its redundant data can fill the gap.
+						size = _decoder.Recover(data, size, buffer, count);
+						if (size > 0)
+						{
+							_recovered++;
+						}
+					}
+					else
+					{
+						size = _decoder.Decode(data, size, buffer, count);
+					}
+				}
+				finally
+				{
+					_ring.Release();
+				}
 
-			if (node != null)
-			{
-				_lostCount = 0;
-				var packet = node.Value;
-				_buffer.Remove(node);
-				_timestamp = node.Value.TimeStamp + _span;
-				return packet;
+				if (size > 0)
+				{
+					_concealer.Update(buffer, size);
+					return size;
+				}
 			}
 
-			_lostCount++;
-			_timestamp += _span;
-			return null;
+			// Extend the signal over the gap. This fades to silence within a few packets, after which nothing is played.
+			return _concealer.Conceal(buffer, count);
 		}
 
-		public void Reset()
+		/// <summary>
+		/// Frees the buffered packets and the decoder. The buffer must no longer be read or written to.
+		/// </summary>
+		public void Dispose()
 		{
-			while (_buffer.Count > 0)
-			{
-				var packet = _buffer.First.Value;
-				packet.Dispose();
-				_buffer.RemoveFirst();
-			}
-			_lostCount = 0;
-			_reset = true;
-			_delay = Delay;
-		}
-
-		public override bool CanRead { get { return true; } }
-		public override bool CanSeek { get { return false; } }
-		public override bool CanWrite { get { return false; } }
-		public override void Flush() { throw new NotImplementedException(); }
-		public override long Length { get { throw new NotImplementedException(); } }
-		public override long Position { get { throw new NotImplementedException(); } set { throw new NotImplementedException(); } }
-		public override long Seek(long offset, SeekOrigin origin) { throw new NotImplementedException(); }
-		public override void SetLength(long value) { throw new NotImplementedException(); }
-		public override void Write(byte[] buffer, int offset, int count) { throw new NotImplementedException(); }
-
-		public override int Read(byte[] buffer, int offset, int count)
-		{
-			Array.Clear(buffer, 0, count);
-
-			var packet = this.Dequeue();
-			if (packet != null)
-			{
-				count = _decoder.Convert(packet.Data, packet.Data.Length, buffer);
-				packet.Dispose();
-				float gain = this.Gain != 0f ? (float)Math.Pow(10, this.Gain / 20f) : 1f;
-				WavProcess.ApplyGain(gain, buffer, count);
-			}
-
-			return count;
+			_ring.Dispose();
+			((IDisposable)_decoder).Dispose();
+			_concealer.Dispose();
+			_corrector.Dispose();
 		}
 	}
 }
@@ -0,0 +1,68 @@
+﻿using System;
+
+namespace Floe.Audio
+{
+	/// <summary>
+	/// A snapshot of the counters for the microphone capture path, which records, encodes and sends each frame.
+	/// </summary>
+	public class VoiceCaptureStatistics
+	{
+		/// <summary>
+		/// Gets the number of frames captured from the microphone.
+		/// </summary>
+		public long Frames { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of frames that were encoded. Frames that voice activity detection classed as silence are not.
+		/// </summary>
+		public long EncodedFrames { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of comfort noise packets sent in place of silent frames.
+		/// </summary>
+		public long ComfortNoisePackets { get; internal set; }
+
+		/// <summary>
+		/// Gets how much quieter the echo of the peers is after echo cancellation, in decibels. This is zero when echo
+		/// cancellation is off.
+		/// </summary>
+		public float EchoReturnLossEnhancement { get; internal set; }
+
+		/// <summary>
+		/// Gets the estimated delay from playing audio to hearing its echo in the microphone, in milliseconds.
+		/// </summary>
+		public float EchoDelay { get; internal set; }
+
+		/// <summary>
+		/// Gets the level of the background noise in the microphone, in decibels relative to full scale. This is the noise
+		/// suppressor's estimate when noise suppression is on, and otherwise that of voice activity detection.
+		/// </summary>
+		public float NoiseLevel { get; internal set; }
+
+		/// <summary>
+		/// Gets the gain applied to the microphone, in decibels. This is set by automatic gain control when it is on, and
+		/// is otherwise the input gain.
+		/// </summary>
+		public float InputGain { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of packets sent to the peers.
+		/// </summary>
+		public long PacketsSent { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of packets dropped because the send thread could not keep up.
+		/// </summary>
+		public long PacketsDropped { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of bytes copied between buffers while recording, encoding and sending frames.
+		/// </summary>
+		public long BytesCopied { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of objects allocated while sending frames.
+		/// </summary>
+		public long Allocations { get; internal set; }
+	}
+}
@@ -1,5 +1,6 @@
 ﻿using System;
 using System.Collections.Generic;
+using System.IO;
 using System.Net;
 using System.Net.Sockets;
 
@@ -10,18 +11,30 @@ namespace Floe.Audio
 {
 	/// <summary>
 	/// Manages a voice session connecting to one or more peers. Recorded audio is encoded and sent to all peers, and received audio is played.
-	/// This class uses GSM 6.10 to compress the audio stream.
+	/// The audio stream is compressed with the codec given to the constructor; each peer may use a different one.
 	/// </summary>
 	public sealed class VoiceClient : RtpClient, IDisposable
 	{
 		private const long DummyIPAddress = 0x03030303;
 		private const int DummyPort = 3333;
+		private const int MaxBlockSize = 128; // samples
+		private const int MinBlockSize = 32;
+		private const int EchoTailLength = 150; // milliseconds
 
+		private CodecInfo _codec;
 		private VoiceIn _voiceIn;
 		private Dictionary<IPEndPoint, VoicePeer> _peers;
+		private Dictionary<long, VoiceOut> _outputs;
 		private float _outputVolume = 1f, _outputGain = 0f;
-		private VoicePacketPool _pool;
+		private bool _adaptiveDelay;
+		private bool _driftCompensation = true;
 		private ReceivePredicate _receivePredicate;
+		private AcousticEchoCanceller _echoCanceller;
+		private bool _echoCancellation;
+		private NoiseSuppressor _noiseSuppressor;
+		private bool _noiseSuppression;
+		private AutomaticGainControl _gainControl;
+		private bool _automaticGainControl;
 
 		/// <summary>
 		/// Construct a new voice session.
@@ -33,10 +46,11 @@ namespace Floe.Audio
 		/// use logic such as PTT (push-to-talk) or an automatic peak level-based approach. By default, all packets are transmitted.</param>
 		public VoiceClient(CodecInfo codec, UdpClient client = null,
 			TransmitPredicate transmitPredicate = null, ReceivePredicate receivePredicate = null)
-			: base((byte)codec.PayloadType, codec.EncodedBufferSize, new IPEndPoint(new IPAddress(DummyIPAddress), DummyPort), client)
+			: base((byte)codec.PayloadType, codec.EncodedBufferSize, codec.SampleRate, new IPEndPoint(new IPAddress(DummyIPAddress), DummyPort), client)
 		{
+			_codec = codec;
 			_peers = new Dictionary<IPEndPoint, VoicePeer>();
-			_pool = new VoicePacketPool();
+			_outputs = new Dictionary<long, VoiceOut>();
 			_receivePredicate = receivePredicate;
 			_voiceIn = new VoiceIn(codec, this, transmitPredicate);
 		}
@@ -80,10 +94,165 @@ namespace Floe.Audio
 		}
 
 		/// <summary>
-		/// Gets or sets the amount of gain (in decibels) to apply to the microphone input.
+		/// Gets or sets a value indicating whether each peer's playout delay adapts to the measured network jitter.
+		/// When false, a fixed delay is used.
+		/// </summary>
+		public bool AdaptiveDelay
+		{
+			get { return _adaptiveDelay; }
+			set
+			{
+				if (_adaptiveDelay != value)
+				{
+					_adaptiveDelay = value;
+					foreach (var peer in _peers.Values)
+					{
+						peer.AdaptiveDelay = value;
+					}
+				}
+			}
+		}
+
+		/// <summary>
+		/// Gets or sets a value indicating whether each peer's playback is resampled by a few parts per million to follow
+		/// the peer's clock, which never runs at quite the same rate as the local output device. Without it, a long
+		/// session slowly builds up delay or runs short of audio. This is on by default.
+		/// </summary>
+		public bool DriftCompensation
+		{
+			get { return _driftCompensation; }
+			set
+			{
+				if (_driftCompensation != value)
+				{
+					_driftCompensation = value;
+					foreach (var peer in _peers.Values)
+					{
+						peer.DriftCompensation = value;
+					}
+				}
+			}
+		}
+
+		/// <summary>
+		/// Gets or sets the amount of gain (in decibels) to apply to the microphone input. This is ignored while automatic
+		/// gain control is on.
 		/// </summary>
 		public float InputGain { get { return _voiceIn.Gain; } set { _voiceIn.Gain = value; } }
 
+		/// <summary>
+		/// Gets or sets a value indicating whether the gain of the microphone input is set automatically, so that speech is
+		/// sent at a steady level however close the user is to the microphone. This is off by default.
+		/// </summary>
+		public bool AutomaticGainControl
+		{
+			get { return _automaticGainControl; }
+			set
+			{
+				if (_automaticGainControl == value)
+				{
+					return;
+				}
+				_automaticGainControl = value;
+				if (value)
+				{
+					if (_gainControl == null)
+					{
+						_gainControl = new AutomaticGainControl(_codec.SampleRate);
+					}
+					else
+					{
+						_gainControl.Reset();
+					}
+				}
+				_voiceIn.GainControl = value ? _gainControl : null;
+			}
+		}
+
+		/// <summary>
+		/// Gets or sets a value indicating whether steady background noise, such as fans and hum, is suppressed in the
+		/// microphone input. This is off by default.
+		/// </summary>
+		public bool NoiseSuppression
+		{
+			get { return _noiseSuppression; }
+			set
+			{
+				if (_noiseSuppression == value)
+				{
+					return;
+				}
+				_noiseSuppression = value;
+				if (value)
+				{
+					if (_noiseSuppressor == null)
+					{
+						int blockSize = this.GetBlockSize();
+						if (blockSize == 0)
+						{
+							throw new InvalidOperationException("Noise suppression is not supported with this codec.");
+						}
+						_noiseSuppressor = new NoiseSuppressor(_codec.SampleRate, blockSize);
+					}
+					else
+					{
+						_noiseSuppressor.Reset();
+					}
+				}
+				_voiceIn.NoiseSuppressor = value ? _noiseSuppressor : null;
+			}
+		}
+
+		/// <summary>
+		/// Gets or sets a value indicating whether silence is detected and left out of transmission. During silence, only
+		/// an occasional comfort noise packet describing the background level is sent. This is on by default.
+		/// </summary>
+		public bool VoiceActivityDetection { get { return _voiceIn.VoiceActivityDetection; } set { _voiceIn.VoiceActivityDetection = value; } }
+
+		/// <summary>
+		/// Gets or sets a value indicating whether the echo of the peers' voices is removed from the microphone input, so
+		/// that they do not hear themselves when the session is played through speakers. This is off by default.
+		/// </summary>
+		/// <remarks>
+		/// The canceller learns the echo from the output device that plays peers using the transmit codec at the same
+		/// quality. Peers using another codec or quality are played through a separate device at another rate, and their
+		/// echo is not removed.
+		/// </remarks>
+		public bool EchoCancellation
+		{
+			get { return _echoCancellation; }
+			set
+			{
+				if (_echoCancellation == value)
+				{
+					return;
+				}
+				_echoCancellation = value;
+				if (value)
+				{
+					if (_echoCanceller == null)
+					{
+						int blockSize = this.GetBlockSize();
+						if (blockSize == 0)
+						{
+							throw new InvalidOperationException("Echo cancellation is not supported with this codec.");
+						}
+						_echoCanceller = new AcousticEchoCanceller(_codec.SampleRate, blockSize, EchoTailLength);
+					}
+					else
+					{
+						_echoCanceller.Reset();
+					}
+				}
+				VoiceOut output;
+				if (_outputs.TryGetValue(VoiceOut.GetKey(_codec), out output))
+				{
+					output.EchoReference = value ? _echoCanceller : null;
+				}
+				_voiceIn.EchoCanceller = value ? _echoCanceller : null;
+			}
+		}
+
 		/// <summary>
 		/// Gets the current noise level from the microphone input. This could be used, for example, to activate transmission when the user talks.
 		/// </summary>
@@ -117,13 +286,90 @@ namespace Floe.Audio
 		/// <param name="endpoint">The peer's public endpoint.</param>
 		public void AddPeer(VoiceCodec codec, int quality, IPEndPoint endpoint)
 		{
-			base.AddPeer(endpoint);
-			var peer = new VoicePeer(codec, quality, _pool);
+			var info = new CodecInfo(codec, quality);
+			base.AddPeer(endpoint, info.SampleRate);
+			this.AddVoicePeer(info, endpoint);
+		}
+
+		/// <summary>
+		/// Add a peer that is reached through a relay (see RtpRelay). Audio sent to the relay is forwarded to all of the peers
+		/// behind it, so it is only sent once however many such peers there are.
+		/// </summary>
+		/// <param name="codec">The peer's audio codec.</param>
+		/// <param name="quality">The peer's audio quality (usually the sample rate).</param>
+		/// <param name="endpoint">The peer's public endpoint, which identifies it in other calls.</param>
+		/// <param name="relay">The endpoint of the relay.</param>
+		/// <param name="ssrc">The source identifier of the peer's session (see the Ssrc property).</param>
+		public void AddPeer(VoiceCodec codec, int quality, IPEndPoint endpoint, IPEndPoint relay, int ssrc)
+		{
+			var info = new CodecInfo(codec, quality);
+			base.AddPeer(endpoint, info.SampleRate, relay, ssrc);
+			this.AddVoicePeer(info, endpoint);
+		}
+
+		private void AddVoicePeer(CodecInfo info, IPEndPoint endpoint)
+		{
+			VoiceOut output;
+			if (!_outputs.TryGetValue(VoiceOut.GetKey(info), out output))
+			{
+				output = new VoiceOut(info);
+				_outputs.Add(output.Key, output);
+				if (_echoCancellation && output.Key == VoiceOut.GetKey(_codec))
+				{
+					output.EchoReference = _echoCanceller;
+				}
+			}
+			var peer = new VoicePeer(info, output);
 			peer.Volume = _outputVolume;
 			peer.Gain = _outputGain;
+			peer.AdaptiveDelay = _adaptiveDelay;
+			peer.DriftCompensation = _driftCompensation;
 			_peers.Add(endpoint, peer);
 		}
 
+		private int GetBlockSize()
+		{
+			// Echo cancellation and noise suppression work in blocks of a power of two, which must divide the packet.
+			int blockSize = MaxBlockSize;
+			while (_codec.SamplesPerPacket % blockSize != 0 && blockSize > MinBlockSize)
+			{
+				blockSize /= 2;
+			}
+			return _codec.SamplesPerPacket % blockSize == 0 ? blockSize : 0;
+		}
+
+		/// <summary>
+		/// Gets the current playout and network statistics for a peer. The network figures come from the RTCP reports
+		/// exchanged with the peer every few seconds.
+		/// </summary>
+		/// <param name="endpoint">The peer's public endpoint.</param>
+		/// <returns>Returns a snapshot of the peer's statistics.</returns>
+		public VoicePeerStatistics GetStatistics(IPEndPoint endpoint)
+		{
+			var stats = _peers[endpoint].GetStatistics();
+			stats.SendErrors = this.GetSendErrors(endpoint);
+			var network = this.GetPeerStatistics(endpoint);
+			if (network != null)
+			{
+				stats.PacketsReceived = network.PacketsReceived;
+				stats.PacketsLost = network.PacketsLost;
+				stats.FractionLost = network.FractionLost;
+				stats.RemotePacketsLost = network.RemotePacketsLost;
+				stats.RemoteFractionLost = network.RemoteFractionLost;
+				stats.RemoteJitter = network.RemoteJitter;
+				stats.RoundTripTime = network.RoundTripTime;
+			}
+			return stats;
+		}
+
+		/// <summary>
+		/// Gets the current counters for the microphone capture path.
+		/// </summary>
+		public VoiceCaptureStatistics GetCaptureStatistics()
+		{
+			return _voiceIn.GetStatistics();
+		}
+
 		/// <summary>
 		/// Remove a peer from the session.
 		/// </summary>
@@ -135,14 +381,27 @@ namespace Floe.Audio
 				var peer = _peers[endpoint];
 				_peers.Remove(endpoint);
 				peer.Dispose();
+				if (peer.Output.InputCount == 0)
+				{
+					_outputs.Remove(peer.Output.Key);
+					peer.Output.Dispose();
+				}
 			}
 		}
 
-		protected override void OnReceived(IPEndPoint endpoint, short payloadType, int seqNumber, int timeStamp, byte[] payload, int count)
+		protected override void OnReceived(IPEndPoint endpoint, short payloadType, int seqNumber, int timeStamp, byte[] payload, int offset, int count)
 		{
 			if (_receivePredicate == null || _receivePredicate(endpoint))
 			{
-				_peers[endpoint].Enqueue(seqNumber, timeStamp, payload, count);
+				if (payloadType == CodecInfo.ComfortNoisePayloadType)
+				{
+					// The payload is never empty, so the level byte is always there.
+					_peers[endpoint].SetComfortNoise(payload[offset]);
+				}
+				else
+				{
+					_peers[endpoint].Enqueue(seqNumber, timeStamp, payload, offset, count);
+				}
 			}
 		}
 
@@ -166,6 +425,25 @@ namespace Floe.Audio
 			{
 				peer.Dispose();
 			}
+			foreach (var output in _outputs.Values)
+			{
+				output.Dispose();
+			}
+			if (_echoCanceller != null)
+			{
+				_echoCanceller.Dispose();
+				_echoCanceller = null;
+			}
+			if (_noiseSuppressor != null)
+			{
+				_noiseSuppressor.Dispose();
+				_noiseSuppressor = null;
+			}
+			if (_gainControl != null)
+			{
+				_gainControl.Dispose();
+				_gainControl = null;
+			}
 		}
 
 		~VoiceClient()
@@ -0,0 +1,437 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Net;
+using System.Net.Sockets;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+using Floe.Interop;
+using Floe.Net;
+
+namespace Floe.Audio
+{
+	/// <summary>
+	/// A headless conference hub that mixes the voices of its members. Each member sends its stream to the hub and
+	/// receives a single mixed stream back, so that a client decodes one stream however large the conference is. Only the
+	/// loudest few members are mixed, and speakers do not hear themselves.
+	/// </summary>
+	/// <remarks>
+	/// All members must use the hub's codec. Incoming packets pass through a jitter buffer per member, as they would in a
+	/// client, and are mixed and re-encoded once per packet period on the hub's own thread. Listeners that are not speaking
+	/// all receive the same encoded mix, so the encoding cost depends on the number of speakers rather than the number of
+	/// members. A listener that starts or stops speaking switches between encoders, which the decoder gets over within a
+	/// packet. A listener whose mix has nobody in it, such as the only speaker, is sent nothing, as with DTX.
+	/// </remarks>
+	public sealed class VoiceHub : RtpClient, IDisposable
+	{
+		private const long DummyIPAddress = 0x03030303;
+		private const int DummyPort = 3333;
+		private const int DefaultMaxSpeakers = 3;
+		private const int MaxLag = 200; // milliseconds
+
+		private class Member
+		{
+			public IPEndPoint EndPoint;
+			public int Index;
+			public JitterBuffer Buffer;
+			public IAudioCodec Encoder;
+			public IntPtr Payload;
+			public bool Removed;
+		}
+
+		private CodecInfo _codec;
+		private ConferenceMixer _mixer;
+		private IAudioCodec _commonEncoder;
+		private IntPtr _commonPayload;
+		private object _sync;
+		private Dictionary<IPEndPoint, Member> _members;
+		private volatile Dictionary<IPEndPoint, Member> _memberTable;
+		private bool[] _inputsUsed;
+		private int _inputCount;
+		private bool _adaptiveDelay;
+		private bool _driftCompensation = true;
+		private Thread _mixThread;
+		private ManualResetEvent _stopEvent;
+		private int _timeStamp;
+		private long _mixes, _lateMixes, _mixTicks;
+
+		/// <summary>
+		/// Construct a new hub.
+		/// </summary>
+		/// <param name="codec">The codec that all members send and receive.</param>
+		/// <param name="maxMembers">The largest number of members the hub will accept.</param>
+		/// <param name="maxSpeakers">The number of members that are mixed at the same time.</param>
+		/// <param name="client">An optional already-bound UDP client to use. If this is null, then a new client will be constructed.</param>
+		public VoiceHub(CodecInfo codec, int maxMembers, int maxSpeakers = DefaultMaxSpeakers, UdpClient client = null)
+			: base((byte)codec.PayloadType, codec.EncodedBufferSize, codec.SampleRate, new IPEndPoint(new IPAddress(DummyIPAddress), DummyPort), client)
+		{
+			_codec = codec;
+			_mixer = new ConferenceMixer(codec.SamplesPerPacket, maxMembers, maxSpeakers);
+			_commonEncoder = codec.GetCodec();
+			_commonPayload = Marshal.AllocHGlobal(codec.EncodedBufferSize);
+			_sync = new object();
+			_members = new Dictionary<IPEndPoint, Member>();
+			_memberTable = new Dictionary<IPEndPoint, Member>();
+			_inputsUsed = new bool[maxMembers];
+		}
+
+		/// <summary>
+		/// Gets or sets a value indicating whether each member's playout delay adapts to the measured network jitter.
+		/// When false, a fixed delay is used.
+		/// </summary>
+		public bool AdaptiveDelay
+		{
+			get { return _adaptiveDelay; }
+			set
+			{
+				lock (_sync)
+				{
+					_adaptiveDelay = value;
+					foreach (var member in _members.Values)
+					{
+						member.Buffer.Adaptive = value;
+					}
+				}
+			}
+		}
+
+		/// <summary>
+		/// Gets or sets a value indicating whether each member's audio is resampled to follow the member's clock, so that
+		/// drift between it and the hub's mixing timer neither builds up delay nor runs the member's buffer dry. The default
+		/// is true.
+		/// </summary>
+		public bool DriftCompensation
+		{
+			get { return _driftCompensation; }
+			set
+			{
+				lock (_sync)
+				{
+					_driftCompensation = value;
+					foreach (var member in _members.Values)
+					{
+						member.Buffer.DriftCompensation = value;
+					}
+				}
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of mixes made. One mix is made per packet period, and produces the packets for all members.
+		/// </summary>
+		public long Mixes { get { return Interlocked.Read(ref _mixes); } }
+
+		/// <summary>
+		/// Gets the number of times the hub fell so far behind that packet periods were skipped.
+		/// </summary>
+		public long LateMixes { get { return Interlocked.Read(ref _lateMixes); } }
+
+		/// <summary>
+		/// Gets the average time taken by a mix, including decoding, encoding and sending, in milliseconds.
+		/// </summary>
+		public float AverageMixTime
+		{
+			get
+			{
+				long mixes = this.Mixes;
+				return mixes > 0 ? (float)(Interlocked.Read(ref _mixTicks) * 1000.0 / Stopwatch.Frequency / mixes) : 0f;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of members whose voices were in the last mix.
+		/// </summary>
+		public int SpeakerCount { get { return _mixer.SpeakerCount; } }
+
+		public event EventHandler<ErrorEventArgs> Error;
+
+		/// <summary>
+		/// Open the hub and begin mixing.
+		/// </summary>
+		public override void Open()
+		{
+			base.Open();
+			_stopEvent = new ManualResetEvent(false);
+			_mixThread = new Thread(new ThreadStart(MixThreadProc));
+			_mixThread.Start();
+		}
+
+		/// <summary>
+		/// Close the hub.
+		/// </summary>
+		public override void Close()
+		{
+			if (_mixThread != null)
+			{
+				_stopEvent.Set();
+				_mixThread.Join();
+				_mixThread = null;
+			}
+			base.Close();
+		}
+
+		/// <summary>
+		/// Add a member to the conference.
+		/// </summary>
+		/// <param name="endpoint">The member's public endpoint.</param>
+		public void AddMember(IPEndPoint endpoint)
+		{
+			lock (_sync)
+			{
+				if (_members.ContainsKey(endpoint))
+				{
+					return;
+				}
+				int index = Array.IndexOf(_inputsUsed, false);
+				if (index < 0)
+				{
+					throw new InvalidOperationException("The hub is full.");
+				}
+
+				var member = new Member
+				{
+					EndPoint = endpoint,
+					Index = index,
+					Buffer = new JitterBuffer(_codec),
+					Encoder = _codec.GetCodec(),
+					Payload = Marshal.AllocHGlobal(_codec.EncodedBufferSize)
+				};
+				member.Buffer.Adaptive = _adaptiveDelay;
+				member.Buffer.DriftCompensation = _driftCompensation;
+				_inputsUsed[index] = true;
+				_inputCount = Math.Max(_inputCount, index + 1);
+				_mixer.ResetInput(index);
+				_members.Add(endpoint, member);
+				_memberTable = new Dictionary<IPEndPoint, Member>(_members);
+			}
+			base.AddPeer(endpoint, _codec.SampleRate);
+		}
+
+		/// <summary>
+		/// Remove a member from the conference.
+		/// </summary>
+		/// <param name="endpoint">The member's public endpoint.</param>
+		public void RemoveMember(IPEndPoint endpoint)
+		{
+			base.RemovePeer(endpoint);
+			lock (_sync)
+			{
+				Member member;
+				if (_members.TryGetValue(endpoint, out member))
+				{
+					_members.Remove(endpoint);
+					_memberTable = new Dictionary<IPEndPoint, Member>(_members);
+					_inputsUsed[member.Index] = false;
+					_mixer.ResetInput(member.Index);
+					this.FreeMember(member);
+				}
+			}
+		}
+
+		/// <summary>
+		/// Gets the current playout statistics for a member's incoming stream. The delay is the time its audio waits at the
+		/// hub before it is mixed.
+		/// </summary>
+		/// <param name="endpoint">The member's public endpoint.</param>
+		/// <returns>Returns a snapshot of the member's statistics.</returns>
+		public VoicePeerStatistics GetStatistics(IPEndPoint endpoint)
+		{
+			var member = _memberTable[endpoint];
+			lock (member)
+			{
+				if (member.Removed)
+				{
+					throw new KeyNotFoundException();
+				}
+				var buffer = member.Buffer;
+				return new VoicePeerStatistics
+				{
+					Jitter = buffer.Jitter,
+					Delay = buffer.Delay,
+					Drift = buffer.Drift,
+					LatePackets = buffer.LatePackets,
+					Underruns = buffer.Underruns,
+					RecoveredPackets = buffer.RecoveredPackets,
+					ConcealedPackets = buffer.ConcealedPackets,
+					SendErrors = this.GetSendErrors(endpoint)
+				};
+			}
+		}
+
+		protected override void OnReceived(IPEndPoint endpoint, short payloadType, int seqNumber, int timeStamp, byte[] payload, int offset, int count)
+		{
+			Member member;
+			if (_memberTable.TryGetValue(endpoint, out member))
+			{
+				// The member may have been removed, and its buffer freed, since the table was read.
+				lock (member)
+				{
+					if (member.Removed)
+					{
+						return;
+					}
+					if (payloadType == CodecInfo.ComfortNoisePayloadType)
+					{
+						// The payload is never empty, so the level byte is always there.
+						member.Buffer.SetComfortNoise(payload[offset]);
+					}
+					else
+					{
+						member.Buffer.Enqueue(timeStamp, payload, offset, count);
+					}
+				}
+			}
+		}
+
+		protected override void OnError(Exception ex)
+		{
+			var handler = this.Error;
+			if (handler != null)
+			{
+				handler(this, new ErrorEventArgs(ex));
+			}
+		}
+
+		private void MixThreadProc()
+		{
+			// Mixes are scheduled against a clock rather than by sleeping a fixed time, so that waits that run long do not
+			// add up. After a long stall, the missed periods are skipped rather than made up in a burst.
+			double period = _codec.SamplesPerPacket * 1000.0 / _codec.SampleRate;
+			var clock = Stopwatch.StartNew();
+			long round = 0;
+			while (true)
+			{
+				int wait = (int)(round * period - clock.Elapsed.TotalMilliseconds);
+				if (_stopEvent.WaitOne(Math.Max(0, wait)))
+				{
+					return;
+				}
+
+				long start = Stopwatch.GetTimestamp();
+				try
+				{
+					this.Mix();
+				}
+				catch (InteropException ex)
+				{
+					this.OnError(ex);
+				}
+				Interlocked.Add(ref _mixTicks, Stopwatch.GetTimestamp() - start);
+				Interlocked.Increment(ref _mixes);
+
+				round++;
+				double now = clock.Elapsed.TotalMilliseconds;
+				if (now - round * period > MaxLag)
+				{
+					round = (long)(now / period);
+					Interlocked.Increment(ref _lateMixes);
+				}
+			}
+		}
+
+		private void Mix()
+		{
+			lock (_sync)
+			{
+				// Each member's next packet is decoded (or concealed) straight into its mixer input.
+				for (int i = 0; i < _inputCount; i++)
+				{
+					if (!_inputsUsed[i])
+					{
+						_mixer.SetInputLength(i, 0);
+					}
+				}
+				foreach (var member in _members.Values)
+				{
+					int count = member.Buffer.Read(_mixer.GetInput(member.Index), _codec.DecodedBufferSize);
+					_mixer.SetInputLength(member.Index, count);
+				}
+				_mixer.Mix(_inputCount);
+
+				// A mix with no voices in it is digital silence, and encoding that straight after a voice makes GSM ring for
+				// a few packets while its offset filter settles, so it is not sent at all.
+				int speakers = _mixer.SpeakerCount;
+				int commonSize = -1;
+				foreach (var member in _members.Values)
+				{
+					var output = _mixer.GetOutput(member.Index);
+					int slot = _mixer.GetSpeakerSlot(member.Index);
+					if (speakers == (slot < 0 ? 0 : 1))
+					{
+						continue;
+					}
+					if (slot < 0)
+					{
+						if (commonSize < 0)
+						{
+							commonSize = _commonEncoder.Encode(output, _codec.DecodedBufferSize, _commonPayload, _codec.EncodedBufferSize);
+						}
+						if (commonSize > 0)
+						{
+							this.SendTo(member.EndPoint, _timeStamp, _commonPayload, commonSize);
+						}
+					}
+					else
+					{
+						int size = member.Encoder.Encode(output, _codec.DecodedBufferSize, member.Payload, _codec.EncodedBufferSize);
+						if (size > 0)
+						{
+							this.SendTo(member.EndPoint, _timeStamp, member.Payload, size);
+						}
+					}
+				}
+				_timeStamp += _codec.SamplesPerPacket;
+			}
+		}
+
+		// Frees what a member holds once it is out of the tables. The mix thread only touches members under _sync, which
+		// the caller holds; the network thread may still have the member from an old table, and checks Removed under the
+		// member's own lock before it enqueues anything.
+		private void FreeMember(Member member)
+		{
+			lock (member)
+			{
+				member.Removed = true;
+				member.Buffer.Dispose();
+				((IDisposable)member.Encoder).Dispose();
+				Marshal.FreeHGlobal(member.Payload);
+			}
+		}
+
+		/// <summary>
+		/// Dispose the hub.
+		/// </summary>
+		public override void Dispose()
+		{
+			base.Dispose();
+			lock (_sync)
+			{
+				var members = new List<Member>(_members.Values);
+				_members.Clear();
+				_memberTable = new Dictionary<IPEndPoint, Member>();
+				foreach (var member in members)
+				{
+					this.FreeMember(member);
+				}
+				if (_commonEncoder != null)
+				{
+					((IDisposable)_commonEncoder).Dispose();
+					_commonEncoder = null;
+				}
+				if (_commonPayload != IntPtr.Zero)
+				{
+					Marshal.FreeHGlobal(_commonPayload);
+					_commonPayload = IntPtr.Zero;
+				}
+			}
+			_mixer.Dispose();
+		}
+
+		~VoiceHub()
+		{
+			this.Dispose();
+		}
+	}
+}
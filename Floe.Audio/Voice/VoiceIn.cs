@@ -1,25 +1,41 @@
 ﻿using System;
-using System.IO;
+using System.Runtime.InteropServices;
+using System.Threading;
 
 using Floe.Interop;
 using Floe.Net;
 
 namespace Floe.Audio
 {
-	class VoiceIn : Stream
+	class VoiceIn : IWaveSink, IDisposable
 	{
+		private const int ComfortNoiseInterval = 10; // packets
+
 		private CodecInfo _codec;
-		private AudioConverter _encoder;
+		private IAudioCodec _encoder;
+		private IntPtr _payload;
 		private RtpClient _client;
 		private TransmitPredicate _predicate;
 		private int _timeStamp;
 		private WaveIn _waveIn;
+		private SampleRateConverter _resampler;
+		private IntPtr _packet;
+		private int _packetLength;
+		private VoiceActivityDetector _vad;
+		private volatile AcousticEchoCanceller _echoCanceller;
+		private volatile NoiseSuppressor _noiseSuppressor;
+		private volatile AutomaticGainControl _gainControl;
+		private bool _talking;
+		private int _silentFrames;
+		private long _frames, _encodedFrames, _comfortNoisePackets;
 
 		public VoiceIn(CodecInfo codec, RtpClient client, TransmitPredicate predicate)
 		{
 			_codec = codec;
 			_client = client;
-			_predicate = predicate;			
+			_predicate = predicate;
+			_vad = new VoiceActivityDetector(codec.SampleRate);
+			this.VoiceActivityDetection = true;
 			this.InitAudio();
 		}
 
@@ -27,15 +43,64 @@ namespace Floe.Audio
 
 		public float Gain { get; set; }
 
+		public bool VoiceActivityDetection { get; set; }
+
+		public AcousticEchoCanceller EchoCanceller { get { return _echoCanceller; } set { _echoCanceller = value; } }
+
+		public NoiseSuppressor NoiseSuppressor { get { return _noiseSuppressor; } set { _noiseSuppressor = value; } }
+
+		/// <summary>
+		/// Gets or sets the gain control that sets the level of the microphone. While it is set, Gain is ignored.
+		/// </summary>
+		public AutomaticGainControl GainControl { get { return _gainControl; } set { _gainControl = value; } }
+
 		public void Start()
 		{
 			_waveIn.Start();
 		}
 
-		public override void Close()
+		public void Close()
 		{
-			base.Close();
 			_waveIn.Dispose();
+			_vad.Dispose();
+			if (_resampler != null)
+			{
+				_resampler.Dispose();
+				_resampler = null;
+			}
+			if (_packet != IntPtr.Zero)
+			{
+				Marshal.FreeHGlobal(_packet);
+				_packet = IntPtr.Zero;
+			}
+			if (_payload != IntPtr.Zero)
+			{
+				Marshal.FreeHGlobal(_payload);
+				_payload = IntPtr.Zero;
+			}
+		}
+
+		public void Dispose()
+		{
+			this.Close();
+		}
+
+		public VoiceCaptureStatistics GetStatistics()
+		{
+			return new VoiceCaptureStatistics
+			{
+				Frames = Interlocked.Read(ref _frames),
+				EncodedFrames = Interlocked.Read(ref _encodedFrames),
+				ComfortNoisePackets = Interlocked.Read(ref _comfortNoisePackets),
+				EchoReturnLossEnhancement = _echoCanceller != null ? _echoCanceller.Erle : 0f,
+				EchoDelay = _echoCanceller != null ? _echoCanceller.Delay * 1000f / _codec.SampleRate : 0f,
+				NoiseLevel = _noiseSuppressor != null ? _noiseSuppressor.NoiseLevel : _vad.NoiseFloor,
+				InputGain = _gainControl != null ? _gainControl.Gain : this.Gain,
+				BytesCopied = _waveIn.BytesCopied + (_client != null ? _client.BytesCopied : 0),
+				PacketsSent = _client != null ? _client.PacketsSent : 0,
+				PacketsDropped = _client != null ? _client.PacketsDropped : 0,
+				Allocations = _client != null ? _client.Allocations : 0
+			};
 		}
 
 		private void InitAudio()
@@ -44,34 +109,122 @@ namespace Floe.Audio
 			{
 				_waveIn.Close();
 			}
-			_waveIn = new WaveIn(this, _codec.DecodedFormat, _codec.DecodedBufferSize);
-			_encoder = new AudioConverter(_codec.DecodedBufferSize, _codec.DecodedFormat, _codec.EncodedFormat);
+			if (_codec.CaptureRate != _codec.SampleRate)
+			{
+				// Record about one packet at a time at the device's rate, and convert it to the codec's rate here.
+				int captureSize = (int)((long)_codec.SamplesPerPacket * _codec.CaptureRate / _codec.SampleRate) * 2;
+				_waveIn = new WaveIn(this, new WaveFormatPcm(_codec.CaptureRate, 16, 1), captureSize, _codec.DeviceBufferCount);
+				if (_resampler == null)
+				{
+					_resampler = new SampleRateConverter(_codec.CaptureRate, _codec.SampleRate, ResamplerQuality.Medium, captureSize);
+					_packet = Marshal.AllocHGlobal(_codec.DecodedBufferSize);
+				}
+			}
+			else
+			{
+				_waveIn = new WaveIn(this, _codec.DecodedFormat, _codec.DecodedBufferSize, _codec.DeviceBufferCount);
+			}
+			_encoder = _codec.GetCodec();
+			if (_payload == IntPtr.Zero)
+			{
+				_payload = Marshal.AllocHGlobal(_codec.EncodedBufferSize);
+			}
 		}
 
-		public override bool CanRead { get { return true; } }
-		public override bool CanSeek { get { return false; } }
-		public override bool CanWrite { get { return false; } }
-		public override void Flush() { throw new NotImplementedException(); }
-		public override long Length { get { throw new NotImplementedException(); } }
-		public override long Position { get { throw new NotImplementedException(); } set { throw new NotImplementedException(); } }
-		public override long Seek(long offset, SeekOrigin origin) { throw new NotImplementedException(); }
-		public override void SetLength(long value) { throw new NotImplementedException(); }
-		public override int Read(byte[] buffer, int offset, int count) { throw new NotImplementedException(); }
-
-		public override void Write(byte[] buffer, int offset, int count)
+		public void Write(IntPtr buffer, int count)
 		{
-			float gain = this.Gain != 0f ? (float)Math.Pow(10, this.Gain / 20f) : 1f;
-			this.Level = WavProcess.ApplyGain(gain, buffer, count);
+			if (_resampler == null)
+			{
+				this.WritePacket(buffer, count);
+				return;
+			}
 
-			if (_client != null)
+			// Converted buffers do not line up with packets, so each packet is filled from the converter, which keeps
+			// whatever input it has not used for the next one.
+			int size = _resampler.Convert(buffer, count, _packet + _packetLength, _codec.DecodedBufferSize - _packetLength);
+			while (true)
 			{
-				count = _encoder.Convert(buffer, count, buffer);
-				if (count >= _client.PayloadSize && (_predicate == null || _predicate()))
+				_packetLength += size;
+				if (_packetLength < _codec.DecodedBufferSize)
 				{
-					_client.Send(_timeStamp, buffer);
+					break;
 				}
+				this.WritePacket(_packet, _packetLength);
+				_packetLength = 0;
+				size = _resampler.Convert(IntPtr.Zero, 0, _packet, _codec.DecodedBufferSize);
+			}
+		}
+
+		private void WritePacket(IntPtr buffer, int count)
+		{
+			// Echo cancellation, noise suppression, gain and encoding all work on the packet in place, without copying it
+			// out. The echo is removed first, so that neither the level nor voice activity detection hears it, and the
+			// noise before the gain, so that automatic gain control judges the level of speech alone. Each of these does
+			// the same amount of work for every packet, so the capture thread's time per packet does not depend on what
+			// the microphone hears.
+			var echoCanceller = _echoCanceller;
+			if (echoCanceller != null)
+			{
+				echoCanceller.Process(buffer, count);
+			}
+			var noiseSuppressor = _noiseSuppressor;
+			if (noiseSuppressor != null)
+			{
+				noiseSuppressor.Process(buffer, count);
+			}
+			var gainControl = _gainControl;
+			float gain = 1f;
+			if (gainControl != null)
+			{
+				gainControl.Process(buffer, count);
+			}
+			else if (this.Gain != 0f)
+			{
+				gain = (float)Math.Pow(10, this.Gain / 20f);
+			}
+			this.Level = Dsp.ApplyGain(buffer, count, gain).Rms;
+			Interlocked.Increment(ref _frames);
+
+			bool speech = !this.VoiceActivityDetection || _vad.Process(buffer, count);
+			if (_client != null && (_predicate == null || _predicate()))
+			{
+				if (speech)
+				{
+					_silentFrames = 0;
+					count = _encoder.Encode(buffer, count, _payload, _codec.EncodedBufferSize);
+					Interlocked.Increment(ref _encodedFrames);
+					if (count > 0)
+					{
+						_client.Send(_timeStamp, _payload, count, (byte)_codec.PayloadType, !_talking);
+					}
+					_talking = count > 0;
+				}
+				else
+				{
+					// During silence, only a description of the background noise is sent, at the start and then often
+					// enough for a peer that misses one to pick up the next.
+					if (_silentFrames++ % ComfortNoiseInterval == 0)
+					{
+						this.SendComfortNoise();
+					}
+					_talking = false;
+				}
+			}
+			else
+			{
+				_talking = false;
+				_silentFrames = 0;
 			}
 			_timeStamp += _codec.SamplesPerPacket;
 		}
+
+		private void SendComfortNoise()
+		{
+			// RFC 3389: a single byte giving the noise level in -dBov.
+			int level = (int)Math.Round(-_vad.NoiseFloor);
+			Marshal.WriteByte(_payload, (byte)Math.Max(0, Math.Min(127, level)));
+			_client.Send(_timeStamp, _payload, 1, CodecInfo.ComfortNoisePayloadType, false);
+			Interlocked.Increment(ref _comfortNoisePackets);
+		}
 	}
 }
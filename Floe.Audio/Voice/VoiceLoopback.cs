@@ -1,4 +1,5 @@
 ﻿using System;
+using System.Runtime.InteropServices;
 
 using Floe.Interop;
 
@@ -8,11 +9,16 @@ namespace Floe.Audio
 	/// Allows users to test their microphone by hearing themselves speak. This class encodes the audio
 	/// using the selected codec and quality and immediate decodes and plays it back.
 	/// </summary>
-	public class VoiceLoopback : FifoStream, IDisposable
+	public class VoiceLoopback : IWaveSink, IDisposable
 	{
+		private const int RingPackets = 8;
+
+		private AudioRing _ring;
 		private WaveIn _waveIn;
 		private WaveOut _waveOut;
-		private AudioConverter _encoder;
+		private IAudioCodec _codec;
+		private IntPtr _decoded, _encoded;
+		private int _encodedSize;
 
 		/// <summary>
 		/// Construct a new voice loopback session.
@@ -22,9 +28,13 @@ namespace Floe.Audio
 		public VoiceLoopback(VoiceCodec codec, int quality)
 		{
 			var info = new CodecInfo(codec, quality);
-			_waveIn = new WaveIn(this, info.DecodedFormat, info.DecodedBufferSize);
-			_waveOut = new WaveOut(this, info.EncodedFormat, info.EncodedBufferSize);
-			_encoder = new AudioConverter(info.DecodedBufferSize, info.DecodedFormat, info.EncodedFormat);
+			_ring = new AudioRing(info.DecodedBufferSize * RingPackets);
+			_waveIn = new WaveIn(this, info.DecodedFormat, info.DecodedBufferSize, info.DeviceBufferCount);
+			_waveOut = new WaveOut((IWaveSource)_ring, info.DecodedFormat, info.DecodedBufferSize, info.DeviceBufferCount);
+			_codec = info.GetCodec();
+			_encodedSize = info.EncodedBufferSize;
+			_decoded = Marshal.AllocHGlobal(info.DecodedBufferSize);
+			_encoded = Marshal.AllocHGlobal(info.EncodedBufferSize);
 		}
 
 		/// <summary>
@@ -54,29 +64,53 @@ namespace Floe.Audio
 		/// <summary>
 		/// Stops the loopback session.
 		/// </summary>
-		public override void Close()
+		public void Close()
 		{
-			base.Close();
 			_waveIn.Dispose();
 			_waveOut.Dispose();
+			_ring.Dispose();
+			if (_decoded != IntPtr.Zero)
+			{
+				Marshal.FreeHGlobal(_decoded);
+				Marshal.FreeHGlobal(_encoded);
+				_decoded = _encoded = IntPtr.Zero;
+			}
 		}
 
-		public override int Read(byte[] buffer, int offset, int count)
+		public void Dispose()
 		{
-			return base.Read(buffer, offset, count);
+			this.Close();
 		}
 
-		public override void Write(byte[] buffer, int offset, int count)
+		void IWaveSink.Write(IntPtr buffer, int count)
 		{
+			// The recorded buffer is encoded where it lies, and decoded straight into the ring that the output device
+			// plays from when the free space there does not wrap.
 			float gain = this.InputGain != 0f ? (float)Math.Pow(10, this.InputGain / 20f) : 1f;
-			WavProcess.ApplyGain(gain, buffer, count);
+			Dsp.ApplyGain(buffer, count, gain);
 
-			if (offset != 0)
+			int span;
+			var target = _ring.AcquireWrite(out span);
+			if (span < count)
+			{
+				target = _decoded;
+			}
+			int size = _codec.Encode(buffer, count, _encoded, _encodedSize);
+			size = size > 0 ? _codec.Decode(_encoded, size, target, count) : 0;
+			if (size <= 0)
+			{
+				// Nothing was sent (e.g. silence under DTX), so play silence in its place.
+				Dsp.ApplyGain(target, count, 0f);
+				size = count;
+			}
+			if (target == _decoded)
+			{
+				_ring.Write(_decoded, size);
+			}
+			else
 			{
-				throw new ArgumentException("Offsets are not supported.");
+				_ring.CommitWrite(size);
 			}
-			count = _encoder.Convert(buffer, count, buffer);
-			base.Write(buffer, offset, count);
 		}
 	}
 }
@@ -0,0 +1,67 @@
+﻿using System;
+
+using Floe.Interop;
+
+namespace Floe.Audio
+{
+	/// <summary>
+	/// Plays the mix of any number of decoded voice streams through a single output device. All streams must share
+	/// the same decoded format and packet size.
+	/// </summary>
+	class VoiceOut : IWaveSource, IDisposable
+	{
+		private AudioMixer _mixer;
+		private WaveOut _waveOut;
+		private volatile AcousticEchoCanceller _echoReference;
+
+		public VoiceOut(CodecInfo codec)
+		{
+			this.Key = GetKey(codec);
+			_mixer = new AudioMixer(codec.DecodedBufferSize);
+			_waveOut = new WaveOut(this, codec.DecodedFormat, codec.DecodedBufferSize, codec.DeviceBufferCount);
+			_waveOut.Start();
+		}
+
+		public long Key { get; private set; }
+		public int InputCount { get { return _mixer.InputCount; } }
+		public int Underruns { get { return _waveOut.Underruns; } }
+
+		/// <summary>
+		/// Gets or sets an echo canceller that is given everything this output plays, as the reference for the echo it
+		/// removes from the microphone. It must run at this output's sample rate.
+		/// </summary>
+		public AcousticEchoCanceller EchoReference { get { return _echoReference; } set { _echoReference = value; } }
+
+		public MixerInput AddInput(IWaveSource source)
+		{
+			return _mixer.AddInput(source);
+		}
+
+		public void RemoveInput(MixerInput input)
+		{
+			_mixer.RemoveInput(input);
+		}
+
+		int IWaveSource.Read(IntPtr buffer, int count)
+		{
+			count = ((IWaveSource)_mixer).Read(buffer, count);
+			var echoReference = _echoReference;
+			if (echoReference != null && count > 0)
+			{
+				echoReference.AddReference(buffer, count);
+			}
+			return count;
+		}
+
+		public static long GetKey(CodecInfo codec)
+		{
+			return ((long)codec.SampleRate << 32) | (uint)codec.DecodedBufferSize;
+		}
+
+		public void Dispose()
+		{
+			_waveOut.Dispose();
+			_mixer.Dispose();
+		}
+	}
+}
@@ -6,36 +6,59 @@ namespace Floe.Audio
 {
 	class VoicePeer : IDisposable
 	{
-		private WaveOut _waveOut;
+		private VoiceOut _output;
+		private MixerInput _input;
 		private JitterBuffer _buffer;
-		private CodecInfo _codec;
-		private VoicePacketPool _pool;
+		private float _volume = 1f, _gain = 0f;
 
-		public VoicePeer(VoiceCodec codec, int quality, VoicePacketPool pool)
+		public VoicePeer(CodecInfo codec, VoiceOut output)
 		{
-			_codec = new CodecInfo(codec, quality);
-			_buffer = new JitterBuffer(_codec);
-			_pool = pool;
-			this.InitAudio();
+			_buffer = new JitterBuffer(codec);
+			_output = output;
+			_input = output.AddInput(_buffer);
 		}
 
-		public float Volume { get { return _waveOut.Volume; } set { _waveOut.Volume = value; } }
-		public float Gain { get { return _buffer.Gain; } set { _buffer.Gain = value; } }
+		public VoiceOut Output { get { return _output; } }
+		public float Volume { get { return _volume; } set { _volume = value; this.UpdateGain(); } }
+		public float Gain { get { return _gain; } set { _gain = value; this.UpdateGain(); } }
+		public bool AdaptiveDelay { get { return _buffer.Adaptive; } set { _buffer.Adaptive = value; } }
+		public bool DriftCompensation { get { return _buffer.DriftCompensation; } set { _buffer.DriftCompensation = value; } }
 
-		public void Enqueue(int seqNumber, int timeStamp, byte[] payload, int count)
+		public VoicePeerStatistics GetStatistics()
 		{
-			_buffer.Enqueue(_pool.Create(seqNumber, timeStamp, payload, count));
+			return new VoicePeerStatistics
+			{
+				Jitter = _buffer.Jitter,
+				Delay = _buffer.Delay,
+				Drift = _buffer.Drift,
+				LatePackets = _buffer.LatePackets,
+				Underruns = _buffer.Underruns,
+				RecoveredPackets = _buffer.RecoveredPackets,
+				ConcealedPackets = _buffer.ConcealedPackets,
+				DeviceUnderruns = this.Output.Underruns
+			};
 		}
 
-		private void InitAudio()
+		public void Enqueue(int seqNumber, int timeStamp, byte[] payload, int offset, int count)
 		{
-			_waveOut = new WaveOut(_buffer, _codec.DecodedFormat, _codec.DecodedBufferSize);
-			_waveOut.Start();
+			_buffer.Enqueue(timeStamp, payload, offset, count);
+		}
+
+		public void SetComfortNoise(int level)
+		{
+			_buffer.SetComfortNoise(level);
+		}
+
+		private void UpdateGain()
+		{
+			float gain = _gain != 0f ? (float)Math.Pow(10, _gain / 20f) : 1f;
+			_input.Gain = Math.Max(0f, Math.Min(1f, _volume)) * gain;
 		}
 
 		public void Dispose()
 		{
-			_waveOut.Dispose();
+			_output.RemoveInput(_input);
+			_buffer.Dispose();
 		}
 	}
 }
@@ -0,0 +1,92 @@
+﻿using System;
+
+namespace Floe.Audio
+{
+	/// <summary>
+	/// A snapshot of the playout statistics for a single voice peer.
+	/// </summary>
+	public class VoicePeerStatistics
+	{
+		/// <summary>
+		/// Gets the estimated interarrival jitter, in milliseconds.
+		/// </summary>
+		public float Jitter { get; internal set; }
+
+		/// <summary>
+		/// Gets the playout delay currently applied by the jitter buffer, in milliseconds.
+		/// </summary>
+		public float Delay { get; internal set; }
+
+		/// <summary>
+		/// Gets how much faster the peer's clock runs than the local output device's, in parts per million. This is
+		/// zero for the first ten seconds or so, until there is enough history to go on.
+		/// </summary>
+		public float Drift { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of packets that arrived after their playout time and were discarded.
+		/// </summary>
+		public int LatePackets { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of times playback ran out of packets.
+		/// </summary>
+		public int Underruns { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of missing packets that were rebuilt from the redundant data in the packet after them.
+		/// </summary>
+		public int RecoveredPackets { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of missing packets that were replaced by a synthetic continuation of the audio before them.
+		/// </summary>
+		public int ConcealedPackets { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of times the output device that plays this peer ran out of audio. The device is shared
+		/// by all peers with the same codec.
+		/// </summary>
+		public int DeviceUnderruns { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of times sending a packet to this peer failed.
+		/// </summary>
+		public int SendErrors { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of packets received from this peer.
+		/// </summary>
+		public int PacketsReceived { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of packets from this peer that were lost in the network.
+		/// </summary>
+		public int PacketsLost { get; internal set; }
+
+		/// <summary>
+		/// Gets the fraction of packets from this peer that were lost in the last RTCP reporting interval, between 0 and 1.
+		/// </summary>
+		public float FractionLost { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of our packets that this peer reported as lost.
+		/// </summary>
+		public int RemotePacketsLost { get; internal set; }
+
+		/// <summary>
+		/// Gets the fraction of our packets that this peer reported as lost in its last reporting interval, between 0 and 1.
+		/// </summary>
+		public float RemoteFractionLost { get; internal set; }
+
+		/// <summary>
+		/// Gets the interarrival jitter of our packets as measured by this peer, in milliseconds.
+		/// </summary>
+		public float RemoteJitter { get; internal set; }
+
+		/// <summary>
+		/// Gets the round-trip time to this peer, in milliseconds, or zero if it has not been measured yet.
+		/// </summary>
+		public float RoundTripTime { get; internal set; }
+	}
+}
@@ -1,49 +1,75 @@
 ﻿using System;
 using System.IO;
+using System.Runtime.InteropServices;
 
 using Floe.Interop;
 
 namespace Floe.Audio
 {
-	public class WavFileStream : Stream
+	/// <summary>
+	/// Reads a WAV file as 16-bit PCM, for playback through a WaveOut. Integer samples of 8 to 32 bits and float samples,
+	/// in plain or extensible formats, are converted as they are read, so that any of them plays on any device.
+	/// </summary>
+	public class WavFileStream : Stream, IWaveSource
 	{
-		private Stream _stream;
-		private WaveFormat _format;
+		private WavReader _reader;
 
+		/// <summary>
+		/// Opens a file. The file is mapped into memory rather than read through a stream.
+		/// </summary>
 		public WavFileStream(string fileName)
-			: this(new FileStream(fileName, FileMode.Open, FileAccess.Read, FileShare.Read))
 		{
+			try
+			{
+				_reader = new WavReader(fileName);
+			}
+			catch (InteropException ex)
+			{
+				throw new FileFormatException(ex.Message);
+			}
 		}
 
+		/// <summary>
+		/// Reads the rest of a stream into memory and opens it.
+		/// </summary>
 		public WavFileStream(Stream stream)
 		{
-			_stream = stream;
-			var bytes = new byte[20];
-			if (_stream.Read(bytes, 0, bytes.Length) < bytes.Length ||
-				BitConverter.ToInt32(bytes, 4) == 0 ||
-				BitConverter.ToInt32(bytes, 8) != 0x45564157 || // "WAVE"
-				BitConverter.ToInt32(bytes, 12) != 0x20746d66) // "fmt "
+			try
 			{
-				throw new FileFormatException("Badly formed RIFF file.");
+				_reader = new WavReader(stream);
 			}
-			var fmtBytes = new byte[BitConverter.ToInt32(bytes, 16)];
-			_stream.Read(fmtBytes, 0, fmtBytes.Length);
-			_format = new WaveFormat(fmtBytes);
-
-			while (_stream.Read(bytes, 0, 8) == 8)
+			catch (InteropException ex)
 			{
-				var dataType = BitConverter.ToInt32(bytes, 0);
-				var dataSize = BitConverter.ToInt32(bytes, 4);
-				if (dataType == 0x61746164)
-				{
-					return;
-				}
-				_stream.Seek(dataSize, SeekOrigin.Current);
+				throw new FileFormatException(ex.Message);
 			}
-			throw new FileFormatException("Could not find wave data.");
 		}
 
-		public WaveFormat Format { get { return _format; } }
+		/// <summary>
+		/// Gets the format that reads return: 16-bit PCM, at the file's sample rate with up to two channels unless
+		/// SetOutputFormat has changed it.
+		/// </summary>
+		public WaveFormat Format { get { return _reader.Format; } }
+
+		/// <summary>
+		/// Gets the format of the file itself.
+		/// </summary>
+		public WaveFormat SourceFormat { get { return _reader.SourceFormat; } }
+
+		/// <summary>
+		/// Gets the number of frames in the file.
+		/// </summary>
+		public long Frames { get { return _reader.Frames; } }
+
+		/// <summary>
+		/// Gets the length of the audio.
+		/// </summary>
+		public TimeSpan Duration { get { return _reader.Duration; } }
+
+		/// <summary>
+		/// Gets or sets the time of the next frame to be read.
+		/// </summary>
+		public TimeSpan CurrentTime { get { return _reader.Position; } set { _reader.Position = value; } }
+
 		public override bool CanRead { get { return true; } }
 		public override bool CanSeek { get { return false; } }
 		public override bool CanWrite { get { return false; } }
@@ -54,14 +80,58 @@ namespace Floe.Audio
 		public override void SetLength(long value) { throw new NotImplementedException(); }
 		public override void Write(byte[] buffer, int offset, int count) { throw new NotImplementedException(); }
 
+		/// <summary>
+		/// Converts the audio to a different rate or number of channels from the current position on.
+		/// </summary>
+		/// <param name="sampleRate">The sample rate to convert to.</param>
+		/// <param name="channels">The number of channels to convert to, which must be one or two.</param>
+		/// <param name="quality">The quality of the sample rate conversion.</param>
+		public void SetOutputFormat(int sampleRate, int channels, ResamplerQuality quality)
+		{
+			_reader.SetOutputFormat(sampleRate, channels, quality);
+		}
+
+		/// <summary>
+		/// Gets a buffer size that holds the given length of audio in the output format.
+		/// </summary>
+		/// <param name="milliseconds">The length of audio, in milliseconds.</param>
+		public int GetBufferSize(int milliseconds)
+		{
+			return _reader.GetBufferSize(milliseconds);
+		}
+
+		/// <summary>
+		/// Reads as many whole frames as fit. The count must hold at least one frame.
+		/// </summary>
 		public override int Read(byte[] buffer, int offset, int count)
 		{
-			return _stream.Read(buffer, offset, count);
+			if (offset < 0 || count < 0 || offset + count > buffer.Length)
+			{
+				throw new ArgumentOutOfRangeException("count");
+			}
+			var handle = GCHandle.Alloc(buffer, GCHandleType.Pinned);
+			try
+			{
+				return _reader.Read(handle.AddrOfPinnedObject() + offset, count);
+			}
+			finally
+			{
+				handle.Free();
+			}
+		}
+
+		int IWaveSource.Read(IntPtr buffer, int count)
+		{
+			return _reader.Read(buffer, count);
 		}
 
-		public override void Close()
+		protected override void Dispose(bool disposing)
 		{
-			_stream.Close();
+			if (disposing)
+			{
+				_reader.Dispose();
+			}
+			base.Dispose(disposing);
 		}
 	}
 }
@@ -1,30 +1,21 @@
 ﻿using System;
-using System.Collections.Generic;
-using System.Linq;
-using System.Text;
+
+using Floe.Interop;
 
 namespace Floe.Audio
 {
 	public static class WavProcess
 	{
+		/// <summary>
+		/// Applies gain to a buffer of 16-bit PCM samples in place and measures the resulting level.
+		/// </summary>
+		/// <param name="gain">The linear gain factor. A value of 1 leaves the samples unchanged.</param>
+		/// <param name="buffer">The sample buffer.</param>
+		/// <param name="count">The number of bytes in the buffer to process.</param>
+		/// <returns>Returns the RMS level of the processed samples, between 0 and 1.</returns>
 		public static float ApplyGain(float gain, byte[] buffer, int count)
 		{
-			float sum = 0f;
-			double min = (double)short.MinValue;
-			double max = (double)short.MaxValue;
-			for (int i = 0; i < count; i += 2)
-			{
-				short sample = BitConverter.ToInt16(buffer, i);
-				if (gain != 1f)
-				{
-					double adj = Math.Max(min, Math.Min(max, (double)sample * gain));
-					sample = (short)adj;
-					buffer[i] = (byte)sample;
-					buffer[i + 1] = (byte)(sample >> 8);
-				}
-				sum += (float)Math.Pow(2, (double)sample / (double)short.MaxValue);
-			}
-			return (float)Math.Sqrt(sum);
+			return Dsp.ApplyGain(buffer, 0, count, gain).Rms;
 		}
 	}
 }
@@ -0,0 +1,59 @@
+#include "Stdafx.h"
+#include "AcousticEchoCanceller.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		AcousticEchoCanceller::AcousticEchoCanceller(int sampleRate, int blockSize, int tailLength)
+		{
+			if(sampleRate < 8000)
+			{
+				throw gcnew System::ArgumentException("Invalid sample rate.");
+			}
+			if(blockSize < 32 || blockSize > 1024 || (blockSize & (blockSize - 1)) != 0)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("blockSize");
+			}
+			if(tailLength < 1 || tailLength > 500)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("tailLength");
+			}
+			m_sampleRate = sampleRate;
+			m_canceller = new EchoCanceller(sampleRate, blockSize, tailLength);
+		}
+
+		void AcousticEchoCanceller::AddReference(IntPtr buffer, int size)
+		{
+			m_canceller->AddReference((const short*)(void*)buffer, size / 2);
+		}
+
+		void AcousticEchoCanceller::Process(IntPtr buffer, int size)
+		{
+			if((size / 2) % m_canceller->BlockSize() != 0)
+			{
+				throw gcnew System::ArgumentException("The buffer is not a whole number of blocks.");
+			}
+			m_canceller->Process((short*)(void*)buffer, size / 2);
+		}
+
+		void AcousticEchoCanceller::Reset()
+		{
+			m_canceller->Reset();
+		}
+
+		AcousticEchoCanceller::~AcousticEchoCanceller()
+		{
+			if(m_canceller != 0)
+			{
+				delete m_canceller;
+				m_canceller = 0;
+			}
+		}
+
+		AcousticEchoCanceller::!AcousticEchoCanceller()
+		{
+			this->~AcousticEchoCanceller();
+		}
+	}
+}
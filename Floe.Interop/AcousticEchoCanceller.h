@@ -0,0 +1,82 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "EchoCanceller.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// Removes the echo of the far end from captured 16-bit mono PCM. The audio about to be played is passed to
+		// AddReference on the render thread, and each captured buffer to Process on the capture thread; the two may be
+		// called concurrently. The delay between them need not be known, as it is estimated from the signals.
+		public ref class AcousticEchoCanceller
+		{
+		private:
+			EchoCanceller *m_canceller;
+			int m_sampleRate;
+
+		public:
+			// The block size is in samples and must be a power of two between 32 and 1024. The tail length is the
+			// longest echo to cancel after the delay, in milliseconds.
+			AcousticEchoCanceller(int sampleRate, int blockSize, int tailLength);
+
+			// Adds size bytes that are about to be played.
+			void AddReference(IntPtr buffer, int size);
+
+			// Removes the echo from size bytes of captured audio in place. The size must be a whole number of blocks.
+			void Process(IntPtr buffer, int size);
+
+			// Forgets the echo path and the delay, as when either device is restarted.
+			void Reset();
+
+			property int SampleRate
+			{
+				int get()
+				{
+					return m_sampleRate;
+				}
+			}
+
+			property int BlockSize
+			{
+				int get()
+				{
+					return m_canceller->BlockSize();
+				}
+			}
+
+			// The estimated delay from the reference to the microphone, in samples.
+			property int Delay
+			{
+				int get()
+				{
+					return m_canceller->Delay();
+				}
+			}
+
+			// The echo return loss enhancement in dB.
+			property float Erle
+			{
+				float get()
+				{
+					return m_canceller->Erle();
+				}
+			}
+
+			property bool IsDoubleTalk
+			{
+				bool get()
+				{
+					return m_canceller->IsDoubleTalk();
+				}
+			}
+
+		private:
+			~AcousticEchoCanceller();
+			!AcousticEchoCanceller();
+		};
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "Stdafx.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// A voice codec that works directly on unmanaged buffers. Encode turns one packet's worth of samples into a payload
+		// and Decode does the reverse; both return the number of bytes written to the destination. Encode returns zero
+		// when the packet does not need to be sent at all.
+		public interface class IAudioCodec
+		{
+			int Encode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
+			int Decode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
+
+			// Reconstructs the packet that was lost just before the given one from redundant data carried in it. Returns
+			// zero if the codec or the packet carries no such data.
+			int Recover(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
+		};
+	}
+}
@@ -5,6 +5,8 @@ namespace Floe
 {
 	namespace Interop
 	{
+		using System::Threading::Interlocked;
+
 		AudioConverter::AudioConverter(int maxSrcSize, WaveFormat ^srcFormat, ...array<WaveFormat^> ^dstFormats)
 		{
 			m_count = dstFormats->Length;
@@ -13,22 +15,63 @@ namespace Floe
 				throw gcnew System::ArgumentException("At least one destination format must be specified.");
 			}
 
+			m_maxSrcSize = maxSrcSize;
+			m_pending = 0;
+			m_bytesCopied = m_bytesConverted = m_copies = 0;
 			m_streams = new HACMSTREAM[m_count];
 			m_headers = new LPACMSTREAMHEADER[m_count];
+			m_carry = new LPACMSTREAMHEADER[m_count];
+			m_carrySize = new int[m_count];
+			m_carryMax = new int[m_count];
 
+			// A stage converts whole blocks of its destination format, so it may leave up to the source bytes of one such
+			// block unconverted: a GSM encoder leaves up to 319 samples, not one.
 			int srcSize, dstSize;
 			for(int i = 0; i < m_count; i++)
 			{
 				ThrowOnFailure(acmStreamOpen(&m_streams[i], 0, i == 0 ? srcFormat->Data : dstFormats[i-1]->Data, dstFormats[i]->Data, 0, 0, 0, 0));
+				m_carryMax[i] = 0;
+				if(i > 0)
+				{
+					ThrowOnFailure(acmStreamSize(m_streams[i], dstFormats[i]->Data->nBlockAlign, (LPDWORD)&srcSize, ACM_STREAMSIZEF_DESTINATION));
+					m_carryMax[i] = srcSize > dstFormats[i-1]->Data->nBlockAlign ? srcSize : dstFormats[i-1]->Data->nBlockAlign;
+				}
+			}
+
+			// Each stage after the first reads straight from the destination buffer of the stage before it, so no bytes
+			// are moved between stages. A stage that leaves a partial block has a second header over a buffer of its own,
+			// with room for the block in front of the output. The partial block is kept there, and the next output is
+			// copied in behind it, which is no more than the stages used to copy every time.
+			for(int i = 0; i < m_count; i++)
+			{
 				m_headers[i] = new ACMSTREAMHEADER();
 				m_headers[i]->cbStruct = sizeof(ACMSTREAMHEADER);
-				m_headers[i]->cbSrcLength = m_headers[i]->dwSrcUser = srcSize = i == 0 ? maxSrcSize * 2 : m_headers[i-1]->cbDstLength;
-				m_headers[i]->pbSrc = (LPBYTE)malloc(srcSize);
-				ThrowOnFailure(acmStreamSize(m_streams[i], srcSize, (LPDWORD)&dstSize, ACM_STREAMSIZEF_SOURCE));
+				if(i == 0)
+				{
+					srcSize = maxSrcSize * 2;
+					m_headers[i]->pbSrc = (LPBYTE)malloc(srcSize);
+				}
+				else
+				{
+					srcSize = m_headers[i-1]->dwDstUser;
+					m_headers[i]->pbSrc = m_headers[i-1]->pbDst;
+				}
+				m_headers[i]->cbSrcLength = m_headers[i]->dwSrcUser = srcSize;
+				ThrowOnFailure(acmStreamSize(m_streams[i], srcSize + m_carryMax[i], (LPDWORD)&dstSize, ACM_STREAMSIZEF_SOURCE));
 				m_headers[i]->cbDstLength = m_headers[i]->dwDstUser = dstSize;
 				m_headers[i]->pbDst = (LPBYTE)malloc(dstSize);
 				m_headers[i]->fdwStatus = 0;
 				m_headers[i]->cbSrcLengthUsed = m_headers[i]->cbDstLengthUsed = 0;
+
+				m_carry[i] = 0;
+				m_carrySize[i] = 0;
+				if(m_carryMax[i] > 0)
+				{
+					m_carry[i] = new ACMSTREAMHEADER(*m_headers[i]);
+					m_carry[i]->cbSrcLength = m_carry[i]->dwSrcUser = srcSize + m_carryMax[i];
+					m_carry[i]->pbSrc = (LPBYTE)malloc(m_carry[i]->cbSrcLength);
+					ThrowOnFailure(acmStreamPrepareHeader(m_streams[i], m_carry[i], 0));
+				}
 				ThrowOnFailure(acmStreamPrepareHeader(m_streams[i], m_headers[i], 0));
 				m_headers[i]->cbSrcLengthUsed = m_headers[i]->cbSrcLength;
 			}
@@ -36,20 +79,82 @@ namespace Floe
 
 		int AudioConverter::Convert(IntPtr srcBuffer, int size, [Out] IntPtr &dstBuffer)
 		{
-			for(int i = 0; i < m_count; i++)
+			LPACMSTREAMHEADER hdr = m_headers[0];
+			if(m_pending + size > (int)hdr->dwSrcUser)
+			{
+				throw gcnew InteropException("Source buffer too large.");
+			}
+			if((LPBYTE)(void*)srcBuffer != hdr->pbSrc + m_pending)
+			{
+				memcpy(hdr->pbSrc + m_pending, (void*)srcBuffer, size);
+				Interlocked::Add(m_bytesCopied, size);
+				Interlocked::Increment(m_copies);
+			}
+			hdr->cbSrcLength = m_pending + size;
+			ThrowOnFailure(acmStreamConvert(m_streams[0], hdr, ACM_STREAMCONVERTF_BLOCKALIGN));
+
+			// Keep the unconverted tail at the front of the buffer, which is also where SourceBuffer points.
+			m_pending = hdr->cbSrcLength - hdr->cbSrcLengthUsed;
+			if(m_pending > 0 && hdr->cbSrcLengthUsed > 0)
+			{
+				memmove(hdr->pbSrc, hdr->pbSrc + hdr->cbSrcLengthUsed, m_pending);
+				Interlocked::Add(m_bytesCopied, m_pending);
+				Interlocked::Increment(m_copies);
+			}
+
+			int produced = hdr->cbDstLengthUsed;
+			for(int i = 1; i < m_count; i++)
 			{
-				int remainder = m_headers[i]->cbSrcLength - m_headers[i]->cbSrcLengthUsed;
-				if(remainder > 0)
+				// Output from the stage before is read where it is, unless a partial block from the last call must go in
+				// front of it, in which case it is copied in behind the block.
+				int carry = m_carrySize[i];
+				if(carry > 0)
 				{
-					memmove(m_headers[i]->pbSrc, m_headers[i]->pbSrc + m_headers[i]->cbSrcLengthUsed, remainder);
+					hdr = m_carry[i];
+					memcpy(hdr->pbSrc + carry, m_headers[i-1]->pbDst, produced);
+					Interlocked::Add(m_bytesCopied, produced);
+					Interlocked::Increment(m_copies);
 				}
-				m_headers[i]->cbSrcLength = i == 0 ? size : m_headers[i-1]->cbDstLengthUsed;
-				memcpy(m_headers[i]->pbSrc + remainder, i == 0 ? (void*)srcBuffer : m_headers[i-1]->pbDst, m_headers[i]->cbSrcLength);
-				m_headers[i]->cbSrcLength += remainder;
-				ThrowOnFailure(acmStreamConvert(m_streams[i], m_headers[i], ACM_STREAMCONVERTF_BLOCKALIGN));
+				else
+				{
+					hdr = m_headers[i];
+				}
+				hdr->cbSrcLength = produced + carry;
+				ThrowOnFailure(acmStreamConvert(m_streams[i], hdr, ACM_STREAMCONVERTF_BLOCKALIGN));
+				produced = hdr->cbDstLengthUsed;
+
+				// The stage before overwrites the shared buffer on the next call, so a partial block is kept in this one's own.
+				carry = hdr->cbSrcLength - hdr->cbSrcLengthUsed;
+				if(carry > m_carryMax[i])
+				{
+					throw gcnew InteropException("Conversion stage left more than one block unconverted.");
+				}
+				if(carry > 0 && (hdr != m_carry[i] || hdr->cbSrcLengthUsed > 0))
+				{
+					memmove(m_carry[i]->pbSrc, hdr->pbSrc + hdr->cbSrcLengthUsed, carry);
+					Interlocked::Add(m_bytesCopied, carry);
+					Interlocked::Increment(m_copies);
+				}
+				m_carrySize[i] = carry;
 			}
+
+			Interlocked::Add(m_bytesConverted, size);
 			dstBuffer = (IntPtr)m_headers[m_count-1]->pbDst;
-			return m_headers[m_count-1]->cbDstLengthUsed;
+			return produced;
+		}
+
+		int AudioConverter::Convert(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			IntPtr pDst;
+			size = this->Convert(srcBuffer, size, pDst);
+			if(dstSize < size)
+			{
+				throw gcnew InteropException("Destination buffer too small.");
+			}
+			memcpy((void*)dstBuffer, (void*)pDst, size);
+			Interlocked::Add(m_bytesCopied, size);
+			Interlocked::Increment(m_copies);
+			return size;
 		}
 
 		int AudioConverter::Convert(array<Byte>^ srcBuffer, int size, array<Byte>^ dstBuffer)
@@ -62,9 +167,25 @@ namespace Floe
 				throw gcnew InteropException("Destination buffer too small.");
 			}
 			Marshal::Copy(pDst, dstBuffer, 0, size);
+			Interlocked::Add(m_bytesCopied, size);
+			Interlocked::Increment(m_copies);
 			return size;
 		}
 
+		int AudioConverter::ConvertBatch(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			LPBYTE src = (LPBYTE)(void*)srcBuffer;
+			LPBYTE dst = (LPBYTE)(void*)dstBuffer;
+			int total = 0;
+			for(int offset = 0; offset < size; )
+			{
+				int count = size - offset < m_maxSrcSize ? size - offset : m_maxSrcSize;
+				total += this->Convert((IntPtr)(src + offset), count, (IntPtr)(dst + total), dstSize - total);
+				offset += count;
+			}
+			return total;
+		}
+
 		AudioConverter::~AudioConverter()
 		{
 			if(m_headers != 0 && m_streams != 0)
@@ -74,13 +195,34 @@ namespace Floe
 					m_headers[i]->cbSrcLength = m_headers[i]->dwSrcUser;
 					m_headers[i]->cbDstLength = m_headers[i]->dwDstUser;
 					acmStreamUnprepareHeader(m_streams[i], m_headers[i], 0);
+					if(m_carry[i] != 0)
+					{
+						m_carry[i]->cbSrcLength = m_carry[i]->dwSrcUser;
+						m_carry[i]->cbDstLength = m_carry[i]->dwDstUser;
+						acmStreamUnprepareHeader(m_streams[i], m_carry[i], 0);
+					}
 					acmStreamClose(m_streams[i], 0);
-					delete m_headers[i]->pbSrc;
-					delete m_headers[i]->pbDst;
+				}
+				for(int i = 0; i < m_count; i++)
+				{
+					// Source buffers after the first stage belong to the stage before.
+					if(i == 0)
+					{
+						free(m_headers[i]->pbSrc);
+					}
+					free(m_headers[i]->pbDst);
 					delete m_headers[i];
+					if(m_carry[i] != 0)
+					{
+						free(m_carry[i]->pbSrc);
+						delete m_carry[i];
+					}
 				}
-				delete m_headers;
-				delete m_streams;
+				delete[] m_headers;
+				delete[] m_streams;
+				delete[] m_carry;
+				delete[] m_carrySize;
+				delete[] m_carryMax;
 				m_headers = 0;
 				m_streams = 0;
 			}
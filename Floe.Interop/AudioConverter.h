@@ -16,12 +16,22 @@ namespace Floe
 		private:
 			HACMSTREAM *m_streams;
 			LPACMSTREAMHEADER *m_headers;
+			LPACMSTREAMHEADER *m_carry;
+			int *m_carrySize;
+			int *m_carryMax;
 			int m_count;
+			int m_maxSrcSize;
+			int m_pending;
+			__int64 m_bytesCopied;
+			__int64 m_bytesConverted;
+			__int64 m_copies;
 
 		public:
 			AudioConverter(int maxSrcSize, WaveFormat ^srcFormat, ...array<WaveFormat^> ^dstFormats);
 			int Convert(IntPtr srcBuffer, int size, [Out] IntPtr &dstBuffer);
+			int Convert(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
 			int Convert(array<Byte>^ srcBuffer, int size, array<Byte>^ dstBuffer);
+			int ConvertBatch(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
 
 			property int SourceBufferSize
 			{
@@ -31,6 +41,44 @@ namespace Floe
 				}
 			}
 
+			// Input may be written here directly and then passed to Convert using this pointer, in which case it is not
+			// copied. At most the maximum source size given to the constructor may be written.
+			property IntPtr SourceBuffer
+			{
+				IntPtr get()
+				{
+					return (IntPtr)(m_headers[0]->pbSrc + m_pending);
+				}
+			}
+
+			// The number of bytes staged into and out of the conversion buffers.
+			property __int64 BytesCopied
+			{
+				__int64 get()
+				{
+					return System::Threading::Interlocked::Read(m_bytesCopied);
+				}
+			}
+
+			// The number of times bytes were staged into or out of the conversion buffers, each a memcpy or memmove.
+			property __int64 Copies
+			{
+				__int64 get()
+				{
+					return System::Threading::Interlocked::Read(m_copies);
+				}
+			}
+
+			// The number of input bytes that have been converted. Together with BytesCopied, this gives the number of
+			// bytes moved per converted byte.
+			property __int64 BytesConverted
+			{
+				__int64 get()
+				{
+					return System::Threading::Interlocked::Read(m_bytesConverted);
+				}
+			}
+
 			property int DestBufferSize
 			{
 				int get()
@@ -0,0 +1,172 @@
+#include "Stdafx.h"
+#include "AudioMixer.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::Threading::Monitor;
+
+		AudioMixer::AudioMixer(int bufferSize)
+		{
+			m_inputs = gcnew array<MixerInput^>(0);
+			m_sync = gcnew System::Object();
+			m_mixSync = gcnew System::Object();
+			this->EnsureCapacity(bufferSize / 2);
+		}
+
+		MixerInput ^AudioMixer::AddInput(Stream ^source)
+		{
+			return this->Add(gcnew MixerInput(source));
+		}
+
+		MixerInput ^AudioMixer::AddInput(IWaveSource ^source)
+		{
+			return this->Add(gcnew MixerInput(source));
+		}
+
+		MixerInput ^AudioMixer::Add(MixerInput ^input)
+		{
+			Monitor::Enter(m_sync);
+			try
+			{
+				// The playback thread reads the input list without locking, so it is replaced rather than modified.
+				array<MixerInput^> ^inputs = gcnew array<MixerInput^>(m_inputs->Length + 1);
+				System::Array::Copy(m_inputs, inputs, m_inputs->Length);
+				inputs[m_inputs->Length] = input;
+				m_inputs = inputs;
+			}
+			finally
+			{
+				Monitor::Exit(m_sync);
+			}
+			return input;
+		}
+
+		void AudioMixer::RemoveInput(MixerInput ^input)
+		{
+			Monitor::Enter(m_sync);
+			try
+			{
+				int idx = System::Array::IndexOf(m_inputs, input);
+				if(idx >= 0)
+				{
+					array<MixerInput^> ^inputs = gcnew array<MixerInput^>(m_inputs->Length - 1);
+					System::Array::Copy(m_inputs, 0, inputs, 0, idx);
+					System::Array::Copy(m_inputs, idx + 1, inputs, idx, inputs->Length - idx);
+					m_inputs = inputs;
+				}
+			}
+			finally
+			{
+				Monitor::Exit(m_sync);
+			}
+
+			// A mix already under way may still hold the old list; wait for it to finish.
+			Monitor::Enter(m_mixSync);
+			Monitor::Exit(m_mixSync);
+		}
+
+		int AudioMixer::Read(array<Byte> ^buffer, int offset, int count)
+		{
+			int samples = count / 2;
+			if(samples < 1)
+			{
+				return 0;
+			}
+			pin_ptr<Byte> dst = &buffer[offset];
+			this->Mix((short*)dst, samples);
+			return samples * 2;
+		}
+
+		int AudioMixer::Read(System::IntPtr buffer, int count)
+		{
+			int samples = count / 2;
+			if(samples < 1)
+			{
+				return 0;
+			}
+			this->Mix((short*)(void*)buffer, samples);
+			return samples * 2;
+		}
+
+		void AudioMixer::Mix(short *dst, int samples)
+		{
+			this->EnsureCapacity(samples);
+			memset(m_accumulator, 0, samples * sizeof(int));
+
+			Monitor::Enter(m_mixSync);
+			try
+			{
+				this->MixInputs(samples);
+			}
+			finally
+			{
+				Monitor::Exit(m_mixSync);
+			}
+
+			SaturatePcm16(m_accumulator, dst, samples);
+		}
+
+		void AudioMixer::MixInputs(int samples)
+		{
+			array<MixerInput^> ^inputs = m_inputs;
+			for(int i = 0; i < inputs->Length; i++)
+			{
+				// Every input is read even when muted so that its jitter buffer keeps pace with playback.
+				// Sources decode straight into native memory; streams need a pass through a managed array.
+				MixerInput ^input = inputs[i];
+				if(input->Source != nullptr)
+				{
+					int read = input->Source->Read((System::IntPtr)m_samples, samples * 2) / 2;
+					if(read > 0 && input->Gain > 0.0f)
+					{
+						MixPcm16(m_accumulator, m_samples, Math::Min(read, samples), input->Gain);
+					}
+				}
+				else
+				{
+					if(m_scratch == nullptr || m_scratch->Length < samples * 2)
+					{
+						m_scratch = gcnew array<Byte>(samples * 2);
+					}
+					int read = input->InputStream->Read(m_scratch, 0, samples * 2) / 2;
+					if(read > 0 && input->Gain > 0.0f)
+					{
+						pin_ptr<Byte> src = &m_scratch[0];
+						MixPcm16(m_accumulator, (const short*)src, Math::Min(read, samples), input->Gain);
+					}
+				}
+			}
+		}
+
+		void AudioMixer::EnsureCapacity(int samples)
+		{
+			if(samples > m_capacity)
+			{
+				delete[] m_accumulator;
+				delete[] m_samples;
+				m_accumulator = new int[samples];
+				m_samples = new short[samples];
+				m_capacity = samples;
+			}
+		}
+
+		AudioMixer::~AudioMixer()
+		{
+			if(m_accumulator != 0)
+			{
+				delete[] m_accumulator;
+				delete[] m_samples;
+				m_accumulator = 0;
+				m_samples = 0;
+				m_capacity = 0;
+			}
+		}
+
+		AudioMixer::!AudioMixer()
+		{
+			this->~AudioMixer();
+		}
+	}
+}
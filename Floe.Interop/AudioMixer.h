@@ -0,0 +1,163 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "DspKernels.h"
+#include "WaveSource.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using namespace System::IO;
+		using System::Byte;
+		using System::Math;
+
+		public ref class MixerInput
+		{
+		private:
+			Stream ^m_stream;
+			IWaveSource ^m_source;
+			float m_gain;
+
+		internal:
+			MixerInput(Stream ^stream) : m_stream(stream), m_gain(1.0f)
+			{
+			}
+
+			MixerInput(IWaveSource ^source) : m_source(source), m_gain(1.0f)
+			{
+			}
+
+			property Stream ^InputStream
+			{
+				Stream ^get()
+				{
+					return m_stream;
+				}
+			}
+
+			property IWaveSource ^Source
+			{
+				IWaveSource ^get()
+				{
+					return m_source;
+				}
+			}
+
+		public:
+			property float Gain
+			{
+				float get()
+				{
+					return m_gain;
+				}
+				void set(float value)
+				{
+					m_gain = Math::Max(0.0f, Math::Min(256.0f, value));
+				}
+			}
+		};
+
+		public ref class AudioMixer : Stream, IWaveSource
+		{
+		private:
+			array<MixerInput^> ^m_inputs;
+			System::Object ^m_sync;
+			System::Object ^m_mixSync;
+			array<Byte> ^m_scratch;
+			short *m_samples;
+			int *m_accumulator;
+			int m_capacity;
+
+		public:
+			AudioMixer(int bufferSize);
+			MixerInput ^AddInput(Stream ^source);
+			MixerInput ^AddInput(IWaveSource ^source);
+
+			// Once this returns, the input is no longer being read, and its source may be disposed.
+			void RemoveInput(MixerInput ^input);
+
+			property int InputCount
+			{
+				int get()
+				{
+					return m_inputs->Length;
+				}
+			}
+
+			virtual property bool CanRead
+			{
+				bool get() override
+				{
+					return true;
+				}
+			}
+
+			virtual property bool CanSeek
+			{
+				bool get() override
+				{
+					return false;
+				}
+			}
+
+			virtual property bool CanWrite
+			{
+				bool get() override
+				{
+					return false;
+				}
+			}
+
+			virtual property long long Length
+			{
+				long long get() override
+				{
+					throw gcnew System::NotSupportedException();
+				}
+			}
+
+			virtual property long long Position
+			{
+				long long get() override
+				{
+					throw gcnew System::NotSupportedException();
+				}
+				void set(long long) override
+				{
+					throw gcnew System::NotSupportedException();
+				}
+			}
+
+			virtual void Flush() override
+			{
+			}
+
+			virtual long long Seek(long long, SeekOrigin) override
+			{
+				throw gcnew System::NotSupportedException();
+			}
+
+			virtual void SetLength(long long) override
+			{
+				throw gcnew System::NotSupportedException();
+			}
+
+			virtual void Write(array<Byte>^, int, int) override
+			{
+				throw gcnew System::NotSupportedException();
+			}
+
+			virtual int Read(array<Byte> ^buffer, int offset, int count) override;
+			virtual int Read(System::IntPtr buffer, int count);
+
+		private:
+			MixerInput ^Add(MixerInput ^input);
+			void Mix(short *dst, int samples);
+			void MixInputs(int samples);
+			void EnsureCapacity(int samples);
+			~AudioMixer();
+			!AudioMixer();
+		};
+	}
+}
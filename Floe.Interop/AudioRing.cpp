@@ -0,0 +1,137 @@
+#include "Stdafx.h"
+#include "AudioRing.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		AudioRing::AudioRing(int capacity)
+		{
+			if(capacity < 1 || capacity > (1 << 24))
+			{
+				throw gcnew System::ArgumentOutOfRangeException("capacity");
+			}
+			m_ring = new ByteRing(capacity);
+			m_acquiredWrite = m_acquiredRead = 0;
+			m_overruns = m_underruns = 0;
+		}
+
+		void AudioRing::CheckRange(array<Byte> ^buffer, int offset, int count)
+		{
+			if(buffer == nullptr)
+			{
+				throw gcnew System::ArgumentNullException("buffer");
+			}
+			if(offset < 0 || count < 0 || offset + count > buffer->Length)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("count");
+			}
+		}
+
+		int AudioRing::Read(array<Byte> ^buffer, int offset, int count)
+		{
+			CheckRange(buffer, offset, count);
+			if(count < 1)
+			{
+				return 0;
+			}
+			m_ring->Wait(count, INFINITE);
+			pin_ptr<Byte> dst = &buffer[offset];
+			return m_ring->Read(dst, count);
+		}
+
+		void AudioRing::Write(array<Byte> ^buffer, int offset, int count)
+		{
+			CheckRange(buffer, offset, count);
+			if(count < 1)
+			{
+				return;
+			}
+			pin_ptr<Byte> src = &buffer[offset];
+			if(m_ring->Write(src, count) < count)
+			{
+				m_overruns++;
+			}
+		}
+
+		int AudioRing::Read(IntPtr buffer, int count)
+		{
+			unsigned char *dst = (unsigned char*)(void*)buffer;
+			int read = m_ring->Read(dst, count);
+			if(read == 0 && m_ring->IsClosed())
+			{
+				return 0;
+			}
+			if(read < count)
+			{
+				memset(dst + read, 0, count - read);
+				m_underruns++;
+			}
+			return count;
+		}
+
+		void AudioRing::Write(IntPtr buffer, int count)
+		{
+			if(m_ring->Write((const unsigned char*)(void*)buffer, count) < count)
+			{
+				m_overruns++;
+			}
+		}
+
+		IntPtr AudioRing::AcquireWrite(int %count)
+		{
+			int size;
+			unsigned char *span = m_ring->BeginWrite(&size);
+			m_acquiredWrite = count = size;
+			return IntPtr(span);
+		}
+
+		void AudioRing::CommitWrite(int count)
+		{
+			if(count < 0 || count > m_acquiredWrite)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("count");
+			}
+			m_acquiredWrite = 0;
+			m_ring->EndWrite(count);
+		}
+
+		IntPtr AudioRing::AcquireRead(int %count)
+		{
+			int size;
+			const unsigned char *span = m_ring->BeginRead(&size);
+			m_acquiredRead = count = size;
+			return IntPtr((void*)span);
+		}
+
+		void AudioRing::CommitRead(int count)
+		{
+			if(count < 0 || count > m_acquiredRead)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("count");
+			}
+			m_acquiredRead = 0;
+			m_ring->EndRead(count);
+		}
+
+		void AudioRing::Complete()
+		{
+			m_ring->Close();
+		}
+
+		AudioRing::~AudioRing()
+		{
+			if(m_ring != 0)
+			{
+				m_ring->Close();
+				delete m_ring;
+				m_ring = 0;
+			}
+		}
+
+		AudioRing::!AudioRing()
+		{
+			this->~AudioRing();
+		}
+	}
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "ByteRing.h"
+#include "WaveSink.h"
+#include "WaveSource.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using namespace System::IO;
+		using namespace System::Runtime::InteropServices;
+		using System::Byte;
+		using System::IntPtr;
+
+		// A fixed-capacity audio queue between one writing thread and one reading thread, such as a recording device and
+		// a playback device. Nothing is allocated or locked once it is constructed.
+		//
+		// As a stream, Read blocks until the whole count is queued or the ring is closed, and Write never blocks: what
+		// does not fit is dropped and counted as an overrun. As a wave sink and source, it can be handed straight to
+		// WaveIn and WaveOut; reads then never block, and a short read is filled with silence and counted as an
+		// underrun. The Acquire and Commit methods give direct access to the ring's memory, one contiguous span at a
+		// time, for writers and readers that can work in place.
+		public ref class AudioRing : Stream, IWaveSink, IWaveSource
+		{
+		private:
+			ByteRing *m_ring;
+			int m_acquiredWrite;
+			int m_acquiredRead;
+			int m_overruns;
+			int m_underruns;
+
+		public:
+			// The capacity is in bytes, and is rounded up to a power of two.
+			AudioRing(int capacity);
+
+			virtual int Read(array<Byte> ^buffer, int offset, int count) override;
+			virtual void Write(array<Byte> ^buffer, int offset, int count) override;
+			virtual int Read(IntPtr buffer, int count);
+			virtual void Write(IntPtr buffer, int count);
+
+			// Returns the next span that can be written, and its size in bytes, which may be less than the free space
+			// when the span reaches the end of the ring.
+			IntPtr AcquireWrite([Out] int %count);
+			void CommitWrite(int count);
+
+			// Returns the next span that can be read, and its size in bytes.
+			IntPtr AcquireRead([Out] int %count);
+			void CommitRead(int count);
+
+			// Marks the end of the stream. A blocked Read returns what is queued, and reads return zero once the ring is
+			// drained. The ring must not be disposed while the other thread may still be using it.
+			void Complete();
+
+			// The number of bytes queued.
+			property int Count
+			{
+				int get()
+				{
+					return m_ring->Count();
+				}
+			}
+
+			property int Capacity
+			{
+				int get()
+				{
+					return m_ring->Capacity();
+				}
+			}
+
+			// The number of writes that did not entirely fit.
+			property int Overruns
+			{
+				int get()
+				{
+					return m_overruns;
+				}
+			}
+
+			// The number of wave source reads that had to be padded with silence.
+			property int Underruns
+			{
+				int get()
+				{
+					return m_underruns;
+				}
+			}
+
+			virtual property bool CanRead
+			{
+				bool get() override
+				{
+					return true;
+				}
+			}
+
+			virtual property bool CanSeek
+			{
+				bool get() override
+				{
+					return false;
+				}
+			}
+
+			virtual property bool CanWrite
+			{
+				bool get() override
+				{
+					return true;
+				}
+			}
+
+			virtual property long long Length
+			{
+				long long get() override
+				{
+					throw gcnew System::NotSupportedException();
+				}
+			}
+
+			virtual property long long Position
+			{
+				long long get() override
+				{
+					throw gcnew System::NotSupportedException();
+				}
+				void set(long long) override
+				{
+					throw gcnew System::NotSupportedException();
+				}
+			}
+
+			virtual void Flush() override
+			{
+			}
+
+			virtual long long Seek(long long, SeekOrigin) override
+			{
+				throw gcnew System::NotSupportedException();
+			}
+
+			virtual void SetLength(long long) override
+			{
+				throw gcnew System::NotSupportedException();
+			}
+
+		private:
+			static void CheckRange(array<Byte> ^buffer, int offset, int count);
+			~AudioRing();
+			!AudioRing();
+		};
+	}
+}
@@ -0,0 +1,41 @@
+#include "Stdafx.h"
+#include "AutomaticGainControl.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		AutomaticGainControl::AutomaticGainControl(int sampleRate)
+		{
+			if(sampleRate < 8000)
+			{
+				throw gcnew System::ArgumentException("Invalid sample rate.");
+			}
+			m_controller = new GainController(sampleRate);
+		}
+
+		void AutomaticGainControl::Process(IntPtr buffer, int size)
+		{
+			m_controller->Process((short*)(void*)buffer, size / 2);
+		}
+
+		void AutomaticGainControl::Reset()
+		{
+			m_controller->Reset();
+		}
+
+		AutomaticGainControl::~AutomaticGainControl()
+		{
+			if(m_controller != 0)
+			{
+				delete m_controller;
+				m_controller = 0;
+			}
+		}
+
+		AutomaticGainControl::!AutomaticGainControl()
+		{
+			this->~AutomaticGainControl();
+		}
+	}
+}
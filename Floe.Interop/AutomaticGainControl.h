@@ -0,0 +1,76 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "GainController.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// Adjusts the gain of 16-bit mono PCM so that speech reaches a steady level, whatever the microphone's own
+		// sensitivity. The gain falls quickly and rises slowly, and is never so high that the signal clips.
+		public ref class AutomaticGainControl
+		{
+		private:
+			GainController *m_controller;
+
+		public:
+			AutomaticGainControl(int sampleRate);
+
+			// Applies the gain to size bytes in place.
+			void Process(IntPtr buffer, int size);
+
+			// Returns the gain to unity, as when the device is restarted.
+			void Reset();
+
+			// The level that speech is brought to, in dB relative to full scale.
+			property float TargetLevel
+			{
+				float get()
+				{
+					return m_controller->TargetLevel();
+				}
+				void set(float value)
+				{
+					if(value < -40.0f || value > 0.0f)
+					{
+						throw gcnew System::ArgumentOutOfRangeException("value");
+					}
+					m_controller->SetTargetLevel(value);
+				}
+			}
+
+			// The most gain that is applied, in dB.
+			property float MaxGain
+			{
+				float get()
+				{
+					return m_controller->MaxGain();
+				}
+				void set(float value)
+				{
+					if(value < 0.0f || value > 40.0f)
+					{
+						throw gcnew System::ArgumentOutOfRangeException("value");
+					}
+					m_controller->SetMaxGain(value);
+				}
+			}
+
+			// The gain currently applied, in dB.
+			property float Gain
+			{
+				float get()
+				{
+					return m_controller->Gain();
+				}
+			}
+
+		private:
+			~AutomaticGainControl();
+			!AutomaticGainControl();
+		};
+	}
+}
@@ -0,0 +1,148 @@
+#include <Windows.h>
+#include <string.h>
+#include "ByteRing.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		ByteRing::ByteRing(int capacity)
+		{
+			m_capacity = 1;
+			while(m_capacity < capacity)
+			{
+				m_capacity <<= 1;
+			}
+			m_buffer = new unsigned char[m_capacity];
+			m_event = CreateEvent(0, FALSE, FALSE, 0);
+			m_head = m_tail = 0;
+			m_waiting = m_wanted = 0;
+			m_closed = 0;
+		}
+
+		ByteRing::~ByteRing()
+		{
+			CloseHandle(m_event);
+			delete[] m_buffer;
+		}
+
+		int ByteRing::Write(const unsigned char *data, int count)
+		{
+			long head = m_head;
+			long space = m_capacity - (head - m_tail);
+			if(count > space)
+			{
+				count = space;
+			}
+			if(count <= 0)
+			{
+				return 0;
+			}
+			long offset = head & (m_capacity - 1);
+			long first = m_capacity - offset < count ? m_capacity - offset : count;
+			memcpy(m_buffer + offset, data, first);
+			memcpy(m_buffer, data + first, count - first);
+			this->Publish(count);
+			return count;
+		}
+
+		int ByteRing::Read(unsigned char *data, int count)
+		{
+			long tail = m_tail;
+			long queued = m_head - tail;
+			if(count > queued)
+			{
+				count = queued;
+			}
+			if(count <= 0)
+			{
+				return 0;
+			}
+			long offset = tail & (m_capacity - 1);
+			long first = m_capacity - offset < count ? m_capacity - offset : count;
+			memcpy(data, m_buffer + offset, first);
+			memcpy(data + first, m_buffer, count - first);
+			InterlockedExchangeAdd(&m_tail, count);
+			return count;
+		}
+
+		unsigned char *ByteRing::BeginWrite(int *count)
+		{
+			long head = m_head;
+			long offset = head & (m_capacity - 1);
+			long space = m_capacity - (head - m_tail);
+			*count = (int)(m_capacity - offset < space ? m_capacity - offset : space);
+			return m_buffer + offset;
+		}
+
+		void ByteRing::EndWrite(int count)
+		{
+			if(count > 0)
+			{
+				this->Publish(count);
+			}
+		}
+
+		const unsigned char *ByteRing::BeginRead(int *count)
+		{
+			long tail = m_tail;
+			long offset = tail & (m_capacity - 1);
+			long queued = m_head - tail;
+			*count = (int)(m_capacity - offset < queued ? m_capacity - offset : queued);
+			return m_buffer + offset;
+		}
+
+		void ByteRing::EndRead(int count)
+		{
+			if(count > 0)
+			{
+				InterlockedExchangeAdd(&m_tail, count);
+			}
+		}
+
+		bool ByteRing::Wait(int count, unsigned long timeout)
+		{
+			if(count > m_capacity)
+			{
+				count = m_capacity;
+			}
+			DWORD start = GetTickCount();
+			while(m_head - m_tail < count && !m_closed)
+			{
+				// The flag is raised before the count is checked again, and the producer publishes before it looks at
+				// the flag; both are full barriers, so either this thread sees the new bytes or the producer sees the
+				// flag and signals.
+				m_wanted = count;
+				InterlockedExchange(&m_waiting, 1);
+				if(m_head - m_tail >= count || m_closed)
+				{
+					InterlockedExchange(&m_waiting, 0);
+					break;
+				}
+				DWORD elapsed = GetTickCount() - start;
+				if(timeout != INFINITE && elapsed >= timeout)
+				{
+					InterlockedExchange(&m_waiting, 0);
+					break;
+				}
+				WaitForSingleObject(m_event, timeout == INFINITE ? INFINITE : timeout - elapsed);
+			}
+			return m_head - m_tail >= count;
+		}
+
+		void ByteRing::Close()
+		{
+			InterlockedExchange(&m_closed, 1);
+			SetEvent(m_event);
+		}
+
+		void ByteRing::Publish(int count)
+		{
+			long queued = InterlockedExchangeAdd(&m_head, count) + count - m_tail;
+			if(m_waiting && queued >= m_wanted && InterlockedExchange(&m_waiting, 0) != 0)
+			{
+				SetEvent(m_event);
+			}
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+// A fixed-capacity byte ring for one producer thread and one consumer thread, without locks. The producer only
+// ever moves the head and the consumer only the tail; both are free-running counters, and the capacity is a power of
+// two so that they may wrap. The head and the tail are kept on separate cache lines, so that the two threads do not
+// contend for the same line on every write and read.
+//
+// A consumer that has to block says how many bytes it is waiting for, and the producer signals it only once that many
+// are queued, rather than after every write. When nobody is waiting, a write costs no kernel call at all.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class ByteRing
+		{
+		private:
+			static const int CacheLine = 64;
+
+			unsigned char *m_buffer;
+			long m_capacity;
+			HANDLE m_event;
+			char m_pad0[CacheLine];
+
+			// Written by the producer.
+			volatile long m_head;
+			char m_pad1[CacheLine - sizeof(long)];
+
+			// Written by the consumer.
+			volatile long m_tail;
+			volatile long m_waiting;
+			volatile long m_wanted;
+			char m_pad2[CacheLine - 3 * sizeof(long)];
+
+			volatile long m_closed;
+
+		public:
+			// The capacity is rounded up to a power of two.
+			ByteRing(int capacity);
+			~ByteRing();
+
+			// Copies as much as fits and returns the number of bytes written. Called from the producer.
+			int Write(const unsigned char *data, int count);
+
+			// Copies out as much as is queued, up to count, and returns the number of bytes read. Called from the
+			// consumer.
+			int Read(unsigned char *data, int count);
+
+			// Returns the largest free span that can be written in one piece. Nothing is visible to the consumer
+			// until EndWrite publishes it.
+			unsigned char *BeginWrite(int *count);
+			void EndWrite(int count);
+
+			// Returns the largest queued span that can be read in one piece. The space is not given back to the
+			// producer until EndRead releases it.
+			const unsigned char *BeginRead(int *count);
+			void EndRead(int count);
+
+			// Blocks the consumer until at least count bytes are queued or the ring is closed, or until the timeout in
+			// milliseconds passes. Returns whether count bytes are queued.
+			bool Wait(int count, unsigned long timeout);
+
+			// Wakes a waiting consumer for good. Whatever is still queued may be read.
+			void Close();
+
+			bool IsClosed() const
+			{
+				return m_closed != 0;
+			}
+
+			int Count() const
+			{
+				return (int)(m_head - m_tail);
+			}
+
+			int Capacity() const
+			{
+				return (int)m_capacity;
+			}
+
+		private:
+			void Publish(int count);
+			ByteRing(const ByteRing&);
+			ByteRing &operator=(const ByteRing&);
+		};
+	}
+}
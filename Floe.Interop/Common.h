@@ -38,6 +38,12 @@ namespace Floe
 			}
 		};
 
+		public enum class WaveDeviceKind
+		{
+			Default,
+			Null
+		};
+
 		inline void ThrowOnFailure(HRESULT hr)
 		{
 			switch(hr)
@@ -0,0 +1,80 @@
+#include "Stdafx.h"
+#include "ConferenceMixer.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		ConferenceMixer::ConferenceMixer(int samplesPerPacket, int maxInputs, int maxSpeakers)
+		{
+			if(samplesPerPacket < 1 || maxInputs < 1 || maxSpeakers < 1)
+			{
+				throw gcnew System::ArgumentException("Invalid mixer dimensions.");
+			}
+			m_samples = samplesPerPacket;
+			m_maxInputs = maxInputs;
+			m_mixer = new MixMinus(samplesPerPacket, maxInputs, maxSpeakers);
+		}
+
+		IntPtr ConferenceMixer::GetInput(int index)
+		{
+			this->CheckIndex(index);
+			return IntPtr(m_mixer->Input(index));
+		}
+
+		void ConferenceMixer::SetInputLength(int index, int count)
+		{
+			this->CheckIndex(index);
+			m_mixer->SetLength(index, count / 2);
+		}
+
+		void ConferenceMixer::ResetInput(int index)
+		{
+			this->CheckIndex(index);
+			m_mixer->ResetInput(index);
+		}
+
+		void ConferenceMixer::Mix(int count)
+		{
+			if(count < 0 || count > m_maxInputs)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("count");
+			}
+			m_mixer->Mix(count);
+		}
+
+		IntPtr ConferenceMixer::GetOutput(int index)
+		{
+			this->CheckIndex(index);
+			return IntPtr((void*)m_mixer->Output(index));
+		}
+
+		int ConferenceMixer::GetSpeakerSlot(int index)
+		{
+			this->CheckIndex(index);
+			return m_mixer->SpeakerSlot(index);
+		}
+
+		void ConferenceMixer::CheckIndex(int index)
+		{
+			if(index < 0 || index >= m_maxInputs)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("index");
+			}
+		}
+
+		ConferenceMixer::~ConferenceMixer()
+		{
+			if(m_mixer != 0)
+			{
+				delete m_mixer;
+				m_mixer = 0;
+			}
+		}
+
+		ConferenceMixer::!ConferenceMixer()
+		{
+			this->~ConferenceMixer();
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "MixMinus.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// Mixes the loudest few of a conference's decoded 16-bit mono streams into one stream per listener, leaving each
+		// speaker's own voice out of what it hears. Inputs are numbered; each round, every input's frame is decoded into
+		// its buffer, Mix is called, and each listener's mix is taken from GetOutput.
+		public ref class ConferenceMixer
+		{
+		private:
+			MixMinus *m_mixer;
+			int m_samples;
+			int m_maxInputs;
+
+		public:
+			ConferenceMixer(int samplesPerPacket, int maxInputs, int maxSpeakers);
+
+			// The buffer that the next frame of an input is decoded into, holding one packet of samples.
+			IntPtr GetInput(int index);
+
+			// Sets how many bytes of the input's buffer hold audio this round; the rest is silence.
+			void SetInputLength(int index, int count);
+
+			// Forgets an input's level history and its place as a speaker, when its stream is removed or the input is
+			// given to another stream.
+			void ResetInput(int index);
+
+			// Selects the speakers among inputs 0..count-1 and builds the mixes.
+			void Mix(int count);
+
+			// The mix that the listener at an input should hear, holding one packet of samples.
+			IntPtr GetOutput(int index);
+
+			// The speaker slot of an input in the last round (0..MaxSpeakers-1), or -1 if it was not selected. Listeners that
+			// are not speaking all hear the same mix.
+			int GetSpeakerSlot(int index);
+
+			property int SpeakerCount
+			{
+				int get()
+				{
+					return m_mixer->SpeakerCount();
+				}
+			}
+
+			property int MaxSpeakers
+			{
+				int get()
+				{
+					return m_mixer->MaxSpeakerCount();
+				}
+			}
+
+		private:
+			void CheckIndex(int index);
+			~ConferenceMixer();
+			!ConferenceMixer();
+		};
+	}
+}
@@ -0,0 +1,83 @@
+#include "Stdafx.h"
+#include "DriftCorrector.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		DriftCorrector::DriftCorrector(int maxSize)
+		{
+			if(maxSize < 2)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("maxSize");
+			}
+			m_maxSize = maxSize;
+			m_acquired = 0;
+			m_resampler = new VariableResampler(maxSize / 2);
+			m_drift = 0.0f;
+			m_ratio = 1.0;
+		}
+
+		int DriftCorrector::Needed(int size)
+		{
+			return m_resampler->Needed(size / 2, m_ratio) * 2;
+		}
+
+		void DriftCorrector::Write(IntPtr buffer, int size)
+		{
+			if(size > m_maxSize || !m_resampler->Write((const short*)(void*)buffer, size / 2))
+			{
+				throw gcnew System::ArgumentException("The input does not fit.");
+			}
+		}
+
+		IntPtr DriftCorrector::AcquireWrite(int size)
+		{
+			short *span = size <= m_maxSize ? m_resampler->BeginWrite(size / 2) : 0;
+			if(span == 0)
+			{
+				throw gcnew System::ArgumentException("The input does not fit.");
+			}
+			m_acquired = size;
+			return IntPtr(span);
+		}
+
+		void DriftCorrector::CommitWrite(int size)
+		{
+			if(size < 0 || size > m_acquired)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("size");
+			}
+			m_acquired = 0;
+			m_resampler->EndWrite(size / 2);
+		}
+
+		int DriftCorrector::Read(IntPtr buffer, int size)
+		{
+			if(size > m_maxSize)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("size");
+			}
+			return m_resampler->Read((short*)(void*)buffer, size / 2, m_ratio) * 2;
+		}
+
+		void DriftCorrector::Reset()
+		{
+			m_resampler->Reset();
+		}
+
+		DriftCorrector::~DriftCorrector()
+		{
+			if(m_resampler != 0)
+			{
+				delete m_resampler;
+				m_resampler = 0;
+			}
+		}
+
+		DriftCorrector::!DriftCorrector()
+		{
+			this->~DriftCorrector();
+		}
+	}
+}
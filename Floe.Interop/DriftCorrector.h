@@ -0,0 +1,64 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "VariableResampler.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// Stretches or squeezes 16-bit mono PCM by a few hundred parts per million at most, so that audio from a sender
+		// whose clock drifts can be played without the queue in front of it slowly filling up or running dry. Input is
+		// written as it is decoded, or decoded straight into the corrector, and output is read as the device asks for it;
+		// Needed says how much more input a read will take.
+		public ref class DriftCorrector
+		{
+		private:
+			VariableResampler *m_resampler;
+			int m_maxSize;
+			int m_acquired;
+			double m_ratio;
+			float m_drift;
+
+		public:
+			// Up to maxSize bytes may be written or read at a time.
+			DriftCorrector(int maxSize);
+
+			// The number of bytes still to be written before size bytes can be read.
+			int Needed(int size);
+
+			void Write(IntPtr buffer, int size);
+
+			// Returns where up to size bytes of input may be decoded in place. CommitWrite then appends what was
+			// decoded there.
+			IntPtr AcquireWrite(int size);
+			void CommitWrite(int size);
+
+			// Reads up to size bytes, as far as the input allows, and returns the number of bytes read.
+			int Read(IntPtr buffer, int size);
+
+			// Drops all input, as at the start of a new stream.
+			void Reset();
+
+			// How much faster the input's clock runs than the output's, in parts per million, from -1000 to 1000.
+			property float Drift
+			{
+				float get()
+				{
+					return m_drift;
+				}
+				void set(float value)
+				{
+					m_drift = value < -1000.0f ? -1000.0f : value > 1000.0f ? 1000.0f : value;
+					m_ratio = 1.0 + m_drift * 1e-6;
+				}
+			}
+
+		private:
+			~DriftCorrector();
+			!DriftCorrector();
+		};
+	}
+}
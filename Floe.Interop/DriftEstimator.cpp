@@ -0,0 +1,102 @@
+#include "DriftEstimator.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		DriftEstimator::DriftEstimator(int clockRate)
+		{
+			m_window = (double)clockRate * WindowSeconds;
+			m_limit = clockRate;
+			this->Reset();
+		}
+
+		void DriftEstimator::Reset()
+		{
+			m_started = false;
+			m_count = m_head = 0;
+			m_windowHasMin = false;
+			m_drift = 0.0f;
+		}
+
+		void DriftEstimator::Update(double localTime, double remoteTime)
+		{
+			if(!m_started)
+			{
+				m_windowStart = localTime;
+				m_started = true;
+			}
+
+			// Windows close on the local clock, whether or not anything was read in them, as the remote end may be
+			// silent for a while.
+			while(localTime - m_windowStart >= m_window)
+			{
+				this->CloseWindow();
+			}
+
+			double transit = localTime - remoteTime;
+			if(m_count > 0)
+			{
+				double predicted = m_minima[(m_head + Windows - 1) % Windows];
+				if(transit - predicted > m_limit || predicted - transit > m_limit)
+				{
+					this->Reset();
+					this->Update(localTime, remoteTime);
+					return;
+				}
+			}
+			if(!m_windowHasMin || transit < m_windowMin)
+			{
+				m_windowMin = transit;
+				m_windowHasMin = true;
+			}
+		}
+
+		void DriftEstimator::CloseWindow()
+		{
+			if(m_windowHasMin)
+			{
+				m_times[m_head] = m_windowStart;
+				m_minima[m_head] = m_windowMin;
+				m_head = (m_head + 1) % Windows;
+				if(m_count < Windows)
+				{
+					m_count++;
+				}
+				this->Fit();
+			}
+			m_windowStart += m_window;
+			m_windowHasMin = false;
+		}
+
+		void DriftEstimator::Fit()
+		{
+			if(m_count < MinWindows)
+			{
+				return;
+			}
+
+			// The times are taken relative to the newest window, so that their squares stay small.
+			double origin = m_times[(m_head + Windows - 1) % Windows];
+			double meanTime = 0.0, meanMin = 0.0;
+			for(int i = 0; i < m_count; i++)
+			{
+				meanTime += m_times[i] - origin;
+				meanMin += m_minima[i];
+			}
+			meanTime /= m_count;
+			meanMin /= m_count;
+			double covariance = 0.0, variance = 0.0;
+			for(int i = 0; i < m_count; i++)
+			{
+				double t = m_times[i] - origin - meanTime;
+				covariance += t * (m_minima[i] - meanMin);
+				variance += t * t;
+			}
+
+			// A fast remote clock gains on the local one, so the transit falls.
+			double drift = variance > 0.0 ? -covariance / variance * 1e6 : 0.0;
+			m_drift = (float)(drift > MaxDrift ? MaxDrift : drift < -MaxDrift ? -MaxDrift : drift);
+		}
+	}
+}
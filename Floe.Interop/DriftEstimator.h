@@ -0,0 +1,59 @@
+#pragma once
+
+// Estimates how much faster a remote clock runs than a local one, from pairs of readings of the two taken at the same
+// moment. The difference between the readings, the transit, grows or shrinks steadily with the drift, but any delay
+// between the remote reading and the local one (network delay, or a thread waking late) only ever adds to it, so the
+// smallest transit in each window of a few seconds is taken as the clean value. The drift is the slope of a line fitted
+// through the last minute or so of these minima.
+//
+// A transit that jumps far off the line means that the remote clock was restarted, and the estimate starts over.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class DriftEstimator
+		{
+		private:
+			static const int WindowSeconds = 2;
+			static const int Windows = 32;
+			static const int MinWindows = 5;
+			static const int MaxDrift = 1000; // ppm
+
+			double m_window;
+			double m_limit;
+			bool m_started;
+			double m_windowStart;
+			double m_windowMin;
+			bool m_windowHasMin;
+			double m_times[Windows];
+			double m_minima[Windows];
+			int m_count;
+			int m_head;
+			volatile float m_drift;
+
+		public:
+			// The clock rate is the nominal rate of both clocks, in ticks per second.
+			DriftEstimator(int clockRate);
+
+			// Records a reading of the remote clock and of the local clock when it was taken, both in ticks.
+			void Update(double localTime, double remoteTime);
+
+			// Forgets the history.
+			void Reset();
+
+			// The drift in parts per million; positive when the remote clock runs fast. This is zero until enough
+			// history has been gathered. It may be read from another thread.
+			float Drift() const
+			{
+				return m_drift;
+			}
+
+		private:
+			void CloseWindow();
+			void Fit();
+			DriftEstimator(const DriftEstimator&);
+			DriftEstimator &operator=(const DriftEstimator&);
+		};
+	}
+}
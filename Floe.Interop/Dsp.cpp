@@ -0,0 +1,78 @@
+#include "Stdafx.h"
+#include "Dsp.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		SignalLevel Dsp::ApplyGain(IntPtr buffer, int count, float gain)
+		{
+			PcmLevel level;
+			ApplyGainPcm16((short*)(void*)buffer, count / 2, gain, &level);
+			return SignalLevel(level.rms, level.peak);
+		}
+
+		SignalLevel Dsp::ApplyGain(IntPtr buffer, int count, float gain, DspPath path)
+		{
+			if(!IsSupported(path))
+			{
+				throw gcnew System::NotSupportedException("This CPU cannot run that version of the kernels.");
+			}
+
+			PcmLevel level;
+			short *samples = (short*)(void*)buffer;
+			switch(path)
+			{
+			case DspPath::Scalar:
+				Kernels::ApplyGainPcm16Scalar(samples, count / 2, gain, &level);
+				break;
+			case DspPath::Sse2:
+				Kernels::ApplyGainPcm16Sse2(samples, count / 2, gain, &level);
+				break;
+#ifdef FLOE_HAVE_AVX2
+			case DspPath::Avx2:
+				Kernels::ApplyGainPcm16Avx2(samples, count / 2, gain, &level);
+				break;
+#endif
+			default:
+				ApplyGainPcm16(samples, count / 2, gain, &level);
+				break;
+			}
+			return SignalLevel(level.rms, level.peak);
+		}
+
+		SignalLevel Dsp::ApplyGain(array<Byte> ^buffer, int offset, int count, float gain)
+		{
+			if(offset < 0 || count < 0 || offset + count > buffer->Length)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("count");
+			}
+			if(count < 2)
+			{
+				return SignalLevel(0.0f, 0.0f);
+			}
+
+			pin_ptr<Byte> ptr = &buffer[offset];
+			PcmLevel level;
+			ApplyGainPcm16((short*)ptr, count / 2, gain, &level);
+			return SignalLevel(level.rms, level.peak);
+		}
+
+		bool Dsp::IsSupported(DspPath path)
+		{
+			switch(path)
+			{
+			case DspPath::Sse2:
+				return CpuHasSse2();
+			case DspPath::Avx2:
+#ifdef FLOE_HAVE_AVX2
+				return CpuHasAvx2();
+#else
+				return false;
+#endif
+			default:
+				return true;
+			}
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "DspKernels.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+		using System::Byte;
+
+		public value class SignalLevel
+		{
+		private:
+			float m_rms;
+			float m_peak;
+
+		internal:
+			SignalLevel(float rms, float peak) : m_rms(rms), m_peak(peak)
+			{
+			}
+
+		public:
+			property float Rms
+			{
+				float get()
+				{
+					return m_rms;
+				}
+			}
+
+			property float Peak
+			{
+				float get()
+				{
+					return m_peak;
+				}
+			}
+		};
+
+		// The versions of a kernel. Best is whichever the CPU supports that runs the fastest, which is what the other
+		// calls use; the rest are there so that tests can check each version against the others.
+		public enum class DspPath
+		{
+			Best,
+			Scalar,
+			Sse2,
+			Avx2
+		};
+
+		public ref class Dsp abstract sealed
+		{
+		public:
+			static SignalLevel ApplyGain(IntPtr buffer, int count, float gain);
+			static SignalLevel ApplyGain(IntPtr buffer, int count, float gain, DspPath path);
+			static SignalLevel ApplyGain(array<Byte> ^buffer, int offset, int count, float gain);
+
+			// Whether this CPU, and this build, can run the given version of the kernels.
+			static bool IsSupported(DspPath path);
+		};
+	}
+}
@@ -0,0 +1,806 @@
+#include <math.h>
+#include <intrin.h>
+#include <emmintrin.h>
+#ifdef FLOE_HAVE_AVX2
+#include <immintrin.h>
+#endif
+#include "DspKernels.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		typedef void (*ApplyGainPcm16Func)(short*, int, float, PcmLevel*);
+		typedef void (*MixPcm16Func)(int*, const short*, int, float);
+		typedef void (*SaturatePcm16Func)(const int*, short*, int);
+		typedef float (*DotProductFunc)(const float*, const float*, int);
+		typedef void (*FftButterfliesFunc)(float*, float*, const float*, const float*, int);
+		typedef void (*Pcm8ToPcm16Func)(const unsigned char*, short*, int);
+		typedef void (*Pcm24ToPcm16Func)(const unsigned char*, short*, int);
+		typedef void (*Pcm32ToPcm16Func)(const int*, short*, int);
+		typedef void (*FloatToPcm16Func)(const float*, short*, int);
+
+		static int s_cpuFeatures = -1;
+		static ApplyGainPcm16Func s_applyGain = 0;
+		static MixPcm16Func s_mix = 0;
+		static SaturatePcm16Func s_saturate = 0;
+		static DotProductFunc s_dot = 0;
+		static FftButterfliesFunc s_butterflies = 0;
+		static Pcm8ToPcm16Func s_pcm8 = 0;
+		static Pcm24ToPcm16Func s_pcm24 = 0;
+		static Pcm32ToPcm16Func s_pcm32 = 0;
+		static FloatToPcm16Func s_float = 0;
+
+		enum CpuFeature
+		{
+			CpuFeatureSse2 = 1,
+			CpuFeatureAvx2 = 2
+		};
+
+		static int GetCpuFeatures()
+		{
+			if(s_cpuFeatures < 0)
+			{
+				int features = 0;
+				int info[4];
+				__cpuid(info, 0);
+				int maxLeaf = info[0];
+				__cpuid(info, 1);
+				if((info[3] & (1 << 26)) != 0)
+				{
+					features |= CpuFeatureSse2;
+				}
+#ifdef FLOE_HAVE_AVX2
+				bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+				if(osAvx && maxLeaf >= 7)
+				{
+					__cpuidex(info, 7, 0);
+					if((info[1] & (1 << 5)) != 0)
+					{
+						features |= CpuFeatureAvx2;
+					}
+				}
+#endif
+				s_cpuFeatures = features;
+			}
+			return s_cpuFeatures;
+		}
+
+		bool CpuHasSse2()
+		{
+			return (GetCpuFeatures() & CpuFeatureSse2) != 0;
+		}
+
+		bool CpuHasAvx2()
+		{
+			return (GetCpuFeatures() & CpuFeatureAvx2) != 0;
+		}
+
+		static inline short ClampPcm16(float value)
+		{
+			if(value >= 32767.0f)
+			{
+				return 32767;
+			}
+			if(value <= -32768.0f)
+			{
+				return -32768;
+			}
+			return (short)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+		}
+
+		// Converts to integers the way ClampPcm16 does, with halves rounded away from zero. The rounding conversion would
+		// take them to even, so a half with the sign of each value is added and the sum truncated instead.
+		static inline __m128i RoundPcm(__m128 value)
+		{
+			const __m128 sign = _mm_set1_ps(-0.0f);
+			return _mm_cvttps_epi32(_mm_add_ps(value, _mm_or_ps(_mm_and_ps(value, sign), _mm_set1_ps(0.5f))));
+		}
+
+#ifdef FLOE_HAVE_AVX2
+		static inline __m256i RoundPcm(__m256 value)
+		{
+			const __m256 sign = _mm256_set1_ps(-0.0f);
+			return _mm256_cvttps_epi32(_mm256_add_ps(value, _mm256_or_ps(_mm256_and_ps(value, sign), _mm256_set1_ps(0.5f))));
+		}
+#endif
+
+		static inline void FinishLevel(unsigned __int64 sumSquares, int peak, int count, PcmLevel *level)
+		{
+			if(level != 0)
+			{
+				level->rms = count > 0 ? (float)(sqrt((double)sumSquares / count) / 32768.0) : 0.0f;
+				level->peak = (float)peak / 32768.0f;
+			}
+		}
+
+		void ApplyGainPcm16(short *samples, int count, float gain, PcmLevel *level)
+		{
+			if(s_applyGain == 0)
+			{
+#ifdef FLOE_HAVE_AVX2
+				if(CpuHasAvx2())
+				{
+					s_applyGain = &Kernels::ApplyGainPcm16Avx2;
+				}
+				else
+#endif
+				if(CpuHasSse2())
+				{
+					s_applyGain = &Kernels::ApplyGainPcm16Sse2;
+				}
+				else
+				{
+					s_applyGain = &Kernels::ApplyGainPcm16Scalar;
+				}
+			}
+			s_applyGain(samples, count, gain, level);
+		}
+
+		void MixPcm16(int *accumulator, const short *samples, int count, float gain)
+		{
+			if(s_mix == 0)
+			{
+#ifdef FLOE_HAVE_AVX2
+				if(CpuHasAvx2())
+				{
+					s_mix = &Kernels::MixPcm16Avx2;
+				}
+				else
+#endif
+				if(CpuHasSse2())
+				{
+					s_mix = &Kernels::MixPcm16Sse2;
+				}
+				else
+				{
+					s_mix = &Kernels::MixPcm16Scalar;
+				}
+			}
+			s_mix(accumulator, samples, count, gain);
+		}
+
+		void SaturatePcm16(const int *accumulator, short *samples, int count)
+		{
+			if(s_saturate == 0)
+			{
+#ifdef FLOE_HAVE_AVX2
+				if(CpuHasAvx2())
+				{
+					s_saturate = &Kernels::SaturatePcm16Avx2;
+				}
+				else
+#endif
+				if(CpuHasSse2())
+				{
+					s_saturate = &Kernels::SaturatePcm16Sse2;
+				}
+				else
+				{
+					s_saturate = &Kernels::SaturatePcm16Scalar;
+				}
+			}
+			s_saturate(accumulator, samples, count);
+		}
+
+		float DotProduct(const float *a, const float *b, int count)
+		{
+			if(s_dot == 0)
+			{
+#ifdef FLOE_HAVE_AVX2
+				if(CpuHasAvx2())
+				{
+					s_dot = &Kernels::DotProductAvx2;
+				}
+				else
+#endif
+				if(CpuHasSse2())
+				{
+					s_dot = &Kernels::DotProductSse2;
+				}
+				else
+				{
+					s_dot = &Kernels::DotProductScalar;
+				}
+			}
+			return s_dot(a, b, count);
+		}
+
+		void FftButterflies(float *re, float *im, const float *wr, const float *wi, int half)
+		{
+			if(s_butterflies == 0)
+			{
+#ifdef FLOE_HAVE_AVX2
+				if(CpuHasAvx2())
+				{
+					s_butterflies = &Kernels::FftButterfliesAvx2;
+				}
+				else
+#endif
+				if(CpuHasSse2())
+				{
+					s_butterflies = &Kernels::FftButterfliesSse2;
+				}
+				else
+				{
+					s_butterflies = &Kernels::FftButterfliesScalar;
+				}
+			}
+			s_butterflies(re, im, wr, wi, half);
+		}
+
+		void Pcm8ToPcm16(const unsigned char *src, short *dst, int count)
+		{
+			// There is no AVX2 version: twice the width was no faster, since the conversion is bound by its stores.
+			if(s_pcm8 == 0)
+			{
+				if(CpuHasSse2())
+				{
+					s_pcm8 = &Kernels::Pcm8ToPcm16Sse2;
+				}
+				else
+				{
+					s_pcm8 = &Kernels::Pcm8ToPcm16Scalar;
+				}
+			}
+			s_pcm8(src, dst, count);
+		}
+
+		void Pcm24ToPcm16(const unsigned char *src, short *dst, int count)
+		{
+			if(s_pcm24 == 0)
+			{
+#ifdef FLOE_HAVE_AVX2
+				if(CpuHasAvx2())
+				{
+					s_pcm24 = &Kernels::Pcm24ToPcm16Avx2;
+				}
+				else
+#endif
+				if(CpuHasSse2())
+				{
+					s_pcm24 = &Kernels::Pcm24ToPcm16Sse2;
+				}
+				else
+				{
+					s_pcm24 = &Kernels::Pcm24ToPcm16Scalar;
+				}
+			}
+			s_pcm24(src, dst, count);
+		}
+
+		void Pcm32ToPcm16(const int *src, short *dst, int count)
+		{
+			if(s_pcm32 == 0)
+			{
+#ifdef FLOE_HAVE_AVX2
+				if(CpuHasAvx2())
+				{
+					s_pcm32 = &Kernels::Pcm32ToPcm16Avx2;
+				}
+				else
+#endif
+				if(CpuHasSse2())
+				{
+					s_pcm32 = &Kernels::Pcm32ToPcm16Sse2;
+				}
+				else
+				{
+					s_pcm32 = &Kernels::Pcm32ToPcm16Scalar;
+				}
+			}
+			s_pcm32(src, dst, count);
+		}
+
+		void FloatToPcm16(const float *src, short *dst, int count)
+		{
+			if(s_float == 0)
+			{
+#ifdef FLOE_HAVE_AVX2
+				if(CpuHasAvx2())
+				{
+					s_float = &Kernels::FloatToPcm16Avx2;
+				}
+				else
+#endif
+				if(CpuHasSse2())
+				{
+					s_float = &Kernels::FloatToPcm16Sse2;
+				}
+				else
+				{
+					s_float = &Kernels::FloatToPcm16Scalar;
+				}
+			}
+			s_float(src, dst, count);
+		}
+
+		namespace Kernels
+		{
+			// Processes the samples that did not fill a whole vector, and folds in the partial results.
+			static void ApplyGainTail(short *samples, int count, float gain, unsigned __int64 &sumSquares, int &peak)
+			{
+				for(int i = 0; i < count; i++)
+				{
+					int sample = gain != 1.0f ? ClampPcm16(samples[i] * gain) : samples[i];
+					samples[i] = (short)sample;
+					sumSquares += (unsigned int)(sample * sample);
+					int mag = sample < 0 ? -sample : sample;
+					if(mag > peak)
+					{
+						peak = mag;
+					}
+				}
+			}
+
+			void ApplyGainPcm16Scalar(short *samples, int count, float gain, PcmLevel *level)
+			{
+				unsigned __int64 sumSquares = 0;
+				int peak = 0;
+				ApplyGainTail(samples, count, gain, sumSquares, peak);
+				FinishLevel(sumSquares, peak, count, level);
+			}
+
+			void ApplyGainPcm16Sse2(short *samples, int count, float gain, PcmLevel *level)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				const __m128 vgain = _mm_set1_ps(gain);
+				const __m128 vmax = _mm_set1_ps(32767.0f);
+				const __m128 vmin = _mm_set1_ps(-32768.0f);
+				bool scale = gain != 1.0f;
+				__m128i hi16 = zero, lo16 = zero, sum = zero;
+				int i = 0;
+
+				for(; i + 8 <= count; i += 8)
+				{
+					__m128i x = _mm_loadu_si128((const __m128i*)(samples + i));
+					if(scale)
+					{
+						__m128 a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+						__m128 b = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+						a = _mm_max_ps(vmin, _mm_min_ps(vmax, _mm_mul_ps(a, vgain)));
+						b = _mm_max_ps(vmin, _mm_min_ps(vmax, _mm_mul_ps(b, vgain)));
+						x = _mm_packs_epi32(RoundPcm(a), RoundPcm(b));
+						_mm_storeu_si128((__m128i*)(samples + i), x);
+					}
+					hi16 = _mm_max_epi16(hi16, x);
+					lo16 = _mm_min_epi16(lo16, x);
+
+					// Each 32-bit lane holds the sum of two squares, which fits unsigned but not signed.
+					__m128i sq = _mm_madd_epi16(x, x);
+					sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(sq, zero));
+					sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(sq, zero));
+				}
+
+				__declspec(align(16)) unsigned __int64 sums[2];
+				__declspec(align(16)) short highs[8], lows[8];
+				_mm_store_si128((__m128i*)sums, sum);
+				_mm_store_si128((__m128i*)highs, hi16);
+				_mm_store_si128((__m128i*)lows, lo16);
+
+				unsigned __int64 sumSquares = sums[0] + sums[1];
+				int peak = 0;
+				for(int j = 0; j < 8; j++)
+				{
+					peak = highs[j] > peak ? highs[j] : peak;
+					peak = -lows[j] > peak ? -lows[j] : peak;
+				}
+				ApplyGainTail(samples + i, count - i, gain, sumSquares, peak);
+				FinishLevel(sumSquares, peak, count, level);
+			}
+
+			void MixPcm16Scalar(int *accumulator, const short *samples, int count, float gain)
+			{
+				if(gain == 1.0f)
+				{
+					for(int i = 0; i < count; i++)
+					{
+						accumulator[i] += samples[i];
+					}
+				}
+				else
+				{
+					for(int i = 0; i < count; i++)
+					{
+						float value = samples[i] * gain;
+						accumulator[i] += (int)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+					}
+				}
+			}
+
+			void MixPcm16Sse2(int *accumulator, const short *samples, int count, float gain)
+			{
+				const __m128 vgain = _mm_set1_ps(gain);
+				bool scale = gain != 1.0f;
+				int i = 0;
+
+				for(; i + 8 <= count; i += 8)
+				{
+					__m128i x = _mm_loadu_si128((const __m128i*)(samples + i));
+					__m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+					__m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+					if(scale)
+					{
+						a = RoundPcm(_mm_mul_ps(_mm_cvtepi32_ps(a), vgain));
+						b = RoundPcm(_mm_mul_ps(_mm_cvtepi32_ps(b), vgain));
+					}
+					__m128i *acc = (__m128i*)(accumulator + i);
+					_mm_storeu_si128(acc, _mm_add_epi32(_mm_loadu_si128(acc), a));
+					_mm_storeu_si128(acc + 1, _mm_add_epi32(_mm_loadu_si128(acc + 1), b));
+				}
+				MixPcm16Scalar(accumulator + i, samples + i, count - i, gain);
+			}
+
+			void SaturatePcm16Scalar(const int *accumulator, short *samples, int count)
+			{
+				for(int i = 0; i < count; i++)
+				{
+					int value = accumulator[i];
+					samples[i] = (short)(value > 32767 ? 32767 : value < -32768 ? -32768 : value);
+				}
+			}
+
+			void SaturatePcm16Sse2(const int *accumulator, short *samples, int count)
+			{
+				int i = 0;
+				for(; i + 8 <= count; i += 8)
+				{
+					const __m128i *acc = (const __m128i*)(accumulator + i);
+					__m128i x = _mm_packs_epi32(_mm_loadu_si128(acc), _mm_loadu_si128(acc + 1));
+					_mm_storeu_si128((__m128i*)(samples + i), x);
+				}
+				SaturatePcm16Scalar(accumulator + i, samples + i, count - i);
+			}
+
+			float DotProductScalar(const float *a, const float *b, int count)
+			{
+				float sum = 0.0f;
+				for(int i = 0; i < count; i++)
+				{
+					sum += a[i] * b[i];
+				}
+				return sum;
+			}
+
+			float DotProductSse2(const float *a, const float *b, int count)
+			{
+				// Two accumulators, so that each add does not wait on the one before it.
+				__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+				int i = 0;
+				for(; i + 8 <= count; i += 8)
+				{
+					sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+					sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+				}
+
+				__declspec(align(16)) float sums[4];
+				_mm_store_ps(sums, _mm_add_ps(sum0, sum1));
+				return sums[0] + sums[1] + sums[2] + sums[3] + DotProductScalar(a + i, b + i, count - i);
+			}
+
+			void FftButterfliesScalar(float *re, float *im, const float *wr, const float *wi, int half)
+			{
+				float *re2 = re + half, *im2 = im + half;
+				for(int k = 0; k < half; k++)
+				{
+					float tr = re2[k] * wr[k] - im2[k] * wi[k];
+					float ti = re2[k] * wi[k] + im2[k] * wr[k];
+					re2[k] = re[k] - tr;
+					im2[k] = im[k] - ti;
+					re[k] += tr;
+					im[k] += ti;
+				}
+			}
+
+			void FftButterfliesSse2(float *re, float *im, const float *wr, const float *wi, int half)
+			{
+				// Groups are a power of two in size, so only the first stages have less than a whole vector.
+				if(half < 4)
+				{
+					FftButterfliesScalar(re, im, wr, wi, half);
+					return;
+				}
+				float *re2 = re + half, *im2 = im + half;
+				for(int k = 0; k < half; k += 4)
+				{
+					__m128 br = _mm_loadu_ps(re2 + k), bi = _mm_loadu_ps(im2 + k);
+					__m128 cr = _mm_loadu_ps(wr + k), ci = _mm_loadu_ps(wi + k);
+					__m128 tr = _mm_sub_ps(_mm_mul_ps(br, cr), _mm_mul_ps(bi, ci));
+					__m128 ti = _mm_add_ps(_mm_mul_ps(br, ci), _mm_mul_ps(bi, cr));
+					__m128 ar = _mm_loadu_ps(re + k), ai = _mm_loadu_ps(im + k);
+					_mm_storeu_ps(re2 + k, _mm_sub_ps(ar, tr));
+					_mm_storeu_ps(im2 + k, _mm_sub_ps(ai, ti));
+					_mm_storeu_ps(re + k, _mm_add_ps(ar, tr));
+					_mm_storeu_ps(im + k, _mm_add_ps(ai, ti));
+				}
+			}
+
+			void Pcm8ToPcm16Scalar(const unsigned char *src, short *dst, int count)
+			{
+				for(int i = 0; i < count; i++)
+				{
+					dst[i] = (short)((src[i] - 128) << 8);
+				}
+			}
+
+			void Pcm8ToPcm16Sse2(const unsigned char *src, short *dst, int count)
+			{
+				// Flipping the top bit makes each byte signed, and unpacking it above a zero byte shifts it into place.
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i bias = _mm_set1_epi8((char)0x80);
+				int i = 0;
+				for(; i + 16 <= count; i += 16)
+				{
+					__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(src + i)), bias);
+					_mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi8(zero, x));
+					_mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpackhi_epi8(zero, x));
+				}
+				Pcm8ToPcm16Scalar(src + i, dst + i, count - i);
+			}
+
+			void Pcm24ToPcm16Scalar(const unsigned char *src, short *dst, int count)
+			{
+				for(int i = 0; i < count; i++)
+				{
+					dst[i] = (short)(src[i * 3 + 1] | (src[i * 3 + 2] << 8));
+				}
+			}
+
+			void Pcm24ToPcm16Sse2(const unsigned char *src, short *dst, int count)
+			{
+				// SSE2 has no byte shuffle, so each sample is loaded as a 32-bit word whose top byte belongs to the next
+				// sample; the shifts drop it and the low byte. The last load reads one byte past the eighth sample, so
+				// the loop stops a sample early.
+				int i = 0;
+				for(; i + 9 <= count; i += 8)
+				{
+					const unsigned char *p = src + i * 3;
+					__m128i a = _mm_set_epi32(*(const int*)(p + 9), *(const int*)(p + 6), *(const int*)(p + 3), *(const int*)p);
+					__m128i b = _mm_set_epi32(*(const int*)(p + 21), *(const int*)(p + 18), *(const int*)(p + 15), *(const int*)(p + 12));
+					a = _mm_srai_epi32(_mm_slli_epi32(a, 8), 16);
+					b = _mm_srai_epi32(_mm_slli_epi32(b, 8), 16);
+					_mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(a, b));
+				}
+				Pcm24ToPcm16Scalar(src + i * 3, dst + i, count - i);
+			}
+
+			void Pcm32ToPcm16Scalar(const int *src, short *dst, int count)
+			{
+				for(int i = 0; i < count; i++)
+				{
+					dst[i] = (short)(src[i] >> 16);
+				}
+			}
+
+			void Pcm32ToPcm16Sse2(const int *src, short *dst, int count)
+			{
+				int i = 0;
+				for(; i + 8 <= count; i += 8)
+				{
+					__m128i a = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(src + i)), 16);
+					__m128i b = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(src + i + 4)), 16);
+					_mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(a, b));
+				}
+				Pcm32ToPcm16Scalar(src + i, dst + i, count - i);
+			}
+
+			void FloatToPcm16Scalar(const float *src, short *dst, int count)
+			{
+				// NaN is taken as silence, as the vector kernels take it.
+				for(int i = 0; i < count; i++)
+				{
+					float value = src[i] * 32768.0f;
+					dst[i] = value == value ? ClampPcm16(value) : 0;
+				}
+			}
+
+			void FloatToPcm16Sse2(const float *src, short *dst, int count)
+			{
+				// The clamp comes before the conversion, which turns anything out of the 32-bit range into the most
+				// negative value. NaN gets through the clamp, so it is masked to zero first.
+				const __m128 scale = _mm_set1_ps(32768.0f);
+				const __m128 vmax = _mm_set1_ps(32767.0f);
+				const __m128 vmin = _mm_set1_ps(-32768.0f);
+				int i = 0;
+				for(; i + 8 <= count; i += 8)
+				{
+					__m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+					__m128 b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+					a = _mm_and_ps(a, _mm_cmpord_ps(a, a));
+					b = _mm_and_ps(b, _mm_cmpord_ps(b, b));
+					a = _mm_max_ps(vmin, _mm_min_ps(vmax, a));
+					b = _mm_max_ps(vmin, _mm_min_ps(vmax, b));
+					_mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(RoundPcm(a), RoundPcm(b)));
+				}
+				FloatToPcm16Scalar(src + i, dst + i, count - i);
+			}
+
+#ifdef FLOE_HAVE_AVX2
+			void ApplyGainPcm16Avx2(short *samples, int count, float gain, PcmLevel *level)
+			{
+				const __m256i zero = _mm256_setzero_si256();
+				const __m256 vgain = _mm256_set1_ps(gain);
+				const __m256 vmax = _mm256_set1_ps(32767.0f);
+				const __m256 vmin = _mm256_set1_ps(-32768.0f);
+				bool scale = gain != 1.0f;
+				__m256i hi16 = zero, lo16 = zero, sum = zero;
+				int i = 0;
+
+				for(; i + 16 <= count; i += 16)
+				{
+					__m256i x = _mm256_loadu_si256((const __m256i*)(samples + i));
+					if(scale)
+					{
+						__m256 a = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(x)));
+						__m256 b = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1)));
+						a = _mm256_max_ps(vmin, _mm256_min_ps(vmax, _mm256_mul_ps(a, vgain)));
+						b = _mm256_max_ps(vmin, _mm256_min_ps(vmax, _mm256_mul_ps(b, vgain)));
+
+						// The pack works per 128-bit lane, so the middle quadwords come out swapped.
+						x = _mm256_packs_epi32(RoundPcm(a), RoundPcm(b));
+						x = _mm256_permute4x64_epi64(x, 0xd8);
+						_mm256_storeu_si256((__m256i*)(samples + i), x);
+					}
+					hi16 = _mm256_max_epi16(hi16, x);
+					lo16 = _mm256_min_epi16(lo16, x);
+
+					__m256i sq = _mm256_madd_epi16(x, x);
+					sum = _mm256_add_epi64(sum, _mm256_unpacklo_epi32(sq, zero));
+					sum = _mm256_add_epi64(sum, _mm256_unpackhi_epi32(sq, zero));
+				}
+
+				__declspec(align(32)) unsigned __int64 sums[4];
+				__declspec(align(32)) short highs[16], lows[16];
+				_mm256_store_si256((__m256i*)sums, sum);
+				_mm256_store_si256((__m256i*)highs, hi16);
+				_mm256_store_si256((__m256i*)lows, lo16);
+				_mm256_zeroupper();
+
+				unsigned __int64 sumSquares = sums[0] + sums[1] + sums[2] + sums[3];
+				int peak = 0;
+				for(int j = 0; j < 16; j++)
+				{
+					peak = highs[j] > peak ? highs[j] : peak;
+					peak = -lows[j] > peak ? -lows[j] : peak;
+				}
+				ApplyGainTail(samples + i, count - i, gain, sumSquares, peak);
+				FinishLevel(sumSquares, peak, count, level);
+			}
+			void MixPcm16Avx2(int *accumulator, const short *samples, int count, float gain)
+			{
+				const __m256 vgain = _mm256_set1_ps(gain);
+				bool scale = gain != 1.0f;
+				int i = 0;
+
+				for(; i + 16 <= count; i += 16)
+				{
+					__m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(samples + i)));
+					__m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(samples + i + 8)));
+					if(scale)
+					{
+						a = RoundPcm(_mm256_mul_ps(_mm256_cvtepi32_ps(a), vgain));
+						b = RoundPcm(_mm256_mul_ps(_mm256_cvtepi32_ps(b), vgain));
+					}
+					__m256i *acc = (__m256i*)(accumulator + i);
+					_mm256_storeu_si256(acc, _mm256_add_epi32(_mm256_loadu_si256(acc), a));
+					_mm256_storeu_si256(acc + 1, _mm256_add_epi32(_mm256_loadu_si256(acc + 1), b));
+				}
+				_mm256_zeroupper();
+				MixPcm16Scalar(accumulator + i, samples + i, count - i, gain);
+			}
+
+			void SaturatePcm16Avx2(const int *accumulator, short *samples, int count)
+			{
+				int i = 0;
+				for(; i + 16 <= count; i += 16)
+				{
+					const __m256i *acc = (const __m256i*)(accumulator + i);
+					__m256i x = _mm256_packs_epi32(_mm256_loadu_si256(acc), _mm256_loadu_si256(acc + 1));
+					_mm256_storeu_si256((__m256i*)(samples + i), _mm256_permute4x64_epi64(x, 0xd8));
+				}
+				_mm256_zeroupper();
+				SaturatePcm16Scalar(accumulator + i, samples + i, count - i);
+			}
+
+			float DotProductAvx2(const float *a, const float *b, int count)
+			{
+				__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+				int i = 0;
+				for(; i + 16 <= count; i += 16)
+				{
+					sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+					sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+				}
+
+				__declspec(align(32)) float sums[8];
+				_mm256_store_ps(sums, _mm256_add_ps(sum0, sum1));
+				_mm256_zeroupper();
+				float sum = 0.0f;
+				for(int j = 0; j < 8; j++)
+				{
+					sum += sums[j];
+				}
+				return sum + DotProductScalar(a + i, b + i, count - i);
+			}
+
+			void FftButterfliesAvx2(float *re, float *im, const float *wr, const float *wi, int half)
+			{
+				if(half < 8)
+				{
+					FftButterfliesSse2(re, im, wr, wi, half);
+					return;
+				}
+				float *re2 = re + half, *im2 = im + half;
+				for(int k = 0; k < half; k += 8)
+				{
+					__m256 br = _mm256_loadu_ps(re2 + k), bi = _mm256_loadu_ps(im2 + k);
+					__m256 cr = _mm256_loadu_ps(wr + k), ci = _mm256_loadu_ps(wi + k);
+					__m256 tr = _mm256_sub_ps(_mm256_mul_ps(br, cr), _mm256_mul_ps(bi, ci));
+					__m256 ti = _mm256_add_ps(_mm256_mul_ps(br, ci), _mm256_mul_ps(bi, cr));
+					__m256 ar = _mm256_loadu_ps(re + k), ai = _mm256_loadu_ps(im + k);
+					_mm256_storeu_ps(re2 + k, _mm256_sub_ps(ar, tr));
+					_mm256_storeu_ps(im2 + k, _mm256_sub_ps(ai, ti));
+					_mm256_storeu_ps(re + k, _mm256_add_ps(ar, tr));
+					_mm256_storeu_ps(im + k, _mm256_add_ps(ai, ti));
+				}
+				_mm256_zeroupper();
+			}
+
+			void Pcm24ToPcm16Avx2(const unsigned char *src, short *dst, int count)
+			{
+				// Eight samples take 24 bytes. The permute gives each lane twelve of them, and the shuffle picks the top
+				// two bytes of each sample within the lane; the two halves are then joined in the low lane. Each load
+				// reads 32 bytes, so the loop stops while that is still inside the input.
+				const __m256i spread = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+				const __m256i pick = _mm256_setr_epi8(1, 2, 4, 5, 7, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1,
+					1, 2, 4, 5, 7, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1);
+				int i = 0;
+				for(; i + 11 <= count; i += 8)
+				{
+					__m256i x = _mm256_loadu_si256((const __m256i*)(src + i * 3));
+					x = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(x, spread), pick);
+					x = _mm256_permute4x64_epi64(x, 0x08);
+					_mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(x));
+				}
+				_mm256_zeroupper();
+				Pcm24ToPcm16Sse2(src + i * 3, dst + i, count - i);
+			}
+
+			void Pcm32ToPcm16Avx2(const int *src, short *dst, int count)
+			{
+				int i = 0;
+				for(; i + 16 <= count; i += 16)
+				{
+					__m256i a = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i*)(src + i)), 16);
+					__m256i b = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i*)(src + i + 8)), 16);
+					__m256i x = _mm256_packs_epi32(a, b);
+					_mm256_storeu_si256((__m256i*)(dst + i), _mm256_permute4x64_epi64(x, 0xd8));
+				}
+				_mm256_zeroupper();
+				Pcm32ToPcm16Scalar(src + i, dst + i, count - i);
+			}
+
+			void FloatToPcm16Avx2(const float *src, short *dst, int count)
+			{
+				const __m256 scale = _mm256_set1_ps(32768.0f);
+				const __m256 vmax = _mm256_set1_ps(32767.0f);
+				const __m256 vmin = _mm256_set1_ps(-32768.0f);
+				int i = 0;
+				for(; i + 16 <= count; i += 16)
+				{
+					__m256 a = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+					__m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale);
+					a = _mm256_and_ps(a, _mm256_cmp_ps(a, a, _CMP_ORD_Q));
+					b = _mm256_and_ps(b, _mm256_cmp_ps(b, b, _CMP_ORD_Q));
+					a = _mm256_max_ps(vmin, _mm256_min_ps(vmax, a));
+					b = _mm256_max_ps(vmin, _mm256_min_ps(vmax, b));
+					__m256i x = _mm256_packs_epi32(RoundPcm(a), RoundPcm(b));
+					_mm256_storeu_si256((__m256i*)(dst + i), _mm256_permute4x64_epi64(x, 0xd8));
+				}
+				_mm256_zeroupper();
+				FloatToPcm16Scalar(src + i, dst + i, count - i);
+			}
+#endif
+		}
+	}
+}
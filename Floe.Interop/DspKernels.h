@@ -0,0 +1,84 @@
+#pragma once
+
+// Native sample processing kernels. This header is shared by managed and unmanaged translation units,
+// so it must not reference any managed types.
+
+#if defined(_MSC_VER) && _MSC_VER >= 1700
+#define FLOE_HAVE_AVX2
+#endif
+
+namespace Floe
+{
+	namespace Interop
+	{
+		struct PcmLevel
+		{
+			float rms;
+			float peak;
+		};
+
+		bool CpuHasSse2();
+		bool CpuHasAvx2();
+
+		// Multiplies 16-bit PCM samples by gain in place, saturating to the 16-bit range, and measures
+		// the RMS and peak of the result (both normalized to 0..1). A gain of 1 only measures the level.
+		void ApplyGainPcm16(short *samples, int count, float gain, PcmLevel *level);
+
+		// Scales 16-bit PCM samples by gain and adds them to a 32-bit accumulator.
+		void MixPcm16(int *accumulator, const short *samples, int count, float gain);
+
+		// Converts a 32-bit accumulator back to 16-bit PCM samples, saturating each sample.
+		void SaturatePcm16(const int *accumulator, short *samples, int count);
+
+		// Returns the sum of the products of two float vectors, as used by FIR filters.
+		float DotProduct(const float *a, const float *b, int count);
+
+		// Runs the radix-2 butterflies of one group of an FFT stage in place: each element k of the first half is
+		// combined with element k of the second half, taken times the twiddle factor wr[k] + i wi[k].
+		void FftButterflies(float *re, float *im, const float *wr, const float *wi, int half);
+
+		// Converts unsigned 8-bit PCM samples to 16-bit.
+		void Pcm8ToPcm16(const unsigned char *src, short *dst, int count);
+
+		// Converts packed 24-bit PCM samples to 16-bit, keeping the top 16 bits of each.
+		void Pcm24ToPcm16(const unsigned char *src, short *dst, int count);
+
+		// Converts 32-bit PCM samples to 16-bit, keeping the top 16 bits of each.
+		void Pcm32ToPcm16(const int *src, short *dst, int count);
+
+		// Converts float samples in the range -1..1 to 16-bit PCM, rounding and saturating each sample.
+		void FloatToPcm16(const float *src, short *dst, int count);
+
+		namespace Kernels
+		{
+			void ApplyGainPcm16Scalar(short *samples, int count, float gain, PcmLevel *level);
+			void ApplyGainPcm16Sse2(short *samples, int count, float gain, PcmLevel *level);
+			void MixPcm16Scalar(int *accumulator, const short *samples, int count, float gain);
+			void MixPcm16Sse2(int *accumulator, const short *samples, int count, float gain);
+			void SaturatePcm16Scalar(const int *accumulator, short *samples, int count);
+			void SaturatePcm16Sse2(const int *accumulator, short *samples, int count);
+			float DotProductScalar(const float *a, const float *b, int count);
+			float DotProductSse2(const float *a, const float *b, int count);
+			void FftButterfliesScalar(float *re, float *im, const float *wr, const float *wi, int half);
+			void FftButterfliesSse2(float *re, float *im, const float *wr, const float *wi, int half);
+			void Pcm8ToPcm16Scalar(const unsigned char *src, short *dst, int count);
+			void Pcm8ToPcm16Sse2(const unsigned char *src, short *dst, int count);
+			void Pcm24ToPcm16Scalar(const unsigned char *src, short *dst, int count);
+			void Pcm24ToPcm16Sse2(const unsigned char *src, short *dst, int count);
+			void Pcm32ToPcm16Scalar(const int *src, short *dst, int count);
+			void Pcm32ToPcm16Sse2(const int *src, short *dst, int count);
+			void FloatToPcm16Scalar(const float *src, short *dst, int count);
+			void FloatToPcm16Sse2(const float *src, short *dst, int count);
+#ifdef FLOE_HAVE_AVX2
+			void ApplyGainPcm16Avx2(short *samples, int count, float gain, PcmLevel *level);
+			void MixPcm16Avx2(int *accumulator, const short *samples, int count, float gain);
+			void SaturatePcm16Avx2(const int *accumulator, short *samples, int count);
+			float DotProductAvx2(const float *a, const float *b, int count);
+			void FftButterfliesAvx2(float *re, float *im, const float *wr, const float *wi, int half);
+			void Pcm24ToPcm16Avx2(const unsigned char *src, short *dst, int count);
+			void Pcm32ToPcm16Avx2(const int *src, short *dst, int count);
+			void FloatToPcm16Avx2(const float *src, short *dst, int count);
+#endif
+		}
+	}
+}
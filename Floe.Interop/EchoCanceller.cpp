@@ -0,0 +1,481 @@
+#include <Windows.h>
+#include <math.h>
+#include <string.h>
+#include "Fft.h"
+#include "EchoCanceller.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		static const float StepSize = 0.5f;
+		static const float FarFloor = 900.0f; // mean square of a block, about -60 dBFS
+		static const float PathGainAttack = 0.05f;
+		static const float PathGainRelease = 0.002f;
+		static const float MinPathGain = 0.05f;
+		static const float MaxPathGain = 4.0f;
+		static const float DoubleTalkFactor = 2.0f;
+		static const float DivergenceFactor = 4.0f;
+		static const float ErleRate = 0.05f;
+		static const float ShortRate = 0.3f;
+		static const float ConvergedErle = 10.0f;
+		static const float DoubleTalkErleDrop = 10.0f;
+		static const int PathChangeMs = 500;
+		static const float PathChangeMatch = 4.0f;
+		static const float BandMeanRate = 0.02f;
+		static const float ScoreRate = 0.02f;
+		static const float DelayConfidence = 3.0f; // mismatched bits out of 32
+		static const float DelayMargin = 1.0f;
+		static const float MatchRate = 0.1f;
+
+		static inline int CountBits(unsigned int x)
+		{
+			x = x - ((x >> 1) & 0x55555555);
+			x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+			return (((x + (x >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+		}
+
+		static inline short ToPcm16(float value)
+		{
+			if(value >= 32767.0f)
+			{
+				return 32767;
+			}
+			if(value <= -32768.0f)
+			{
+				return -32768;
+			}
+			return (short)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+		}
+
+		EchoCanceller::EchoCanceller(int sampleRate, int blockSize, int tailLength)
+		{
+			m_block = blockSize;
+			m_fftSize = blockSize * 2;
+			m_bins = blockSize + 1;
+			int tail = (int)((__int64)sampleRate * tailLength / 1000);
+
+			// More partitions than the tail needs, since the filter starts a little ahead of the estimated delay.
+			m_partitions = (tail + blockSize - 1) / blockSize + LeadBlocks;
+			m_lags = sampleRate * MaxDelayMs / 1000 / blockSize;
+			m_pathChangeBlocks = sampleRate * PathChangeMs / 1000 / blockSize;
+			m_fft = new Fft(m_fftSize);
+
+			m_ringSize = 1;
+			while(m_ringSize < sampleRate)
+			{
+				m_ringSize <<= 1;
+			}
+			m_ring = new short[m_ringSize];
+			m_written = m_read = m_maxChunk = 0;
+
+			m_historyLength = (m_lags + 2) * blockSize;
+			m_far = new float[m_historyLength * 2];
+			m_near = new float[m_fftSize];
+			m_error = new float[blockSize];
+			m_xre = new float[m_partitions * m_bins];
+			m_xim = new float[m_partitions * m_bins];
+			m_wre = new float[m_partitions * m_bins];
+			m_wim = new float[m_partitions * m_bins];
+			m_power = new float[m_bins];
+			m_re = new float[m_fftSize];
+			m_im = new float[m_fftSize];
+			m_peakCount = m_lags + m_partitions;
+			m_peaks = new float[m_peakCount];
+			m_farBits = new unsigned int[m_lags];
+			m_farBandMean = new float[Bands];
+			m_nearBandMean = new float[Bands];
+			m_scores = new float[m_lags];
+			this->Reset();
+		}
+
+		EchoCanceller::~EchoCanceller()
+		{
+			delete m_fft;
+			delete[] m_ring;
+			delete[] m_far;
+			delete[] m_near;
+			delete[] m_error;
+			delete[] m_xre;
+			delete[] m_xim;
+			delete[] m_wre;
+			delete[] m_wim;
+			delete[] m_power;
+			delete[] m_re;
+			delete[] m_im;
+			delete[] m_peaks;
+			delete[] m_farBits;
+			delete[] m_farBandMean;
+			delete[] m_nearBandMean;
+			delete[] m_scores;
+		}
+
+		void EchoCanceller::Reset()
+		{
+			InterlockedExchange(&m_read, m_written);
+			m_started = false;
+			memset(m_far, 0, m_historyLength * 2 * sizeof(float));
+			memset(m_near, 0, m_fftSize * sizeof(float));
+			m_farPos = 0;
+			memset(m_farBits, 0, m_lags * sizeof(unsigned int));
+			m_bitsHead = 0;
+			for(int b = 0; b < Bands; b++)
+			{
+				m_farBandMean[b] = m_nearBandMean[b] = 0.0f;
+			}
+			for(int l = 0; l < m_lags; l++)
+			{
+				m_scores[l] = Bands / 2.0f;
+			}
+			memset(m_peaks, 0, m_peakCount * sizeof(float));
+			m_peakHead = 0;
+			m_delay = 0;
+			m_pathGain = 1.0f;
+			m_match = Bands / 2.0f;
+			this->ResetFilter();
+		}
+
+		void EchoCanceller::ResetFilter()
+		{
+			memset(m_xre, 0, m_partitions * m_bins * sizeof(float));
+			memset(m_xim, 0, m_partitions * m_bins * sizeof(float));
+			memset(m_wre, 0, m_partitions * m_bins * sizeof(float));
+			memset(m_wim, 0, m_partitions * m_bins * sizeof(float));
+			memset(m_power, 0, m_bins * sizeof(float));
+			m_xHead = 0;
+			m_constrain = 0;
+			m_doubleTalk = 0;
+			m_doubleTalkBlocks = 0;
+			m_nearShort = m_errorShort = 0.0f;
+			m_echoPower = m_residualPower = 0.0f;
+			m_erle = 0.0f;
+		}
+
+		void EchoCanceller::AddReference(const short *samples, int count)
+		{
+			// If the capture thread is not keeping up, the newest reference is dropped; it resynchronizes when it
+			// next reads.
+			long space = m_ringSize - (m_written - m_read);
+			count = count > space ? space : count;
+			long pos = m_written;
+			for(int i = 0; i < count; i++)
+			{
+				m_ring[(pos + i) & (m_ringSize - 1)] = samples[i];
+			}
+			if(count > m_maxChunk && count <= m_ringSize / 4)
+			{
+				InterlockedExchange(&m_maxChunk, count);
+			}
+			InterlockedExchangeAdd(&m_written, count);
+		}
+
+		void EchoCanceller::Process(short *samples, int count)
+		{
+			for(int i = 0; i + m_block <= count; i += m_block)
+			{
+				this->ProcessBlock(samples + i);
+			}
+		}
+
+		void EchoCanceller::ReadReference()
+		{
+			// The render thread adds the reference in chunks of its own size, so reading starts only once a whole
+			// chunk is queued beyond this block; from then on the ring does not run dry between chunks. If the render
+			// side gets far ahead, as when capture starts late, reading skips to the newest audio. Either way the
+			// delay changes, and the estimator finds the new one.
+			int n = m_block;
+			long available = m_written - m_read;
+			long chunk = m_maxChunk;
+			if(!m_started && available >= chunk + n)
+			{
+				m_started = true;
+			}
+			if(m_started && available > m_ringSize / 2)
+			{
+				InterlockedExchangeAdd(&m_read, available - (chunk + n));
+			}
+			else if(m_started && available < n)
+			{
+				m_started = false;
+			}
+
+			long pos = m_read;
+			for(int i = 0; i < n; i++)
+			{
+				float sample = m_started ? m_ring[(pos + i) & (m_ringSize - 1)] : 0.0f;
+				m_far[m_farPos] = m_far[m_farPos + m_historyLength] = sample;
+				m_farPos = m_farPos + 1 < m_historyLength ? m_farPos + 1 : 0;
+			}
+			if(m_started)
+			{
+				InterlockedExchangeAdd(&m_read, n);
+			}
+		}
+
+		void EchoCanceller::ProcessBlock(short *samples)
+		{
+			int n = m_block, bins = m_bins, partitions = m_partitions;
+			this->ReadReference();
+			memmove(m_near, m_near + n, n * sizeof(float));
+			for(int i = 0; i < n; i++)
+			{
+				m_near[n + i] = samples[i];
+			}
+
+			// The history is stored twice over, so that any window ending at the newest sample is contiguous.
+			const float *newest = m_far + m_farPos + m_historyLength - m_fftSize;
+			double newestEnergy = 0.0;
+			float newestPeak = 0.0f;
+			for(int i = n; i < m_fftSize; i++)
+			{
+				newestEnergy += newest[i] * newest[i];
+				newestPeak = fabsf(newest[i]) > newestPeak ? fabsf(newest[i]) : newestPeak;
+			}
+
+			// The far-end peak over every delay the echo could have, so that double talk is not mistaken for echo
+			// while the delay estimate is wrong.
+			m_peakHead = (m_peakHead + 1) % m_peakCount;
+			m_peaks[m_peakHead] = newestPeak;
+			float farPeak = 0.0f;
+			for(int i = 0; i < m_peakCount; i++)
+			{
+				farPeak = m_peaks[i] > farPeak ? m_peaks[i] : farPeak;
+			}
+
+			const float *far = newest - (m_delay > LeadBlocks ? m_delay - LeadBlocks : 0) * n;
+			double farEnergy = 0.0;
+			for(int i = n; i < m_fftSize; i++)
+			{
+				farEnergy += far[i] * far[i];
+			}
+			bool farActive = farEnergy > FarFloor * n;
+
+			// The newest partition holds the spectrum of the last two far-end blocks.
+			m_xHead = (m_xHead + partitions - 1) % partitions;
+			memcpy(m_re, far, m_fftSize * sizeof(float));
+			memset(m_im, 0, m_fftSize * sizeof(float));
+			m_fft->Forward(m_re, m_im);
+			float *xre = m_xre + m_xHead * bins, *xim = m_xim + m_xHead * bins;
+			for(int k = 0; k < bins; k++)
+			{
+				xre[k] = m_re[k];
+				xim[k] = m_im[k];
+			}
+
+			// The echo estimate is the sum over the partitions of each one's weights times the far-end spectrum from as
+			// many blocks ago. Only the second half of its inverse is free of circular wrap-around. The far-end power
+			// across all partitions is summed along the way, to normalize the update.
+			memset(m_re, 0, bins * sizeof(float));
+			memset(m_im, 0, bins * sizeof(float));
+			memset(m_power, 0, bins * sizeof(float));
+			for(int p = 0; p < partitions; p++)
+			{
+				int x = (m_xHead + p) % partitions;
+				const float *xr = m_xre + x * bins, *xi = m_xim + x * bins;
+				const float *wr = m_wre + p * bins, *wi = m_wim + p * bins;
+				for(int k = 0; k < bins; k++)
+				{
+					m_re[k] += wr[k] * xr[k] - wi[k] * xi[k];
+					m_im[k] += wr[k] * xi[k] + wi[k] * xr[k];
+					m_power[k] += xr[k] * xr[k] + xi[k] * xi[k];
+				}
+			}
+			this->InverseReal();
+
+			double nearEnergy = 0.0, errorEnergy = 0.0;
+			float nearPeak = 0.0f;
+			for(int i = 0; i < n; i++)
+			{
+				float d = m_near[n + i];
+				float e = d - m_re[n + i];
+				m_error[i] = e;
+				nearEnergy += d * d;
+				errorEnergy += e * e;
+				nearPeak = fabsf(d) > nearPeak ? fabsf(d) : nearPeak;
+			}
+
+			// Double talk is detected in two ways. Before the filter has converged, a Geigel detector flags a microphone
+			// peak well above what the echo of the recent far-end peaks could reach; the gain of the echo path follows the
+			// highest ratios seen while only the far end talks, rising quickly and falling slowly. Once it has converged,
+			// a block whose error is much louder than the filter usually leaves is taken as near-end speech, whether or not
+			// the far end is talking, unless the microphone keeps matching the far end so closely that the echo path must
+			// have changed instead. The short-term ERLE is smoothed over a few blocks, so that one block where the echo
+			// happens to be weak is not taken for talking.
+			m_nearShort += ShortRate * ((float)nearEnergy - m_nearShort);
+			m_errorShort += ShortRate * ((float)errorEnergy - m_errorShort);
+			float shortErle = (float)(10.0 * log10((m_nearShort + 1.0) / (m_errorShort + 1.0)));
+			bool talking = nearEnergy > FarFloor * n && ((farActive && nearPeak > DoubleTalkFactor * m_pathGain * farPeak) ||
+				(m_erle > ConvergedErle && shortErle < m_erle - DoubleTalkErleDrop));
+			if(talking)
+			{
+				m_doubleTalk = DoubleTalkHangover;
+			}
+			else if(m_doubleTalk > 0)
+			{
+				m_doubleTalk--;
+			}
+			m_doubleTalkBlocks = m_doubleTalk > 0 && m_match < PathChangeMatch ? m_doubleTalkBlocks + 1 : 0;
+			if(m_doubleTalkBlocks > m_pathChangeBlocks)
+			{
+				m_echoPower = m_residualPower = 0.0f;
+				m_erle = 0.0f;
+				m_doubleTalk = 0;
+			}
+			if(m_doubleTalk == 0 && farActive && farPeak > 0.0f)
+			{
+				float ratio = nearPeak / farPeak;
+				m_pathGain += (ratio > m_pathGain ? PathGainAttack : PathGainRelease) * (ratio - m_pathGain);
+				m_pathGain = m_pathGain < MinPathGain ? MinPathGain : m_pathGain > MaxPathGain ? MaxPathGain : m_pathGain;
+			}
+
+			// A block that the filter would make louder is passed through as it was, and a filter that keeps doing so
+			// has diverged and starts over.
+			bool louder = errorEnergy > nearEnergy;
+			if(m_errorShort > DivergenceFactor * m_nearShort && m_nearShort > FarFloor * n)
+			{
+				this->ResetFilter();
+			}
+			else if(farActive && m_doubleTalk == 0)
+			{
+				// NLMS update of every partition with the spectrum of the error, normalized per bin by the far-end
+				// power across the whole filter.
+				memset(m_re, 0, n * sizeof(float));
+				memcpy(m_re + n, m_error, n * sizeof(float));
+				memset(m_im, 0, m_fftSize * sizeof(float));
+				m_fft->Forward(m_re, m_im);
+				float delta = FarFloor * m_fftSize;
+				for(int k = 0; k < bins; k++)
+				{
+					float mu = StepSize / (m_power[k] + delta);
+					m_re[k] *= mu;
+					m_im[k] *= mu;
+				}
+				for(int p = 0; p < partitions; p++)
+				{
+					int x = (m_xHead + p) % partitions;
+					const float *xr = m_xre + x * bins, *xi = m_xim + x * bins;
+					float *wr = m_wre + p * bins, *wi = m_wim + p * bins;
+					for(int k = 0; k < bins; k++)
+					{
+						wr[k] += xr[k] * m_re[k] + xi[k] * m_im[k];
+						wi[k] += xr[k] * m_im[k] - xi[k] * m_re[k];
+					}
+				}
+
+				// Constrain one partition per block to a causal filter of one block, by zeroing the second half of
+				// its impulse response.
+				float *wr = m_wre + m_constrain * bins, *wi = m_wim + m_constrain * bins;
+				memcpy(m_re, wr, bins * sizeof(float));
+				memcpy(m_im, wi, bins * sizeof(float));
+				this->InverseReal();
+				memset(m_re + n, 0, n * sizeof(float));
+				memset(m_im, 0, m_fftSize * sizeof(float));
+				m_fft->Forward(m_re, m_im);
+				memcpy(wr, m_re, bins * sizeof(float));
+				memcpy(wi, m_im, bins * sizeof(float));
+				m_constrain = (m_constrain + 1) % partitions;
+			}
+
+			if(farActive && m_doubleTalk == 0)
+			{
+				m_echoPower += ErleRate * ((float)nearEnergy - m_echoPower);
+				m_residualPower += ErleRate * ((float)(errorEnergy < nearEnergy ? errorEnergy : nearEnergy) - m_residualPower);
+				m_erle = (float)(10.0 * log10((m_echoPower + 1.0) / (m_residualPower + 1.0)));
+			}
+
+			for(int i = 0; i < n; i++)
+			{
+				samples[i] = ToPcm16(louder ? m_near[n + i] : m_error[i]);
+			}
+
+			// The delay is estimated last, since a change of delay starts the filter over.
+			this->UpdateDelay(newest, m_near, newestEnergy > FarFloor * n);
+		}
+
+		void EchoCanceller::InverseReal()
+		{
+			// Fills in the upper half of a real signal's spectrum from the lower half, and transforms it back.
+			int n = m_block;
+			m_im[0] = m_im[n] = 0.0f;
+			for(int k = 1; k < n; k++)
+			{
+				m_re[m_fftSize - k] = m_re[k];
+				m_im[m_fftSize - k] = -m_im[k];
+			}
+			m_fft->Inverse(m_re, m_im);
+		}
+
+		void EchoCanceller::UpdateDelay(const float *far, const float *near, bool farActive)
+		{
+			unsigned int farBits = this->GetBandBits(far, m_farBandMean);
+			unsigned int nearBits = this->GetBandBits(near, m_nearBandMean);
+			m_bitsHead = (m_bitsHead + m_lags - 1) % m_lags;
+			m_farBits[m_bitsHead] = farBits;
+			if(!farActive)
+			{
+				return;
+			}
+
+			// How well the near end still matches the far end at the current delay tells double talk, where it stops
+			// matching, from a change of the echo path, where it keeps matching while the filter no longer fits.
+			int matched = CountBits(nearBits ^ m_farBits[(m_bitsHead + m_delay) % m_lags]);
+			m_match += MatchRate * (matched - m_match);
+			if(m_doubleTalk > 0)
+			{
+				return;
+			}
+
+			// Each lag keeps a running count of the bits that differ between the near end and the far end from that many
+			// blocks ago. The delay moves to a lag that is clearly better than the current one, and stands out from the
+			// lags as a whole. A slightly later lag is still covered by the filter, which starts ahead of the delay, so
+			// it is not worth starting over for.
+			int best = m_delay;
+			float mean = 0.0f;
+			for(int l = 0; l < m_lags; l++)
+			{
+				int distance = CountBits(nearBits ^ m_farBits[(m_bitsHead + l) % m_lags]);
+				m_scores[l] += ScoreRate * (distance - m_scores[l]);
+				mean += m_scores[l];
+				if(m_scores[l] < m_scores[best])
+				{
+					best = l;
+				}
+			}
+			mean /= m_lags;
+			if((best < m_delay || best > m_delay + LeadBlocks) && m_scores[best] + DelayConfidence < mean && m_scores[best] + DelayMargin < m_scores[m_delay])
+			{
+				m_delay = best;
+				this->ResetFilter();
+			}
+		}
+
+		unsigned int EchoCanceller::GetBandBits(const float *window, float *means)
+		{
+			memcpy(m_re, window, m_fftSize * sizeof(float));
+			memset(m_im, 0, m_fftSize * sizeof(float));
+			m_fft->Forward(m_re, m_im);
+
+			int width = m_block / Bands;
+			unsigned int bits = 0;
+			for(int b = 0; b < Bands; b++)
+			{
+				double energy = 0.0;
+				for(int k = 1 + b * width; k < 1 + (b + 1) * width; k++)
+				{
+					energy += (double)m_re[k] * m_re[k] + (double)m_im[k] * m_im[k];
+				}
+				float level = (float)(10.0 * log10(energy + 1.0));
+				if(means[b] == 0.0f)
+				{
+					means[b] = level;
+				}
+				if(level > means[b])
+				{
+					bits |= 1u << b;
+				}
+				means[b] += BandMeanRate * (level - means[b]);
+			}
+			return bits;
+		}
+	}
+}
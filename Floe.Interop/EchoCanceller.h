@@ -0,0 +1,128 @@
+#pragma once
+
+// Acoustic echo cancellation with a partitioned-block frequency-domain adaptive filter (PBFDAF). The far-end signal,
+// as it is handed to the output device, is the reference; the filter learns the echo path from the speakers back to
+// the microphone and subtracts its estimate of the echo from each captured block. The filter is split into partitions
+// of one block each, so that a long echo tail costs a few short FFTs per block rather than one long one, and the
+// gradient constraint is applied to one partition per block in turn.
+//
+// The reference passes through a ring from the render thread to the capture thread, and the delay between the two
+// paths is unknown. It is estimated by matching binary spectra: each block of both signals is reduced to one bit per
+// band telling whether the band is louder than usual, and the lag at which the far-end bits best agree with the near-end
+// bits is taken as the delay. The filter then only has to cover the echo tail instead of the whole delay.
+//
+// Adaptation stops while both ends are talking, and the filter is reset if it ever makes the signal louder than it was.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class Fft;
+
+		class EchoCanceller
+		{
+		private:
+			static const int Bands = 32;
+			static const int MaxDelayMs = 400;
+			static const int DoubleTalkHangover = 8; // blocks
+			static const int LeadBlocks = 2; // the delay estimate tends to fall after the direct path
+
+			int m_block;
+			int m_fftSize;
+			int m_bins;
+			int m_partitions;
+			int m_lags;
+			Fft *m_fft;
+
+			// The reference ring, written by the render thread and read by the capture thread. Its size is a power of
+			// two, so that the free-running counters can wrap.
+			short *m_ring;
+			long m_ringSize;
+			volatile long m_written;
+			volatile long m_read;
+			volatile long m_maxChunk;
+
+			// Owned by the capture thread.
+			bool m_started;
+			float *m_far;
+			int m_historyLength;
+			int m_farPos;
+			float *m_near;
+			float *m_error;
+			float *m_xre;
+			float *m_xim;
+			int m_xHead;
+			float *m_wre;
+			float *m_wim;
+			float *m_power;
+			float *m_re;
+			float *m_im;
+			float *m_peaks;
+			int m_peakCount;
+			int m_peakHead;
+			unsigned int *m_farBits;
+			int m_bitsHead;
+			float *m_farBandMean;
+			float *m_nearBandMean;
+			float *m_scores;
+			int m_delay;
+			float m_match;
+			int m_constrain;
+			int m_doubleTalk;
+			int m_doubleTalkBlocks;
+			int m_pathChangeBlocks;
+			float m_pathGain;
+			float m_nearShort;
+			float m_errorShort;
+			float m_echoPower;
+			float m_residualPower;
+			float m_erle;
+
+		public:
+			// The block size must be a power of two of at least 32 samples, and the tail length is in milliseconds.
+			EchoCanceller(int sampleRate, int blockSize, int tailLength);
+			~EchoCanceller();
+
+			// Adds samples that are about to be played. Called from the render thread.
+			void AddReference(const short *samples, int count);
+
+			// Removes the echo from captured samples in place. The count must be a multiple of the block size.
+			void Process(short *samples, int count);
+
+			// Forgets the echo path and the delay, and drops any queued reference.
+			void Reset();
+
+			// The estimated delay from the reference to the microphone, in samples.
+			int Delay() const
+			{
+				return m_delay * m_block;
+			}
+
+			// The smoothed echo return loss enhancement in dB: how much quieter the echo is after cancellation.
+			float Erle() const
+			{
+				return m_erle;
+			}
+
+			bool IsDoubleTalk() const
+			{
+				return m_doubleTalk > 0;
+			}
+
+			int BlockSize() const
+			{
+				return m_block;
+			}
+
+		private:
+			void ProcessBlock(short *samples);
+			void ReadReference();
+			void InverseReal();
+			void UpdateDelay(const float *far, const float *near, bool farActive);
+			unsigned int GetBandBits(const float *window, float *means);
+			void ResetFilter();
+			EchoCanceller(const EchoCanceller&);
+			EchoCanceller &operator=(const EchoCanceller&);
+		};
+	}
+}
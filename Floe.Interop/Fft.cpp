@@ -0,0 +1,94 @@
+#include <math.h>
+#include "DspKernels.h"
+#include "Fft.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		Fft::Fft(int size)
+		{
+			const double pi = 3.14159265358979323846;
+			m_size = size;
+
+			// The stage whose groups have half butterflies keeps its twiddle factors at offset half - 1.
+			m_twiddleRe = new float[size];
+			m_twiddleIm = new float[size];
+			for(int half = 1; half < size; half <<= 1)
+			{
+				for(int k = 0; k < half; k++)
+				{
+					m_twiddleRe[half - 1 + k] = (float)cos(pi * k / half);
+					m_twiddleIm[half - 1 + k] = (float)-sin(pi * k / half);
+				}
+			}
+
+			m_reverse = new int[size];
+			for(int i = 0, j = 0; i < size; i++)
+			{
+				m_reverse[i] = j;
+				int bit = size >> 1;
+				for(; j & bit; bit >>= 1)
+				{
+					j ^= bit;
+				}
+				j ^= bit;
+			}
+		}
+
+		Fft::~Fft()
+		{
+			delete[] m_twiddleRe;
+			delete[] m_twiddleIm;
+			delete[] m_reverse;
+		}
+
+		void Fft::Forward(float *re, float *im) const
+		{
+			this->Transform(re, im);
+		}
+
+		void Fft::Inverse(float *re, float *im) const
+		{
+			// The inverse is the conjugate of the forward transform of the conjugate, scaled.
+			for(int i = 0; i < m_size; i++)
+			{
+				im[i] = -im[i];
+			}
+			this->Transform(re, im);
+			float scale = 1.0f / m_size;
+			for(int i = 0; i < m_size; i++)
+			{
+				re[i] *= scale;
+				im[i] *= -scale;
+			}
+		}
+
+		void Fft::Transform(float *re, float *im) const
+		{
+			int n = m_size;
+			for(int i = 0; i < n; i++)
+			{
+				int j = m_reverse[i];
+				if(i < j)
+				{
+					float t = re[i];
+					re[i] = re[j];
+					re[j] = t;
+					t = im[i];
+					im[i] = im[j];
+					im[j] = t;
+				}
+			}
+
+			for(int half = 1; half < n; half <<= 1)
+			{
+				const float *wr = m_twiddleRe + half - 1, *wi = m_twiddleIm + half - 1;
+				for(int i = 0; i < n; i += half * 2)
+				{
+					FftButterflies(re + i, im + i, wr, wi, half);
+				}
+			}
+		}
+	}
+}
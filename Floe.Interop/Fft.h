@@ -0,0 +1,38 @@
+#pragma once
+
+// An in-place radix-2 complex FFT of a fixed power-of-two size, with the twiddle factors and bit-reversal order
+// computed once up front. The twiddle factors are stored stage by stage, so that the butterflies of each group run
+// through the vector kernels in DspKernels. The forward transform is unscaled; the inverse divides by the size, so
+// that a forward transform followed by an inverse one gives back the input.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class Fft
+		{
+		private:
+			int m_size;
+			float *m_twiddleRe;
+			float *m_twiddleIm;
+			int *m_reverse;
+
+		public:
+			Fft(int size);
+			~Fft();
+
+			void Forward(float *re, float *im) const;
+			void Inverse(float *re, float *im) const;
+
+			int Size() const
+			{
+				return m_size;
+			}
+
+		private:
+			void Transform(float *re, float *im) const;
+			Fft(const Fft&);
+			Fft &operator=(const Fft&);
+		};
+	}
+}
@@ -0,0 +1,111 @@
+#include <math.h>
+#include "DspKernels.h"
+#include "GainController.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		static const int BlockMs = 10;
+		static const float DefaultTargetLevel = -20.0f; // dBFS
+		static const float DefaultMaxGain = 30.0f; // dB
+		static const float MinGain = -20.0f;
+		static const float GainUpRate = 6.0f; // dB per second
+		static const float GainDownRate = 60.0f;
+		static const float NoiseRiseRate = 1.0f;
+		static const float LevelAttackMs = 20.0f;
+		static const float LevelReleaseMs = 1000.0f;
+		static const float SpeechMargin = 10.0f; // dB above the noise
+		static const float SilenceLevel = -60.0f;
+		static const float PeakLimit = 32767.0f * 0.9f;
+
+		static inline short ToPcm16(float value)
+		{
+			if(value >= 32767.0f)
+			{
+				return 32767;
+			}
+			if(value <= -32768.0f)
+			{
+				return -32768;
+			}
+			return (short)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+		}
+
+		GainController::GainController(int sampleRate)
+		{
+			m_block = sampleRate * BlockMs / 1000;
+			float blocksPerSecond = 1000.0f / BlockMs;
+			m_upStep = GainUpRate / blocksPerSecond;
+			m_downStep = GainDownRate / blocksPerSecond;
+			m_noiseRise = NoiseRiseRate / blocksPerSecond;
+			m_levelAttack = 1.0f - (float)exp(-BlockMs / LevelAttackMs);
+			m_levelRelease = 1.0f - (float)exp(-BlockMs / LevelReleaseMs);
+			m_targetLevel = DefaultTargetLevel;
+			m_maxGain = DefaultMaxGain;
+			this->Reset();
+		}
+
+		void GainController::Reset()
+		{
+			m_speechLevel = m_targetLevel;
+			m_noiseLevel = SilenceLevel;
+			m_gain = 0.0f;
+		}
+
+		void GainController::SetTargetLevel(float level)
+		{
+			m_targetLevel = level > 0.0f ? 0.0f : level;
+		}
+
+		void GainController::SetMaxGain(float gain)
+		{
+			m_maxGain = gain < 0.0f ? 0.0f : gain;
+		}
+
+		void GainController::Process(short *samples, int count)
+		{
+			for(int i = 0; i < count; i += m_block)
+			{
+				this->ProcessBlock(samples + i, count - i < m_block ? count - i : m_block);
+			}
+		}
+
+		void GainController::ProcessBlock(short *samples, int count)
+		{
+			PcmLevel level;
+			ApplyGainPcm16(samples, count, 1.0f, &level);
+			float rms = (float)(20.0 * log10(level.rms + 1e-6f));
+
+			// The noise follows the quietest blocks, and speech is whatever stands well clear of it.
+			m_noiseLevel = rms < m_noiseLevel ? rms : m_noiseLevel + m_noiseRise;
+			if(rms > m_noiseLevel + SpeechMargin && rms > SilenceLevel)
+			{
+				m_speechLevel += (rms > m_speechLevel ? m_levelAttack : m_levelRelease) * (rms - m_speechLevel);
+			}
+
+			float target = m_targetLevel - m_speechLevel;
+			target = target > m_maxGain ? m_maxGain : target < MinGain ? MinGain : target;
+			float gain = target > m_gain ? (target - m_gain > m_upStep ? m_gain + m_upStep : target) :
+				(m_gain - target > m_downStep ? m_gain - m_downStep : target);
+
+			float start = (float)pow(10.0, m_gain / 20.0);
+			float end = (float)pow(10.0, gain / 20.0);
+			float peak = level.peak * 32768.0f;
+			if(peak * end > PeakLimit || peak * start > PeakLimit)
+			{
+				// A ramp down could still clip at its start, so the limited gain applies to the whole block.
+				end = peak * end > PeakLimit ? PeakLimit / peak : end;
+				start = end < start ? end : start;
+				gain = (float)(20.0 * log10(end));
+			}
+			m_gain = gain;
+
+			float step = (end - start) / count;
+			for(int i = 0; i < count; i++)
+			{
+				samples[i] = ToPcm16(samples[i] * (start + step * (i + 1)));
+			}
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// Brings speech to a steady level, so that users need not set the microphone gain by hand. The level of speech is
+// followed in short blocks, rising quickly and falling slowly, and only from blocks well above the background noise,
+// so that pauses do not make the gain climb. The gain moves towards the target level less the speech level at a
+// limited rate, faster down than up, and is always held low enough for the block's peak to fit, so that a sudden loud
+// sound does not clip. Within a block the gain is ramped from its last value, to avoid audible steps.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class GainController
+		{
+		private:
+			int m_block;
+			float m_speechLevel;
+			float m_noiseLevel;
+			float m_gain;
+			float m_targetLevel;
+			float m_maxGain;
+			float m_upStep;
+			float m_downStep;
+			float m_noiseRise;
+			float m_levelAttack;
+			float m_levelRelease;
+
+		public:
+			GainController(int sampleRate);
+
+			// Applies the gain in place. Any number of samples may be passed.
+			void Process(short *samples, int count);
+
+			// Returns the gain to where it starts, as at the start of a new stream.
+			void Reset();
+
+			// The level that speech is brought to, in dB relative to full scale.
+			float TargetLevel() const
+			{
+				return m_targetLevel;
+			}
+			void SetTargetLevel(float level);
+
+			// The most gain that is applied, in dB.
+			float MaxGain() const
+			{
+				return m_maxGain;
+			}
+			void SetMaxGain(float gain);
+
+			// The gain applied to the last block, in dB.
+			float Gain() const
+			{
+				return m_gain;
+			}
+
+		private:
+			void ProcessBlock(short *samples, int count);
+			GainController(const GainController&);
+			GainController &operator=(const GainController&);
+		};
+	}
+}
@@ -0,0 +1,829 @@
+#include <string.h>
+#include <emmintrin.h>
+#include "DspKernels.h"
+#include "Gsm610.h"
+
+// The clause numbers below refer to the GSM 06.10 specification, which also gives the exact fixed-point operations.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		static const short MinWord = -32768;
+		static const short MaxWord = 32767;
+
+		static const short A[8] = { 20480, 20480, 20480, 20480, 13964, 15360, 8534, 9036 };
+		static const short B[8] = { 0, 0, 2048, -2560, 94, -1792, -341, -1144 };
+		static const short MIC[8] = { -32, -32, -16, -16, -8, -8, -4, -4 };
+		static const short MAC[8] = { 31, 31, 15, 15, 7, 7, 3, 3 };
+		static const short INVA[8] = { 13107, 13107, 13107, 13107, 19223, 17476, 31454, 29708 };
+		static const short DLB[4] = { 6554, 16384, 26214, 32767 };
+		static const short QLB[4] = { 3277, 11469, 21299, 32767 };
+		static const short NRFAC[8] = { 29128, 26215, 23832, 21846, 20165, 18725, 17476, 16384 };
+		static const short FAC[8] = { 18431, 20479, 22527, 24575, 26623, 28671, 30719, 32767 };
+		static const int LarBits[8] = { 6, 6, 5, 5, 4, 4, 3, 3 };
+
+		static inline short Saturate(int value)
+		{
+			return value < MinWord ? MinWord : value > MaxWord ? MaxWord : (short)value;
+		}
+
+		static inline short Add(short a, short b)
+		{
+			return Saturate((int)a + b);
+		}
+
+		static inline short Sub(short a, short b)
+		{
+			return Saturate((int)a - b);
+		}
+
+		static inline short Mult(short a, short b)
+		{
+			return a == MinWord && b == MinWord ? MaxWord : (short)(((int)a * b) >> 15);
+		}
+
+		static inline short MultR(short a, short b)
+		{
+			return a == MinWord && b == MinWord ? MaxWord : (short)(((int)a * b + 16384) >> 15);
+		}
+
+		static inline short Abs(short a)
+		{
+			return a < 0 ? (a == MinWord ? MaxWord : (short)-a) : a;
+		}
+
+		static inline int LAdd(int a, int b)
+		{
+			__int64 sum = (__int64)a + b;
+			return sum < -2147483647 - 1 ? -2147483647 - 1 : sum > 2147483647 ? 2147483647 : (int)sum;
+		}
+
+		// The number of left shifts needed to normalize a 32-bit value.
+		static short Norm(int a)
+		{
+			if(a < 0)
+			{
+				if(a <= -1073741824)
+				{
+					return 0;
+				}
+				a = ~a;
+			}
+			short n = 31;
+			for(unsigned int u = (unsigned int)a; u != 0; u >>= 1)
+			{
+				n--;
+			}
+			return n;
+		}
+
+		static short Asr(short a, int n);
+
+		static short Asl(short a, int n)
+		{
+			if(n >= 16)
+			{
+				return 0;
+			}
+			if(n <= -16)
+			{
+				return a < 0 ? -1 : 0;
+			}
+			return n < 0 ? Asr(a, -n) : (short)(a << n);
+		}
+
+		static short Asr(short a, int n)
+		{
+			if(n >= 16)
+			{
+				return a < 0 ? -1 : 0;
+			}
+			if(n <= -16)
+			{
+				return 0;
+			}
+			return n < 0 ? (short)(a << -n) : (short)(a >> n);
+		}
+
+		static short Div(short num, short denum)
+		{
+			if(num == 0)
+			{
+				return 0;
+			}
+			int L_num = num, L_denum = denum;
+			short div = 0;
+			for(int k = 0; k < 15; k++)
+			{
+				div <<= 1;
+				L_num <<= 1;
+				if(L_num >= L_denum)
+				{
+					L_num -= L_denum;
+					div++;
+				}
+			}
+			return div;
+		}
+
+		Gsm610::Gsm610()
+		{
+			m_ltpSearch = CpuHasSse2() ? &Kernels::Gsm610LtpSearchSse2 : &Kernels::Gsm610LtpSearchScalar;
+			this->Reset();
+		}
+
+		Gsm610::Gsm610(LtpSearchFunc ltpSearch)
+		{
+			m_ltpSearch = ltpSearch;
+			this->Reset();
+		}
+
+		void Gsm610::Reset()
+		{
+			memset(m_dp0, 0, sizeof(m_dp0));
+			memset(m_e, 0, sizeof(m_e));
+			memset(m_u, 0, sizeof(m_u));
+			memset(m_LARpp, 0, sizeof(m_LARpp));
+			memset(m_v, 0, sizeof(m_v));
+			m_z1 = m_mp = m_j = m_msr = 0;
+			m_L_z2 = 0;
+			m_nrp = 40;
+		}
+
+		void Gsm610::Encode(const short *samples, unsigned char *block)
+		{
+			Frame frame;
+			memset(block, 0, BytesPerBlock);
+			this->EncodeFrame(samples, &frame);
+			Pack(&frame, block, 0);
+			this->EncodeFrame(samples + SamplesPerFrame, &frame);
+			Pack(&frame, block, BitsPerFrame);
+		}
+
+		void Gsm610::Decode(const unsigned char *block, short *samples)
+		{
+			Frame frame;
+			Unpack(block, 0, &frame);
+			this->DecodeFrame(&frame, samples);
+			Unpack(block, BitsPerFrame, &frame);
+			this->DecodeFrame(&frame, samples + SamplesPerFrame);
+		}
+
+		// 4.2.0 - 4.2.3: Downscaling, offset compensation and preemphasis.
+		void Gsm610::Preprocess(const short *s, short *so)
+		{
+			short z1 = m_z1, mp = m_mp;
+			int L_z2 = m_L_z2;
+
+			for(int k = 0; k < 160; k++)
+			{
+				short SO = (short)((s[k] >> 3) << 2);
+				short s1 = (short)(SO - z1);
+				z1 = SO;
+
+				int L_s2 = (int)s1 << 15;
+				short msp = (short)(L_z2 >> 15);
+				short lsp = (short)(L_z2 - ((int)msp << 15));
+				L_s2 += MultR(lsp, 32735);
+				L_z2 = LAdd((int)msp * 32735, L_s2);
+
+				int L_temp = LAdd(L_z2, 16384);
+				msp = MultR(mp, -28180);
+				mp = (short)(L_temp >> 15);
+				so[k] = Add(mp, msp);
+			}
+
+			m_z1 = z1;
+			m_L_z2 = L_z2;
+			m_mp = mp;
+		}
+
+		// 4.2.4: Autocorrelation. The signal is scaled down in place and back up afterwards, which loses the low bits
+		// exactly as the reference does.
+		static void Autocorrelation(short *s, int *L_ACF)
+		{
+			short smax = 0;
+			for(int k = 0; k < 160; k++)
+			{
+				short temp = Abs(s[k]);
+				if(temp > smax)
+				{
+					smax = temp;
+				}
+			}
+
+			int scalauto = smax == 0 ? 0 : 4 - Norm((int)smax << 16);
+			if(scalauto > 0)
+			{
+				short factor = (short)(16384 >> (scalauto - 1));
+				for(int k = 0; k < 160; k++)
+				{
+					s[k] = MultR(s[k], factor);
+				}
+			}
+
+			for(int k = 0; k < 9; k++)
+			{
+				int sum = 0;
+				for(int i = k; i < 160; i++)
+				{
+					sum += (int)s[i] * s[i - k];
+				}
+				L_ACF[k] = sum << 1;
+			}
+
+			if(scalauto > 0)
+			{
+				for(int k = 0; k < 160; k++)
+				{
+					s[k] = (short)(s[k] << scalauto);
+				}
+			}
+		}
+
+		// 4.2.5: Schur recursion for the reflection coefficients.
+		static void ReflectionCoefficients(const int *L_ACF, short *r)
+		{
+			short ACF[9], P[9], K[9];
+
+			if(L_ACF[0] == 0)
+			{
+				memset(r, 0, 8 * sizeof(short));
+				return;
+			}
+
+			short temp = Norm(L_ACF[0]);
+			for(int i = 0; i <= 8; i++)
+			{
+				ACF[i] = (short)((L_ACF[i] << temp) >> 16);
+			}
+			for(int i = 1; i <= 7; i++)
+			{
+				K[i] = ACF[i];
+			}
+			for(int i = 0; i <= 8; i++)
+			{
+				P[i] = ACF[i];
+			}
+
+			for(int n = 1; n <= 8; n++, r++)
+			{
+				temp = Abs(P[1]);
+				if(P[0] < temp)
+				{
+					for(int i = n; i <= 8; i++)
+					{
+						*r++ = 0;
+					}
+					return;
+				}
+
+				*r = Div(temp, P[0]);
+				if(P[1] > 0)
+				{
+					*r = -*r;
+				}
+				if(n == 8)
+				{
+					return;
+				}
+
+				P[0] = Add(P[0], MultR(P[1], *r));
+				for(int m = 1; m <= 8 - n; m++)
+				{
+					P[m] = Add(P[m + 1], MultR(K[m], *r));
+					K[m] = Add(K[m], MultR(P[m + 1], *r));
+				}
+			}
+		}
+
+		// 4.2.6: Reflection coefficients to log area ratios.
+		static void TransformToLogAreaRatios(short *r)
+		{
+			for(int i = 0; i < 8; i++)
+			{
+				short temp = Abs(r[i]);
+				if(temp < 22118)
+				{
+					temp >>= 1;
+				}
+				else if(temp < 31130)
+				{
+					temp -= 11059;
+				}
+				else
+				{
+					temp = (short)((temp - 26112) << 2);
+				}
+				r[i] = r[i] < 0 ? -temp : temp;
+			}
+		}
+
+		// 4.2.7: Quantization and coding of the log area ratios.
+		static void QuantizeLogAreaRatios(short *LAR)
+		{
+			for(int i = 0; i < 8; i++)
+			{
+				short temp = Mult(A[i], LAR[i]);
+				temp = Add(temp, B[i]);
+				temp = Add(temp, 256);
+				temp >>= 9;
+				LAR[i] = temp > MAC[i] ? MAC[i] - MIC[i] : (temp < MIC[i] ? 0 : temp - MIC[i]);
+			}
+		}
+
+		// 4.2.8: Decoding of the coded log area ratios.
+		static void DecodeLogAreaRatios(const short *LARc, short *LARpp)
+		{
+			for(int i = 0; i < 8; i++)
+			{
+				short temp = (short)(Add(LARc[i], MIC[i]) << 10);
+				temp = Sub(temp, (short)(B[i] << 1));
+				temp = MultR(INVA[i], temp);
+				LARpp[i] = Add(temp, temp);
+			}
+		}
+
+		// 4.2.9.1: Interpolation of the log area ratios for each of the four segments of a frame.
+		static void InterpolateLogAreaRatios(int segment, const short *LARpp_j_1, const short *LARpp_j, short *LARp)
+		{
+			for(int i = 0; i < 8; i++)
+			{
+				switch(segment)
+				{
+				case 0:
+					LARp[i] = Add(LARpp_j_1[i] >> 2, LARpp_j[i] >> 2);
+					LARp[i] = Add(LARp[i], LARpp_j_1[i] >> 1);
+					break;
+				case 1:
+					LARp[i] = Add(LARpp_j_1[i] >> 1, LARpp_j[i] >> 1);
+					break;
+				case 2:
+					LARp[i] = Add(LARpp_j_1[i] >> 2, LARpp_j[i] >> 2);
+					LARp[i] = Add(LARp[i], LARpp_j[i] >> 1);
+					break;
+				default:
+					LARp[i] = LARpp_j[i];
+					break;
+				}
+			}
+		}
+
+		// 4.2.9.2: Log area ratios to reflection coefficients.
+		static void LogAreaRatiosToReflection(short *LARp)
+		{
+			for(int i = 0; i < 8; i++)
+			{
+				short temp = LARp[i] < 0 ? (LARp[i] == MinWord ? MaxWord : (short)-LARp[i]) : LARp[i];
+				temp = temp < 11059 ? (short)(temp << 1) : (temp < 20070 ? temp + 11059 : Add(temp >> 2, 26112));
+				LARp[i] = LARp[i] < 0 ? -temp : temp;
+			}
+		}
+
+		static const int SegmentStart[5] = { 0, 13, 27, 40, 160 };
+
+		// 4.2.10: Short term analysis filtering, in place.
+		void Gsm610::ShortTermAnalysis(const short *LARc, short *s)
+		{
+			short *LARpp_j = m_LARpp[m_j];
+			short *LARpp_j_1 = m_LARpp[m_j ^= 1];
+			short rp[8];
+
+			DecodeLogAreaRatios(LARc, LARpp_j);
+			for(int segment = 0; segment < 4; segment++)
+			{
+				InterpolateLogAreaRatios(segment, LARpp_j_1, LARpp_j, rp);
+				LogAreaRatiosToReflection(rp);
+				for(int k = SegmentStart[segment]; k < SegmentStart[segment + 1]; k++)
+				{
+					short di = s[k], sav = s[k];
+					for(int i = 0; i < 8; i++)
+					{
+						short ui = m_u[i];
+						m_u[i] = sav;
+						sav = Add(ui, MultR(rp[i], di));
+						di = Add(di, MultR(rp[i], ui));
+					}
+					s[k] = di;
+				}
+			}
+		}
+
+		// 4.3.4: Short term synthesis filtering.
+		void Gsm610::ShortTermSynthesis(const short *LARcr, short *wt, short *s)
+		{
+			short *LARpp_j = m_LARpp[m_j];
+			short *LARpp_j_1 = m_LARpp[m_j ^= 1];
+			short rrp[8];
+
+			DecodeLogAreaRatios(LARcr, LARpp_j);
+			for(int segment = 0; segment < 4; segment++)
+			{
+				InterpolateLogAreaRatios(segment, LARpp_j_1, LARpp_j, rrp);
+				LogAreaRatiosToReflection(rrp);
+				for(int k = SegmentStart[segment]; k < SegmentStart[segment + 1]; k++)
+				{
+					short sri = wt[k];
+					for(int i = 7; i >= 0; i--)
+					{
+						sri = Sub(sri, MultR(rrp[i], m_v[i]));
+						m_v[i + 1] = Add(m_v[i], MultR(rrp[i], sri));
+					}
+					s[k] = m_v[0] = sri;
+				}
+			}
+		}
+
+		// 4.2.11: Calculation of the LTP parameters.
+		static void CalculateLtpParameters(Gsm610::LtpSearchFunc ltpSearch, const short *d, const short *dp, short *bc,
+			short *Nc)
+		{
+			short wt[40];
+			short dmax = 0;
+			for(int k = 0; k < 40; k++)
+			{
+				short temp = Abs(d[k]);
+				if(temp > dmax)
+				{
+					dmax = temp;
+				}
+			}
+
+			short temp = dmax == 0 ? 0 : Norm((int)dmax << 16);
+			short scal = temp > 6 ? 0 : 6 - temp;
+			for(int k = 0; k < 40; k++)
+			{
+				wt[k] = d[k] >> scal;
+			}
+
+			int L_max;
+			*Nc = (short)ltpSearch(wt, dp, &L_max);
+			L_max <<= 1;
+			L_max >>= 6 - scal;
+
+			int L_power = 0;
+			for(int k = 0; k < 40; k++)
+			{
+				int L_temp = dp[k - *Nc] >> 3;
+				L_power += L_temp * L_temp;
+			}
+			L_power <<= 1;
+
+			if(L_max <= 0)
+			{
+				*bc = 0;
+				return;
+			}
+			if(L_max >= L_power)
+			{
+				*bc = 3;
+				return;
+			}
+
+			temp = Norm(L_power);
+			short R = (short)((L_max << temp) >> 16);
+			short S = (short)((L_power << temp) >> 16);
+			for(*bc = 0; *bc <= 2; (*bc)++)
+			{
+				if(R <= Mult(S, DLB[*bc]))
+				{
+					break;
+				}
+			}
+		}
+
+		// 4.2.12: Long term analysis filtering. dpp may alias dp, since only dp[-120..-1] is read.
+		static void LongTermAnalysisFilter(short bc, short Nc, const short *dp, const short *d, short *dpp, short *e)
+		{
+			for(int k = 0; k < 40; k++)
+			{
+				dpp[k] = MultR(QLB[bc], dp[k - Nc]);
+				e[k] = Sub(d[k], dpp[k]);
+			}
+		}
+
+		// 4.3.2: Long term synthesis filtering.
+		void Gsm610::LongTermSynthesis(short Ncr, short bcr, const short *erp, short *drp)
+		{
+			short Nr = Ncr < 40 || Ncr > 120 ? m_nrp : Ncr;
+			m_nrp = Nr;
+
+			short brp = QLB[bcr];
+			for(int k = 0; k < 40; k++)
+			{
+				drp[k] = Add(erp[k], MultR(brp, drp[k - Nr]));
+			}
+			memmove(drp - 120, drp - 80, 120 * sizeof(short));
+		}
+
+		// 4.2.13: Weighting filter. e has five samples of zero padding on either side.
+		static void WeightingFilter(const short *e, short *x)
+		{
+			static const short H[11] = { -134, -374, 0, 2054, 5741, 8192, 5741, 2054, 0, -374, -134 };
+			e -= 5;
+			for(int k = 0; k < 40; k++)
+			{
+				int L_result = 4096;
+				for(int i = 0; i < 11; i++)
+				{
+					L_result += e[k + i] * (int)H[i];
+				}
+				L_result >>= 13;
+				x[k] = Saturate(L_result);
+			}
+		}
+
+		// 4.2.14: RPE grid selection.
+		static void SelectRpeGrid(const short *x, short *xM, short *Mc)
+		{
+			int EM = 0;
+			*Mc = 0;
+			for(int m = 0; m < 4; m++)
+			{
+				int L_result = 0;
+				for(int i = 0; i < 13; i++)
+				{
+					int L_temp = x[m + 3 * i] >> 2;
+					L_result += L_temp * L_temp;
+				}
+				L_result <<= 1;
+				if(m == 0 || L_result > EM)
+				{
+					*Mc = (short)m;
+					EM = L_result;
+				}
+			}
+			for(int i = 0; i < 13; i++)
+			{
+				xM[i] = x[*Mc + 3 * i];
+			}
+		}
+
+		static void XmaxcToExpMant(short xmaxc, short *exp, short *mant)
+		{
+			*exp = 0;
+			if(xmaxc > 15)
+			{
+				*exp = (xmaxc >> 3) - 1;
+			}
+			*mant = xmaxc - (*exp << 3);
+
+			if(*mant == 0)
+			{
+				*exp = -4;
+				*mant = 7;
+			}
+			else
+			{
+				while(*mant <= 7)
+				{
+					*mant = *mant << 1 | 1;
+					(*exp)--;
+				}
+				*mant -= 8;
+			}
+		}
+
+		// 4.2.15: APCM quantization of the selected RPE sequence.
+		static void QuantizeApcm(const short *xM, short *xMc, short *mant, short *exp, short *xmaxc)
+		{
+			short xmax = 0;
+			for(int i = 0; i < 13; i++)
+			{
+				short temp = Abs(xM[i]);
+				if(temp > xmax)
+				{
+					xmax = temp;
+				}
+			}
+
+			*exp = 0;
+			short temp = xmax >> 9;
+			bool itest = false;
+			for(int i = 0; i <= 5; i++)
+			{
+				itest |= temp <= 0;
+				temp >>= 1;
+				if(!itest)
+				{
+					(*exp)++;
+				}
+			}
+			*xmaxc = Add(xmax >> (*exp + 5), *exp << 3);
+
+			XmaxcToExpMant(*xmaxc, exp, mant);
+			short temp1 = 6 - *exp;
+			short temp2 = NRFAC[*mant];
+			for(int i = 0; i < 13; i++)
+			{
+				temp = (short)(xM[i] << temp1);
+				temp = Mult(temp, temp2);
+				xMc[i] = (temp >> 12) + 4;
+			}
+		}
+
+		// 4.2.16: APCM inverse quantization.
+		static void DequantizeApcm(const short *xMc, short mant, short exp, short *xMp)
+		{
+			short temp1 = FAC[mant];
+			short temp2 = Sub(6, exp);
+			short temp3 = Asl(1, Sub(temp2, 1));
+			for(int i = 0; i < 13; i++)
+			{
+				short temp = (short)(((xMc[i] << 1) - 7) << 12);
+				temp = MultR(temp1, temp);
+				temp = Add(temp, temp3);
+				xMp[i] = Asr(temp, temp2);
+			}
+		}
+
+		// 4.2.17: RPE grid positioning.
+		static void PositionRpeGrid(short Mc, const short *xMp, short *ep)
+		{
+			memset(ep, 0, 40 * sizeof(short));
+			for(int i = 0; i < 13; i++)
+			{
+				ep[Mc + 3 * i] = xMp[i];
+			}
+		}
+
+		void Gsm610::EncodeFrame(const short *s, Frame *f)
+		{
+			short so[160];
+			int L_ACF[9];
+
+			this->Preprocess(s, so);
+			Autocorrelation(so, L_ACF);
+			ReflectionCoefficients(L_ACF, f->LARc);
+			TransformToLogAreaRatios(f->LARc);
+			QuantizeLogAreaRatios(f->LARc);
+			this->ShortTermAnalysis(f->LARc, so);
+
+			short *dp = m_dp0 + 120;
+			short *e = m_e + 5;
+			for(int k = 0; k < 4; k++, dp += 40)
+			{
+				short x[40], xM[13], xMp[13], mant, exp;
+
+				CalculateLtpParameters(m_ltpSearch, so + k * 40, dp, &f->bc[k], &f->Nc[k]);
+				LongTermAnalysisFilter(f->bc[k], f->Nc[k], dp, so + k * 40, dp, e);
+
+				WeightingFilter(e, x);
+				SelectRpeGrid(x, xM, &f->Mc[k]);
+				QuantizeApcm(xM, f->xMc[k], &mant, &exp, &f->xmaxc[k]);
+				DequantizeApcm(f->xMc[k], mant, exp, xMp);
+				PositionRpeGrid(f->Mc[k], xMp, e);
+
+				for(int i = 0; i < 40; i++)
+				{
+					dp[i] = Add(e[i], dp[i]);
+				}
+			}
+			memmove(m_dp0, m_dp0 + 160, 120 * sizeof(short));
+		}
+
+		// 4.3.5: Deemphasis, truncation and upscaling.
+		void Gsm610::Postprocess(short *s)
+		{
+			short msr = m_msr;
+			for(int k = 0; k < 160; k++)
+			{
+				msr = Add(s[k], MultR(msr, 28180));
+				s[k] = Add(msr, msr) & 0xfff8;
+			}
+			m_msr = msr;
+		}
+
+		void Gsm610::DecodeFrame(const Frame *f, short *s)
+		{
+			short erp[40], wt[160];
+			short *drp = m_dp0 + 120;
+
+			for(int j = 0; j < 4; j++)
+			{
+				short xMp[13], mant, exp;
+
+				XmaxcToExpMant(f->xmaxc[j], &exp, &mant);
+				DequantizeApcm(f->xMc[j], mant, exp, xMp);
+				PositionRpeGrid(f->Mc[j], xMp, erp);
+				this->LongTermSynthesis(f->Nc[j], f->bc[j], erp, drp);
+				memcpy(wt + j * 40, drp, 40 * sizeof(short));
+			}
+
+			this->ShortTermSynthesis(f->LARc, wt, s);
+			this->Postprocess(s);
+		}
+
+		// WAV49 packs both frames of a block into one least-significant-bit-first stream of 2 x 260 bits.
+		static inline void PutBits(unsigned char *block, int &pos, int value, int bits)
+		{
+			for(int i = 0; i < bits; i++, pos++)
+			{
+				block[pos >> 3] |= (unsigned char)(((value >> i) & 1) << (pos & 7));
+			}
+		}
+
+		static inline short GetBits(const unsigned char *block, int &pos, int bits)
+		{
+			int value = 0;
+			for(int i = 0; i < bits; i++, pos++)
+			{
+				value |= ((block[pos >> 3] >> (pos & 7)) & 1) << i;
+			}
+			return (short)value;
+		}
+
+		void Gsm610::Pack(const Frame *f, unsigned char *block, int bitOffset)
+		{
+			int pos = bitOffset;
+			for(int i = 0; i < 8; i++)
+			{
+				PutBits(block, pos, f->LARc[i], LarBits[i]);
+			}
+			for(int k = 0; k < 4; k++)
+			{
+				PutBits(block, pos, f->Nc[k], 7);
+				PutBits(block, pos, f->bc[k], 2);
+				PutBits(block, pos, f->Mc[k], 2);
+				PutBits(block, pos, f->xmaxc[k], 6);
+				for(int i = 0; i < 13; i++)
+				{
+					PutBits(block, pos, f->xMc[k][i], 3);
+				}
+			}
+		}
+
+		void Gsm610::Unpack(const unsigned char *block, int bitOffset, Frame *f)
+		{
+			int pos = bitOffset;
+			for(int i = 0; i < 8; i++)
+			{
+				f->LARc[i] = GetBits(block, pos, LarBits[i]);
+			}
+			for(int k = 0; k < 4; k++)
+			{
+				f->Nc[k] = GetBits(block, pos, 7);
+				f->bc[k] = GetBits(block, pos, 2);
+				f->Mc[k] = GetBits(block, pos, 2);
+				f->xmaxc[k] = GetBits(block, pos, 6);
+				for(int i = 0; i < 13; i++)
+				{
+					f->xMc[k][i] = GetBits(block, pos, 3);
+				}
+			}
+		}
+
+		int Kernels::Gsm610LtpSearchScalar(const short *wt, const short *dp, int *maxCorrelation)
+		{
+			int Nc = 40, L_max = 0;
+			for(int lambda = 40; lambda <= 120; lambda++)
+			{
+				int L_result = 0;
+				for(int k = 0; k < 40; k++)
+				{
+					L_result += (int)wt[k] * dp[k - lambda];
+				}
+				if(L_result > L_max)
+				{
+					Nc = lambda;
+					L_max = L_result;
+				}
+			}
+			*maxCorrelation = L_max;
+			return Nc;
+		}
+
+		int Kernels::Gsm610LtpSearchSse2(const short *wt, const short *dp, int *maxCorrelation)
+		{
+			// The products are summed in 32 bits exactly as in the scalar version; the input scaling guarantees
+			// that the sums cannot overflow.
+			__m128i w0 = _mm_loadu_si128((const __m128i*)wt);
+			__m128i w1 = _mm_loadu_si128((const __m128i*)(wt + 8));
+			__m128i w2 = _mm_loadu_si128((const __m128i*)(wt + 16));
+			__m128i w3 = _mm_loadu_si128((const __m128i*)(wt + 24));
+			__m128i w4 = _mm_loadu_si128((const __m128i*)(wt + 32));
+
+			int Nc = 40, L_max = 0;
+			for(int lambda = 40; lambda <= 120; lambda++)
+			{
+				const short *p = dp - lambda;
+				__m128i sum = _mm_madd_epi16(w0, _mm_loadu_si128((const __m128i*)p));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(w1, _mm_loadu_si128((const __m128i*)(p + 8))));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(w2, _mm_loadu_si128((const __m128i*)(p + 16))));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(w3, _mm_loadu_si128((const __m128i*)(p + 24))));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(w4, _mm_loadu_si128((const __m128i*)(p + 32))));
+				sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+				sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+				int L_result = _mm_cvtsi128_si32(sum);
+				if(L_result > L_max)
+				{
+					Nc = lambda;
+					L_max = L_result;
+				}
+			}
+			*maxCorrelation = L_max;
+			return Nc;
+		}
+	}
+}
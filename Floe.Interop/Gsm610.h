@@ -0,0 +1,84 @@
+#pragma once
+
+// A native GSM 06.10 full-rate speech codec. Frames of 160 samples are packed in pairs into the 65-byte blocks of the
+// Microsoft WAV49 format (as produced by the ACM GSM 6.10 codec), so the output is interchangeable with
+// WaveFormatGsm610 data. The arithmetic follows the fixed-point reference in the standard, but has not been checked
+// against the output of another implementation; the vectors in the test project were made with this one.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		// An instance holds the state of a single stream in one direction, so encoding and decoding need separate instances.
+		class Gsm610
+		{
+		public:
+			static const int SamplesPerFrame = 160;
+			static const int SamplesPerBlock = 320;
+			static const int BytesPerBlock = 65;
+
+			// The long-term predictor's search for the best lag, which has scalar and SSE2 versions in Kernels.
+			typedef int (*LtpSearchFunc)(const short *wt, const short *dp, int *maxCorrelation);
+
+		private:
+			static const int BitsPerFrame = 260;
+
+			struct Frame
+			{
+				short LARc[8];
+				short Nc[4];
+				short bc[4];
+				short Mc[4];
+				short xmaxc[4];
+				short xMc[4][13];
+			};
+
+			// Encoder and decoder state, as in the reference implementation.
+			short m_dp0[280];
+			short m_e[50];
+			short m_z1;
+			int m_L_z2;
+			short m_mp;
+			short m_u[8];
+			short m_LARpp[2][8];
+			short m_j;
+			short m_nrp;
+			short m_v[9];
+			short m_msr;
+			LtpSearchFunc m_ltpSearch;
+
+		public:
+			// Uses the fastest version of the LTP search that the CPU supports.
+			Gsm610();
+
+			// Uses the given version of the LTP search, so that the versions can be checked against each other.
+			explicit Gsm610(LtpSearchFunc ltpSearch);
+			void Reset();
+
+			// Encodes 320 samples into one 65-byte block.
+			void Encode(const short *samples, unsigned char *block);
+
+			// Decodes one 65-byte block into 320 samples.
+			void Decode(const unsigned char *block, short *samples);
+
+		private:
+			void EncodeFrame(const short *s, Frame *f);
+			void DecodeFrame(const Frame *f, short *s);
+			void Preprocess(const short *s, short *so);
+			void ShortTermAnalysis(const short *LARc, short *s);
+			void ShortTermSynthesis(const short *LARcr, short *wt, short *s);
+			void LongTermSynthesis(short Ncr, short bcr, const short *erp, short *drp);
+			void Postprocess(short *s);
+			static void Pack(const Frame *f, unsigned char *block, int bitOffset);
+			static void Unpack(const unsigned char *block, int bitOffset, Frame *f);
+		};
+
+		namespace Kernels
+		{
+			// The cross-correlation search of the long-term predictor, which dominates the encoder. Returns the lag
+			// (40..120) with the largest correlation between wt[0..39] and dp[-lag..39-lag], and that correlation.
+			int Gsm610LtpSearchScalar(const short *wt, const short *dp, int *maxCorrelation);
+			int Gsm610LtpSearchSse2(const short *wt, const short *dp, int *maxCorrelation);
+		}
+	}
+}
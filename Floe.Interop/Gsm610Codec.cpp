@@ -0,0 +1,88 @@
+#include "Stdafx.h"
+#include "Gsm610Codec.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		Gsm610Codec::Gsm610Codec()
+		{
+			m_encoder = new Gsm610();
+			m_decoder = new Gsm610();
+		}
+
+		Gsm610Codec::Gsm610Codec(bool useSimd)
+		{
+			m_encoder = new Gsm610(useSimd && CpuHasSse2() ? &Kernels::Gsm610LtpSearchSse2 : &Kernels::Gsm610LtpSearchScalar);
+			m_decoder = new Gsm610();
+		}
+
+		int Gsm610Codec::Encode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			int blocks = size / (Gsm610::SamplesPerBlock * 2);
+			if(blocks * Gsm610::BytesPerBlock > dstSize)
+			{
+				throw gcnew InteropException("Destination buffer too small.");
+			}
+
+			const short *src = (const short*)(void*)srcBuffer;
+			unsigned char *dst = (unsigned char*)(void*)dstBuffer;
+			for(int i = 0; i < blocks; i++)
+			{
+				m_encoder->Encode(src, dst);
+				src += Gsm610::SamplesPerBlock;
+				dst += Gsm610::BytesPerBlock;
+			}
+			return blocks * Gsm610::BytesPerBlock;
+		}
+
+		int Gsm610Codec::Decode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			int blocks = size / Gsm610::BytesPerBlock;
+			if(blocks * Gsm610::SamplesPerBlock * 2 > dstSize)
+			{
+				throw gcnew InteropException("Destination buffer too small.");
+			}
+
+			const unsigned char *src = (const unsigned char*)(void*)srcBuffer;
+			short *dst = (short*)(void*)dstBuffer;
+			for(int i = 0; i < blocks; i++)
+			{
+				m_decoder->Decode(src, dst);
+				src += Gsm610::BytesPerBlock;
+				dst += Gsm610::SamplesPerBlock;
+			}
+			return blocks * Gsm610::SamplesPerBlock * 2;
+		}
+
+		int Gsm610Codec::Recover(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			return 0;
+		}
+
+		void Gsm610Codec::Reset()
+		{
+			m_encoder->Reset();
+			m_decoder->Reset();
+		}
+
+		Gsm610Codec::~Gsm610Codec()
+		{
+			if(m_encoder != 0)
+			{
+				delete m_encoder;
+				m_encoder = 0;
+			}
+			if(m_decoder != 0)
+			{
+				delete m_decoder;
+				m_decoder = 0;
+			}
+		}
+
+		Gsm610Codec::!Gsm610Codec()
+		{
+			this->~Gsm610Codec();
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "AudioCodec.h"
+#include "DspKernels.h"
+#include "Gsm610.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// The built-in GSM 6.10 codec, which produces the same 65-byte blocks as WaveFormatGsm610 without going through ACM.
+		public ref class Gsm610Codec : IAudioCodec
+		{
+		private:
+			Gsm610 *m_encoder;
+			Gsm610 *m_decoder;
+
+		public:
+			Gsm610Codec();
+
+			// Uses the SSE2 version of the encoder's long-term predictor search if useSimd is set and the CPU supports
+			// it, or the scalar version otherwise, so that tests can check one against the other.
+			Gsm610Codec(bool useSimd);
+
+			virtual int Encode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
+			virtual int Decode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
+			virtual int Recover(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
+			void Reset();
+
+			static property int SamplesPerBlock
+			{
+				int get()
+				{
+					return Gsm610::SamplesPerBlock;
+				}
+			}
+
+			static property int BytesPerBlock
+			{
+				int get()
+				{
+					return Gsm610::BytesPerBlock;
+				}
+			}
+
+			// Whether the CPU supports the SSE2 version of the long-term predictor search.
+			static property bool HasSimd
+			{
+				bool get()
+				{
+					return CpuHasSse2();
+				}
+			}
+
+		private:
+			~Gsm610Codec();
+			!Gsm610Codec();
+		};
+	}
+}
@@ -0,0 +1,71 @@
+#include "Stdafx.h"
+#include "JitterRing.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		JitterRing::JitterRing(int span, int clockRate, int maxPacketSize, int capacity, int delay)
+		{
+			if(span < 1 || clockRate < 1 || maxPacketSize < 1 || capacity < 1 || delay < 0)
+			{
+				throw gcnew System::ArgumentException("Invalid jitter buffer dimensions.");
+			}
+			m_ring = new PacketRing(span, clockRate, maxPacketSize, capacity, delay);
+		}
+
+		bool JitterRing::Insert(int timeStamp, array<Byte> ^payload, int offset, int count)
+		{
+			if(offset < 0 || count < 1 || offset + count > payload->Length)
+			{
+				return false;
+			}
+			pin_ptr<Byte> ptr = &payload[offset];
+			return m_ring->Insert(timeStamp, ptr, count);
+		}
+
+		IntPtr JitterRing::Acquire([Out] int %size, [Out] bool %recovery)
+		{
+			int count;
+			bool borrowed;
+			const unsigned char *data = m_ring->Acquire(&count, &borrowed);
+			size = count;
+			recovery = borrowed;
+			return IntPtr((void*)data);
+		}
+
+		void JitterRing::Release()
+		{
+			m_ring->Release();
+		}
+
+		void JitterRing::Reset()
+		{
+			m_ring->Reset();
+		}
+
+		void JitterRing::AdvanceClock(int count)
+		{
+			m_ring->AdvanceClock(count);
+		}
+
+		void JitterRing::SetClock(double seconds)
+		{
+			m_ring->SetClock(seconds);
+		}
+
+		JitterRing::~JitterRing()
+		{
+			if(m_ring != 0)
+			{
+				delete m_ring;
+				m_ring = 0;
+			}
+		}
+
+		JitterRing::!JitterRing()
+		{
+			this->~JitterRing();
+		}
+	}
+}
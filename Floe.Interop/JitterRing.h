@@ -0,0 +1,108 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "PacketRing.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+		using System::Byte;
+		using namespace System::Runtime::InteropServices;
+
+		public ref class JitterRing
+		{
+		private:
+			PacketRing *m_ring;
+
+		public:
+			JitterRing(int span, int clockRate, int maxPacketSize, int capacity, int delay);
+			bool Insert(int timeStamp, array<Byte> ^payload, int offset, int count);
+			IntPtr Acquire([Out] int %size, [Out] bool %recovery);
+			void Release();
+			void Reset();
+
+			// Advances the playback clock by count samples. Call this once for every playback buffer.
+			void AdvanceClock(int count);
+
+			// Drives the ring from a simulated clock, in seconds, instead of the performance counter, so that a long
+			// session can be replayed faster than real time from a single thread.
+			void SetClock(double seconds);
+
+			property int Count
+			{
+				int get()
+				{
+					return m_ring->Count();
+				}
+			}
+
+			property bool Adaptive
+			{
+				bool get()
+				{
+					return m_ring->IsAdaptive();
+				}
+				void set(bool value)
+				{
+					m_ring->SetAdaptive(value);
+				}
+			}
+
+			property float Jitter
+			{
+				float get()
+				{
+					return m_ring->Jitter();
+				}
+			}
+
+			property float Delay
+			{
+				float get()
+				{
+					return m_ring->Delay();
+				}
+			}
+
+			property int LatePackets
+			{
+				int get()
+				{
+					return m_ring->LateCount();
+				}
+			}
+
+			property int Underruns
+			{
+				int get()
+				{
+					return m_ring->UnderrunCount();
+				}
+			}
+
+			// The number of times the ring has started over by itself because too many packets in a row were missing.
+			property int Resets
+			{
+				int get()
+				{
+					return m_ring->ResetCount();
+				}
+			}
+
+			// How much faster the sender's clock runs than the playback device's, in parts per million.
+			property float Drift
+			{
+				float get()
+				{
+					return m_ring->Drift();
+				}
+			}
+
+		private:
+			~JitterRing();
+			!JitterRing();
+		};
+	}
+}
@@ -0,0 +1,51 @@
+#include "Stdafx.h"
+#include "LossConcealer.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		LossConcealer::LossConcealer(int sampleRate)
+		{
+			if(sampleRate < 1000)
+			{
+				throw gcnew System::ArgumentException("Invalid sample rate.");
+			}
+			m_concealer = new PitchConcealer(sampleRate);
+		}
+
+		void LossConcealer::Update(IntPtr buffer, int count)
+		{
+			m_concealer->Update((short*)(void*)buffer, count / 2);
+		}
+
+		int LossConcealer::Conceal(IntPtr buffer, int count)
+		{
+			return m_concealer->Conceal((short*)(void*)buffer, count / 2) ? count & ~1 : 0;
+		}
+
+		void LossConcealer::Reset()
+		{
+			m_concealer->Reset();
+		}
+
+		void LossConcealer::SetComfortNoise(float rms)
+		{
+			m_concealer->SetComfortNoise(rms);
+		}
+
+		LossConcealer::~LossConcealer()
+		{
+			if(m_concealer != 0)
+			{
+				delete m_concealer;
+				m_concealer = 0;
+			}
+		}
+
+		LossConcealer::!LossConcealer()
+		{
+			this->~LossConcealer();
+		}
+	}
+}
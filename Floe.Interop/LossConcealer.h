@@ -0,0 +1,41 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "PitchConcealer.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// Fills the gaps left by lost packets in a decoded 16-bit mono stream. Every decoded packet must pass through
+		// Update so that the concealment has a signal to extend.
+		public ref class LossConcealer
+		{
+		private:
+			PitchConcealer *m_concealer;
+
+		public:
+			LossConcealer(int sampleRate);
+			void Update(IntPtr buffer, int count);
+			int Conceal(IntPtr buffer, int count);
+			void Reset();
+
+			// Sets the RMS level (relative to full scale) of the background noise that fills gaps, or zero for silence.
+			void SetComfortNoise(float rms);
+
+			property int ConcealedFrames
+			{
+				int get()
+				{
+					return m_concealer->ConcealedFrames();
+				}
+			}
+
+		private:
+			~LossConcealer();
+			!LossConcealer();
+		};
+	}
+}
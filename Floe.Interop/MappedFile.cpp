@@ -0,0 +1,83 @@
+#include <Windows.h>
+#include "MappedFile.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		MappedFile::MappedFile()
+		{
+			m_file = INVALID_HANDLE_VALUE;
+			m_mapping = 0;
+			m_data = 0;
+			m_size = 0;
+		}
+
+		MappedFile::~MappedFile()
+		{
+			this->Close();
+		}
+
+		DWORD MappedFile::Open(const wchar_t *fileName)
+		{
+			this->Close();
+			m_file = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+			if(m_file == INVALID_HANDLE_VALUE)
+			{
+				return GetLastError();
+			}
+
+			LARGE_INTEGER size;
+			if(!GetFileSizeEx(m_file, &size))
+			{
+				DWORD error = GetLastError();
+				this->Close();
+				return error;
+			}
+			if(size.QuadPart == 0)
+			{
+				// A mapping cannot be made of an empty file.
+				return 0;
+			}
+			if((unsigned long long)size.QuadPart > (SIZE_T)-1)
+			{
+				this->Close();
+				return ERROR_FILE_TOO_LARGE;
+			}
+
+			m_mapping = CreateFileMappingW(m_file, 0, PAGE_READONLY, 0, 0, 0);
+			if(m_mapping != 0)
+			{
+				m_data = (const unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+			}
+			if(m_data == 0)
+			{
+				DWORD error = GetLastError();
+				this->Close();
+				return error;
+			}
+			m_size = size.QuadPart;
+			return 0;
+		}
+
+		void MappedFile::Close()
+		{
+			if(m_data != 0)
+			{
+				UnmapViewOfFile(m_data);
+				m_data = 0;
+			}
+			if(m_mapping != 0)
+			{
+				CloseHandle(m_mapping);
+				m_mapping = 0;
+			}
+			if(m_file != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(m_file);
+				m_file = INVALID_HANDLE_VALUE;
+			}
+			m_size = 0;
+		}
+	}
+}
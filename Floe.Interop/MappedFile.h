@@ -0,0 +1,41 @@
+#pragma once
+
+// A read-only view of a whole file, mapped into memory. Parsers can then work on the file as one buffer, and the
+// operating system pages it in as it is touched, in large reads, instead of the caller copying it out a block at a time.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class MappedFile
+		{
+		private:
+			HANDLE m_file;
+			HANDLE m_mapping;
+			const unsigned char *m_data;
+			long long m_size;
+
+		public:
+			MappedFile();
+			~MappedFile();
+
+			// Maps the file. Returns zero on success, or else the Win32 error code. An empty file maps to no data.
+			DWORD Open(const wchar_t *fileName);
+			void Close();
+
+			const unsigned char *Data() const
+			{
+				return m_data;
+			}
+
+			long long Size() const
+			{
+				return m_size;
+			}
+
+		private:
+			MappedFile(const MappedFile&);
+			MappedFile &operator=(const MappedFile&);
+		};
+	}
+}
@@ -0,0 +1,155 @@
+#include <string.h>
+#include "DspKernels.h"
+#include "MixMinus.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		// Levels are RMS values relative to full scale. A stream must be above the floor (about -50 dBFS) to be selected,
+		// and a current speaker only loses its place to a stream that is more than 6 dB louder.
+		static const float MinLevel = 0.003f;
+		static const float Release = 0.85f;
+		static const float Hysteresis = 2.0f;
+
+		MixMinus::MixMinus(int samples, int maxInputs, int maxSpeakers)
+		{
+			m_samples = samples;
+			m_maxInputs = maxInputs;
+			m_maxSpeakers = maxSpeakers < 1 ? 1 : maxSpeakers > MaxSpeakers ? MaxSpeakers : maxSpeakers;
+			m_inputs = new short[samples * maxInputs];
+			m_levels = new float[maxInputs];
+			m_slots = new int[maxInputs];
+			m_accumulator = new int[samples];
+			m_common = new short[samples];
+			m_minus = new short[samples * m_maxSpeakers];
+			m_speakerCount = 0;
+
+			memset(m_inputs, 0, samples * maxInputs * sizeof(short));
+			memset(m_common, 0, samples * sizeof(short));
+			for(int i = 0; i < maxInputs; i++)
+			{
+				m_levels[i] = 0.0f;
+				m_slots[i] = -1;
+			}
+		}
+
+		MixMinus::~MixMinus()
+		{
+			delete[] m_inputs;
+			delete[] m_levels;
+			delete[] m_slots;
+			delete[] m_accumulator;
+			delete[] m_common;
+			delete[] m_minus;
+		}
+
+		void MixMinus::SetLength(int index, int samples)
+		{
+			samples = samples < 0 ? 0 : samples > m_samples ? m_samples : samples;
+			if(samples < m_samples)
+			{
+				memset(this->Input(index) + samples, 0, (m_samples - samples) * sizeof(short));
+			}
+		}
+
+		void MixMinus::ResetInput(int index)
+		{
+			m_levels[index] = 0.0f;
+			memset(this->Input(index), 0, m_samples * sizeof(short));
+
+			// Otherwise the input would keep its place, with the benefit of the hysteresis, until its level decayed.
+			int slot = m_slots[index];
+			if(slot >= 0)
+			{
+				for(int s = slot; s < m_speakerCount - 1; s++)
+				{
+					m_speakers[s] = m_speakers[s + 1];
+					m_slots[m_speakers[s]] = s;
+				}
+				m_speakerCount--;
+				m_slots[index] = -1;
+			}
+		}
+
+		void MixMinus::Mix(int count)
+		{
+			count = count > m_maxInputs ? m_maxInputs : count;
+			for(int i = 0; i < count; i++)
+			{
+				// Fast attack and slow release, so that a speaker is not dropped in the gaps between words.
+				PcmLevel level;
+				ApplyGainPcm16(this->Input(i), m_samples, 1.0f, &level);
+				m_levels[i] = level.rms > m_levels[i] ? level.rms : m_levels[i] * Release;
+			}
+			this->Select(count);
+
+			memset(m_accumulator, 0, m_samples * sizeof(int));
+			for(int s = 0; s < m_speakerCount; s++)
+			{
+				MixPcm16(m_accumulator, this->Input(m_speakers[s]), m_samples, 1.0f);
+			}
+			SaturatePcm16(m_accumulator, m_common, m_samples);
+
+			for(int s = 0; s < m_speakerCount; s++)
+			{
+				memset(m_accumulator, 0, m_samples * sizeof(int));
+				for(int t = 0; t < m_speakerCount; t++)
+				{
+					if(t != s)
+					{
+						MixPcm16(m_accumulator, this->Input(m_speakers[t]), m_samples, 1.0f);
+					}
+				}
+				SaturatePcm16(m_accumulator, m_minus + s * m_samples, m_samples);
+			}
+		}
+
+		void MixMinus::Select(int count)
+		{
+			int previous[MaxSpeakers];
+			int previousCount = m_speakerCount;
+			for(int s = 0; s < previousCount; s++)
+			{
+				previous[s] = m_speakers[s];
+				m_slots[previous[s]] = -2; // was speaking
+			}
+
+			// A partial selection sort: the number of speakers is small, so each place is filled by a scan of the inputs.
+			int selected = 0;
+			while(selected < m_maxSpeakers)
+			{
+				int best = -1;
+				float bestLevel = 0.0f;
+				for(int i = 0; i < count; i++)
+				{
+					if(m_slots[i] >= 0 || m_levels[i] <= MinLevel)
+					{
+						continue;
+					}
+					float level = m_slots[i] == -2 ? m_levels[i] * Hysteresis : m_levels[i];
+					if(level > bestLevel)
+					{
+						best = i;
+						bestLevel = level;
+					}
+				}
+				if(best < 0)
+				{
+					break;
+				}
+				m_slots[best] = selected;
+				m_speakers[selected++] = best;
+			}
+			m_speakerCount = selected;
+
+			for(int s = 0; s < previousCount; s++)
+			{
+				if(m_slots[previous[s]] == -2)
+				{
+					m_slots[previous[s]] = -1;
+				}
+			}
+		}
+	}
+}
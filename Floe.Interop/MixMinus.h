@@ -0,0 +1,79 @@
+#pragma once
+
+// Mixes the loudest few of many decoded voice streams for a conference. Each listener hears the mix of the current
+// speakers minus its own voice: listeners who are not speaking all share one mix, and each speaker gets the mix of the
+// others. The cost of a round depends on the number of speakers rather than the number of listeners. A speaker keeps
+// its place until another stream is clearly louder, so that the selection does not flap between similar voices.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class MixMinus
+		{
+		private:
+			static const int MaxSpeakers = 8;
+
+			int m_samples;
+			int m_maxInputs;
+			int m_maxSpeakers;
+			short *m_inputs;
+			float *m_levels;
+			int *m_slots;
+			int *m_accumulator;
+			short *m_common;
+			short *m_minus;
+			int m_speakers[MaxSpeakers];
+			int m_speakerCount;
+
+		public:
+			// Each input and output holds one packet of the given number of 16-bit mono samples.
+			MixMinus(int samples, int maxInputs, int maxSpeakers);
+			~MixMinus();
+
+			// The buffer that the next frame of an input is decoded into.
+			short *Input(int index)
+			{
+				return m_inputs + index * m_samples;
+			}
+
+			// Marks how many samples of an input's buffer hold audio this round. The rest is treated as silence.
+			void SetLength(int index, int samples);
+
+			// Forgets the level history of an input and gives up its place as a speaker, when its stream is removed or
+			// the input is given to another stream.
+			void ResetInput(int index);
+
+			// Selects the speakers among inputs 0..count-1 and builds the mixes.
+			void Mix(int count);
+
+			// The mix that the listener at an input should hear.
+			const short *Output(int index) const
+			{
+				int slot = m_slots[index];
+				return slot >= 0 ? m_minus + slot * m_samples : m_common;
+			}
+
+			// The speaker slot of an input, or -1 if it was not selected in the last round.
+			int SpeakerSlot(int index) const
+			{
+				return m_slots[index];
+			}
+
+			int SpeakerCount() const
+			{
+				return m_speakerCount;
+			}
+
+			int MaxSpeakerCount() const
+			{
+				return m_maxSpeakers;
+			}
+
+		private:
+			void Select(int count);
+			MixMinus(const MixMinus&);
+			MixMinus &operator=(const MixMinus&);
+		};
+	}
+}
@@ -0,0 +1,300 @@
+#include <string.h>
+#include "Mp3Parser.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		const short Mp3Parser::BitRates[2][3][16] =
+		{
+			{
+				{ 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },
+				{ 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },
+				{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 }
+			},
+			{
+				{ 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
+				{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+				{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 }
+			}
+		};
+
+		const int Mp3Parser::SampleRates[3][4] =
+		{
+			{ 44100, 48000, 32000, 0 },
+			{ 22050, 24000, 16000, 0 },
+			{ 11025, 12000, 8000, 0 }
+		};
+
+		Mp3Parser::Mp3Parser()
+		{
+			m_data = 0;
+			m_size = 0;
+			m_frames = 0;
+			m_count = m_capacity = 0;
+			memset(&m_first, 0, sizeof(m_first));
+			m_maxFrameSize = 0;
+			m_audioBytes = 0;
+			m_variable = false;
+		}
+
+		Mp3Parser::~Mp3Parser()
+		{
+			delete[] m_frames;
+		}
+
+		bool Mp3Parser::Parse(const unsigned char *data, long long size)
+		{
+			m_count = 0;
+			m_maxFrameSize = 0;
+			m_audioBytes = 0;
+			m_variable = false;
+			memset(&m_first, 0, sizeof(m_first));
+			if(data == 0 || size < HeaderSize || size > 0xffffffffLL)
+			{
+				return false;
+			}
+			m_data = data;
+			m_size = (unsigned int)size;
+
+			FrameHeader header;
+			unsigned int pos = this->Sync(this->SkipTags(0), &header);
+			if(pos >= m_size)
+			{
+				return false;
+			}
+			m_first = header;
+
+			// The index is sized from the frame count in the VBR header if there is one, or else from the size of the
+			// first frame, so that it rarely has to grow.
+			int expected = this->ReadVbrHeader(pos, header, &m_variable);
+			if(expected >= 0)
+			{
+				pos += header.size;
+			}
+			if(expected <= 0 || expected > (int)((m_size - pos) / HeaderSize))
+			{
+				expected = (int)((m_size - pos) / header.size);
+			}
+			if(expected + 1 > m_capacity)
+			{
+				delete[] m_frames;
+				m_capacity = expected + 1;
+				m_frames = new Frame[m_capacity];
+			}
+
+			while(pos + HeaderSize <= m_size)
+			{
+				if(ReadHeader(m_data + pos, &header) && Matches(header, m_first) && (unsigned int)header.size <= m_size - pos)
+				{
+					if(header.bitRate != m_first.bitRate)
+					{
+						m_variable = true;
+					}
+					this->Add(pos, header.size);
+					pos += header.size;
+				}
+				else
+				{
+					pos = this->Sync(pos + 1, &header);
+				}
+			}
+			return m_count > 0;
+		}
+
+		int Mp3Parser::Pack(int frame, unsigned char *buffer, int size, int *frames) const
+		{
+			// Frames that are next to each other in the file are copied together.
+			int count = 0, written = 0;
+			unsigned int runStart = 0, runLength = 0;
+			for(int i = frame; i < m_count && i >= 0; i++)
+			{
+				int frameSize = m_frames[i].size;
+				if(written + frameSize > size)
+				{
+					break;
+				}
+				if(m_frames[i].offset != runStart + runLength)
+				{
+					memcpy(buffer + written - runLength, m_data + runStart, runLength);
+					runStart = m_frames[i].offset;
+					runLength = 0;
+				}
+				runLength += frameSize;
+				written += frameSize;
+				count++;
+			}
+			memcpy(buffer + written - runLength, m_data + runStart, runLength);
+			*frames = count;
+			return written;
+		}
+
+		int Mp3Parser::BitRate() const
+		{
+			if(m_count == 0)
+			{
+				return 0;
+			}
+			return (int)(m_audioBytes * 8 * m_first.sampleRate / ((long long)m_count * m_first.samples));
+		}
+
+		bool Mp3Parser::ReadHeader(const unsigned char *p, FrameHeader *header)
+		{
+			if(p[0] != 0xff || (p[1] & 0xe0) != 0xe0)
+			{
+				return false;
+			}
+
+			int version = (p[1] >> 3) & 3;
+			int layer = (p[1] >> 1) & 3;
+			int bitRateIndex = p[2] >> 4;
+			int sampleRateIndex = (p[2] >> 2) & 3;
+			int padding = (p[2] >> 1) & 1;
+			if(version == 1 || layer == 0 || bitRateIndex == 0 || bitRateIndex == 15 || sampleRateIndex == 3 ||
+				(p[3] & 3) == 2)
+			{
+				// Reserved values, which a real header never has, and free-format streams, whose frames cannot be
+				// sized from the header.
+				return false;
+			}
+
+			header->version = version == 3 ? 0 : version == 2 ? 1 : 2;
+			header->layer = 4 - layer;
+			header->bitRate = BitRates[header->version > 0 ? 1 : 0][header->layer - 1][bitRateIndex];
+			header->sampleRate = SampleRates[header->version][sampleRateIndex];
+			header->channels = (p[3] >> 6) == 3 ? 1 : 2;
+			if(header->layer == 1)
+			{
+				header->samples = 384;
+				header->size = (12 * header->bitRate * 1000 / header->sampleRate + padding) * 4;
+			}
+			else if(header->layer == 2 || header->version == 0)
+			{
+				header->samples = 1152;
+				header->size = 144 * header->bitRate * 1000 / header->sampleRate + padding;
+			}
+			else
+			{
+				header->samples = 576;
+				header->size = 72 * header->bitRate * 1000 / header->sampleRate + padding;
+			}
+			return true;
+		}
+
+		bool Mp3Parser::Matches(const FrameHeader &a, const FrameHeader &b)
+		{
+			return a.version == b.version && a.layer == b.layer && a.sampleRate == b.sampleRate;
+		}
+
+		unsigned int Mp3Parser::SkipTags(unsigned int pos) const
+		{
+			// Some files carry more than one tag, one after another.
+			while(m_size - pos >= Id3HeaderSize && m_data[pos] == 'I' && m_data[pos + 1] == 'D' && m_data[pos + 2] == '3')
+			{
+				const unsigned char *p = m_data + pos;
+				if(p[3] < 2 || p[3] > 4 || ((p[6] | p[7] | p[8] | p[9]) & 0x80) != 0)
+				{
+					break;
+				}
+
+				// The size is stored seven bits to a byte, and does not include the header, or the footer of a 2.4 tag.
+				unsigned int size = (p[6] << 21) | (p[7] << 14) | (p[8] << 7) | p[9];
+				size += Id3HeaderSize;
+				if(p[3] == 4 && (p[5] & 0x10) != 0)
+				{
+					size += Id3HeaderSize;
+				}
+				if(size > m_size - pos)
+				{
+					break;
+				}
+				pos += size;
+			}
+			return pos;
+		}
+
+		unsigned int Mp3Parser::Sync(unsigned int pos, FrameHeader *header) const
+		{
+			while(pos + HeaderSize <= m_size)
+			{
+				const unsigned char *p = (const unsigned char*)memchr(m_data + pos, 0xff, m_size - pos - HeaderSize + 1);
+				if(p == 0)
+				{
+					break;
+				}
+				pos = (unsigned int)(p - m_data);
+
+				FrameHeader next;
+				if(ReadHeader(p, header) && (m_first.samples == 0 || Matches(*header, m_first)) &&
+					(unsigned int)header->size <= m_size - pos)
+				{
+					// The last frame in the buffer has nothing after it to check against.
+					unsigned int end = pos + header->size;
+					if(end + HeaderSize > m_size || (ReadHeader(m_data + end, &next) && Matches(next, *header)))
+					{
+						return pos;
+					}
+				}
+				pos++;
+			}
+			return m_size;
+		}
+
+		int Mp3Parser::ReadVbrHeader(unsigned int pos, const FrameHeader &header, bool *variable) const
+		{
+			// Returns the number of frames that a Xing, Info or VBRI header gives, zero if it does not say, or -1 if
+			// there is no such header.
+			const unsigned char *p = m_data + pos;
+			if(header.layer != 3)
+			{
+				return -1;
+			}
+
+			// The Xing header follows the side information, whose size depends on the version and the channels.
+			int sideInfo = header.version == 0 ? (header.channels == 1 ? 17 : 32) : (header.channels == 1 ? 9 : 17);
+			int offset = HeaderSize + sideInfo;
+			if(offset + 12 <= header.size && (memcmp(p + offset, "Xing", 4) == 0 || memcmp(p + offset, "Info", 4) == 0))
+			{
+				*variable = p[offset] == 'X';
+				const unsigned char *q = p + offset + 4;
+				if((q[3] & 1) != 0)
+				{
+					int frames = (q[4] << 24) | (q[5] << 16) | (q[6] << 8) | q[7];
+					return frames > 0 ? frames : 0;
+				}
+				return 0;
+			}
+
+			offset = HeaderSize + 32;
+			if(offset + 18 <= header.size && memcmp(p + offset, "VBRI", 4) == 0)
+			{
+				*variable = true;
+				const unsigned char *q = p + offset;
+				int frames = (q[14] << 24) | (q[15] << 16) | (q[16] << 8) | q[17];
+				return frames > 0 ? frames : 0;
+			}
+			return -1;
+		}
+
+		void Mp3Parser::Add(unsigned int pos, int size)
+		{
+			if(m_count == m_capacity)
+			{
+				int capacity = m_capacity * 2 + 16;
+				Frame *frames = new Frame[capacity];
+				memcpy(frames, m_frames, m_count * sizeof(Frame));
+				delete[] m_frames;
+				m_frames = frames;
+				m_capacity = capacity;
+			}
+			m_frames[m_count].offset = pos;
+			m_frames[m_count].size = (unsigned short)size;
+			m_count++;
+			m_audioBytes += size;
+			if(size > m_maxFrameSize)
+			{
+				m_maxFrameSize = size;
+			}
+		}
+	}
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+// Finds the frames of an MPEG audio stream (layer I, II or III) in a buffer, such as a mapped file, and indexes them,
+// so that playback can start at any frame without scanning and whole frames can be handed out many at a time.
+//
+// ID3v2 tags (versions 2.2 to 2.4) at the start are skipped by their stated size. A Xing, Info or VBRI header in the
+// first frame is noted and left out of the index, since it holds no audio. While looking for sync, a candidate is only
+// taken for a frame if the header of another frame with the same version, layer and sample rate follows it, so that a
+// stray sync word in a tag or in junk between frames is not mistaken for audio. Once in sync, frames are followed by
+// their sizes, which costs one header check per frame.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class Mp3Parser
+		{
+		private:
+			struct FrameHeader
+			{
+				int version; // 0 for MPEG-1, 1 for MPEG-2, 2 for MPEG-2.5
+				int layer;
+				int bitRate; // kbit/s
+				int sampleRate;
+				int channels;
+				int samples;
+				int size;
+			};
+
+			struct Frame
+			{
+				unsigned int offset;
+				unsigned short size;
+			};
+
+			static const int HeaderSize = 4;
+			static const int Id3HeaderSize = 10;
+			static const short BitRates[2][3][16];
+			static const int SampleRates[3][4];
+
+			const unsigned char *m_data;
+			unsigned int m_size;
+			Frame *m_frames;
+			int m_count;
+			int m_capacity;
+			FrameHeader m_first;
+			int m_maxFrameSize;
+			long long m_audioBytes;
+			bool m_variable;
+
+		public:
+			Mp3Parser();
+			~Mp3Parser();
+
+			// Indexes the frames in the buffer, which must stay valid while the parser is used. Buffers of 4 GB or more
+			// are not supported. Returns false if no frames were found.
+			bool Parse(const unsigned char *data, long long size);
+
+			// Copies as many whole frames as fit in the buffer, starting at the given frame, and returns the number of
+			// bytes copied. The number of frames copied is returned through frames; it is zero if the buffer is
+			// smaller than the first frame.
+			int Pack(int frame, unsigned char *buffer, int size, int *frames) const;
+
+			// The frame that holds the given sample.
+			int FrameAt(long long sample) const
+			{
+				long long frame = sample / m_first.samples;
+				return frame < 0 ? 0 : frame > m_count ? m_count : (int)frame;
+			}
+
+			int Frames() const
+			{
+				return m_count;
+			}
+
+			int SamplesPerFrame() const
+			{
+				return m_first.samples;
+			}
+
+			int SampleRate() const
+			{
+				return m_first.sampleRate;
+			}
+
+			int Channels() const
+			{
+				return m_first.channels;
+			}
+
+			int Layer() const
+			{
+				return m_first.layer;
+			}
+
+			int MaxFrameSize() const
+			{
+				return m_maxFrameSize;
+			}
+
+			// The average bit rate over all frames, in bit/s.
+			int BitRate() const;
+
+			// Whether the frames differ in bit rate, or the stream says that they may.
+			bool IsVariableBitRate() const
+			{
+				return m_variable;
+			}
+
+		private:
+			static bool ReadHeader(const unsigned char *p, FrameHeader *header);
+			static bool Matches(const FrameHeader &a, const FrameHeader &b);
+			unsigned int SkipTags(unsigned int pos) const;
+			unsigned int Sync(unsigned int pos, FrameHeader *header) const;
+			int ReadVbrHeader(unsigned int pos, const FrameHeader &header, bool *variable) const;
+			void Add(unsigned int pos, int size);
+			Mp3Parser(const Mp3Parser&);
+			Mp3Parser &operator=(const Mp3Parser&);
+		};
+	}
+}
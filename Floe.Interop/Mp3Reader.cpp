@@ -0,0 +1,134 @@
+#include "Stdafx.h"
+#include <string.h>
+#include <vcclr.h>
+#include "Mp3Reader.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using namespace System::Runtime::InteropServices;
+		using System::Byte;
+
+		Mp3Reader::Mp3Reader(String ^fileName)
+		{
+			if(fileName == nullptr)
+			{
+				throw gcnew System::ArgumentNullException("fileName");
+			}
+			m_file = new MappedFile();
+			pin_ptr<const wchar_t> name = PtrToStringChars(fileName);
+			DWORD error = m_file->Open(name);
+			if(error != 0)
+			{
+				delete m_file;
+				m_file = 0;
+				Marshal::ThrowExceptionForHR(HRESULT_FROM_WIN32(error));
+			}
+			this->Init(m_file->Data(), m_file->Size());
+		}
+
+		Mp3Reader::Mp3Reader(Stream ^stream)
+		{
+			if(stream == nullptr)
+			{
+				throw gcnew System::ArgumentNullException("stream");
+			}
+
+			long long capacity = stream->CanSeek ? stream->Length - stream->Position : BlockSize;
+			if(capacity > System::Int32::MaxValue)
+			{
+				throw gcnew InteropException("The stream is too large.");
+			}
+			m_data = new unsigned char[capacity > 0 ? (int)capacity : 1];
+			long long size = 0;
+			array<Byte> ^block = gcnew array<Byte>(BlockSize);
+			int count;
+			while((count = stream->Read(block, 0, BlockSize)) > 0)
+			{
+				if(size + count > capacity)
+				{
+					long long newCapacity = capacity * 2 > size + count ? capacity * 2 : size + count;
+					if(newCapacity > System::Int32::MaxValue)
+					{
+						throw gcnew InteropException("The stream is too large.");
+					}
+					unsigned char *data = new unsigned char[(int)newCapacity];
+					memcpy(data, m_data, (size_t)size);
+					delete[] m_data;
+					m_data = data;
+					capacity = newCapacity;
+				}
+				Marshal::Copy(block, 0, IntPtr(m_data + size), count);
+				size += count;
+			}
+
+			this->Init(m_data, size);
+		}
+
+		void Mp3Reader::Init(const unsigned char *data, long long size)
+		{
+			m_parser = new Mp3Parser();
+			if(!m_parser->Parse(data, size))
+			{
+				throw gcnew InteropException("No MPEG audio frames were found.");
+			}
+			m_format = gcnew WaveFormatMp3((short)m_parser->Channels(), m_parser->SampleRate(), m_parser->BitRate());
+			m_frame = 0;
+		}
+
+		int Mp3Reader::Read(IntPtr buffer, int count)
+		{
+			int frame = m_frame;
+			if(frame >= m_parser->Frames())
+			{
+				return 0;
+			}
+			if(count < m_parser->MaxFrameSize())
+			{
+				throw gcnew System::ArgumentOutOfRangeException("count");
+			}
+			int frames;
+			int size = m_parser->Pack(frame, (unsigned char*)(void*)buffer, count, &frames);
+			m_frame = frame + frames;
+			return size;
+		}
+
+		int Mp3Reader::GetBufferSize(int milliseconds)
+		{
+			long long samples = (long long)milliseconds * m_parser->SampleRate() / 1000;
+			long long frames = (samples + m_parser->SamplesPerFrame() - 1) / m_parser->SamplesPerFrame();
+			return (int)((frames > 1 ? frames : 1) * m_parser->MaxFrameSize());
+		}
+
+		TimeSpan Mp3Reader::ToTime(int frame)
+		{
+			long long samples = (long long)frame * m_parser->SamplesPerFrame();
+			return TimeSpan::FromTicks(samples * TimeSpan::TicksPerSecond / m_parser->SampleRate());
+		}
+
+		Mp3Reader::~Mp3Reader()
+		{
+			if(m_parser != 0)
+			{
+				delete m_parser;
+				m_parser = 0;
+			}
+			if(m_file != 0)
+			{
+				delete m_file;
+				m_file = 0;
+			}
+			if(m_data != 0)
+			{
+				delete[] m_data;
+				m_data = 0;
+			}
+		}
+
+		Mp3Reader::!Mp3Reader()
+		{
+			this->~Mp3Reader();
+		}
+	}
+}
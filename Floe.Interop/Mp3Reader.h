@@ -0,0 +1,148 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "MappedFile.h"
+#include "Mp3Parser.h"
+#include "WaveSource.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using namespace System::IO;
+		using System::IntPtr;
+		using System::String;
+		using System::TimeSpan;
+
+		// Reads the frames of an MPEG audio file for playback through the wave mapper, which decodes them. The file is
+		// mapped into memory and indexed once when it is opened, so that seeking to any frame is immediate, and each
+		// read packs as many whole frames as fit into the device's buffer.
+		public ref class Mp3Reader : IWaveSource
+		{
+		private:
+			static const int BlockSize = 1 << 20;
+
+			MappedFile *m_file;
+			unsigned char *m_data;
+			Mp3Parser *m_parser;
+			WaveFormatMp3 ^m_format;
+			int m_frame;
+
+		public:
+			// Maps the file.
+			Mp3Reader(String ^fileName);
+
+			// Reads the rest of the stream into memory, a large block at a time, for streams that are not files.
+			Mp3Reader(Stream ^stream);
+
+			// Copies as many whole frames as fit, and returns the number of bytes copied, or zero at the end of the
+			// file. The count must be at least MaxFrameSize.
+			virtual int Read(IntPtr buffer, int count);
+
+			// Returns a buffer size that holds at least the given length of audio in whole frames of the largest size.
+			int GetBufferSize(int milliseconds);
+
+			property WaveFormatMp3 ^Format
+			{
+				WaveFormatMp3 ^get()
+				{
+					return m_format;
+				}
+			}
+
+			property int Frames
+			{
+				int get()
+				{
+					return m_parser->Frames();
+				}
+			}
+
+			// The next frame to be read. Setting it seeks, and takes effect at the next read.
+			property int Frame
+			{
+				int get()
+				{
+					return m_frame;
+				}
+				void set(int value)
+				{
+					if(value < 0 || value > m_parser->Frames())
+					{
+						throw gcnew System::ArgumentOutOfRangeException("value");
+					}
+					m_frame = value;
+				}
+			}
+
+			property int SampleRate
+			{
+				int get()
+				{
+					return m_parser->SampleRate();
+				}
+			}
+
+			property int Channels
+			{
+				int get()
+				{
+					return m_parser->Channels();
+				}
+			}
+
+			// The average bit rate, in bit/s.
+			property int BitRate
+			{
+				int get()
+				{
+					return m_parser->BitRate();
+				}
+			}
+
+			property bool IsVariableBitRate
+			{
+				bool get()
+				{
+					return m_parser->IsVariableBitRate();
+				}
+			}
+
+			property int MaxFrameSize
+			{
+				int get()
+				{
+					return m_parser->MaxFrameSize();
+				}
+			}
+
+			property TimeSpan Duration
+			{
+				TimeSpan get()
+				{
+					return this->ToTime(m_parser->Frames());
+				}
+			}
+
+			// The start of the next frame to be read. Setting it seeks to the frame that holds the given time.
+			property TimeSpan Position
+			{
+				TimeSpan get()
+				{
+					return this->ToTime(m_frame);
+				}
+				void set(TimeSpan value)
+				{
+					long long sample = (long long)(value.TotalSeconds * m_parser->SampleRate());
+					m_frame = m_parser->FrameAt(sample);
+				}
+			}
+
+		private:
+			void Init(const unsigned char *data, long long size);
+			TimeSpan ToTime(int frame);
+			~Mp3Reader();
+			!Mp3Reader();
+		};
+	}
+}
@@ -0,0 +1,49 @@
+#include "Stdafx.h"
+#include "NoiseSuppressor.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		NoiseSuppressor::NoiseSuppressor(int sampleRate, int blockSize)
+		{
+			if(sampleRate < 8000)
+			{
+				throw gcnew System::ArgumentException("Invalid sample rate.");
+			}
+			if(blockSize < 32 || blockSize > 1024 || (blockSize & (blockSize - 1)) != 0)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("blockSize");
+			}
+			m_suppressor = new SpectralSuppressor(sampleRate, blockSize);
+		}
+
+		void NoiseSuppressor::Process(IntPtr buffer, int size)
+		{
+			if((size / 2) % m_suppressor->BlockSize() != 0)
+			{
+				throw gcnew System::ArgumentException("The buffer is not a whole number of blocks.");
+			}
+			m_suppressor->Process((short*)(void*)buffer, size / 2);
+		}
+
+		void NoiseSuppressor::Reset()
+		{
+			m_suppressor->Reset();
+		}
+
+		NoiseSuppressor::~NoiseSuppressor()
+		{
+			if(m_suppressor != 0)
+			{
+				delete m_suppressor;
+				m_suppressor = 0;
+			}
+		}
+
+		NoiseSuppressor::!NoiseSuppressor()
+		{
+			this->~NoiseSuppressor();
+		}
+	}
+}
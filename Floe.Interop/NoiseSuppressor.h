@@ -0,0 +1,68 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "SpectralSuppressor.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// Suppresses steady background noise, such as fans and hum, in 16-bit mono PCM. The output is delayed by one
+		// block, and the noise is learnt from the signal itself, so it takes a moment after a reset to take full effect.
+		public ref class NoiseSuppressor
+		{
+		private:
+			SpectralSuppressor *m_suppressor;
+
+		public:
+			// The block size is in samples and must be a power of two between 32 and 1024.
+			NoiseSuppressor(int sampleRate, int blockSize);
+
+			// Suppresses the noise in size bytes in place. The size must be a whole number of blocks.
+			void Process(IntPtr buffer, int size);
+
+			// Forgets the noise, as when the device is restarted.
+			void Reset();
+
+			property int BlockSize
+			{
+				int get()
+				{
+					return m_suppressor->BlockSize();
+				}
+			}
+
+			// The most that the noise is attenuated, in dB, from 0 to 40.
+			property float SuppressionLevel
+			{
+				float get()
+				{
+					return m_suppressor->Suppression();
+				}
+				void set(float value)
+				{
+					if(value < 0.0f || value > 40.0f)
+					{
+						throw gcnew System::ArgumentOutOfRangeException("value");
+					}
+					m_suppressor->SetSuppression(value);
+				}
+			}
+
+			// The level of the estimated noise, in dB relative to full scale.
+			property float NoiseLevel
+			{
+				float get()
+				{
+					return m_suppressor->NoiseLevel();
+				}
+			}
+
+		private:
+			~NoiseSuppressor();
+			!NoiseSuppressor();
+		};
+	}
+}
@@ -0,0 +1,204 @@
+#include "Stdafx.h"
+#include "OpusCodec.h"
+
+#ifdef FLOE_HAVE_OPUS
+#include <opus.h>
+#endif
+
+namespace Floe
+{
+	namespace Interop
+	{
+#ifdef FLOE_HAVE_OPUS
+		static void ThrowOnOpusFailure(int result)
+		{
+			if(result < 0)
+			{
+				throw gcnew InteropException(gcnew String(OpusCoder::ErrorText(result)));
+			}
+		}
+
+		OpusCodec::OpusCodec(int sampleRate, int frameSize)
+		{
+			m_frameSize = frameSize;
+			m_coder = new OpusCoder(frameSize);
+			int result = m_coder->Open(sampleRate);
+			if(result < 0)
+			{
+				delete m_coder;
+				m_coder = 0;
+				ThrowOnOpusFailure(result);
+			}
+		}
+
+		int OpusCodec::Encode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			if(size < m_frameSize * 2)
+			{
+				return 0;
+			}
+
+			int count = m_coder->Encode((const short*)(void*)srcBuffer, (unsigned char*)(void*)dstBuffer, dstSize);
+			ThrowOnOpusFailure(count);
+			return count;
+		}
+
+		int OpusCodec::Decode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			return m_coder->Decode((const unsigned char*)(void*)srcBuffer, size, (short*)(void*)dstBuffer, dstSize / 2) * 2;
+		}
+
+		int OpusCodec::Recover(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			return m_coder->Recover((const unsigned char*)(void*)srcBuffer, size, (short*)(void*)dstBuffer, dstSize / 2) * 2;
+		}
+
+		bool OpusCodec::IsAvailable::get()
+		{
+			return true;
+		}
+
+		int OpusCodec::GetSetting(int request)
+		{
+			int value;
+			ThrowOnOpusFailure(m_coder->GetSetting(request, &value));
+			return value;
+		}
+
+		void OpusCodec::SetSetting(int request, int value)
+		{
+			ThrowOnOpusFailure(m_coder->SetSetting(request, value));
+		}
+
+		int OpusCodec::BitRate::get()
+		{
+			return this->GetSetting(OPUS_GET_BITRATE_REQUEST);
+		}
+
+		void OpusCodec::BitRate::set(int value)
+		{
+			this->SetSetting(OPUS_SET_BITRATE_REQUEST, value);
+		}
+
+		bool OpusCodec::ForwardErrorCorrection::get()
+		{
+			return this->GetSetting(OPUS_GET_INBAND_FEC_REQUEST) != 0;
+		}
+
+		void OpusCodec::ForwardErrorCorrection::set(bool value)
+		{
+			this->SetSetting(OPUS_SET_INBAND_FEC_REQUEST, value ? 1 : 0);
+		}
+
+		int OpusCodec::ExpectedPacketLoss::get()
+		{
+			return this->GetSetting(OPUS_GET_PACKET_LOSS_PERC_REQUEST);
+		}
+
+		void OpusCodec::ExpectedPacketLoss::set(int value)
+		{
+			this->SetSetting(OPUS_SET_PACKET_LOSS_PERC_REQUEST, value);
+		}
+
+		bool OpusCodec::DiscontinuousTransmission::get()
+		{
+			return this->GetSetting(OPUS_GET_DTX_REQUEST) != 0;
+		}
+
+		void OpusCodec::DiscontinuousTransmission::set(bool value)
+		{
+			this->SetSetting(OPUS_SET_DTX_REQUEST, value ? 1 : 0);
+		}
+
+		OpusCodec::~OpusCodec()
+		{
+			if(m_coder != 0)
+			{
+				delete m_coder;
+				m_coder = 0;
+			}
+		}
+#else
+		OpusCodec::OpusCodec(int sampleRate, int frameSize)
+		{
+			m_coder = 0;
+			m_frameSize = frameSize;
+			throw gcnew InteropException("This build does not include Opus support.");
+		}
+
+		int OpusCodec::Encode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			return 0;
+		}
+
+		int OpusCodec::Decode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			return 0;
+		}
+
+		int OpusCodec::Recover(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			return 0;
+		}
+
+		bool OpusCodec::IsAvailable::get()
+		{
+			return false;
+		}
+
+		int OpusCodec::GetSetting(int request)
+		{
+			return 0;
+		}
+
+		void OpusCodec::SetSetting(int request, int value)
+		{
+		}
+
+		int OpusCodec::BitRate::get()
+		{
+			return 0;
+		}
+
+		void OpusCodec::BitRate::set(int value)
+		{
+		}
+
+		bool OpusCodec::ForwardErrorCorrection::get()
+		{
+			return false;
+		}
+
+		void OpusCodec::ForwardErrorCorrection::set(bool value)
+		{
+		}
+
+		int OpusCodec::ExpectedPacketLoss::get()
+		{
+			return 0;
+		}
+
+		void OpusCodec::ExpectedPacketLoss::set(int value)
+		{
+		}
+
+		bool OpusCodec::DiscontinuousTransmission::get()
+		{
+			return false;
+		}
+
+		void OpusCodec::DiscontinuousTransmission::set(bool value)
+		{
+		}
+
+		OpusCodec::~OpusCodec()
+		{
+		}
+#endif
+
+		OpusCodec::!OpusCodec()
+		{
+			this->~OpusCodec();
+		}
+	}
+}
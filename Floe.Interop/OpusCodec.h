@@ -0,0 +1,71 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "AudioCodec.h"
+#include "OpusCoder.h"
+
+// Opus support needs the libopus headers and library, so it is only compiled in when FLOE_HAVE_OPUS is defined, which
+// the project does when OPUS_DIR (or the OpusDir property) points at libopus. Without it the class still exists, but
+// IsAvailable is false and construction fails.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// A mono Opus voice codec. Each packet holds one frame, and its size varies with the content and bit rate, up to
+		// the size of the destination buffer given to Encode.
+		public ref class OpusCodec : IAudioCodec
+		{
+		private:
+			OpusCoder *m_coder;
+			int m_frameSize;
+
+		public:
+			OpusCodec(int sampleRate, int frameSize);
+			virtual int Encode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
+			virtual int Decode(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
+			virtual int Recover(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
+
+			static property bool IsAvailable
+			{
+				bool get();
+			}
+
+			property int BitRate
+			{
+				int get();
+				void set(int value);
+			}
+
+			// Whether each packet carries a low bit rate copy of the previous frame, which Recover uses.
+			property bool ForwardErrorCorrection
+			{
+				bool get();
+				void set(bool value);
+			}
+
+			// The packet loss rate (in percent) that the encoder should expect. This sets how much of the bit rate goes
+			// to forward error correction.
+			property int ExpectedPacketLoss
+			{
+				int get();
+				void set(int value);
+			}
+
+			// Whether silent frames are skipped. Encode returns zero for the frames that need not be sent.
+			property bool DiscontinuousTransmission
+			{
+				bool get();
+				void set(bool value);
+			}
+
+		private:
+			int GetSetting(int request);
+			void SetSetting(int request, int value);
+			~OpusCodec();
+			!OpusCodec();
+		};
+	}
+}
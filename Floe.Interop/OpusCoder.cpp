@@ -0,0 +1,114 @@
+#ifdef FLOE_HAVE_OPUS
+#include <opus.h>
+#include "OpusCoder.h"
+
+#pragma comment(lib, "opus.lib")
+
+namespace Floe
+{
+	namespace Interop
+	{
+		OpusCoder::OpusCoder(int frameSize)
+		{
+			m_encoder = 0;
+			m_decoder = 0;
+			m_frameSize = frameSize;
+		}
+
+		OpusCoder::~OpusCoder()
+		{
+			if(m_encoder != 0)
+			{
+				opus_encoder_destroy(m_encoder);
+				m_encoder = 0;
+			}
+			if(m_decoder != 0)
+			{
+				opus_decoder_destroy(m_decoder);
+				m_decoder = 0;
+			}
+		}
+
+		int OpusCoder::Open(int sampleRate)
+		{
+			int result;
+			m_encoder = opus_encoder_create(sampleRate, 1, OPUS_APPLICATION_VOIP, &result);
+			if(result < 0)
+			{
+				return result;
+			}
+			m_decoder = opus_decoder_create(sampleRate, 1, &result);
+			if(result < 0)
+			{
+				return result;
+			}
+			result = opus_encoder_ctl(m_encoder, OPUS_SET_VBR(1));
+			if(result < 0)
+			{
+				return result;
+			}
+			return opus_encoder_ctl(m_encoder, OPUS_SET_SIGNAL(OPUS_SIGNAL_VOICE));
+		}
+
+		int OpusCoder::Encode(const short *samples, unsigned char *packet, int maxSize)
+		{
+			int count = opus_encode(m_encoder, samples, m_frameSize, packet, maxSize);
+
+			// With DTX on, the encoder produces packets of at most two bytes during silence, which are not worth sending.
+			return count < 0 ? count : count > 2 ? count : 0;
+		}
+
+		int OpusCoder::Decode(const unsigned char *packet, int size, short *samples, int maxSamples)
+		{
+			int count = opus_decode(m_decoder, packet, size, samples, maxSamples, 0);
+			return count > 0 ? count : 0;
+		}
+
+		int OpusCoder::Recover(const unsigned char *packet, int size, short *samples, int maxSamples)
+		{
+			if(!HasRedundancy(packet, size) || maxSamples < m_frameSize)
+			{
+				return 0;
+			}
+
+			// The redundant copy describes exactly one frame before this packet.
+			int count = opus_decode(m_decoder, packet, size, samples, m_frameSize, 1);
+			return count > 0 ? count : 0;
+		}
+
+		int OpusCoder::GetSetting(int request, int *value)
+		{
+			opus_int32 setting = 0;
+			int result = opus_encoder_ctl(m_encoder, request, &setting);
+			*value = setting;
+			return result;
+		}
+
+		int OpusCoder::SetSetting(int request, int value)
+		{
+			return opus_encoder_ctl(m_encoder, request, (opus_int32)value);
+		}
+
+		bool OpusCoder::HasRedundancy(const unsigned char *packet, int size)
+		{
+			// This is what opus_packet_has_lbrr does, but that only exists from libopus 1.5 on. CELT packets (the top
+			// four configurations) carry no redundancy. In SILK and hybrid packets, the first frame starts with a voice
+			// activity bit for each 20 ms SILK frame it holds, and then the bit that says whether redundancy follows.
+			const unsigned char *frames[48];
+			opus_int16 sizes[48];
+			if(size < 1 || (packet[0] >> 3) >= 16 || opus_packet_parse(packet, size, 0, frames, sizes, 0) < 1 || sizes[0] < 1)
+			{
+				return false;
+			}
+			int samples = opus_packet_get_samples_per_frame(packet, 48000);
+			int silkFrames = samples > 960 ? samples / 960 : 1;
+			return ((frames[0][0] >> (7 - silkFrames)) & 1) != 0;
+		}
+
+		const char *OpusCoder::ErrorText(int error)
+		{
+			return opus_strerror(error);
+		}
+	}
+}
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+// The native half of OpusCodec: a mono Opus encoder and decoder, with one frame in each packet. It needs the libopus
+// headers and library, so OpusCoder.cpp is only compiled in when FLOE_HAVE_OPUS is defined. Failures are returned as
+// the negative error codes of libopus.
+
+struct OpusEncoder;
+struct OpusDecoder;
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class OpusCoder
+		{
+		private:
+			OpusEncoder *m_encoder;
+			OpusDecoder *m_decoder;
+			int m_frameSize;
+
+		public:
+			OpusCoder(int frameSize);
+			~OpusCoder();
+
+			// Creates the encoder, set up for voice with a variable bit rate, and the decoder. Returns zero on success,
+			// or else an error code.
+			int Open(int sampleRate);
+
+			// Encodes one frame into at most maxSize bytes. Returns the size of the packet, zero if the frame need not be
+			// sent, or an error code.
+			int Encode(const short *samples, unsigned char *packet, int maxSize);
+
+			// Decodes a packet, and returns the number of samples written, or zero if the packet could not be decoded.
+			int Decode(const unsigned char *packet, int size, short *samples, int maxSamples);
+
+			// Decodes the low bit rate copy of the frame before the given packet, and returns the number of samples
+			// written, or zero if the packet carries no such copy.
+			int Recover(const unsigned char *packet, int size, short *samples, int maxSamples);
+
+			// Reads or changes an encoder setting by its OPUS_GET_ or OPUS_SET_ request number. Returns zero on success,
+			// or else an error code.
+			int GetSetting(int request, int *value);
+			int SetSetting(int request, int value);
+
+			// Whether a packet carries a low bit rate copy of the frame before it.
+			static bool HasRedundancy(const unsigned char *packet, int size);
+
+			static const char *ErrorText(int error);
+
+		private:
+			OpusCoder(const OpusCoder&);
+			OpusCoder &operator=(const OpusCoder&);
+		};
+	}
+}
@@ -0,0 +1,329 @@
+#include <Windows.h>
+#include "PacketRing.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		PacketRing::PacketRing(int span, int clockRate, int maxPacketSize, int capacity, int delay)
+		{
+			m_capacity = 1;
+			while(m_capacity < capacity)
+			{
+				m_capacity <<= 1;
+			}
+			m_span = span;
+			m_clockRate = clockRate;
+			m_maxPacketSize = maxPacketSize;
+			m_delay = delay;
+			m_adaptive = false;
+			m_targetDelay = delay;
+			m_lateCount = m_underrunCount = m_resetCount = 0;
+
+			LARGE_INTEGER freq;
+			QueryPerformanceFrequency(&freq);
+			m_ticksToClock = (double)clockRate / (double)freq.QuadPart;
+			m_simulated = false;
+			m_simulatedTime = 0.0;
+			m_jitter = m_lastArrival = 0.0;
+			m_lastTimeStamp = 0;
+			m_hasTransit = false;
+			m_hasBase = false;
+			m_baseTimeStamp = 0;
+			m_baseKey = 0;
+			m_senderClock = new DriftEstimator(clockRate);
+			m_deviceClock = new DriftEstimator(clockRate);
+			m_senderTime = m_played = 0.0;
+
+			m_slots = new Slot[m_capacity];
+			m_data = new unsigned char[m_capacity * maxPacketSize];
+			for(int i = 0; i < m_capacity; i++)
+			{
+				m_slots[i].state = SlotEmpty;
+				m_slots[i].key = 0;
+				m_slots[i].size = 0;
+				m_slots[i].data = m_data + i * maxPacketSize;
+			}
+
+			m_count = 0;
+			m_acquired = 0;
+			m_borrowed = false;
+			this->Reset();
+		}
+
+		PacketRing::~PacketRing()
+		{
+			delete[] m_slots;
+			delete[] m_data;
+			delete m_senderClock;
+			delete m_deviceClock;
+		}
+
+		bool PacketRing::Insert(int timeStamp, const unsigned char *data, int size)
+		{
+			if(size > m_maxPacketSize || size < 1)
+			{
+				return false;
+			}
+
+			double arrival = this->Now();
+			this->UpdateDrift(timeStamp, arrival);
+			this->UpdateJitter(timeStamp, arrival);
+
+			unsigned int key = this->KeyOf(timeStamp);
+			if(m_playing)
+			{
+				int ahead = (int)(key - (unsigned int)m_playKey);
+				if(ahead < 0)
+				{
+					InterlockedIncrement(&m_lateCount);
+					return false;
+				}
+				if(ahead >= m_capacity)
+				{
+					return false;
+				}
+			}
+
+			Slot *slot = this->SlotOf(key);
+			bool wasEmpty = true;
+			if(InterlockedCompareExchange(&slot->state, SlotWriting, SlotEmpty) != SlotEmpty)
+			{
+				// The slot holds another packet. Replace it only if it is older than this one and the
+				// consumer is not busy with it; duplicates and packets that are already too old are dropped.
+				if((int)(key - slot->key) <= 0 ||
+					InterlockedCompareExchange(&slot->state, SlotWriting, SlotFull) != SlotFull)
+				{
+					return false;
+				}
+				wasEmpty = false;
+			}
+
+			slot->key = key;
+			slot->size = size;
+			memcpy(slot->data, data, size);
+			if(wasEmpty)
+			{
+				InterlockedIncrement(&m_count);
+			}
+			InterlockedExchange(&slot->state, SlotFull);
+			return true;
+		}
+
+		const unsigned char *PacketRing::Acquire(int *size, bool *recovery)
+		{
+			*size = 0;
+			*recovery = false;
+			if(m_acquired != 0)
+			{
+				this->Release();
+			}
+
+			if(m_lostCount > MaxLostCount)
+			{
+				InterlockedIncrement(&m_resetCount);
+				this->Reset();
+			}
+
+			if(m_playing == 0)
+			{
+				unsigned int oldest = 0;
+				if(!this->FindOldest(&oldest))
+				{
+					return 0;
+				}
+				m_key = oldest;
+				m_playKey = (long)m_key;
+				InterlockedExchange(&m_playing, 1);
+			}
+
+			if(m_count > 0 && m_delayLeft > 0)
+			{
+				m_delayLeft--;
+				return 0;
+			}
+
+			Slot *slot = this->SlotOf(m_key);
+			if(InterlockedCompareExchange(&slot->state, SlotReading, SlotFull) == SlotFull)
+			{
+				if(slot->key == m_key)
+				{
+					m_acquired = slot;
+					m_lostCount = 0;
+					this->Advance();
+					*size = slot->size;
+					return slot->data;
+				}
+				if((int)(slot->key - m_key) < 0)
+				{
+					// A leftover from a previous pass around the ring; it can never be played.
+					InterlockedDecrement(&m_count);
+					InterlockedExchange(&slot->state, SlotEmpty);
+				}
+				else
+				{
+					InterlockedExchange(&slot->state, SlotFull);
+				}
+			}
+
+			if(m_lostCount++ == 0)
+			{
+				InterlockedIncrement(&m_underrunCount);
+			}
+			this->Advance();
+
+			// Once the buffer has run dry, nothing is lost by starting over on the next packet with a new delay.
+			if(m_adaptive && m_count == 0 && m_currentDelay != m_targetDelay)
+			{
+				InterlockedExchange(&m_playing, 0);
+				m_delayLeft = m_currentDelay = m_targetDelay;
+				return 0;
+			}
+
+			// The missing packet is gone, but the next one may still describe it.
+			slot = this->SlotOf(m_key);
+			if(InterlockedCompareExchange(&slot->state, SlotReading, SlotFull) == SlotFull)
+			{
+				if(slot->key == m_key)
+				{
+					m_acquired = slot;
+					m_borrowed = true;
+					*size = slot->size;
+					*recovery = true;
+					return slot->data;
+				}
+				InterlockedExchange(&slot->state, SlotFull);
+			}
+			return 0;
+		}
+
+		void PacketRing::Release()
+		{
+			if(m_acquired != 0)
+			{
+				if(m_borrowed)
+				{
+					InterlockedExchange(&m_acquired->state, SlotFull);
+					m_borrowed = false;
+				}
+				else
+				{
+					InterlockedDecrement(&m_count);
+					InterlockedExchange(&m_acquired->state, SlotEmpty);
+				}
+				m_acquired = 0;
+			}
+		}
+
+		void PacketRing::Reset()
+		{
+			this->Release();
+			InterlockedExchange(&m_playing, 0);
+			for(int i = 0; i < m_capacity; i++)
+			{
+				if(InterlockedCompareExchange(&m_slots[i].state, SlotEmpty, SlotFull) == SlotFull)
+				{
+					InterlockedDecrement(&m_count);
+				}
+			}
+			m_lostCount = 0;
+			m_delayLeft = m_currentDelay = m_adaptive ? m_targetDelay : m_delay;
+		}
+
+		unsigned int PacketRing::KeyOf(int timeStamp)
+		{
+			// Keys count spans from the newest packet so far rather than dividing the timestamp itself, so that they
+			// stay consecutive when the timestamp wraps around and the span does not divide 2^32.
+			if(!m_hasBase)
+			{
+				m_baseTimeStamp = timeStamp;
+				m_baseKey = (unsigned int)timeStamp / (unsigned int)m_span;
+				m_hasBase = true;
+			}
+			int offset = (int)(timeStamp - m_baseTimeStamp);
+			int spans = offset >= 0 ? offset / m_span : -((m_span - 1 - offset) / m_span);
+			unsigned int key = m_baseKey + (unsigned int)spans;
+			if(spans > 0)
+			{
+				m_baseTimeStamp += spans * m_span;
+				m_baseKey = key;
+			}
+			return key;
+		}
+
+		bool PacketRing::FindOldest(unsigned int *key)
+		{
+			bool found = false;
+			for(int i = 0; i < m_capacity; i++)
+			{
+				if(m_slots[i].state == SlotFull && (!found || (int)(m_slots[i].key - *key) < 0))
+				{
+					*key = m_slots[i].key;
+					found = true;
+				}
+			}
+			return found;
+		}
+
+		void PacketRing::Advance()
+		{
+			m_key++;
+			m_playKey = (long)m_key;
+		}
+
+		void PacketRing::AdvanceClock(int count)
+		{
+			// The consumer only ever runs late, never early, which is what the estimator expects of the local clock.
+			m_deviceClock->Update(this->Now(), m_played);
+			m_played += count;
+		}
+
+		void PacketRing::SetClock(double seconds)
+		{
+			m_simulated = true;
+			m_simulatedTime = seconds * m_clockRate;
+		}
+
+		double PacketRing::Now() const
+		{
+			if(m_simulated)
+			{
+				return m_simulatedTime;
+			}
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			return (double)now.QuadPart * m_ticksToClock;
+		}
+
+		void PacketRing::UpdateDrift(int timeStamp, double arrival)
+		{
+			// The timestamps are unwrapped by adding up the differences between packets, which also works when they
+			// arrive out of order.
+			if(m_hasTransit)
+			{
+				m_senderTime += (double)(int)(timeStamp - m_lastTimeStamp);
+			}
+			m_senderClock->Update(arrival, m_senderTime);
+		}
+
+		void PacketRing::UpdateJitter(int timeStamp, double arrival)
+		{
+			// RFC 3550, section 6.4.1: J += (|D| - J) / 16, where D is the difference in relative transit time
+			// between two packets. Timestamp jumps (e.g. when the sender restarts) are capped so that a single
+			// outlier cannot dominate the estimate.
+			if(m_hasTransit)
+			{
+				double d = (arrival - m_lastArrival) - (double)(int)(timeStamp - m_lastTimeStamp);
+				double limit = (double)m_span * MaxAdaptiveDelay;
+				d = d < 0.0 ? -d : d;
+				m_jitter += ((d > limit ? limit : d) - m_jitter) / 16.0;
+			}
+			m_lastArrival = arrival;
+			m_lastTimeStamp = timeStamp;
+			m_hasTransit = true;
+
+			int target = (int)(JitterFactor * m_jitter / m_span) + 1;
+			m_targetDelay = target < MinAdaptiveDelay ? MinAdaptiveDelay : target > MaxAdaptiveDelay ? MaxAdaptiveDelay : target;
+		}
+	}
+}
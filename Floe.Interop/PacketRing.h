@@ -0,0 +1,169 @@
+#pragma once
+
+// A fixed-capacity jitter buffer indexed by timestamp. Packets are inserted by a single producer (the
+// network thread) and fetched in timestamp order by a single consumer (the playback thread) without locking.
+// In adaptive mode, the playout delay follows the RFC 3550 interarrival jitter estimate instead of staying
+// fixed; it is only changed while the buffer is empty so that no audible audio is skipped or stretched.
+// When a packet is missing but the one after it has already arrived, the consumer may borrow the later packet
+// to recover the missing audio from redundancy that some codecs carry; it stays queued for its own turn.
+//
+// The ring also estimates the drift between the sender's clock and the playback device's. Both are compared with the
+// performance counter: the sender's through the timestamps of arriving packets, and the device's through the samples
+// it has asked for by the time each playback buffer is read.
+
+#include "DriftEstimator.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class PacketRing
+		{
+		private:
+			enum SlotState
+			{
+				SlotEmpty = 0,
+				SlotWriting = 1,
+				SlotFull = 2,
+				SlotReading = 3
+			};
+
+			struct Slot
+			{
+				volatile long state;
+				unsigned int key;
+				int size;
+				unsigned char *data;
+			};
+
+			static const int MaxLostCount = 20;
+			static const int MinAdaptiveDelay = 1;
+			static const int MaxAdaptiveDelay = 12;
+			static const int JitterFactor = 3;
+
+			Slot *m_slots;
+			unsigned char *m_data;
+			int m_capacity;
+			int m_maxPacketSize;
+			int m_span;
+			int m_clockRate;
+			int m_delay;
+			volatile bool m_adaptive;
+
+			// Shared between the producer and consumer.
+			volatile long m_count;
+			volatile long m_playing;
+			volatile long m_playKey;
+			volatile long m_targetDelay;
+			volatile long m_lateCount;
+			volatile long m_underrunCount;
+			volatile long m_resetCount;
+
+			double m_ticksToClock;
+			bool m_simulated;
+			double m_simulatedTime;
+
+			// Owned by the producer.
+			double m_jitter;
+			double m_lastArrival;
+			int m_lastTimeStamp;
+			bool m_hasTransit;
+			bool m_hasBase;
+			int m_baseTimeStamp;
+			unsigned int m_baseKey;
+			DriftEstimator *m_senderClock;
+			double m_senderTime;
+
+			// Owned by the consumer.
+			Slot *m_acquired;
+			bool m_borrowed;
+			unsigned int m_key;
+			int m_lostCount;
+			int m_delayLeft;
+			volatile long m_currentDelay;
+			DriftEstimator *m_deviceClock;
+			double m_played;
+
+		public:
+			PacketRing(int span, int clockRate, int maxPacketSize, int capacity, int delay);
+			~PacketRing();
+
+			bool Insert(int timeStamp, const unsigned char *data, int size);
+			const unsigned char *Acquire(int *size, bool *recovery);
+			void Release();
+			void Reset();
+
+			// Tells the ring that the playback device is about to play count more samples. Called from the consumer
+			// once for every playback buffer, whether or not there is anything to play.
+			void AdvanceClock(int count);
+
+			// Replaces the performance counter with a simulated clock, in seconds, so that a long session can be
+			// replayed faster than real time. Only for use when the producer and consumer are the same thread.
+			void SetClock(double seconds);
+
+			int Count() const
+			{
+				return m_count > 0 ? m_count : 0;
+			}
+
+			bool IsAdaptive() const
+			{
+				return m_adaptive;
+			}
+
+			void SetAdaptive(bool adaptive)
+			{
+				m_adaptive = adaptive;
+			}
+
+			// The interarrival jitter estimate, in milliseconds.
+			float Jitter() const
+			{
+				return (float)(m_jitter * 1000.0 / m_clockRate);
+			}
+
+			// The playout delay applied to the current talkspurt, in milliseconds.
+			float Delay() const
+			{
+				return (float)m_currentDelay * m_span * 1000.0f / m_clockRate;
+			}
+
+			int LateCount() const
+			{
+				return m_lateCount;
+			}
+
+			int UnderrunCount() const
+			{
+				return m_underrunCount;
+			}
+
+			// The number of times the ring has started over by itself because too many packets in a row were missing.
+			int ResetCount() const
+			{
+				return m_resetCount;
+			}
+
+			// How much faster the sender's clock runs than the playback device's, in parts per million.
+			float Drift() const
+			{
+				return m_senderClock->Drift() - m_deviceClock->Drift();
+			}
+
+		private:
+			Slot *SlotOf(unsigned int key) const
+			{
+				return &m_slots[key & (unsigned int)(m_capacity - 1)];
+			}
+
+			unsigned int KeyOf(int timeStamp);
+			bool FindOldest(unsigned int *key);
+			void Advance();
+			double Now() const;
+			void UpdateJitter(int timeStamp, double arrival);
+			void UpdateDrift(int timeStamp, double arrival);
+			PacketRing(const PacketRing&);
+			PacketRing &operator=(const PacketRing&);
+		};
+	}
+}
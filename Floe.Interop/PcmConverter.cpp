@@ -0,0 +1,227 @@
+#include <string.h>
+#include "DspKernels.h"
+#include "PcmConverter.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		static const int SampleSizes[] = { 1, 2, 3, 4, 4, 8 };
+
+		PcmConverter::PcmConverter(WavParser::SampleFormat format, int srcChannels, int srcRate, int dstChannels,
+			int dstRate, PolyphaseResampler::Quality quality)
+		{
+			m_format = format;
+			m_sampleSize = SampleSizes[format];
+			m_srcChannels = srcChannels;
+			m_srcRate = srcRate;
+			m_dstChannels = dstChannels;
+			m_dstRate = dstRate;
+			m_samples = new short[BlockFrames * srcChannels];
+			m_resamplers = 0;
+			m_planar = 0;
+			m_resampled = 0;
+			m_maxOutput = 0;
+			if(srcRate != dstRate)
+			{
+				m_resamplers = new PolyphaseResampler*[dstChannels];
+				for(int c = 0; c < dstChannels; c++)
+				{
+					m_resamplers[c] = new PolyphaseResampler(srcRate, dstRate, quality, BlockFrames);
+				}
+				m_maxOutput = (int)((long long)(BlockFrames + m_resamplers[0]->Taps()) * dstRate / srcRate) + 1;
+				m_planar = new short[BlockFrames * dstChannels];
+				m_resampled = new short[m_maxOutput * dstChannels];
+			}
+			this->Reset();
+		}
+
+		PcmConverter::~PcmConverter()
+		{
+			if(m_resamplers != 0)
+			{
+				for(int c = 0; c < m_dstChannels; c++)
+				{
+					delete m_resamplers[c];
+				}
+				delete[] m_resamplers;
+			}
+			delete[] m_samples;
+			delete[] m_planar;
+			delete[] m_resampled;
+		}
+
+		void PcmConverter::Reset()
+		{
+			m_input = 0;
+			m_output = 0;
+			m_flush = 0;
+			if(m_resamplers != 0)
+			{
+				for(int c = 0; c < m_dstChannels; c++)
+				{
+					m_resamplers[c]->Reset();
+				}
+				m_flush = m_resamplers[0]->Taps();
+			}
+		}
+
+		int PcmConverter::Convert(const unsigned char *src, int count, int *used, short *dst, int dstFrames)
+		{
+			*used = 0;
+			int srcFrameSize = m_sampleSize * m_srcChannels;
+			if(m_resamplers == 0)
+			{
+				int frames = count < dstFrames ? count : dstFrames;
+				if(src == 0 || frames <= 0)
+				{
+					return 0;
+				}
+				if(m_srcChannels == m_dstChannels)
+				{
+					this->ToPcm16(src, dst, frames * m_srcChannels);
+				}
+				else
+				{
+					for(int done = 0; done < frames; done += BlockFrames)
+					{
+						int block = frames - done < BlockFrames ? frames - done : BlockFrames;
+						const unsigned char *blockSrc = src + (long long)done * srcFrameSize;
+						const short *samples = (const short*)blockSrc;
+						if(m_format != WavParser::SampleInt16)
+						{
+							this->ToPcm16(blockSrc, m_samples, block * m_srcChannels);
+							samples = m_samples;
+						}
+						this->MapChannels(samples, block, dst + done * m_dstChannels, m_dstChannels, 1);
+					}
+				}
+				*used = frames;
+				return frames;
+			}
+
+			// A block of input is only taken when what the resamplers have kept cannot make another sample, so that
+			// the kept input and the new block always fit.
+			int written = 0;
+			while(written < dstFrames)
+			{
+				int produced = this->Resample(0, 0, dst + written * m_dstChannels, dstFrames - written);
+				if(produced == 0)
+				{
+					int frames;
+					if(src != 0 && *used < count)
+					{
+						frames = count - *used < BlockFrames ? count - *used : BlockFrames;
+						this->ToPcm16(src + (long long)*used * srcFrameSize, m_samples, frames * m_srcChannels);
+						this->MapChannels(m_samples, frames, m_planar, 1, BlockFrames);
+						*used += frames;
+						m_input += frames;
+					}
+					else if(src == 0 && m_flush > 0)
+					{
+						frames = m_flush < BlockFrames ? m_flush : BlockFrames;
+						memset(m_planar, 0, BlockFrames * m_dstChannels * sizeof(short));
+						m_flush -= frames;
+					}
+					else
+					{
+						break;
+					}
+					produced = this->Resample(m_planar, frames, dst + written * m_dstChannels, dstFrames - written);
+				}
+				written += produced;
+			}
+			return written;
+		}
+
+		int PcmConverter::Resample(const short *planar, int count, short *dst, int dstFrames)
+		{
+			// Every channel's resampler has had the same input, so each makes the same number of samples.
+			int max = dstFrames < m_maxOutput ? dstFrames : m_maxOutput;
+			int produced = 0;
+			for(int c = 0; c < m_dstChannels; c++)
+			{
+				produced = m_resamplers[c]->Process(planar != 0 ? planar + c * BlockFrames : 0, count,
+					m_resampled + c * m_maxOutput, max);
+			}
+
+			long long length = (m_input * m_dstRate + m_srcRate - 1) / m_srcRate;
+			if(produced > length - m_output)
+			{
+				produced = (int)(length - m_output);
+			}
+			if(produced <= 0)
+			{
+				return 0;
+			}
+			for(int c = 0; c < m_dstChannels; c++)
+			{
+				const short *channel = m_resampled + c * m_maxOutput;
+				for(int i = 0; i < produced; i++)
+				{
+					dst[i * m_dstChannels + c] = channel[i];
+				}
+			}
+			m_output += produced;
+			return produced;
+		}
+
+		void PcmConverter::ToPcm16(const unsigned char *src, short *dst, int count)
+		{
+			switch(m_format)
+			{
+			case WavParser::SampleUInt8:
+				Pcm8ToPcm16(src, dst, count);
+				break;
+			case WavParser::SampleInt16:
+				memcpy(dst, src, count * sizeof(short));
+				break;
+			case WavParser::SampleInt24:
+				Pcm24ToPcm16(src, dst, count);
+				break;
+			case WavParser::SampleInt32:
+				Pcm32ToPcm16((const int*)src, dst, count);
+				break;
+			case WavParser::SampleFloat32:
+				FloatToPcm16((const float*)src, dst, count);
+				break;
+			case WavParser::SampleFloat64:
+				{
+					// Rare enough that it is not worth a kernel of its own.
+					const double *samples = (const double*)src;
+					for(int i = 0; i < count; i++)
+					{
+						double value = samples[i] * 32768.0;
+						dst[i] = (short)(value != value ? 0 : value >= 32767.0 ? 32767 : value <= -32768.0 ? -32768 :
+							value >= 0.0 ? value + 0.5 : value - 0.5);
+					}
+				}
+				break;
+			}
+		}
+
+		void PcmConverter::MapChannels(const short *src, int frames, short *dst, int frameStride, int channelStride)
+		{
+			for(int c = 0; c < m_dstChannels; c++)
+			{
+				short *out = dst + c * channelStride;
+				if(m_dstChannels == 1 && m_srcChannels >= 2)
+				{
+					for(int i = 0; i < frames; i++)
+					{
+						const short *frame = src + i * m_srcChannels;
+						out[i * frameStride] = (short)((frame[0] + frame[1]) >> 1);
+					}
+				}
+				else
+				{
+					const short *in = src + (c < m_srcChannels ? c : m_srcChannels - 1);
+					for(int i = 0; i < frames; i++)
+					{
+						out[i * frameStride] = in[i * m_srcChannels];
+					}
+				}
+			}
+		}
+	}
+}
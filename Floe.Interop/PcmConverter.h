@@ -0,0 +1,67 @@
+#pragma once
+#include "WavParser.h"
+#include "PolyphaseResampler.h"
+
+// Converts samples in any of the formats that WavParser accepts to 16-bit PCM with a given number of channels and
+// sample rate, as they are read, so that a file plays in the format the device is opened with rather than its own.
+//
+// The sample format is converted by the vectorized kernels in DspKernels. When the channels and the rate already match,
+// the samples go straight from the source to the destination in that one step. Otherwise a block at a time is converted
+// to 16 bits, the channels are mapped (a mono source is played on every channel, a stereo destination takes the first
+// two channels, and a mono destination takes the average of the first two), and each channel is resampled on its own.
+// At the end of the source, silence is fed through the resamplers to flush out the last samples, and the output is cut
+// to the length that the source has at the destination rate.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class PcmConverter
+		{
+		public:
+			static const int BlockFrames = 4096;
+
+		private:
+			WavParser::SampleFormat m_format;
+			int m_sampleSize;
+			int m_srcChannels;
+			int m_srcRate;
+			int m_dstChannels;
+			int m_dstRate;
+			short *m_samples;
+			PolyphaseResampler **m_resamplers;
+			short *m_planar;
+			short *m_resampled;
+			int m_maxOutput;
+			long long m_input;
+			long long m_output;
+			int m_flush;
+
+		public:
+			PcmConverter(WavParser::SampleFormat format, int srcChannels, int srcRate, int dstChannels, int dstRate,
+				PolyphaseResampler::Quality quality);
+			~PcmConverter();
+
+			// Converts up to count frames from src and writes up to dstFrames frames to dst. Returns the number of frames
+			// written, and the number of source frames used through used; when resampling, source frames are taken a
+			// block at a time, and the resamplers keep what they have not used for the next call. At the end of the
+			// source, pass no source until nothing more is written.
+			int Convert(const unsigned char *src, int count, int *used, short *dst, int dstFrames);
+
+			// Forgets the kept input, as at the start of a new stream or after seeking.
+			void Reset();
+
+			bool IsResampling() const
+			{
+				return m_resamplers != 0;
+			}
+
+		private:
+			void ToPcm16(const unsigned char *src, short *dst, int count);
+			void MapChannels(const short *src, int frames, short *dst, int frameStride, int channelStride);
+			int Resample(const short *planar, int count, short *dst, int dstFrames);
+			PcmConverter(const PcmConverter&);
+			PcmConverter &operator=(const PcmConverter&);
+		};
+	}
+}
@@ -0,0 +1,183 @@
+#include <string.h>
+#include <math.h>
+#include "PitchConcealer.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		PitchConcealer::PitchConcealer(int sampleRate)
+		{
+			m_sampleRate = sampleRate;
+			m_minPitch = sampleRate * MinPitchMs / 1000;
+			m_maxPitch = sampleRate * MaxPitchMs / 1000;
+			m_window = sampleRate * CorrelationMs / 1000;
+			m_historyLength = m_maxPitch * MaxPeriods + m_window;
+			m_history = new short[m_historyLength];
+			m_concealedFrames = 0;
+			m_noiseAmplitude = 0.0f;
+			m_noiseSeed = 1;
+			this->Reset();
+		}
+
+		PitchConcealer::~PitchConcealer()
+		{
+			delete[] m_history;
+		}
+
+		void PitchConcealer::Reset()
+		{
+			memset(m_history, 0, m_historyLength * sizeof(short));
+			m_hasHistory = false;
+			m_lostSamples = 0;
+			m_pitch = m_maxPitch;
+			m_periods = 1;
+			m_offset = 0;
+			m_startStep = 0.0f;
+			m_startLength = 0;
+		}
+
+		void PitchConcealer::SetComfortNoise(float rms)
+		{
+			// Uniform noise has an RMS of 1/sqrt(3) of its amplitude.
+			m_noiseAmplitude = rms > 0.0f ? rms * 32768.0f * 1.7320508f : 0.0f;
+		}
+
+		void PitchConcealer::Update(short *samples, int count)
+		{
+			if(m_lostSamples > 0)
+			{
+				// The overlap grows with the length of the loss, as the synthetic signal drifts further from the real one.
+				int overlap = m_pitch / 4;
+				int expanded = m_lostSamples - m_sampleRate * ExpandMs / 1000;
+				if(expanded > 0)
+				{
+					overlap += (expanded / (m_sampleRate * ExpandMs / 1000) + 1) * m_sampleRate * OverlapPerExpandMs / 1000;
+				}
+				int maxOverlap = m_sampleRate * MaxOverlapMs / 1000;
+				overlap = overlap > maxOverlap ? maxOverlap : overlap;
+				overlap = overlap > count ? count : overlap;
+
+				for(int i = 0; i < overlap; i++)
+				{
+					float w = (float)(i + 1) / (float)(overlap + 1);
+					samples[i] = (short)((float)this->Synthesize() * (1.0f - w) + (float)samples[i] * w);
+				}
+				m_lostSamples = 0;
+			}
+
+			if(count >= m_historyLength)
+			{
+				memcpy(m_history, samples + count - m_historyLength, m_historyLength * sizeof(short));
+			}
+			else
+			{
+				memmove(m_history, m_history + count, (m_historyLength - count) * sizeof(short));
+				memcpy(m_history + m_historyLength - count, samples, count * sizeof(short));
+			}
+			m_hasHistory = true;
+		}
+
+		bool PitchConcealer::Conceal(short *samples, int count)
+		{
+			int expandAt = m_sampleRate * ExpandMs / 1000;
+			bool faded = !m_hasHistory || m_lostSamples >= expandAt + m_sampleRate * FadeMs / 1000;
+			if(faded && m_noiseAmplitude == 0.0f)
+			{
+				return false;
+			}
+
+			if(m_lostSamples == 0)
+			{
+				m_pitch = this->FindPitch();
+				m_periods = 1;
+				m_offset = 0;
+
+				// The repeated period follows on from the sample one period before the last real one, which only matches
+				// the last real sample if the pitch has held steady.
+				const short *last = m_history + m_historyLength - 1;
+				m_startStep = m_hasHistory ? (float)(*last - *(last - m_pitch)) : 0.0f;
+				m_startLength = m_pitch / 4;
+			}
+
+			for(int i = 0; i < count; i++)
+			{
+				// Every 10 ms, use one more period of history. Reading that much further back keeps the current position.
+				if(m_lostSamples > 0 && m_lostSamples % expandAt == 0 && m_periods < MaxPeriods)
+				{
+					m_periods++;
+					m_offset += m_pitch;
+				}
+				samples[i] = this->Synthesize();
+			}
+			if(!faded)
+			{
+				m_concealedFrames++;
+			}
+			return true;
+		}
+
+		short PitchConcealer::Synthesize()
+		{
+			int period = m_pitch * m_periods;
+			float sample = m_hasHistory ? m_history[m_historyLength - period + m_offset] : 0.0f;
+			m_offset = m_offset + 1 < period ? m_offset + 1 : 0;
+			if(m_lostSamples < m_startLength)
+			{
+				sample += m_startStep * (float)(m_startLength - m_lostSamples) / (float)(m_startLength + 1);
+			}
+
+			int expandAt = m_sampleRate * ExpandMs / 1000;
+			int fadeLength = m_sampleRate * FadeMs / 1000;
+			int faded = m_lostSamples - expandAt;
+			if(faded < fadeLength)
+			{
+				m_lostSamples++;
+			}
+			if(faded > 0)
+			{
+				float gain = faded < fadeLength ? (float)(fadeLength - faded) / fadeLength : 0.0f;
+				sample = sample * gain + this->Noise() * (1.0f - gain);
+			}
+			return (short)(sample > 32767.0f ? 32767.0f : sample < -32768.0f ? -32768.0f : sample);
+		}
+
+		float PitchConcealer::Noise()
+		{
+			if(m_noiseAmplitude == 0.0f)
+			{
+				return 0.0f;
+			}
+			m_noiseSeed = m_noiseSeed * 1664525u + 1013904223u;
+			return ((float)(m_noiseSeed >> 8) / 8388608.0f - 1.0f) * m_noiseAmplitude;
+		}
+
+		int PitchConcealer::FindPitch() const
+		{
+			// Match the most recent window against earlier parts of the history, using the normalized cross-correlation.
+			const short *recent = m_history + m_historyLength - m_window;
+			int best = m_maxPitch;
+			double bestScore = -1.0;
+			for(int lag = m_minPitch; lag <= m_maxPitch; lag++)
+			{
+				const short *past = recent - lag;
+				double corr = 0.0, energy = 0.0;
+				for(int i = 0; i < m_window; i++)
+				{
+					corr += (double)recent[i] * past[i];
+					energy += (double)past[i] * past[i];
+				}
+				if(energy > 0.0 && corr > 0.0)
+				{
+					double score = corr / sqrt(energy);
+					if(score > bestScore)
+					{
+						bestScore = score;
+						best = lag;
+					}
+				}
+			}
+			return best;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// Conceals lost packets by repeating the last pitch period of the decoded signal, in the manner of G.711
+// Appendix I. The pitch is estimated once per loss from the recent history. Longer losses repeat up to three
+// periods to avoid a buzzy sound and fade out from 10 ms on, reaching silence after 60 ms. When packets
+// resume, the first good samples are cross-faded with the continuing synthetic signal. When the sender has
+// described its background noise, the concealment fades into comfort noise of that level instead of silence.
+// Appendix I also overlaps the start of the loss with the last real samples, at the cost of holding back a quarter
+// period of output. Here nothing is held back; instead, the step between the last real sample and the first synthetic
+// one is taken out and faded back in over the first quarter period.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class PitchConcealer
+		{
+		private:
+			static const int MinPitchMs = 5;
+			static const int MaxPitchMs = 15;
+			static const int CorrelationMs = 5;
+			static const int ExpandMs = 10;
+			static const int FadeMs = 50;
+			static const int MaxOverlapMs = 10;
+			static const int OverlapPerExpandMs = 4;
+			static const int MaxPeriods = 3;
+
+			int m_sampleRate;
+			int m_minPitch;
+			int m_maxPitch;
+			int m_window;
+			int m_historyLength;
+			short *m_history;
+			bool m_hasHistory;
+
+			// The state of the current loss.
+			int m_lostSamples;
+			int m_pitch;
+			int m_periods;
+			int m_offset;
+			float m_startStep;
+			int m_startLength;
+			int m_concealedFrames;
+			float m_noiseAmplitude;
+			unsigned int m_noiseSeed;
+
+		public:
+			PitchConcealer(int sampleRate);
+			~PitchConcealer();
+
+			// Passes a decoded frame through, cross-fading its start if it ends a loss, and remembers it.
+			void Update(short *samples, int count);
+
+			// Fills in for a lost frame. Returns false, leaving the buffer untouched, once the concealment has
+			// faded to silence or if there is nothing to go on.
+			bool Conceal(short *samples, int count);
+
+			void Reset();
+
+			// Sets the RMS level (relative to full scale) of the comfort noise that fills gaps, or zero for silence.
+			void SetComfortNoise(float rms);
+
+			int ConcealedFrames() const
+			{
+				return m_concealedFrames;
+			}
+
+		private:
+			int FindPitch() const;
+			short Synthesize();
+			float Noise();
+			PitchConcealer(const PitchConcealer&);
+			PitchConcealer &operator=(const PitchConcealer&);
+		};
+	}
+}
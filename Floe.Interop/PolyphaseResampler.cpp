@@ -0,0 +1,186 @@
+#include <math.h>
+#include <string.h>
+#include "DspKernels.h"
+#include "PolyphaseResampler.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		static const double Pi = 3.14159265358979323846;
+
+		// The filter length at the lower of the two rates, and the stopband attenuation in dB, for each quality preset.
+		// The lengths are multiples of eight so that the dot products run in whole vectors.
+		static const int PresetTaps[] = { 24, 48, 96 };
+		static const double PresetAttenuation[] = { 60.0, 80.0, 100.0 };
+
+		static int Gcd(int a, int b)
+		{
+			while(b != 0)
+			{
+				int t = a % b;
+				a = b;
+				b = t;
+			}
+			return a;
+		}
+
+		// The zeroth-order modified Bessel function of the first kind, for the Kaiser window.
+		static double BesselI0(double x)
+		{
+			double sum = 1.0, term = 1.0;
+			for(int k = 1; k < 50 && term > sum * 1e-12; k++)
+			{
+				double t = x / (2.0 * k);
+				term *= t * t;
+				sum += term;
+			}
+			return sum;
+		}
+
+		static inline short ToPcm16(float value)
+		{
+			if(value >= 32767.0f)
+			{
+				return 32767;
+			}
+			if(value <= -32768.0f)
+			{
+				return -32768;
+			}
+			return (short)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+		}
+
+		PolyphaseResampler::PolyphaseResampler(int srcRate, int dstRate, Quality quality, int maxInput)
+		{
+			int gcd = Gcd(srcRate, dstRate);
+			m_up = dstRate / gcd;
+			m_down = srcRate / gcd;
+			m_interpolate = m_up > MaxPhases;
+			m_phases = m_interpolate ? MaxPhases : m_up;
+
+			// Kaiser's estimates give the window shape for the attenuation, and the transition width that the length
+			// allows. The cutoff sits in the middle of the transition, so that the stopband begins at the lower Nyquist
+			// frequency. When downsampling, the filter is stretched by the ratio to keep the same transition.
+			int preset = quality < QualityLow ? QualityLow : quality > QualityHigh ? QualityHigh : quality;
+			double attenuation = PresetAttenuation[preset];
+			double beta = 0.1102 * (attenuation - 8.7);
+			double transition = (attenuation - 7.95) / (14.36 * PresetTaps[preset]);
+			double ratio = m_up < m_down ? (double)m_up / m_down : 1.0;
+			m_taps = ((int)ceil(PresetTaps[preset] / ratio) + 7) & ~7;
+
+			int rows = m_interpolate ? m_phases + 1 : m_phases;
+			m_coefficients = new float[rows * m_taps];
+			this->Design(ratio * (0.5 - transition / 2.0), beta);
+
+			m_capacity = m_taps + maxInput * 2;
+			m_history = new float[m_capacity];
+			this->Reset();
+		}
+
+		PolyphaseResampler::~PolyphaseResampler()
+		{
+			delete[] m_coefficients;
+			delete[] m_history;
+		}
+
+		void PolyphaseResampler::Design(double cutoff, double beta)
+		{
+			// Row p holds the filter for an output that falls p/phases of the way from one input sample to the next,
+			// laid out in the order of the input window so that each output is a single dot product. Each row is scaled
+			// to unit gain at DC, so that no phase adds a ripple of its own.
+			int rows = m_interpolate ? m_phases + 1 : m_phases;
+			double half = m_taps / 2.0;
+			double i0Beta = BesselI0(beta);
+			for(int p = 0; p < rows; p++)
+			{
+				float *row = m_coefficients + p * m_taps;
+				double sum = 0.0;
+				for(int j = 0; j < m_taps; j++)
+				{
+					double t = (double)p / m_phases + half - 1.0 - j;
+					double x = t / half;
+					double window = x * x < 1.0 ? BesselI0(beta * sqrt(1.0 - x * x)) / i0Beta : 0.0;
+					double arg = 2.0 * cutoff * t;
+					double sinc = arg != 0.0 ? sin(Pi * arg) / (Pi * arg) : 1.0;
+					double value = 2.0 * cutoff * sinc * window;
+					row[j] = (float)value;
+					sum += value;
+				}
+				for(int j = 0; j < m_taps; j++)
+				{
+					row[j] = (float)(row[j] / sum);
+				}
+			}
+		}
+
+		void PolyphaseResampler::Reset()
+		{
+			// The history starts with enough silence that the first output lines up with the first input sample.
+			m_length = m_taps / 2 - 1;
+			m_position = 0;
+			m_phase = 0;
+			memset(m_history, 0, m_length * sizeof(float));
+		}
+
+		int PolyphaseResampler::MaxOutput(int count) const
+		{
+			__int64 available = (__int64)(m_length - m_position + count);
+			return available > 0 ? (int)(available * m_up / m_down) + 1 : 0;
+		}
+
+		int PolyphaseResampler::Process(const short *src, int count, short *dst, int dstMax)
+		{
+			// Drop the input that no later output needs. When downsampling, the next window may start past the end of
+			// what is kept, in which case part of the new input is skipped as well.
+			int keep = m_length - m_position;
+			if(keep > 0)
+			{
+				memmove(m_history, m_history + m_position, keep * sizeof(float));
+				m_length = keep;
+				m_position = 0;
+			}
+			else
+			{
+				m_length = 0;
+				m_position = -keep;
+			}
+
+			if(m_length + count > m_capacity)
+			{
+				return -1;
+			}
+			for(int i = 0; i < count; i++)
+			{
+				m_history[m_length + i] = src[i];
+			}
+			m_length += count;
+
+			int produced = 0;
+			while(produced < dstMax && m_position + m_taps <= m_length)
+			{
+				const float *window = m_history + m_position;
+				float value;
+				if(m_interpolate)
+				{
+					__int64 scaled = (__int64)m_phase * m_phases;
+					const float *row = m_coefficients + (int)(scaled / m_up) * m_taps;
+					float frac = (float)(scaled % m_up) / m_up;
+					float a = DotProduct(window, row, m_taps);
+					float b = DotProduct(window, row + m_taps, m_taps);
+					value = a + (b - a) * frac;
+				}
+				else
+				{
+					value = DotProduct(window, m_coefficients + m_phase * m_taps, m_taps);
+				}
+				dst[produced++] = ToPcm16(value);
+
+				m_phase += m_down;
+				m_position += m_phase / m_up;
+				m_phase %= m_up;
+			}
+			return produced;
+		}
+	}
+}
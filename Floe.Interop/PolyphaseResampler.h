@@ -0,0 +1,74 @@
+#pragma once
+
+// Converts a stream of 16-bit mono samples from one rate to another with a polyphase windowed-sinc filter. The
+// ratio between the rates is reduced to L/M; each output sample is the dot product of the input around it with the
+// filter phase for its position between input samples. When L is small, every phase is computed up front and the
+// conversion is exact. Otherwise a fixed table of phases is kept and neighbouring phases are interpolated.
+//
+// The filter is a Kaiser-windowed sinc whose cutoff lies below the lower of the two Nyquist frequencies, so that
+// downsampling does not alias. The quality presets trade the filter length against the width of the transition band
+// and the stopband attenuation.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class PolyphaseResampler
+		{
+		public:
+			enum Quality
+			{
+				QualityLow,
+				QualityMedium,
+				QualityHigh
+			};
+
+		private:
+			static const int MaxPhases = 256;
+
+			int m_up;
+			int m_down;
+			int m_taps;
+			int m_phases;
+			bool m_interpolate;
+			float *m_coefficients;
+			float *m_history;
+			int m_capacity;
+			int m_length;
+			int m_position;
+			int m_phase;
+
+		public:
+			// Up to maxInput samples may be passed to each call of Process.
+			PolyphaseResampler(int srcRate, int dstRate, Quality quality, int maxInput);
+			~PolyphaseResampler();
+
+			// Takes count input samples and writes up to dstMax output samples. Input that is not needed to fill dst is
+			// kept and used by the next call, which may pass no new input at all. Returns the number of samples written,
+			// or -1 if the kept input and the new input together do not fit.
+			int Process(const short *src, int count, short *dst, int dstMax);
+
+			// Clears the kept input, as at the start of a new stream.
+			void Reset();
+
+			// The number of output samples that a call with count new input samples can produce at most.
+			int MaxOutput(int count) const;
+
+			// The delay of the filter, in output samples.
+			int Delay() const
+			{
+				return (int)((__int64)(m_taps / 2) * m_up / m_down);
+			}
+
+			int Taps() const
+			{
+				return m_taps;
+			}
+
+		private:
+			void Design(double cutoff, double beta);
+			PolyphaseResampler(const PolyphaseResampler&);
+			PolyphaseResampler &operator=(const PolyphaseResampler&);
+		};
+	}
+}
@@ -0,0 +1,57 @@
+#include "Stdafx.h"
+#include "SampleRateConverter.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		SampleRateConverter::SampleRateConverter(int sourceRate, int destRate, ResamplerQuality quality, int maxSrcSize)
+		{
+			if(sourceRate < 1000 || destRate < 1000)
+			{
+				throw gcnew System::ArgumentException("Invalid sample rate.");
+			}
+			if(maxSrcSize < 2)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("maxSrcSize");
+			}
+			m_sourceRate = sourceRate;
+			m_destRate = destRate;
+			m_resampler = new PolyphaseResampler(sourceRate, destRate, (PolyphaseResampler::Quality)quality, maxSrcSize / 2);
+		}
+
+		int SampleRateConverter::Convert(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+		{
+			int count = m_resampler->Process((const short*)(void*)srcBuffer, size / 2, (short*)(void*)dstBuffer, dstSize / 2);
+			if(count < 0)
+			{
+				throw gcnew InteropException("Source buffer too large.");
+			}
+			return count * 2;
+		}
+
+		void SampleRateConverter::Reset()
+		{
+			m_resampler->Reset();
+		}
+
+		int SampleRateConverter::GetMaxDestSize(int size)
+		{
+			return m_resampler->MaxOutput(size / 2) * 2;
+		}
+
+		SampleRateConverter::~SampleRateConverter()
+		{
+			if(m_resampler != 0)
+			{
+				delete m_resampler;
+				m_resampler = 0;
+			}
+		}
+
+		SampleRateConverter::!SampleRateConverter()
+		{
+			this->~SampleRateConverter();
+		}
+	}
+}
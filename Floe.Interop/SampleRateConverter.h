@@ -0,0 +1,73 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "PolyphaseResampler.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		public enum class ResamplerQuality
+		{
+			Low,
+			Medium,
+			High
+		};
+
+		// Converts a stream of 16-bit mono PCM from one sample rate to another, without going through ACM. Any pair of
+		// rates is supported. The converter keeps the input it has not yet used, so that output may be taken in blocks of
+		// any size: a call with no new input takes more of what is kept.
+		public ref class SampleRateConverter
+		{
+		private:
+			PolyphaseResampler *m_resampler;
+			int m_sourceRate;
+			int m_destRate;
+
+		public:
+			// Up to maxSrcSize bytes may be passed to each call of Convert.
+			SampleRateConverter(int sourceRate, int destRate, ResamplerQuality quality, int maxSrcSize);
+
+			// Converts size bytes from srcBuffer and writes up to dstSize bytes to dstBuffer. Returns the number of bytes
+			// written.
+			int Convert(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize);
+
+			// Clears the kept input, as at the start of a new stream.
+			void Reset();
+
+			// The largest number of bytes that a call with size bytes of new input can write.
+			int GetMaxDestSize(int size);
+
+			property int SourceRate
+			{
+				int get()
+				{
+					return m_sourceRate;
+				}
+			}
+
+			property int DestRate
+			{
+				int get()
+				{
+					return m_destRate;
+				}
+			}
+
+			// The delay of the filter, in samples at the destination rate.
+			property int Delay
+			{
+				int get()
+				{
+					return m_resampler->Delay();
+				}
+			}
+
+		private:
+			~SampleRateConverter();
+			!SampleRateConverter();
+		};
+	}
+}
@@ -0,0 +1,258 @@
+#include <Windows.h>
+#include <string.h>
+#include "DspKernels.h"
+#include "SoundBank.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		SoundBank::SoundBank(int channels, long long maxBytes, int maxFrames)
+		{
+			m_channels = channels;
+			m_maxBytes = maxBytes;
+			m_maxFrames = maxFrames;
+			LARGE_INTEGER freq;
+			QueryPerformanceFrequency(&freq);
+			m_ticksToMs = 1000.0 / (double)freq.QuadPart;
+
+			memset(m_sounds, 0, sizeof(m_sounds));
+			m_bytes = 0;
+			m_nextId = 1;
+			m_clock = 0;
+			m_nextToken = 1;
+			m_evictions = 0;
+			m_commandHead = m_commandTail = 0;
+			m_voiceCount = 0;
+			m_accumulator = new int[maxFrames * channels];
+			m_finished = new long long[CommandCapacity + MaxVoices];
+			m_finishedCount = 0;
+			m_active = m_steals = 0;
+			m_lastLatency = m_maxLatency = 0.0f;
+		}
+
+		SoundBank::~SoundBank()
+		{
+			for(int i = 0; i < MaxSounds; i++)
+			{
+				delete[] m_sounds[i].samples;
+			}
+			delete[] m_accumulator;
+			delete[] m_finished;
+		}
+
+		int SoundBank::Add(const short *samples, int frames)
+		{
+			long long size = (long long)frames * m_channels * sizeof(short);
+			if(frames < 1 || size > m_maxBytes)
+			{
+				return 0;
+			}
+
+			// Make room by dropping the least recently used sounds that nothing refers to. The clock counts plays, so
+			// the oldest is the one with the largest distance from it, which stays right when the clock wraps.
+			int slot = -1;
+			while(true)
+			{
+				int oldest = -1, empty = -1;
+				for(int i = 0; i < MaxSounds; i++)
+				{
+					Sound &sound = m_sounds[i];
+					if(sound.samples == 0)
+					{
+						empty = i;
+					}
+					else if(sound.references == 0 &&
+						(oldest < 0 || m_clock - sound.lastUsed > m_clock - m_sounds[oldest].lastUsed))
+					{
+						oldest = i;
+					}
+				}
+				if(empty >= 0 && m_bytes + size <= m_maxBytes)
+				{
+					slot = empty;
+					break;
+				}
+				if(oldest < 0)
+				{
+					return 0;
+				}
+				this->Remove(m_sounds[oldest].id);
+				m_evictions++;
+			}
+
+			Sound &sound = m_sounds[slot];
+			sound.samples = new short[frames * m_channels];
+			memcpy(sound.samples, samples, (size_t)size);
+			sound.frames = frames;
+			sound.id = m_nextId++;
+			if(m_nextId <= 0)
+			{
+				m_nextId = 1;
+			}
+			sound.lastUsed = m_clock++;
+			sound.references = 0;
+			m_bytes += size;
+			return sound.id;
+		}
+
+		bool SoundBank::Remove(int id)
+		{
+			Sound *sound = this->Find(id);
+			if(sound == 0 || sound->references != 0)
+			{
+				return false;
+			}
+			delete[] sound->samples;
+			sound->samples = 0;
+			sound->id = 0;
+			m_bytes -= (long long)sound->frames * m_channels * sizeof(short);
+			return true;
+		}
+
+		long long SoundBank::Play(int id, float gain)
+		{
+			Sound *sound = this->Find(id);
+			long head = m_commandHead;
+			if(sound == 0 || head - m_commandTail >= CommandCapacity)
+			{
+				return 0;
+			}
+
+			// The reference is taken before the command is published, so the sound cannot be dropped while the play
+			// is waiting, and the render thread gives it back when the voice ends.
+			InterlockedIncrement(&sound->references);
+			sound->lastUsed = m_clock++;
+			Command &command = m_commands[head & (CommandCapacity - 1)];
+			command.sound = sound;
+			command.gain = gain;
+			command.token = m_nextToken++;
+			command.triggered = this->Now();
+			MemoryBarrier();
+			m_commandHead = head + 1;
+			return command.token;
+		}
+
+		void SoundBank::Render(short *samples, int frames)
+		{
+			if(frames > m_maxFrames)
+			{
+				frames = m_maxFrames;
+			}
+			m_finishedCount = 0;
+
+			// Start the voices that were asked for since the last render.
+			long tail = m_commandTail;
+			long head = m_commandHead;
+			MemoryBarrier();
+			if(tail != head)
+			{
+				long long now = this->Now();
+				for(; tail != head; tail++)
+				{
+					const Command &command = m_commands[tail & (CommandCapacity - 1)];
+					if(m_voiceCount == MaxVoices)
+					{
+						int longest = 0;
+						for(int i = 1; i < m_voiceCount; i++)
+						{
+							if(m_voices[i].position > m_voices[longest].position)
+							{
+								longest = i;
+							}
+						}
+						this->Release(&m_voices[longest]);
+						m_voices[longest] = m_voices[--m_voiceCount];
+						InterlockedIncrement(&m_steals);
+					}
+					Voice &voice = m_voices[m_voiceCount++];
+					voice.sound = command.sound;
+					voice.position = 0;
+					voice.gain = command.gain;
+					voice.token = command.token;
+
+					float latency = (float)((now - command.triggered) * m_ticksToMs);
+					m_lastLatency = latency;
+					if(latency > m_maxLatency)
+					{
+						m_maxLatency = latency;
+					}
+				}
+				MemoryBarrier();
+				m_commandTail = tail;
+			}
+
+			int count = frames * m_channels;
+			if(m_voiceCount == 0)
+			{
+				memset(samples, 0, count * sizeof(short));
+				m_active = 0;
+				return;
+			}
+
+			memset(m_accumulator, 0, count * sizeof(int));
+			for(int i = 0; i < m_voiceCount; )
+			{
+				Voice &voice = m_voices[i];
+				int left = voice.sound->frames - voice.position;
+				int n = left < frames ? left : frames;
+				MixPcm16(m_accumulator, voice.sound->samples + voice.position * m_channels, n * m_channels, voice.gain);
+				voice.position += n;
+				if(voice.position >= voice.sound->frames)
+				{
+					this->Release(&voice);
+					m_voices[i] = m_voices[--m_voiceCount];
+				}
+				else
+				{
+					i++;
+				}
+			}
+			SaturatePcm16(m_accumulator, samples, count);
+			m_active = m_voiceCount;
+		}
+
+		bool SoundBank::Contains(int id) const
+		{
+			return const_cast<SoundBank*>(this)->Find(id) != 0;
+		}
+
+		int SoundBank::Count() const
+		{
+			int count = 0;
+			for(int i = 0; i < MaxSounds; i++)
+			{
+				if(m_sounds[i].samples != 0)
+				{
+					count++;
+				}
+			}
+			return count;
+		}
+
+		SoundBank::Sound *SoundBank::Find(int id)
+		{
+			for(int i = 0; id != 0 && i < MaxSounds; i++)
+			{
+				if(m_sounds[i].id == id)
+				{
+					return &m_sounds[i];
+				}
+			}
+			return 0;
+		}
+
+		void SoundBank::Release(Voice *voice)
+		{
+			m_finished[m_finishedCount++] = voice->token;
+			InterlockedDecrement(&voice->sound->references);
+		}
+
+		long long SoundBank::Now() const
+		{
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			return now.QuadPart;
+		}
+	}
+}
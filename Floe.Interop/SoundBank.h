@@ -0,0 +1,154 @@
+#pragma once
+
+// Decoded sounds kept in memory, and the voices that play them, mixed into a single output stream. Sounds are added
+// and played from one control thread, and the mix is rendered on the output device's thread; the two only meet in a
+// small ring of play commands and in each sound's count of references, so neither ever waits for the other.
+//
+// The memory held by sounds is bounded. When a new sound does not fit, the sounds used least recently are dropped
+// until it does, skipping any that are playing or waiting to play. A fixed number of voices can play at once; when all
+// are busy, a new sound takes the voice that has played the longest.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class SoundBank
+		{
+		private:
+			struct Sound
+			{
+				int id;
+				short *samples;
+				int frames;
+				unsigned int lastUsed;
+				volatile long references;
+			};
+
+			struct Command
+			{
+				Sound *sound;
+				float gain;
+				long long token;
+				long long triggered;
+			};
+
+			struct Voice
+			{
+				Sound *sound;
+				int position;
+				float gain;
+				long long token;
+			};
+
+			static const int MaxSounds = 64;
+			static const int MaxVoices = 16;
+			static const int CommandCapacity = 64; // a power of two
+
+			int m_channels;
+			long long m_maxBytes;
+			int m_maxFrames;
+			double m_ticksToMs;
+
+			// Owned by the control thread.
+			Sound m_sounds[MaxSounds];
+			long long m_bytes;
+			int m_nextId;
+			unsigned int m_clock;
+			long long m_nextToken;
+			int m_evictions;
+
+			// Written by the control thread and read by the render thread.
+			Command m_commands[CommandCapacity];
+			volatile long m_commandHead;
+			volatile long m_commandTail;
+
+			// Owned by the render thread.
+			Voice m_voices[MaxVoices];
+			int m_voiceCount;
+			int *m_accumulator;
+			long long *m_finished;
+			int m_finishedCount;
+			volatile long m_active;
+			volatile long m_steals;
+			volatile float m_lastLatency;
+			volatile float m_maxLatency;
+
+		public:
+			// Sounds hold interleaved 16-bit samples with the given number of channels. Up to maxFrames frames are
+			// rendered at a time.
+			SoundBank(int channels, long long maxBytes, int maxFrames);
+			~SoundBank();
+
+			// Copies a sound into the bank and returns its id, or zero if it cannot be made to fit.
+			int Add(const short *samples, int frames);
+
+			// Drops a sound that is not playing. Returns false if it is playing or not in the bank.
+			bool Remove(int id);
+
+			// Starts a new voice on a sound at the next render, and returns a token for it, or zero if the sound is not in
+			// the bank (it may have been evicted) or too many plays are already waiting.
+			long long Play(int id, float gain);
+
+			// Mixes the next frames of all voices, and fills the rest with silence. Voices that end are listed by
+			// Finished until the next render.
+			void Render(short *samples, int frames);
+
+			// Returns the tokens of the voices that ended or were taken during the last render.
+			int Finished(const long long **tokens) const
+			{
+				*tokens = m_finished;
+				return m_finishedCount;
+			}
+
+			bool Contains(int id) const;
+
+			long long Bytes() const
+			{
+				return m_bytes;
+			}
+
+			long long MaxBytes() const
+			{
+				return m_maxBytes;
+			}
+
+			int Count() const;
+
+			int Evictions() const
+			{
+				return m_evictions;
+			}
+
+			// The number of voices playing, and the number of plays waiting for the next render.
+			int Active() const
+			{
+				return m_active + (m_commandHead - m_commandTail);
+			}
+
+			// The number of voices that were cut short to make room for another.
+			int Steals() const
+			{
+				return m_steals;
+			}
+
+			// The time from Play to the render of the buffer that holds the sound's first sample, in milliseconds,
+			// for the last voice started and the longest so far.
+			float LastLatency() const
+			{
+				return m_lastLatency;
+			}
+
+			float MaxLatency() const
+			{
+				return m_maxLatency;
+			}
+
+		private:
+			Sound *Find(int id);
+			void Release(Voice *voice);
+			long long Now() const;
+			SoundBank(const SoundBank&);
+			SoundBank &operator=(const SoundBank&);
+		};
+	}
+}
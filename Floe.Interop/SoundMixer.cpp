@@ -0,0 +1,126 @@
+#include "Stdafx.h"
+#include "SoundMixer.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::Threading::Monitor;
+
+		SoundMixer::SoundMixer(int channels, int maxBytes, int maxSize)
+		{
+			if(channels < 1 || channels > 2)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("channels");
+			}
+			if(maxBytes < 1)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("maxBytes");
+			}
+			if(maxSize < channels * 2)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("maxSize");
+			}
+			m_channels = channels;
+			m_maxSize = maxSize;
+			m_sync = gcnew System::Object();
+			m_bank = new SoundBank(channels, maxBytes, maxSize / (channels * 2));
+		}
+
+		int SoundMixer::Add(array<Byte> ^samples, int count)
+		{
+			if(samples == nullptr)
+			{
+				throw gcnew System::ArgumentNullException("samples");
+			}
+			if(count < 0 || count > samples->Length)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("count");
+			}
+			int frames = count / (m_channels * 2);
+			if(frames < 1)
+			{
+				return 0;
+			}
+
+			pin_ptr<Byte> src = &samples[0];
+			Monitor::Enter(m_sync);
+			try
+			{
+				return m_bank->Add((const short*)src, frames);
+			}
+			finally
+			{
+				Monitor::Exit(m_sync);
+			}
+		}
+
+		bool SoundMixer::Remove(int id)
+		{
+			Monitor::Enter(m_sync);
+			try
+			{
+				return m_bank->Remove(id);
+			}
+			finally
+			{
+				Monitor::Exit(m_sync);
+			}
+		}
+
+		bool SoundMixer::Contains(int id)
+		{
+			Monitor::Enter(m_sync);
+			try
+			{
+				return m_bank->Contains(id);
+			}
+			finally
+			{
+				Monitor::Exit(m_sync);
+			}
+		}
+
+		long long SoundMixer::Play(int id, float gain)
+		{
+			Monitor::Enter(m_sync);
+			try
+			{
+				return m_bank->Play(id, gain < 0.0f ? 0.0f : gain);
+			}
+			finally
+			{
+				Monitor::Exit(m_sync);
+			}
+		}
+
+		int SoundMixer::Read(IntPtr buffer, int count)
+		{
+			int frameSize = m_channels * 2;
+			count = (count < m_maxSize ? count : m_maxSize) / frameSize * frameSize;
+			m_bank->Render((short*)(void*)buffer, count / frameSize);
+
+			const long long *tokens;
+			int finished = m_bank->Finished(&tokens);
+			for(int i = 0; i < finished; i++)
+			{
+				this->Finished(this, gcnew SoundEventArgs(tokens[i]));
+			}
+			return count;
+		}
+
+		SoundMixer::~SoundMixer()
+		{
+			if(m_bank != 0)
+			{
+				delete m_bank;
+				m_bank = 0;
+			}
+		}
+
+		SoundMixer::!SoundMixer()
+		{
+			this->~SoundMixer();
+		}
+	}
+}
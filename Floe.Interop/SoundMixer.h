@@ -0,0 +1,146 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "SoundBank.h"
+#include "WaveSource.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+		using System::Byte;
+
+		public ref class SoundEventArgs : System::EventArgs
+		{
+		private:
+			long long m_token;
+
+		internal:
+			SoundEventArgs(long long token) : m_token(token)
+			{
+			}
+
+		public:
+			// The token that Play returned for the sound.
+			property long long Token
+			{
+				long long get()
+				{
+					return m_token;
+				}
+			}
+		};
+
+		// Keeps decoded sounds in memory, within a limit, and plays any number of them at once through one output. It
+		// is meant to be handed to a WaveOut that stays open, so that playing a sound costs no more than queueing it
+		// for the next buffer. Sounds are 16-bit PCM in the mixer's format; sounds that have not been played for the
+		// longest are dropped to make room for new ones.
+		public ref class SoundMixer : IWaveSource
+		{
+		private:
+			SoundBank *m_bank;
+			System::Object ^m_sync;
+			int m_channels;
+			int m_maxSize;
+
+		public:
+			// The channels are those of the mixer's output. Sounds may take up to maxBytes in all, and up to maxSize
+			// bytes are read at a time.
+			SoundMixer(int channels, int maxBytes, int maxSize);
+
+			// Copies a sound into the mixer and returns its id, or zero if it is larger than the limit, or the mixer
+			// is full of sounds that are playing.
+			int Add(array<Byte> ^samples, int count);
+
+			// Drops a sound. Returns false if it is playing or not in the mixer.
+			bool Remove(int id);
+
+			bool Contains(int id);
+
+			// Starts playing a sound at the next read, and returns a token that identifies this play in Finished, or
+			// zero if the sound is no longer in the mixer.
+			long long Play(int id, float gain);
+
+			// Mixes the sounds that are playing, and pads with silence, so that the whole count is always written.
+			virtual int Read(IntPtr buffer, int count);
+
+			// Raised on the reading thread when a sound ends or is cut short. Handlers must return quickly.
+			event System::EventHandler<SoundEventArgs^> ^Finished;
+
+			property int Channels
+			{
+				int get()
+				{
+					return m_channels;
+				}
+			}
+
+			// The number of bytes held by sounds.
+			property long long Bytes
+			{
+				long long get()
+				{
+					return m_bank->Bytes();
+				}
+			}
+
+			property int Count
+			{
+				int get()
+				{
+					return m_bank->Count();
+				}
+			}
+
+			// The number of sounds dropped to make room for others.
+			property int Evictions
+			{
+				int get()
+				{
+					return m_bank->Evictions();
+				}
+			}
+
+			// The number of sounds playing or about to play.
+			property int Active
+			{
+				int get()
+				{
+					return m_bank->Active();
+				}
+			}
+
+			// The number of sounds cut short because too many were playing.
+			property int Steals
+			{
+				int get()
+				{
+					return m_bank->Steals();
+				}
+			}
+
+			// The time from Play to the read that holds the first sample of the sound, in milliseconds, for the
+			// last sound started.
+			property float LastLatency
+			{
+				float get()
+				{
+					return m_bank->LastLatency();
+				}
+			}
+
+			property float MaxLatency
+			{
+				float get()
+				{
+					return m_bank->MaxLatency();
+				}
+			}
+
+		private:
+			~SoundMixer();
+			!SoundMixer();
+		};
+	}
+}
@@ -0,0 +1,170 @@
+#include <math.h>
+#include <string.h>
+#include "Fft.h"
+#include "SpectralSuppressor.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		static const double Pi = 3.14159265358979323846;
+		static const float SmoothingRate = 0.3f;
+		static const float NoiseRiseDb = 4.0f; // per second
+		static const float NoiseBias = 1.5f;
+		static const float PrioriWeight = 0.98f;
+		static const float DefaultSuppression = 15.0f; // dB
+		static const int StartupMs = 250;
+
+		static inline short ToPcm16(float value)
+		{
+			if(value >= 32767.0f)
+			{
+				return 32767;
+			}
+			if(value <= -32768.0f)
+			{
+				return -32768;
+			}
+			return (short)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+		}
+
+		SpectralSuppressor::SpectralSuppressor(int sampleRate, int blockSize)
+		{
+			m_block = blockSize;
+			m_fftSize = blockSize * 2;
+			m_bins = blockSize + 1;
+			m_fft = new Fft(m_fftSize);
+
+			// A periodic square-root Hann window: its square, shifted by half its length, sums to one.
+			m_window = new float[m_fftSize];
+			for(int i = 0; i < m_fftSize; i++)
+			{
+				m_window[i] = (float)sqrt(0.5 - 0.5 * cos(2.0 * Pi * i / m_fftSize));
+			}
+
+			m_input = new float[m_fftSize];
+			m_overlap = new float[m_block];
+			m_re = new float[m_fftSize];
+			m_im = new float[m_fftSize];
+			m_smoothed = new float[m_bins];
+			m_noise = new float[m_bins];
+			m_clean = new float[m_bins];
+
+			double blocksPerSecond = (double)sampleRate / blockSize;
+			m_rise = (float)pow(10.0, NoiseRiseDb / 10.0 / blocksPerSecond);
+			m_startup = (int)(StartupMs * blocksPerSecond / 1000.0) + 1;
+			this->SetSuppression(DefaultSuppression);
+			this->Reset();
+		}
+
+		SpectralSuppressor::~SpectralSuppressor()
+		{
+			delete m_fft;
+			delete[] m_window;
+			delete[] m_input;
+			delete[] m_overlap;
+			delete[] m_re;
+			delete[] m_im;
+			delete[] m_smoothed;
+			delete[] m_noise;
+			delete[] m_clean;
+		}
+
+		void SpectralSuppressor::Reset()
+		{
+			memset(m_input, 0, m_fftSize * sizeof(float));
+			memset(m_overlap, 0, m_block * sizeof(float));
+			memset(m_smoothed, 0, m_bins * sizeof(float));
+			memset(m_noise, 0, m_bins * sizeof(float));
+			memset(m_clean, 0, m_bins * sizeof(float));
+			m_frames = 0;
+		}
+
+		void SpectralSuppressor::SetSuppression(float suppression)
+		{
+			m_suppression = suppression < 0.0f ? 0.0f : suppression;
+			m_floor = (float)pow(10.0, -m_suppression / 20.0);
+		}
+
+		float SpectralSuppressor::NoiseLevel() const
+		{
+			// By Parseval's theorem, with the window's mean square of one half.
+			double total = m_noise[0] + m_noise[m_block];
+			for(int k = 1; k < m_block; k++)
+			{
+				total += 2.0 * m_noise[k];
+			}
+			double meanSquare = total / ((double)m_fftSize * m_fftSize / 2.0) / (32768.0 * 32768.0);
+			return (float)(10.0 * log10(meanSquare + 1e-10));
+		}
+
+		void SpectralSuppressor::Process(short *samples, int count)
+		{
+			for(int i = 0; i + m_block <= count; i += m_block)
+			{
+				this->ProcessBlock(samples + i);
+			}
+		}
+
+		void SpectralSuppressor::ProcessBlock(short *samples)
+		{
+			int n = m_block;
+			memmove(m_input, m_input + n, n * sizeof(float));
+			for(int i = 0; i < n; i++)
+			{
+				m_input[n + i] = samples[i];
+			}
+			for(int i = 0; i < m_fftSize; i++)
+			{
+				m_re[i] = m_input[i] * m_window[i];
+			}
+			memset(m_im, 0, m_fftSize * sizeof(float));
+			m_fft->Forward(m_re, m_im);
+
+			// For the first moments the noise is taken as the average of what is heard, so that suppression starts at
+			// once rather than after the minimum has crept up to the noise.
+			bool startup = m_frames < m_startup;
+			m_frames++;
+			for(int k = 0; k < m_bins; k++)
+			{
+				float power = m_re[k] * m_re[k] + m_im[k] * m_im[k];
+				m_smoothed[k] += SmoothingRate * (power - m_smoothed[k]);
+				if(startup)
+				{
+					m_noise[k] += (power - m_noise[k]) / m_frames;
+				}
+				else if(m_smoothed[k] * NoiseBias < m_noise[k])
+				{
+					m_noise[k] = m_smoothed[k] * NoiseBias;
+				}
+				else
+				{
+					m_noise[k] *= m_rise;
+				}
+
+				float noise = m_noise[k] + 1.0f;
+				float posteriori = power / noise;
+				float priori = PrioriWeight * m_clean[k] / noise + (1.0f - PrioriWeight) * (posteriori > 1.0f ? posteriori - 1.0f : 0.0f);
+				float gain = priori / (1.0f + priori);
+				gain = gain < m_floor ? m_floor : gain;
+				m_clean[k] = gain * gain * power;
+				m_re[k] *= gain;
+				m_im[k] *= gain;
+			}
+
+			// The upper half of the spectrum mirrors the lower half, as the signal is real.
+			for(int k = 1; k < n; k++)
+			{
+				m_re[m_fftSize - k] = m_re[k];
+				m_im[m_fftSize - k] = -m_im[k];
+			}
+			m_fft->Inverse(m_re, m_im);
+
+			for(int i = 0; i < n; i++)
+			{
+				samples[i] = ToPcm16(m_overlap[i] + m_re[i] * m_window[i]);
+				m_overlap[i] = m_re[n + i] * m_window[n + i];
+			}
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// Suppresses steady background noise in 16-bit mono speech. Each block is analysed together with the one before it
+// under a square-root Hann window, and the same window is applied again on synthesis, so that the half-overlapping
+// frames add back up to the input. The noise spectrum follows the minimum of the smoothed power in each bin: it drops
+// at once but rises only slowly, so that speech, which comes and goes, does not lift it. Each bin is then scaled by a
+// Wiener gain from a decision-directed estimate of its signal-to-noise ratio, which avoids most of the musical noise
+// of plain spectral subtraction, and no gain falls below the floor set by the suppression level.
+//
+// The output lags the input by one block. The work for a block is the same whatever it holds: two FFTs and a few
+// passes over the bins.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class Fft;
+
+		class SpectralSuppressor
+		{
+		private:
+			int m_block;
+			int m_fftSize;
+			int m_bins;
+			int m_startup;
+			Fft *m_fft;
+			float *m_window;
+			float *m_input;
+			float *m_overlap;
+			float *m_re;
+			float *m_im;
+			float *m_smoothed;
+			float *m_noise;
+			float *m_clean;
+			float m_rise;
+			float m_floor;
+			float m_suppression;
+			int m_frames;
+
+		public:
+			// The block size must be a power of two of at least 32 samples.
+			SpectralSuppressor(int sampleRate, int blockSize);
+			~SpectralSuppressor();
+
+			// Suppresses the noise in place. The count must be a multiple of the block size.
+			void Process(short *samples, int count);
+
+			// Forgets the noise, as at the start of a new stream.
+			void Reset();
+
+			// The most that any part of the spectrum is attenuated, in dB.
+			float Suppression() const
+			{
+				return m_suppression;
+			}
+			void SetSuppression(float suppression);
+
+			// The level of the estimated noise, in dB relative to full scale.
+			float NoiseLevel() const;
+
+			int BlockSize() const
+			{
+				return m_block;
+			}
+
+		private:
+			void ProcessBlock(short *samples);
+			SpectralSuppressor(const SpectralSuppressor&);
+			SpectralSuppressor &operator=(const SpectralSuppressor&);
+		};
+	}
+}
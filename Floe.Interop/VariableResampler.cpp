@@ -0,0 +1,150 @@
+#include <math.h>
+#include <string.h>
+#include "VariableResampler.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		static const double Pi = 3.14159265358979323846;
+		static const double Beta = 8.0;
+
+		// The zeroth-order modified Bessel function of the first kind, for the Kaiser window.
+		static double BesselI0(double x)
+		{
+			double sum = 1.0, term = 1.0;
+			for(int k = 1; k < 50 && term > sum * 1e-12; k++)
+			{
+				double t = x / (2.0 * k);
+				term *= t * t;
+				sum += term;
+			}
+			return sum;
+		}
+
+		static inline short ToPcm16(float value)
+		{
+			if(value >= 32767.0f)
+			{
+				return 32767;
+			}
+			if(value <= -32768.0f)
+			{
+				return -32768;
+			}
+			return (short)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+		}
+
+		VariableResampler::VariableResampler(int maxCount)
+		{
+			// Row p is the filter for an output p/Phases of the way from one input sample to the next, in the order of
+			// the input window, scaled to unit gain at DC. There is one row more than there are phases, so that the last
+			// phase has a neighbour to be interpolated with.
+			m_table = new float[(Phases + 1) * Taps];
+			double half = Taps / 2.0;
+			double i0Beta = BesselI0(Beta);
+			for(int p = 0; p <= Phases; p++)
+			{
+				float *row = m_table + p * Taps;
+				double sum = 0.0;
+				for(int j = 0; j < Taps; j++)
+				{
+					double t = (double)p / Phases + half - 1.0 - j;
+					double x = t / half;
+					double window = x * x < 1.0 ? BesselI0(Beta * sqrt(1.0 - x * x)) / i0Beta : 0.0;
+					double value = t != 0.0 ? sin(Pi * t) / (Pi * t) * window : 1.0;
+					row[j] = (float)value;
+					sum += value;
+				}
+				for(int j = 0; j < Taps; j++)
+				{
+					row[j] = (float)(row[j] / sum);
+				}
+			}
+
+			// Room for what a read at the largest ratio leaves over, plus a whole write.
+			m_capacity = maxCount * 3 + Taps;
+			m_buffer = new short[m_capacity];
+			this->Reset();
+		}
+
+		VariableResampler::~VariableResampler()
+		{
+			delete[] m_table;
+			delete[] m_buffer;
+		}
+
+		void VariableResampler::Reset()
+		{
+			// The filter looks back half its length less one and ahead half its length, so the stream starts after a
+			// filter's length of silence. Were the look-ahead left to the stream, the first read would take a whole packet
+			// more than it plays, and the corrector would hold that packet back from the jitter buffer for good.
+			m_index = Taps / 2 - 1;
+			m_length = Taps;
+			memset(m_buffer, 0, m_length * sizeof(short));
+			m_fraction = 0.0;
+		}
+
+		int VariableResampler::Needed(int count, double ratio) const
+		{
+			// The last output sample lies between index and index + 1, and the filter reaches half its length past it.
+			double last = m_fraction + (count - 1) * ratio;
+			int needed = m_index + (int)floor(last) + Taps / 2 + 1 - m_length;
+			return needed > 0 ? needed : 0;
+		}
+
+		bool VariableResampler::Write(const short *samples, int count)
+		{
+			if(m_length + count > m_capacity)
+			{
+				return false;
+			}
+			memcpy(m_buffer + m_length, samples, count * sizeof(short));
+			m_length += count;
+			return true;
+		}
+
+		short *VariableResampler::BeginWrite(int count)
+		{
+			return m_length + count <= m_capacity ? m_buffer + m_length : 0;
+		}
+
+		void VariableResampler::EndWrite(int count)
+		{
+			m_length += count;
+		}
+
+		int VariableResampler::Read(short *samples, int count, double ratio)
+		{
+			int written = 0;
+			while(written < count && m_index + Taps / 2 < m_length)
+			{
+				const short *x = m_buffer + m_index - (Taps / 2 - 1);
+				double position = m_fraction * Phases;
+				int phase = (int)position;
+				float a = (float)(position - phase);
+				const float *row = m_table + phase * Taps;
+				const float *next = row + Taps;
+				float sum = 0.0f, sumNext = 0.0f;
+				for(int j = 0; j < Taps; j++)
+				{
+					sum += row[j] * x[j];
+					sumNext += next[j] * x[j];
+				}
+				samples[written++] = ToPcm16(sum + a * (sumNext - sum));
+
+				m_fraction += ratio;
+				int step = (int)floor(m_fraction);
+				m_index += step;
+				m_fraction -= step;
+			}
+
+			// Only the samples that the filter looks back over are needed again.
+			int keep = m_length - (m_index - (Taps / 2 - 1));
+			memmove(m_buffer, m_buffer + m_length - keep, keep * sizeof(short));
+			m_index -= m_length - keep;
+			m_length = keep;
+			return written;
+		}
+	}
+}
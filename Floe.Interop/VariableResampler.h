@@ -0,0 +1,55 @@
+#pragma once
+
+// Resamples 16-bit mono audio by a ratio that stays within a fraction of a percent of one and may change from call to
+// call, to make up for the difference between two clocks that should run at the same rate. Each output sample is the
+// dot product of the input around its position with a short Kaiser-windowed sinc for the fraction of the way it lies
+// between two input samples, interpolated from a table of such filters. As the ratio is so close to one, no filtering
+// against aliasing is needed, and the sinc is cut off at the Nyquist frequency; on a whole sample it is a single tap,
+// so at a ratio of exactly one the input comes through unchanged.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class VariableResampler
+		{
+		private:
+			static const int Taps = 16;
+			static const int Phases = 64;
+
+			float *m_table;
+			short *m_buffer;
+			int m_capacity;
+			int m_length;
+			int m_index;
+			double m_fraction;
+
+		public:
+			// Up to maxCount samples may be written or read at a time.
+			VariableResampler(int maxCount);
+			~VariableResampler();
+
+			// The number of input samples still needed before count samples can be read at the given ratio of input
+			// samples to output samples.
+			int Needed(int count, double ratio) const;
+
+			// Appends input samples. Returns false if they do not fit.
+			bool Write(const short *samples, int count);
+
+			// Returns where up to count input samples may be decoded in place, or null if they do not fit. They are
+			// appended by EndWrite.
+			short *BeginWrite(int count);
+			void EndWrite(int count);
+
+			// Writes up to count samples, as far as the input allows, and returns the number written.
+			int Read(short *samples, int count, double ratio);
+
+			// Drops all input, as at the start of a new stream.
+			void Reset();
+
+		private:
+			VariableResampler(const VariableResampler&);
+			VariableResampler &operator=(const VariableResampler&);
+		};
+	}
+}
@@ -0,0 +1,41 @@
+#include "Stdafx.h"
+#include "VoiceActivityDetector.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		VoiceActivityDetector::VoiceActivityDetector(int sampleRate)
+		{
+			if(sampleRate < 1000)
+			{
+				throw gcnew System::ArgumentException("Invalid sample rate.");
+			}
+			m_detector = new VoiceDetector(sampleRate);
+		}
+
+		bool VoiceActivityDetector::Process(IntPtr buffer, int count)
+		{
+			return m_detector->Process((const short*)(void*)buffer, count / 2);
+		}
+
+		void VoiceActivityDetector::Reset()
+		{
+			m_detector->Reset();
+		}
+
+		VoiceActivityDetector::~VoiceActivityDetector()
+		{
+			if(m_detector != 0)
+			{
+				delete m_detector;
+				m_detector = 0;
+			}
+		}
+
+		VoiceActivityDetector::!VoiceActivityDetector()
+		{
+			this->~VoiceActivityDetector();
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "VoiceDetector.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// Tells speech from background noise in a stream of 16-bit mono frames.
+		public ref class VoiceActivityDetector
+		{
+		private:
+			VoiceDetector *m_detector;
+
+		public:
+			VoiceActivityDetector(int sampleRate);
+			bool Process(IntPtr buffer, int count);
+			void Reset();
+
+			property bool IsSpeech
+			{
+				bool get()
+				{
+					return m_detector->IsSpeech();
+				}
+			}
+
+			// The energy of the last frame in dB relative to full scale.
+			property float Energy
+			{
+				float get()
+				{
+					return m_detector->Energy();
+				}
+			}
+
+			// The spectral flatness of the last frame in dB.
+			property float Flatness
+			{
+				float get()
+				{
+					return m_detector->Flatness();
+				}
+			}
+
+			// The estimated background noise energy in dB relative to full scale.
+			property float NoiseFloor
+			{
+				float get()
+				{
+					return m_detector->NoiseFloor();
+				}
+			}
+
+		private:
+			~VoiceActivityDetector();
+			!VoiceActivityDetector();
+		};
+	}
+}
@@ -0,0 +1,183 @@
+#include <math.h>
+#include "VoiceDetector.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		static const float SilenceEnergy = -96.0f;
+		static const float MinSpeechEnergy = -60.0f;
+		static const float SpeechMargin = 9.0f;
+		static const float LoudMargin = 18.0f;
+		static const float TonalFlatness = -6.0f;
+		static const float FloorAttack = 0.1f;
+		static const float FloorRelease = 0.002f;
+
+		VoiceDetector::VoiceDetector(int sampleRate)
+		{
+			m_sampleRate = sampleRate;
+			m_re = new float[MaxFftSize];
+			m_im = new float[MaxFftSize];
+			this->Reset();
+		}
+
+		VoiceDetector::~VoiceDetector()
+		{
+			delete[] m_re;
+			delete[] m_im;
+		}
+
+		void VoiceDetector::Reset()
+		{
+			m_hasFloor = false;
+			m_floor = SilenceEnergy;
+			m_hangover = 0;
+			m_energy = SilenceEnergy;
+			m_flatness = 0.0f;
+			m_isSpeech = false;
+		}
+
+		bool VoiceDetector::Process(const short *samples, int count)
+		{
+			if(count < 1)
+			{
+				return m_isSpeech;
+			}
+
+			double sumSquares = 0.0;
+			for(int i = 0; i < count; i++)
+			{
+				sumSquares += (double)samples[i] * samples[i];
+			}
+			double power = sumSquares / count / (32768.0 * 32768.0);
+			m_energy = power > 1e-10 ? (float)(10.0 * log10(power)) : SilenceEnergy;
+
+			if(!m_hasFloor)
+			{
+				m_floor = m_energy;
+				m_hasFloor = true;
+			}
+
+			bool active = false;
+			if(m_energy > MinSpeechEnergy && m_energy > m_floor + SpeechMargin)
+			{
+				m_flatness = this->MeasureFlatness(samples, count);
+				active = m_flatness < TonalFlatness || m_energy > m_floor + LoudMargin;
+			}
+			else
+			{
+				m_flatness = 0.0f;
+			}
+
+			if(active)
+			{
+				m_hangover = m_sampleRate * HangoverMs / 1000;
+			}
+			else
+			{
+				m_hangover -= count;
+			}
+
+			// The floor follows the background quickly outside of speech and drifts up slowly within it, so that it
+			// recovers if the background gets louder while someone is talking.
+			if(m_energy < m_floor)
+			{
+				m_floor = m_energy;
+			}
+			else
+			{
+				m_floor += (m_energy - m_floor) * (active || m_hangover > 0 ? FloorRelease : FloorAttack);
+			}
+			m_isSpeech = active || m_hangover > 0;
+			return m_isSpeech;
+		}
+
+		float VoiceDetector::MeasureFlatness(const short *samples, int count)
+		{
+			int n = MaxFftSize;
+			while(n > count)
+			{
+				n >>= 1;
+			}
+			if(n < 16)
+			{
+				return 0.0f;
+			}
+
+			const double pi = 3.14159265358979323846;
+			for(int i = 0; i < n; i++)
+			{
+				float window = 0.5f - 0.5f * (float)cos(2.0 * pi * i / (n - 1));
+				m_re[i] = samples[i] * window;
+				m_im[i] = 0.0f;
+			}
+			Fft(m_re, m_im, n);
+
+			// Only the speech band counts; above it there is mostly noise whatever is being said.
+			int first = MinFrequency * n / m_sampleRate;
+			int last = MaxFrequency * n / m_sampleRate;
+			first = first < 1 ? 1 : first;
+			last = last > n / 2 - 1 ? n / 2 - 1 : last;
+			if(last <= first)
+			{
+				return 0.0f;
+			}
+
+			double sumLog = 0.0, sum = 0.0;
+			for(int k = first; k <= last; k++)
+			{
+				double p = (double)m_re[k] * m_re[k] + (double)m_im[k] * m_im[k] + 1e-3;
+				sumLog += log(p);
+				sum += p;
+			}
+			int bins = last - first + 1;
+			return (float)(10.0 * (sumLog / bins - log(sum / bins)) / log(10.0));
+		}
+
+		void VoiceDetector::Fft(float *re, float *im, int n)
+		{
+			for(int i = 1, j = 0; i < n; i++)
+			{
+				int bit = n >> 1;
+				for(; j & bit; bit >>= 1)
+				{
+					j ^= bit;
+				}
+				j ^= bit;
+				if(i < j)
+				{
+					float t = re[i];
+					re[i] = re[j];
+					re[j] = t;
+					t = im[i];
+					im[i] = im[j];
+					im[j] = t;
+				}
+			}
+
+			const double pi = 3.14159265358979323846;
+			for(int len = 2; len <= n; len <<= 1)
+			{
+				double angle = -2.0 * pi / len;
+				float wr = (float)cos(angle), wi = (float)sin(angle);
+				for(int i = 0; i < n; i += len)
+				{
+					float cr = 1.0f, ci = 0.0f;
+					for(int k = 0; k < len / 2; k++)
+					{
+						int a = i + k, b = i + k + len / 2;
+						float tr = re[b] * cr - im[b] * ci;
+						float ti = re[b] * ci + im[b] * cr;
+						re[b] = re[a] - tr;
+						im[b] = im[a] - ti;
+						re[a] += tr;
+						im[a] += ti;
+						float nr = cr * wr - ci * wi;
+						ci = cr * wi + ci * wr;
+						cr = nr;
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+// Voice activity detection from two features of each frame: its energy relative to a tracked noise floor and
+// its spectral flatness (the ratio of the geometric to the arithmetic mean of the power spectrum, which is near
+// 0 dB for noise and well below it for voiced speech). Speech needs energy above the floor and either a peaky
+// spectrum or a lot of energy. A hangover keeps the decision on through the short pauses within speech.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class VoiceDetector
+		{
+		private:
+			static const int MaxFftSize = 1024;
+			static const int MinFrequency = 100;
+			static const int MaxFrequency = 4000;
+			static const int HangoverMs = 200;
+
+			int m_sampleRate;
+			float *m_re;
+			float *m_im;
+			bool m_hasFloor;
+			float m_floor;
+			int m_hangover;
+			float m_energy;
+			float m_flatness;
+			bool m_isSpeech;
+
+		public:
+			VoiceDetector(int sampleRate);
+			~VoiceDetector();
+
+			// Classifies a frame of 16-bit mono samples. Returns true while speech is active, including the hangover.
+			bool Process(const short *samples, int count);
+			void Reset();
+
+			// The energy of the last frame in dB relative to full scale.
+			float Energy() const
+			{
+				return m_energy;
+			}
+
+			// The spectral flatness of the last frame in dB.
+			float Flatness() const
+			{
+				return m_flatness;
+			}
+
+			// The estimated background noise energy in dB relative to full scale.
+			float NoiseFloor() const
+			{
+				return m_floor;
+			}
+
+			bool IsSpeech() const
+			{
+				return m_isSpeech;
+			}
+
+		private:
+			float MeasureFlatness(const short *samples, int count);
+			static void Fft(float *re, float *im, int n);
+			VoiceDetector(const VoiceDetector&);
+			VoiceDetector &operator=(const VoiceDetector&);
+		};
+	}
+}
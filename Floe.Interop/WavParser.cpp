@@ -0,0 +1,197 @@
+#include <string.h>
+#include "WavParser.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		static const int ChunkHeaderSize = 8;
+		static const int FormatSize = 16;
+		static const int ExtensibleSize = 40;
+		static const int ExtensibleExtraSize = 22;
+		static const unsigned short FormatPcm = 1;
+		static const unsigned short FormatFloat = 3;
+		static const unsigned short FormatExtensible = 0xfffe;
+
+		// The subformat GUID of WAVE_FORMAT_EXTENSIBLE is an ordinary format tag in the first two bytes followed by these.
+		static const unsigned char SubFormatBase[14] =
+		{
+			0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71
+		};
+
+		static inline unsigned int ReadUInt16(const unsigned char *p)
+		{
+			return p[0] | (p[1] << 8);
+		}
+
+		static inline unsigned int ReadUInt32(const unsigned char *p)
+		{
+			return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+		}
+
+		static inline bool IsChunkId(const unsigned char *p)
+		{
+			for(int i = 0; i < 4; i++)
+			{
+				if(p[i] < 0x20 || p[i] > 0x7e)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		WavParser::WavParser()
+		{
+			m_samples = 0;
+			m_frames = 0;
+			m_format = SampleInt16;
+			m_channels = 0;
+			m_sampleRate = 0;
+			m_bitsPerSample = 0;
+			m_frameSize = 0;
+			m_channelMask = 0;
+			memset(m_waveFormat, 0, sizeof(m_waveFormat));
+			m_waveFormatSize = 0;
+		}
+
+		WavParser::Result WavParser::Parse(const unsigned char *data, long long size)
+		{
+			if(size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0)
+			{
+				return ResultNotWave;
+			}
+
+			bool haveFormat = false;
+			const unsigned char *samples = 0;
+			long long dataSize = 0;
+			long long pos = 12;
+			while(pos + ChunkHeaderSize <= size && (!haveFormat || samples == 0))
+			{
+				const unsigned char *header = data + pos;
+				unsigned int chunkSize = ReadUInt32(header + 4);
+				long long available = size - pos - ChunkHeaderSize;
+				if(memcmp(header, "fmt ", 4) == 0 && !haveFormat)
+				{
+					if(chunkSize > available)
+					{
+						return ResultNoFormat;
+					}
+					Result result = this->ParseFormat(header + ChunkHeaderSize, chunkSize);
+					if(result != ResultOk)
+					{
+						return result;
+					}
+					haveFormat = true;
+				}
+				else if(memcmp(header, "data", 4) == 0 && samples == 0)
+				{
+					samples = header + ChunkHeaderSize;
+					dataSize = chunkSize < available ? chunkSize : available;
+				}
+
+				pos += ChunkHeaderSize + (long long)chunkSize;
+				if((chunkSize & 1) != 0)
+				{
+					pos++;
+					if(pos + 4 <= size && !IsChunkId(data + pos) && IsChunkId(data + pos - 1))
+					{
+						pos--;
+					}
+				}
+			}
+
+			if(!haveFormat)
+			{
+				return ResultNoFormat;
+			}
+			if(samples == 0)
+			{
+				return ResultNoData;
+			}
+			m_samples = samples;
+			m_frames = dataSize / m_frameSize;
+			return ResultOk;
+		}
+
+		WavParser::Result WavParser::ParseFormat(const unsigned char *chunk, unsigned int size)
+		{
+			if(size < FormatSize)
+			{
+				return ResultNoFormat;
+			}
+			unsigned int tag = ReadUInt16(chunk);
+			int channels = ReadUInt16(chunk + 2);
+			int sampleRate = (int)ReadUInt32(chunk + 4);
+			int blockAlign = ReadUInt16(chunk + 12);
+			int bits = ReadUInt16(chunk + 14);
+			unsigned int extra = 0;
+			if(size >= FormatSize + 2)
+			{
+				extra = ReadUInt16(chunk + 16);
+				if(extra > size - (FormatSize + 2))
+				{
+					extra = size - (FormatSize + 2);
+				}
+			}
+
+			unsigned int mask = 0;
+			if(tag == FormatExtensible)
+			{
+				if(size < ExtensibleSize || extra < ExtensibleExtraSize ||
+					memcmp(chunk + 26, SubFormatBase, sizeof(SubFormatBase)) != 0)
+				{
+					return ResultUnsupported;
+				}
+				int validBits = ReadUInt16(chunk + 18);
+				mask = ReadUInt32(chunk + 20);
+				tag = ReadUInt16(chunk + 24);
+				if(validBits > 0 && validBits < bits)
+				{
+					bits = validBits;
+				}
+				extra = ExtensibleExtraSize;
+			}
+			else if(extra > MaxFormatSize - (FormatSize + 2))
+			{
+				extra = MaxFormatSize - (FormatSize + 2);
+			}
+
+			// The size of each sample is taken from the block alignment, since the bits per sample may only count those
+			// that hold audio, as in 20-bit samples stored in three bytes.
+			if(channels < 1 || channels > MaxChannels || sampleRate <= 0 || blockAlign % channels != 0)
+			{
+				return ResultUnsupported;
+			}
+			int sampleSize = blockAlign / channels;
+			SampleFormat format;
+			if(tag == FormatPcm && sampleSize >= 1 && sampleSize <= 4)
+			{
+				static const SampleFormat IntegerFormats[4] = { SampleUInt8, SampleInt16, SampleInt24, SampleInt32 };
+				format = IntegerFormats[sampleSize - 1];
+			}
+			else if(tag == FormatFloat && (sampleSize == 4 || sampleSize == 8))
+			{
+				format = sampleSize == 4 ? SampleFloat32 : SampleFloat64;
+			}
+			else
+			{
+				return ResultUnsupported;
+			}
+
+			m_format = format;
+			m_channels = channels;
+			m_sampleRate = sampleRate;
+			m_bitsPerSample = bits > 0 && bits <= sampleSize * 8 ? bits : sampleSize * 8;
+			m_frameSize = blockAlign;
+			m_channelMask = mask;
+
+			m_waveFormatSize = FormatSize + 2 + extra;
+			memset(m_waveFormat, 0, sizeof(m_waveFormat));
+			memcpy(m_waveFormat, chunk, size < (unsigned int)m_waveFormatSize ? size : m_waveFormatSize);
+			m_waveFormat[16] = (unsigned char)extra;
+			m_waveFormat[17] = (unsigned char)(extra >> 8);
+			return ResultOk;
+		}
+	}
+}
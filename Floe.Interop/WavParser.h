@@ -0,0 +1,121 @@
+#pragma once
+
+// Finds the format and the samples of a RIFF WAVE file in a buffer, such as a mapped file. Samples are not copied out:
+// the parser hands back pointers into the buffer, which the caller converts as it reads them.
+//
+// Chunks are walked by their sizes, with the pad byte that follows a chunk of odd size. Some writers leave the pad byte
+// out, so if the next chunk ID only makes sense one byte earlier, it is taken from there. The RIFF size is not trusted,
+// and neither is the size of the data chunk, which a file that was cut short or written as a stream often overstates;
+// both are clipped to the buffer. The format may be WAVEFORMATEX or WAVE_FORMAT_EXTENSIBLE with a PCM or IEEE float
+// subformat, in 8, 16, 24 or 32-bit integer samples or 32 or 64-bit float samples.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class WavParser
+		{
+		public:
+			enum SampleFormat
+			{
+				SampleUInt8,
+				SampleInt16,
+				SampleInt24,
+				SampleInt32,
+				SampleFloat32,
+				SampleFloat64
+			};
+
+			enum Result
+			{
+				ResultOk,
+				ResultNotWave,
+				ResultNoFormat,
+				ResultUnsupported,
+				ResultNoData
+			};
+
+			// Large enough for WAVE_FORMAT_EXTENSIBLE, which is the largest format that is supported.
+			static const int MaxFormatSize = 40;
+			static const int MaxChannels = 32;
+
+		private:
+			const unsigned char *m_samples;
+			long long m_frames;
+			SampleFormat m_format;
+			int m_channels;
+			int m_sampleRate;
+			int m_bitsPerSample;
+			int m_frameSize;
+			unsigned int m_channelMask;
+			unsigned char m_waveFormat[MaxFormatSize];
+			int m_waveFormatSize;
+
+		public:
+			WavParser();
+
+			// Finds the format and the data chunk in the buffer, which must stay valid while the parser is used.
+			Result Parse(const unsigned char *data, long long size);
+
+			// The samples of the given frame and those after it, in the file's own format.
+			const unsigned char *Frames(long long frame) const
+			{
+				return m_samples + frame * m_frameSize;
+			}
+
+			long long FrameCount() const
+			{
+				return m_frames;
+			}
+
+			SampleFormat Format() const
+			{
+				return m_format;
+			}
+
+			int Channels() const
+			{
+				return m_channels;
+			}
+
+			int SampleRate() const
+			{
+				return m_sampleRate;
+			}
+
+			// The number of bits in each sample that hold audio, which may be fewer than the sample's size.
+			int BitsPerSample() const
+			{
+				return m_bitsPerSample;
+			}
+
+			int FrameSize() const
+			{
+				return m_frameSize;
+			}
+
+			// The speaker positions of the channels, or zero if the file does not give them.
+			unsigned int ChannelMask() const
+			{
+				return m_channelMask;
+			}
+
+			// The format as a WAVEFORMATEX followed by its extra bytes, with cbSize set to the number of extra bytes that
+			// the file actually holds.
+			const void *WaveFormat() const
+			{
+				return m_waveFormat;
+			}
+
+			int WaveFormatSize() const
+			{
+				return m_waveFormatSize;
+			}
+
+		private:
+			Result ParseFormat(const unsigned char *chunk, unsigned int size);
+			WavParser(const WavParser&);
+			WavParser &operator=(const WavParser&);
+		};
+	}
+}
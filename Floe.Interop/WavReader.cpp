@@ -0,0 +1,224 @@
+#include "Stdafx.h"
+#include <string.h>
+#include <vcclr.h>
+#include "WavReader.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using namespace System::Runtime::InteropServices;
+		using System::Byte;
+		using System::Threading::Monitor;
+
+		WavReader::WavReader(String ^fileName)
+		{
+			if(fileName == nullptr)
+			{
+				throw gcnew System::ArgumentNullException("fileName");
+			}
+			m_file = new MappedFile();
+			pin_ptr<const wchar_t> name = PtrToStringChars(fileName);
+			DWORD error = m_file->Open(name);
+			if(error != 0)
+			{
+				delete m_file;
+				m_file = 0;
+				Marshal::ThrowExceptionForHR(HRESULT_FROM_WIN32(error));
+			}
+			this->Init(m_file->Data(), m_file->Size());
+		}
+
+		WavReader::WavReader(Stream ^stream)
+		{
+			if(stream == nullptr)
+			{
+				throw gcnew System::ArgumentNullException("stream");
+			}
+
+			long long capacity = stream->CanSeek ? stream->Length - stream->Position : BlockSize;
+			if(capacity > System::Int32::MaxValue)
+			{
+				throw gcnew InteropException("The stream is too large.");
+			}
+			m_data = new unsigned char[capacity > 0 ? (int)capacity : 1];
+			long long size = 0;
+			array<Byte> ^block = gcnew array<Byte>(BlockSize);
+			int count;
+			while((count = stream->Read(block, 0, BlockSize)) > 0)
+			{
+				if(size + count > capacity)
+				{
+					long long newCapacity = capacity * 2 > size + count ? capacity * 2 : size + count;
+					if(newCapacity > System::Int32::MaxValue)
+					{
+						throw gcnew InteropException("The stream is too large.");
+					}
+					unsigned char *data = new unsigned char[(int)newCapacity];
+					memcpy(data, m_data, (size_t)size);
+					delete[] m_data;
+					m_data = data;
+					capacity = newCapacity;
+				}
+				Marshal::Copy(block, 0, IntPtr(m_data + size), count);
+				size += count;
+			}
+
+			this->Init(m_data, size);
+		}
+
+		void WavReader::Init(const unsigned char *data, long long size)
+		{
+			m_sync = gcnew System::Object();
+			m_parser = new WavParser();
+			switch(m_parser->Parse(data, size))
+			{
+			case WavParser::ResultNotWave:
+				throw gcnew InteropException("Badly formed RIFF file.");
+			case WavParser::ResultNoFormat:
+				throw gcnew InteropException("Could not find the wave format.");
+			case WavParser::ResultUnsupported:
+				throw gcnew InteropException("Unsupported wave format.");
+			case WavParser::ResultNoData:
+				throw gcnew InteropException("Could not find wave data.");
+			}
+			if(m_parser->SampleRate() < MinSampleRate || m_parser->SampleRate() > MaxSampleRate)
+			{
+				throw gcnew InteropException("Unsupported sample rate.");
+			}
+			m_sourceFormat = gcnew WaveFormat((WAVEFORMATEX*)m_parser->WaveFormat());
+			m_frame = 0;
+			this->SetOutputFormat(m_parser->SampleRate(), m_parser->Channels() < 2 ? 1 : 2, ResamplerQuality::Medium);
+		}
+
+		void WavReader::SetOutputFormat(int sampleRate, int channels, ResamplerQuality quality)
+		{
+			if(sampleRate < MinSampleRate || sampleRate > MaxSampleRate)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("sampleRate");
+			}
+			if(channels < 1 || channels > 2)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("channels");
+			}
+
+			PcmConverter *converter = new PcmConverter(m_parser->Format(), m_parser->Channels(), m_parser->SampleRate(),
+				channels, sampleRate, (PolyphaseResampler::Quality)quality);
+			Monitor::Enter(m_sync);
+			try
+			{
+				delete m_converter;
+				m_converter = converter;
+				m_format = gcnew WaveFormatPcm(sampleRate, 16, (short)channels);
+			}
+			finally
+			{
+				Monitor::Exit(m_sync);
+			}
+		}
+
+		int WavReader::Read(IntPtr buffer, int count)
+		{
+			Monitor::Enter(m_sync);
+			try
+			{
+				int frameSize = m_format->FrameSize;
+				int frames = count / frameSize;
+				if(frames < 1)
+				{
+					throw gcnew System::ArgumentOutOfRangeException("count");
+				}
+
+				// Once the file runs out, further reads flush whatever the converter still holds.
+				short *dst = (short*)(void*)buffer;
+				long long remaining = m_parser->FrameCount() - m_frame;
+				int written = 0;
+				if(remaining > 0)
+				{
+					int used;
+					int available = remaining < System::Int32::MaxValue / m_parser->FrameSize() ?
+						(int)remaining : System::Int32::MaxValue / m_parser->FrameSize();
+					written = m_converter->Convert(m_parser->Frames(m_frame), available, &used, dst, frames);
+					m_frame += used;
+				}
+				if(written < frames && m_frame >= m_parser->FrameCount())
+				{
+					int used;
+					written += m_converter->Convert(0, 0, &used, dst + written * m_format->Channels, frames - written);
+				}
+				return written * frameSize;
+			}
+			finally
+			{
+				Monitor::Exit(m_sync);
+			}
+		}
+
+		int WavReader::GetBufferSize(int milliseconds)
+		{
+			long long frames = (long long)milliseconds * m_format->SampleRate / 1000;
+			return (int)(frames > 1 ? frames : 1) * m_format->FrameSize;
+		}
+
+		IntPtr WavReader::GetFrames(long long frame)
+		{
+			if(frame < 0 || frame > m_parser->FrameCount())
+			{
+				throw gcnew System::ArgumentOutOfRangeException("frame");
+			}
+			return IntPtr((void*)m_parser->Frames(frame));
+		}
+
+		void WavReader::Frame::set(long long value)
+		{
+			if(value < 0 || value > m_parser->FrameCount())
+			{
+				throw gcnew System::ArgumentOutOfRangeException("value");
+			}
+			Monitor::Enter(m_sync);
+			try
+			{
+				m_frame = value;
+				m_converter->Reset();
+			}
+			finally
+			{
+				Monitor::Exit(m_sync);
+			}
+		}
+
+		TimeSpan WavReader::ToTime(long long frame)
+		{
+			return TimeSpan::FromTicks(frame * TimeSpan::TicksPerSecond / m_parser->SampleRate());
+		}
+
+		WavReader::~WavReader()
+		{
+			if(m_converter != 0)
+			{
+				delete m_converter;
+				m_converter = 0;
+			}
+			if(m_parser != 0)
+			{
+				delete m_parser;
+				m_parser = 0;
+			}
+			if(m_file != 0)
+			{
+				delete m_file;
+				m_file = 0;
+			}
+			if(m_data != 0)
+			{
+				delete[] m_data;
+				m_data = 0;
+			}
+		}
+
+		WavReader::!WavReader()
+		{
+			this->~WavReader();
+		}
+	}
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include "Stdafx.h"
+#include "Common.h"
+#include "MappedFile.h"
+#include "WavParser.h"
+#include "PcmConverter.h"
+#include "SampleRateConverter.h"
+#include "WaveSource.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using namespace System::IO;
+		using System::IntPtr;
+		using System::String;
+		using System::TimeSpan;
+
+		// Reads a WAV file for playback as 16-bit PCM. The file is mapped into memory, and its samples are converted
+		// straight from the mapping into the device's buffer, in whatever format and at whatever rate the output was
+		// opened with, so that files in formats the device cannot play (float, 24-bit, WAVE_FORMAT_EXTENSIBLE or more
+		// than two channels) play all the same.
+		public ref class WavReader : IWaveSource
+		{
+		private:
+			static const int BlockSize = 1 << 20;
+			static const int MinSampleRate = 1000;
+			static const int MaxSampleRate = 768000;
+
+			MappedFile *m_file;
+			unsigned char *m_data;
+			WavParser *m_parser;
+			PcmConverter *m_converter;
+			WaveFormat ^m_sourceFormat;
+			WaveFormatPcm ^m_format;
+			long long m_frame;
+			System::Object ^m_sync;
+
+		public:
+			// Maps the file. Reads are at the file's own rate, with up to two channels.
+			WavReader(String ^fileName);
+
+			// Reads the rest of the stream into memory, a large block at a time, for streams that are not files.
+			WavReader(Stream ^stream);
+
+			// Changes the format that reads are converted to, from the current position on.
+			void SetOutputFormat(int sampleRate, int channels, ResamplerQuality quality);
+
+			// Converts as many whole frames as fit, and returns the number of bytes written, or zero at the end of the
+			// file.
+			virtual int Read(IntPtr buffer, int count);
+
+			// Returns a buffer size that holds the given length of audio in the output format.
+			int GetBufferSize(int milliseconds);
+
+			// Returns the samples of the given frame and those after it, in the source format, without copying them.
+			// The pointer is valid until the reader is disposed.
+			IntPtr GetFrames(long long frame);
+
+			// The format that reads are converted to.
+			property WaveFormatPcm ^Format
+			{
+				WaveFormatPcm ^get()
+				{
+					return m_format;
+				}
+			}
+
+			// The format of the file.
+			property WaveFormat ^SourceFormat
+			{
+				WaveFormat ^get()
+				{
+					return m_sourceFormat;
+				}
+			}
+
+			// The number of bits in each sample of the file that hold audio.
+			property int BitsPerSample
+			{
+				int get()
+				{
+					return m_parser->BitsPerSample();
+				}
+			}
+
+			property bool IsFloat
+			{
+				bool get()
+				{
+					return m_parser->Format() == WavParser::SampleFloat32 || m_parser->Format() == WavParser::SampleFloat64;
+				}
+			}
+
+			// The number of frames in the file.
+			property long long Frames
+			{
+				long long get()
+				{
+					return m_parser->FrameCount();
+				}
+			}
+
+			// The next frame of the file to be read. Setting it seeks, and takes effect at the next read.
+			property long long Frame
+			{
+				long long get()
+				{
+					return m_frame;
+				}
+				void set(long long value);
+			}
+
+			property TimeSpan Duration
+			{
+				TimeSpan get()
+				{
+					return this->ToTime(m_parser->FrameCount());
+				}
+			}
+
+			// The time of the next frame of the file to be read. Setting it seeks.
+			property TimeSpan Position
+			{
+				TimeSpan get()
+				{
+					return this->ToTime(m_frame);
+				}
+				void set(TimeSpan value)
+				{
+					long long frame = (long long)(value.TotalSeconds * m_parser->SampleRate());
+					this->Frame = frame < 0 ? 0 : frame > m_parser->FrameCount() ? m_parser->FrameCount() : frame;
+				}
+			}
+
+		private:
+			void Init(const unsigned char *data, long long size);
+			TimeSpan ToTime(long long frame);
+			~WavReader();
+			!WavReader();
+		};
+	}
+}
@@ -0,0 +1,160 @@
+#include <Windows.h>
+#include <MMSystem.h>
+#include "WaveDevice.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		MMRESULT MmeWaveOutDevice::Open(const WAVEFORMATEX *format, HANDLE doneEvent)
+		{
+			return waveOutOpen(&m_handle, WAVE_MAPPER, format, (DWORD_PTR)doneEvent, 0, CALLBACK_EVENT);
+		}
+
+		MMRESULT MmeWaveOutDevice::Prepare(WAVEHDR *hdr)
+		{
+			return waveOutPrepareHeader(m_handle, hdr, sizeof(WAVEHDR));
+		}
+
+		MMRESULT MmeWaveOutDevice::Unprepare(WAVEHDR *hdr)
+		{
+			return waveOutUnprepareHeader(m_handle, hdr, sizeof(WAVEHDR));
+		}
+
+		MMRESULT MmeWaveOutDevice::Write(WAVEHDR *hdr)
+		{
+			return waveOutWrite(m_handle, hdr, sizeof(WAVEHDR));
+		}
+
+		void MmeWaveOutDevice::Pause()
+		{
+			waveOutPause(m_handle);
+		}
+
+		void MmeWaveOutDevice::Restart()
+		{
+			waveOutRestart(m_handle);
+		}
+
+		void MmeWaveOutDevice::Reset()
+		{
+			waveOutReset(m_handle);
+		}
+
+		void MmeWaveOutDevice::Close()
+		{
+			waveOutClose(m_handle);
+			m_handle = 0;
+		}
+
+		DWORD MmeWaveOutDevice::GetVolume()
+		{
+			DWORD vol = 0;
+			waveOutGetVolume(m_handle, &vol);
+			return vol;
+		}
+
+		void MmeWaveOutDevice::SetVolume(DWORD volume)
+		{
+			waveOutSetVolume(m_handle, volume);
+		}
+
+		MMRESULT MmeWaveInDevice::Open(const WAVEFORMATEX *format, HANDLE doneEvent)
+		{
+			return waveInOpen(&m_handle, WAVE_MAPPER, format, (DWORD_PTR)doneEvent, 0, CALLBACK_EVENT);
+		}
+
+		MMRESULT MmeWaveInDevice::Prepare(WAVEHDR *hdr)
+		{
+			return waveInPrepareHeader(m_handle, hdr, sizeof(WAVEHDR));
+		}
+
+		MMRESULT MmeWaveInDevice::Unprepare(WAVEHDR *hdr)
+		{
+			return waveInUnprepareHeader(m_handle, hdr, sizeof(WAVEHDR));
+		}
+
+		MMRESULT MmeWaveInDevice::AddBuffer(WAVEHDR *hdr)
+		{
+			return waveInAddBuffer(m_handle, hdr, sizeof(WAVEHDR));
+		}
+
+		void MmeWaveInDevice::Start()
+		{
+			waveInStart(m_handle);
+		}
+
+		void MmeWaveInDevice::Stop()
+		{
+			waveInStop(m_handle);
+		}
+
+		void MmeWaveInDevice::Reset()
+		{
+			waveInReset(m_handle);
+		}
+
+		void MmeWaveInDevice::Close()
+		{
+			waveInClose(m_handle);
+			m_handle = 0;
+		}
+
+		// The null devices mimic the event callback protocol of the real ones: the event is signaled once on open
+		// and again whenever a buffer is done.
+
+		MMRESULT NullWaveOutDevice::Open(const WAVEFORMATEX *format, HANDLE doneEvent)
+		{
+			m_event = doneEvent;
+			SetEvent(m_event);
+			return MMSYSERR_NOERROR;
+		}
+
+		MMRESULT NullWaveOutDevice::Prepare(WAVEHDR *hdr)
+		{
+			hdr->dwFlags |= WHDR_PREPARED;
+			return MMSYSERR_NOERROR;
+		}
+
+		MMRESULT NullWaveOutDevice::Unprepare(WAVEHDR *hdr)
+		{
+			hdr->dwFlags &= ~WHDR_PREPARED;
+			return MMSYSERR_NOERROR;
+		}
+
+		MMRESULT NullWaveOutDevice::Write(WAVEHDR *hdr)
+		{
+			hdr->dwFlags = (hdr->dwFlags & ~WHDR_INQUEUE) | WHDR_DONE;
+			SetEvent(m_event);
+			return MMSYSERR_NOERROR;
+		}
+
+		MMRESULT NullWaveInDevice::Open(const WAVEFORMATEX *format, HANDLE doneEvent)
+		{
+			m_event = doneEvent;
+			SetEvent(m_event);
+			return MMSYSERR_NOERROR;
+		}
+
+		MMRESULT NullWaveInDevice::Prepare(WAVEHDR *hdr)
+		{
+			hdr->dwFlags |= WHDR_PREPARED;
+			return MMSYSERR_NOERROR;
+		}
+
+		MMRESULT NullWaveInDevice::Unprepare(WAVEHDR *hdr)
+		{
+			hdr->dwFlags &= ~WHDR_PREPARED;
+			return MMSYSERR_NOERROR;
+		}
+
+		MMRESULT NullWaveInDevice::AddBuffer(WAVEHDR *hdr)
+		{
+			memset(hdr->lpData, 0, hdr->dwBufferLength);
+			hdr->dwBytesRecorded = hdr->dwBufferLength;
+			hdr->dwFlags = (hdr->dwFlags & ~WHDR_INQUEUE) | WHDR_DONE;
+			SetEvent(m_event);
+			return MMSYSERR_NOERROR;
+		}
+	}
+}
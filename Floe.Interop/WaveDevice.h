@@ -0,0 +1,124 @@
+#pragma once
+
+// Thin abstractions over the waveIn/waveOut APIs so that the WaveIn and WaveOut buffer loops can run against
+// something other than a sound card. The null devices complete every buffer immediately (silence for capture),
+// which lets the loops run headless and as fast as their consumers allow.
+
+namespace Floe
+{
+	namespace Interop
+	{
+		class WaveOutDevice
+		{
+		public:
+			virtual ~WaveOutDevice() {}
+			virtual MMRESULT Open(const WAVEFORMATEX *format, HANDLE doneEvent) = 0;
+			virtual MMRESULT Prepare(WAVEHDR *hdr) = 0;
+			virtual MMRESULT Unprepare(WAVEHDR *hdr) = 0;
+			virtual MMRESULT Write(WAVEHDR *hdr) = 0;
+			virtual void Pause() = 0;
+			virtual void Restart() = 0;
+			virtual void Reset() = 0;
+			virtual void Close() = 0;
+			virtual DWORD GetVolume() = 0;
+			virtual void SetVolume(DWORD volume) = 0;
+
+			// Whether buffers are played in real time. One that is not hands every buffer back as soon as it is written,
+			// and so never has anything left queued; it cannot run dry.
+			virtual bool IsRealTime() const { return true; }
+		};
+
+		class WaveInDevice
+		{
+		public:
+			virtual ~WaveInDevice() {}
+			virtual MMRESULT Open(const WAVEFORMATEX *format, HANDLE doneEvent) = 0;
+			virtual MMRESULT Prepare(WAVEHDR *hdr) = 0;
+			virtual MMRESULT Unprepare(WAVEHDR *hdr) = 0;
+			virtual MMRESULT AddBuffer(WAVEHDR *hdr) = 0;
+			virtual void Start() = 0;
+			virtual void Stop() = 0;
+			virtual void Reset() = 0;
+			virtual void Close() = 0;
+
+			// Whether buffers are recorded in real time. One that is not fills every buffer as soon as it is added, and so
+			// never has anything left queued; it cannot overrun.
+			virtual bool IsRealTime() const { return true; }
+		};
+
+		class MmeWaveOutDevice : public WaveOutDevice
+		{
+		private:
+			HWAVEOUT m_handle;
+
+		public:
+			MmeWaveOutDevice() : m_handle(0) {}
+			virtual MMRESULT Open(const WAVEFORMATEX *format, HANDLE doneEvent);
+			virtual MMRESULT Prepare(WAVEHDR *hdr);
+			virtual MMRESULT Unprepare(WAVEHDR *hdr);
+			virtual MMRESULT Write(WAVEHDR *hdr);
+			virtual void Pause();
+			virtual void Restart();
+			virtual void Reset();
+			virtual void Close();
+			virtual DWORD GetVolume();
+			virtual void SetVolume(DWORD volume);
+		};
+
+		class MmeWaveInDevice : public WaveInDevice
+		{
+		private:
+			HWAVEIN m_handle;
+
+		public:
+			MmeWaveInDevice() : m_handle(0) {}
+			virtual MMRESULT Open(const WAVEFORMATEX *format, HANDLE doneEvent);
+			virtual MMRESULT Prepare(WAVEHDR *hdr);
+			virtual MMRESULT Unprepare(WAVEHDR *hdr);
+			virtual MMRESULT AddBuffer(WAVEHDR *hdr);
+			virtual void Start();
+			virtual void Stop();
+			virtual void Reset();
+			virtual void Close();
+		};
+
+		class NullWaveOutDevice : public WaveOutDevice
+		{
+		private:
+			HANDLE m_event;
+			DWORD m_volume;
+
+		public:
+			NullWaveOutDevice() : m_event(0), m_volume(0xffffffff) {}
+			virtual MMRESULT Open(const WAVEFORMATEX *format, HANDLE doneEvent);
+			virtual MMRESULT Prepare(WAVEHDR *hdr);
+			virtual MMRESULT Unprepare(WAVEHDR *hdr);
+			virtual MMRESULT Write(WAVEHDR *hdr);
+			virtual void Pause() {}
+			virtual void Restart() {}
+			virtual void Reset() {}
+			virtual void Close() {}
+			virtual DWORD GetVolume() { return m_volume; }
+			virtual void SetVolume(DWORD volume) { m_volume = volume; }
+			virtual bool IsRealTime() const { return false; }
+		};
+
+		class NullWaveInDevice : public WaveInDevice
+		{
+		private:
+			HANDLE m_event;
+
+		public:
+			NullWaveInDevice() : m_event(0) {}
+			virtual MMRESULT Open(const WAVEFORMATEX *format, HANDLE doneEvent);
+			virtual MMRESULT Prepare(WAVEHDR *hdr);
+			virtual MMRESULT Unprepare(WAVEHDR *hdr);
+			virtual MMRESULT AddBuffer(WAVEHDR *hdr);
+			virtual void Start() {}
+			virtual void Stop() {}
+			virtual void Reset() {}
+			virtual void Close() {}
+			virtual bool IsRealTime() const { return false; }
+		};
+	}
+}
@@ -178,7 +178,7 @@ namespace Floe
 				format.wfx.wFormatTag = WAVE_FORMAT_MPEGLAYER3;
 				format.wfx.nChannels = channels;
 				format.wfx.nSamplesPerSec = sampleRate;
-				format.wfx.nAvgBytesPerSec = bitRate * 8 * sampleRate * channels;
+				format.wfx.nAvgBytesPerSec = bitRate / 8;
 				format.wfx.nBlockAlign = 1;
 				format.wfx.wBitsPerSample = 0;
 				format.wfx.cbSize = MPEGLAYER3_WFX_EXTRA_BYTES;
@@ -7,10 +7,57 @@ namespace Floe
 	{
 		WaveIn::WaveIn(Stream ^stream, WaveFormat ^format, int bufferSize)
 		{
+			this->Initialize(stream, nullptr, format, bufferSize, DefaultBufferCount, WaveDeviceKind::Default);
+		}
+
+		WaveIn::WaveIn(Stream ^stream, WaveFormat ^format, int bufferSize, int bufferCount)
+		{
+			this->Initialize(stream, nullptr, format, bufferSize, bufferCount, WaveDeviceKind::Default);
+		}
+
+		WaveIn::WaveIn(Stream ^stream, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device)
+		{
+			this->Initialize(stream, nullptr, format, bufferSize, bufferCount, device);
+		}
+
+		WaveIn::WaveIn(IWaveSink ^sink, WaveFormat ^format, int bufferSize)
+		{
+			this->Initialize(nullptr, sink, format, bufferSize, DefaultBufferCount, WaveDeviceKind::Default);
+		}
+
+		WaveIn::WaveIn(IWaveSink ^sink, WaveFormat ^format, int bufferSize, int bufferCount)
+		{
+			this->Initialize(nullptr, sink, format, bufferSize, bufferCount, WaveDeviceKind::Default);
+		}
+
+		WaveIn::WaveIn(IWaveSink ^sink, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device)
+		{
+			this->Initialize(nullptr, sink, format, bufferSize, bufferCount, device);
+		}
+
+		void WaveIn::Initialize(Stream ^stream, IWaveSink ^sink, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device)
+		{
+			if(bufferCount < 2)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("bufferCount");
+			}
+
 			m_stream = stream;
+			m_sink = sink;
 			m_format = format;
 			m_bufferSize = bufferSize;
+			m_bufferCount = bufferCount;
 			m_stop = gcnew AutoResetEvent(false);
+			m_overruns = 0;
+			m_bytesCopied = 0;
+			if(device == WaveDeviceKind::Null)
+			{
+				m_device = new NullWaveInDevice();
+			}
+			else
+			{
+				m_device = new MmeWaveInDevice();
+			}
 		}
 
 		void WaveIn::Start()
@@ -23,12 +70,12 @@ namespace Floe
 
 		void WaveIn::Pause()
 		{
-			waveInStop(m_wavHandle);
+			m_device->Stop();
 		}
 
 		void WaveIn::Resume()
 		{
-			waveInStart(m_wavHandle);
+			m_device->Start();
 		}
 
 		void WaveIn::Close()
@@ -40,27 +87,27 @@ namespace Floe
 		{
 			using namespace System::Runtime::InteropServices;
 
-			array<System::Byte> ^bytes = gcnew array<System::Byte>(m_bufferSize);
+			array<System::Byte> ^bytes = m_sink == nullptr ? gcnew array<System::Byte>(m_bufferSize) : nullptr;
 			AutoResetEvent ^bufEvent = gcnew AutoResetEvent(false);
 			array<WaitHandle^> ^handles = { m_stop, bufEvent };
-			int bufIdx = 0;
-			HWAVEIN wavHandle;
-			WAVEHDR hdr[2];
-			bool isInitialized = false;
+			WAVEHDR *hdr = new WAVEHDR[m_bufferCount]();
+			int prepared = 0, next = 0;
+			bool isOpen = false, isRecording = false;
 
 			try
 			{
-				ThrowOnFailure(waveInOpen(&wavHandle, WAVE_MAPPER, m_format->Data, (int)bufEvent->Handle, 0, CALLBACK_EVENT));
-				m_wavHandle = wavHandle;
-				for(int i = 0; i < 2; i++)
+				for(int i = 0; i < m_bufferCount; i++)
 				{
 					hdr[i].lpData = (LPSTR)new BYTE[m_bufferSize];
 					hdr[i].dwBufferLength = m_bufferSize;
-					hdr[i].dwFlags = hdr[i].dwBytesRecorded = 0;
-					ThrowOnFailure(waveInPrepareHeader(wavHandle, &hdr[i], sizeof(WAVEHDR)));
 				}
-				isInitialized = true;
-				waveInStart(wavHandle);
+				ThrowOnFailure(m_device->Open(m_format->Data, (HANDLE)bufEvent->Handle.ToPointer()));
+				isOpen = true;
+				for(; prepared < m_bufferCount; prepared++)
+				{
+					ThrowOnFailure(m_device->Prepare(&hdr[prepared]));
+				}
+				m_device->Start();
 
 				while(true)
 				{
@@ -69,19 +116,30 @@ namespace Floe
 					case 0:
 						return;
 					case 1:
-						for(int i = 0; i < 2; i++)
+						// Buffers are filled in the order they were added, so the recorded ones always begin at next.
+						// If even the most recently added buffer is done, the device had nowhere to record.
+						if(isRecording && m_device->IsRealTime() && (hdr[(next + m_bufferCount - 1) % m_bufferCount].dwFlags & WHDR_INQUEUE) == 0)
+						{
+							m_overruns++;
+						}
+
+						for(int n = 0; n < m_bufferCount && (hdr[next].dwFlags & WHDR_INQUEUE) == 0; n++)
 						{
-							if((hdr[i].dwFlags & WHDR_INQUEUE) == 0)
+							int count = hdr[next].dwBytesRecorded;
+							if(count > 0 && m_sink != nullptr)
 							{
-								int count = hdr[i].dwBytesRecorded;
-								if(count > 0)
-								{
-									Marshal::Copy((IntPtr)hdr[i].lpData, bytes, 0, count);
-									m_stream->Write(bytes, 0, count);
-								}
-								ThrowOnFailure(waveInAddBuffer(wavHandle, &hdr[i], sizeof(WAVEHDR)));
+								m_sink->Write((IntPtr)hdr[next].lpData, count);
 							}
+							else if(count > 0)
+							{
+								Marshal::Copy((IntPtr)hdr[next].lpData, bytes, 0, count);
+								Interlocked::Add(m_bytesCopied, count);
+								m_stream->Write(bytes, 0, count);
+							}
+							ThrowOnFailure(m_device->AddBuffer(&hdr[next]));
+							next = (next + 1) % m_bufferCount;
 						}
+						isRecording = true;
 					}
 				}
 			}
@@ -91,16 +149,20 @@ namespace Floe
 			}
 			finally
 			{
-				if(isInitialized)
+				if(isOpen)
 				{
-					waveInReset(wavHandle);
-					for(int i = 0; i < 2; i++)
+					m_device->Reset();
+					for(int i = 0; i < prepared; i++)
 					{
-						waveInUnprepareHeader(wavHandle, &hdr[i], sizeof(WAVEHDR));
-						delete[] (BYTE*)hdr[i].lpData;
+						m_device->Unprepare(&hdr[i]);
 					}
-					waveInClose(wavHandle);
+					m_device->Close();
+				}
+				for(int i = 0; i < m_bufferCount; i++)
+				{
+					delete[] (BYTE*)hdr[i].lpData;
 				}
+				delete[] hdr;
 			}
 		}
 
@@ -112,6 +174,8 @@ namespace Floe
 				m_thread->Join();
 				m_thread = nullptr;
 			}
+			delete m_device;
+			m_device = 0;
 		}
 
 		WaveIn::!WaveIn()
@@ -1,6 +1,8 @@
 #pragma once
 #include "Stdafx.h"
 #include "Common.h"
+#include "WaveDevice.h"
+#include "WaveSink.h"
 
 namespace Floe
 {
@@ -12,22 +14,61 @@ namespace Floe
 		public ref class WaveIn
 		{
 		private:
+			static const int DefaultBufferCount = 2;
+
 			Stream ^m_stream;
+			IWaveSink ^m_sink;
 			WaveFormat ^m_format;
 			Thread ^m_thread;
 			AutoResetEvent ^m_stop;
 			int m_bufferSize;
-			HWAVEIN m_wavHandle;
+			int m_bufferCount;
+			WaveInDevice *m_device;
+			int m_overruns;
+			__int64 m_bytesCopied;
 
 		public:
 			WaveIn(Stream ^stream, WaveFormat ^format, int bufferSize);
+			WaveIn(Stream ^stream, WaveFormat ^format, int bufferSize, int bufferCount);
+			WaveIn(Stream ^stream, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device);
+			WaveIn(IWaveSink ^sink, WaveFormat ^format, int bufferSize);
+			WaveIn(IWaveSink ^sink, WaveFormat ^format, int bufferSize, int bufferCount);
+			WaveIn(IWaveSink ^sink, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device);
 			void Start();
 			void Pause();
 			void Resume();
 			void Close();
 			event System::EventHandler<InteropErrorEventArgs^> ^Error;
 
+			property int BufferCount
+			{
+				int get()
+				{
+					return m_bufferCount;
+				}
+			}
+
+			// The number of times the device filled every queued buffer before one was handed back to it. The null device
+			// never counts any.
+			property int Overruns
+			{
+				int get()
+				{
+					return m_overruns;
+				}
+			}
+
+			// The number of recorded bytes copied out of the device buffers. This stays at zero when recording to a sink.
+			property __int64 BytesCopied
+			{
+				__int64 get()
+				{
+					return Interlocked::Read(m_bytesCopied);
+				}
+			}
+
 		private:
+			void Initialize(Stream ^stream, IWaveSink ^sink, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device);
 			void Loop();
 			~WaveIn();
 			!WaveIn();
@@ -7,11 +7,58 @@ namespace Floe
 	{
 		WaveOut::WaveOut(Stream ^stream, WaveFormat ^format, int bufferSize)
 		{
+			this->Initialize(stream, nullptr, format, bufferSize, DefaultBufferCount, WaveDeviceKind::Default);
+		}
+
+		WaveOut::WaveOut(Stream ^stream, WaveFormat ^format, int bufferSize, int bufferCount)
+		{
+			this->Initialize(stream, nullptr, format, bufferSize, bufferCount, WaveDeviceKind::Default);
+		}
+
+		WaveOut::WaveOut(Stream ^stream, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device)
+		{
+			this->Initialize(stream, nullptr, format, bufferSize, bufferCount, device);
+		}
+
+		WaveOut::WaveOut(IWaveSource ^source, WaveFormat ^format, int bufferSize)
+		{
+			this->Initialize(nullptr, source, format, bufferSize, DefaultBufferCount, WaveDeviceKind::Default);
+		}
+
+		WaveOut::WaveOut(IWaveSource ^source, WaveFormat ^format, int bufferSize, int bufferCount)
+		{
+			this->Initialize(nullptr, source, format, bufferSize, bufferCount, WaveDeviceKind::Default);
+		}
+
+		WaveOut::WaveOut(IWaveSource ^source, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device)
+		{
+			this->Initialize(nullptr, source, format, bufferSize, bufferCount, device);
+		}
+
+		void WaveOut::Initialize(Stream ^stream, IWaveSource ^source, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device)
+		{
+			if(bufferCount < 2)
+			{
+				throw gcnew System::ArgumentOutOfRangeException("bufferCount");
+			}
+
 			m_stream = stream;
+			m_source = source;
 			m_format = format;
 			m_bufferSize = bufferSize;
+			m_bufferCount = bufferCount;
 			m_stop = gcnew AutoResetEvent(false);
 			m_volume = 1.0f;
+			m_underruns = 0;
+			m_bytesCopied = 0;
+			if(device == WaveDeviceKind::Null)
+			{
+				m_device = new NullWaveOutDevice();
+			}
+			else
+			{
+				m_device = new MmeWaveOutDevice();
+			}
 		}
 
 		void WaveOut::Start()
@@ -24,12 +71,12 @@ namespace Floe
 
 		void WaveOut::Pause()
 		{
-			waveOutPause(m_wavHandle);
+			m_device->Pause();
 		}
 
 		void WaveOut::Resume()
 		{
-			waveOutRestart(m_wavHandle);
+			m_device->Restart();
 		}
 
 		void WaveOut::Close()
@@ -41,26 +88,26 @@ namespace Floe
 		{
 			using namespace System::Runtime::InteropServices;
 
-			array<System::Byte> ^bytes = gcnew array<System::Byte>(m_bufferSize);
+			array<System::Byte> ^bytes = m_source == nullptr ? gcnew array<System::Byte>(m_bufferSize) : nullptr;
 			AutoResetEvent ^bufEvent = gcnew AutoResetEvent(false);
 			array<WaitHandle^> ^handles = { m_stop, bufEvent };
-			int bufIdx = 0;
-			HWAVEOUT wavHandle;
-			WAVEHDR hdr[2];
-			bool isInitialized = false;
+			WAVEHDR *hdr = new WAVEHDR[m_bufferCount]();
+			int prepared = 0, next = 0;
+			bool isOpen = false, isPlaying = false, eos = false;
 
 			try
 			{
-				ThrowOnFailure(waveOutOpen(&wavHandle, WAVE_MAPPER, m_format->Data, (int)bufEvent->Handle, 0, CALLBACK_EVENT));
-				m_wavHandle = wavHandle;
-				for(int i = 0; i < 2; i++)
+				for(int i = 0; i < m_bufferCount; i++)
 				{
 					hdr[i].lpData = (LPSTR)new BYTE[m_bufferSize];
 					hdr[i].dwBufferLength = m_bufferSize;
-					hdr[i].dwFlags = 0;
-					ThrowOnFailure(waveOutPrepareHeader(wavHandle, &hdr[i], sizeof(WAVEHDR)));
 				}
-				isInitialized = true;
+				ThrowOnFailure(m_device->Open(m_format->Data, (HANDLE)bufEvent->Handle.ToPointer()));
+				isOpen = true;
+				for(; prepared < m_bufferCount; prepared++)
+				{
+					ThrowOnFailure(m_device->Prepare(&hdr[prepared]));
+				}
 				this->Volume = m_volume;
 
 				while(true)
@@ -70,20 +117,34 @@ namespace Floe
 					case 0:
 						return;
 					case 1:
-						bool eos = true;
-						for(int i = 0; i < 2; i++)
+						// Buffers are returned in the order they were written, so the free ones always begin at next.
+						// If even the most recently written buffer is done, the device ran dry.
+						if(isPlaying && !eos && m_device->IsRealTime() && (hdr[(next + m_bufferCount - 1) % m_bufferCount].dwFlags & WHDR_INQUEUE) == 0)
 						{
-							if((hdr[i].dwFlags & WHDR_INQUEUE) == 0)
+							m_underruns++;
+						}
+
+						eos = true;
+						for(int n = 0; n < m_bufferCount && (hdr[next].dwFlags & WHDR_INQUEUE) == 0; n++)
+						{
+							if(m_source != nullptr)
+							{
+								hdr[next].dwBufferLength = m_source->Read((IntPtr)hdr[next].lpData, m_bufferSize);
+							}
+							else
 							{
-								hdr[i].dwBufferLength = (int)m_stream->Read(bytes, 0, m_bufferSize);
-								Marshal::Copy(bytes, 0, (IntPtr)hdr[i].lpData, hdr[i].dwBufferLength);
-								ThrowOnFailure(waveOutWrite(wavHandle, &hdr[i], sizeof(WAVEHDR)));
-								if(hdr[i].dwBufferLength > 0)
-								{
-									eos = false;
-								}
+								hdr[next].dwBufferLength = (int)m_stream->Read(bytes, 0, m_bufferSize);
+								Marshal::Copy(bytes, 0, (IntPtr)hdr[next].lpData, hdr[next].dwBufferLength);
+								Interlocked::Add(m_bytesCopied, hdr[next].dwBufferLength);
 							}
+							ThrowOnFailure(m_device->Write(&hdr[next]));
+							if(hdr[next].dwBufferLength > 0)
+							{
+								eos = false;
+							}
+							next = (next + 1) % m_bufferCount;
 						}
+						isPlaying = true;
 						if(eos)
 						{
 							this->EndOfStream(this, System::EventArgs::Empty);
@@ -97,16 +158,20 @@ namespace Floe
 			}
 			finally
 			{
-				if(isInitialized)
+				if(isOpen)
 				{
-					waveOutReset(wavHandle);
-					for(int i = 0; i < 2; i++)
+					m_device->Reset();
+					for(int i = 0; i < prepared; i++)
 					{
-						waveOutUnprepareHeader(wavHandle, &hdr[i], sizeof(WAVEHDR));
-						delete[] (BYTE*)hdr[i].lpData;
+						m_device->Unprepare(&hdr[i]);
 					}
-					waveOutClose(wavHandle);
+					m_device->Close();
+				}
+				for(int i = 0; i < m_bufferCount; i++)
+				{
+					delete[] (BYTE*)hdr[i].lpData;
 				}
+				delete[] hdr;
 			}
 		}
 
@@ -118,6 +183,8 @@ namespace Floe
 				m_thread->Join();
 				m_thread = nullptr;
 			}
+			delete m_device;
+			m_device = 0;
 		}
 
 		WaveOut::!WaveOut()
@@ -1,6 +1,8 @@
 #pragma once
 #include "Stdafx.h"
 #include "Common.h"
+#include "WaveDevice.h"
+#include "WaveSource.h"
 
 namespace Floe
 {
@@ -13,16 +15,27 @@ namespace Floe
 		public ref class WaveOut
 		{
 		private:
+			static const int DefaultBufferCount = 2;
+
 			Stream ^m_stream;
+			IWaveSource ^m_source;
 			WaveFormat ^m_format;
 			Thread ^m_thread;
 			AutoResetEvent ^m_stop;
 			int m_bufferSize;
+			int m_bufferCount;
 			float m_volume;
-			HWAVEOUT m_wavHandle;
+			WaveOutDevice *m_device;
+			int m_underruns;
+			__int64 m_bytesCopied;
 
 		public:
 			WaveOut(Stream ^stream, WaveFormat ^format, int bufferSize);
+			WaveOut(Stream ^stream, WaveFormat ^format, int bufferSize, int bufferCount);
+			WaveOut(Stream ^stream, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device);
+			WaveOut(IWaveSource ^source, WaveFormat ^format, int bufferSize);
+			WaveOut(IWaveSource ^source, WaveFormat ^format, int bufferSize, int bufferCount);
+			WaveOut(IWaveSource ^source, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device);
 			void Start();
 			void Pause();
 			void Resume();
@@ -33,8 +46,7 @@ namespace Floe
 			{
 				float get()
 				{
-					DWORD vol;
-					waveOutGetVolume(m_wavHandle, &vol);
+					DWORD vol = m_device->GetVolume();
 					return (float)(vol & 0xffff) / 255.0f;
 				}
 				void set(float value)
@@ -42,13 +54,41 @@ namespace Floe
 					m_volume = Math::Max(0.0f, Math::Min(1.0f, value));
 					DWORD vol = (DWORD)(value * 0xffff);
 					vol |= (vol << 16);
-					waveOutSetVolume(m_wavHandle, vol);
+					m_device->SetVolume(vol);
+				}
+			}
+
+			property int BufferCount
+			{
+				int get()
+				{
+					return m_bufferCount;
+				}
+			}
+
+			// The number of times the device played out every queued buffer before the next one was written. The null device
+			// never counts any.
+			property int Underruns
+			{
+				int get()
+				{
+					return m_underruns;
+				}
+			}
+
+			// The number of bytes copied into the device buffers. This stays at zero when playing from a source.
+			property __int64 BytesCopied
+			{
+				__int64 get()
+				{
+					return Interlocked::Read(m_bytesCopied);
 				}
 			}
 
 			event System::EventHandler ^EndOfStream;
 
 		private:
+			void Initialize(Stream ^stream, IWaveSource ^source, WaveFormat ^format, int bufferSize, int bufferCount, WaveDeviceKind device);
 			void Loop();
 			~WaveOut();
 			!WaveOut();
@@ -0,0 +1,18 @@
+#pragma once
+#include "Stdafx.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// Receives recorded audio directly from the device buffers. The buffer is only lent to the sink for the
+		// duration of the call and goes back to the device afterwards, so the sink may process it in place but
+		// must not hold on to it.
+		public interface class IWaveSink
+		{
+			void Write(IntPtr buffer, int count);
+		};
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "Stdafx.h"
+
+namespace Floe
+{
+	namespace Interop
+	{
+		using System::IntPtr;
+
+		// Supplies audio for playback by writing it directly into a device buffer of the given size. Returns the
+		// number of bytes written, or zero if there is nothing to play.
+		public interface class IWaveSource
+		{
+			int Read(IntPtr buffer, int count);
+		};
+	}
+}
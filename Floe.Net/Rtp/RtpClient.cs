@@ -1,7 +1,9 @@
 ﻿using System;
 using System.Collections.Generic;
+using System.Diagnostics;
 using System.Net;
 using System.Net.Sockets;
+using System.Runtime.InteropServices;
 using System.Threading;
 
 namespace Floe.Net
@@ -11,48 +13,187 @@ namespace Floe.Net
 	/// that derive from this class will implement their own specific logic utilizing RTP (for example, voice chat).
 	/// </summary>
 	/// <remarks>
-	/// Each packet sent will be sent to all peers. Any packet received from an unrecognized peer will be discarded.
+	/// Each packet sent will be sent to all peers. Any packet received from an unrecognized peer will be discarded. A peer
+	/// may also be reached through a relay (see RtpRelay), in which case its packets are told apart from those of the other
+	/// peers on the relay by their source identifier, and a packet sent once to the relay reaches all of them.
+	/// Packets are built in place in a small queue and sent to the peers by a separate thread, so that the caller never
+	/// waits on the network. RTCP sender and receiver reports are exchanged with each peer on the same socket, and the
+	/// statistics they carry are available through GetPeerStatistics.
 	/// </remarks>
-	public abstract class RtpClient : IDisposable
+	public abstract partial class RtpClient : IDisposable
 	{
 		private const int HeaderSize = 12;
 		private const int KeepAliveInterval = 10000;
 		private const int MaxPayloadSize = 1024;
+		private const int SendQueueLength = 8; // must be a power of 2
+		private const int PollInterval = 100; // milliseconds
+
+		// The state of the stream received from a single peer.
+		private class PeerState
+		{
+			public IPEndPoint EndPoint;
+			public RouteState Route;
+			public bool Relayed;
+			public IPEndPoint Relay;
+			public int Sequence;
+			public int ClockRate;
+
+			// Reception statistics, updated by the receive thread as described in RFC 3550, appendix A.3.
+			public bool Receiving;
+			public uint Ssrc;
+			public int BaseSequence, Received, ExpectedPrior, ReceivedPrior;
+			public int Transit;
+			public double Jitter;
+			public int FractionLost, PacketsLost;
+
+			// The last sender report from the peer, echoed back in the next receiver report.
+			public uint LastSenderReport;
+			public long LastSenderReportTicks;
+
+			// The counts from the peer's last sender report.
+			public uint SenderPackets, SenderOctets;
+
+			// The peer's view of our stream, taken from its reports.
+			public int RemoteFractionLost, RemotePacketsLost;
+			public uint RemoteJitter;
+			public int RoundTripTime;
+		}
+
+		// An address that packets are sent to and received from: either a peer itself, or a relay shared by several peers.
+		private class RouteState
+		{
+			public IPEndPoint EndPoint;
+			public long Key;
+			public int SendErrors;
+			public int SendSequence;
+			public PeerState[] Peers;
+
+			// What has been sent on this route, for its sender reports. A member of a hub gets a stream of its own, so these
+			// can differ from one route to the next.
+			public long PacketsSent, OctetsSent, ReportedPackets;
+
+			public PeerState FindSource(uint ssrc)
+			{
+				if (!this.Peers[0].Relayed)
+				{
+					return this.Peers[0];
+				}
+				foreach (var peer in this.Peers)
+				{
+					if (peer.Ssrc == ssrc)
+					{
+						return peer;
+					}
+				}
+				return null;
+			}
+		}
+
+		// An immutable snapshot of the routes, shared by the send and receive threads and replaced whenever a peer is added or
+		// removed. Received datagrams are matched to routes through an open-addressing table keyed by address and port, so
+		// that the lookup neither allocates nor hashes an IPEndPoint.
+		private class PeerTable
+		{
+			public RouteState[] Routes;
+			public RouteState[] Slots;
+
+			public PeerTable(RouteState[] routes)
+			{
+				this.Routes = routes;
+				int capacity = 4;
+				while (capacity < routes.Length * 2)
+				{
+					capacity <<= 1;
+				}
+				this.Slots = new RouteState[capacity];
+				foreach (var route in routes)
+				{
+					int i = Hash(route.Key) & (capacity - 1);
+					while (this.Slots[i] != null)
+					{
+						i = (i + 1) & (capacity - 1);
+					}
+					this.Slots[i] = route;
+				}
+			}
+
+			public RouteState Find(IPEndPoint endpoint)
+			{
+				long key = KeyOf(endpoint);
+				int mask = this.Slots.Length - 1;
+				for (int i = Hash(key) & mask; this.Slots[i] != null; i = (i + 1) & mask)
+				{
+					var route = this.Slots[i];
+					if (route.Key == key && (endpoint.AddressFamily == AddressFamily.InterNetwork || route.EndPoint.Equals(endpoint)))
+					{
+						return route;
+					}
+				}
+				return null;
+			}
+
+			public static long KeyOf(IPEndPoint endpoint)
+			{
+				// An IPv4 address and port fit in the key exactly; other addresses are only hashed and must be compared.
+#pragma warning disable 618
+				return endpoint.AddressFamily == AddressFamily.InterNetwork ?
+					(1L << 48) | (endpoint.Address.Address << 16) | (long)endpoint.Port :
+					(2L << 48) | (uint)endpoint.GetHashCode();
+#pragma warning restore 618
+			}
+
+			private static int Hash(long key)
+			{
+				return (int)((uint)(key ^ (key >> 29)) * 2654435761u >> 8);
+			}
+		}
 
 		private UdpClient _client;
-		private HashSet<IPEndPoint> _peers;
-		private Dictionary<IPEndPoint, int> _seq;
+		private Dictionary<IPEndPoint, PeerState> _peers;
+		private volatile PeerTable _peerTable;
 		private ManualResetEvent _endEvent, _readyEvent;
-		private Thread _thread;
-		private byte[] _payload;
+		private Thread _thread, _sendThread;
+		private AutoResetEvent _sendEvent;
 		private int _payloadSize;
-		private IAsyncResult[] _sendResults;
-		private WaitHandle[] _sendHandles;
-		private byte[] _sendBuffer;
+		private byte[][] _sendQueue;
+		private byte[] _directPacket;
+		private int[] _sendSizes;
+		private volatile int _sendHead, _sendTail;
 		private uint _seqNumber;
 		private byte[] _ssrc, _keepalive;
 		private byte _payloadType;
 		private IPEndPoint _keepAliveTarget;
+		private long _bytesCopied, _allocations, _packetsSent, _packetsDropped;
+		private int _clockRate;
 
 		/// <summary>
 		/// Constructs a new RcpClient using the specified UdpClient for communication.
 		/// </summary>
 		/// <param name="payloadType">An RTP payload type identifier.</param>
-		/// <param name="payloadSize">The size of the payload for both send and receive.</param>
+		/// <param name="payloadSize">The maximum size of an outgoing payload. Payloads may be smaller when the codec produces
+		/// variable-size packets.</param>
+		/// <param name="clockRate">The rate at which the timestamps of outgoing packets advance, in units per second.</param>
 		/// <param name="keepAliveTarget">An address to send keepalive packets to when no peers are connected.</param>
 		/// <param name="client">An optional already-bound UdpClient to use for communication.</param>
-		public RtpClient(byte payloadType, int payloadSize, IPEndPoint keepAliveTarget, UdpClient client = null)
+		public RtpClient(byte payloadType, int payloadSize, int clockRate, IPEndPoint keepAliveTarget, UdpClient client = null)
 		{
+			if (payloadSize < 1 || payloadSize > MaxPayloadSize)
+			{
+				throw new ArgumentOutOfRangeException("payloadSize");
+			}
+
 			_payloadType = (byte)(payloadType & 0x7f);
 			_client = client ?? new UdpClient(0);
-			_peers = new HashSet<IPEndPoint>();
-			_payload = new byte[MaxPayloadSize];
+			_peers = new Dictionary<IPEndPoint, PeerState>();
+			_peerTable = new PeerTable(new RouteState[0]);
+			_sendEvent = new AutoResetEvent(false);
 			_payloadSize = payloadSize;
 			_ssrc = new byte[4];
-			_seq = new Dictionary<IPEndPoint, int>();
 			new Random().NextBytes(_ssrc);
 			_keepAliveTarget = keepAliveTarget;
 			_keepalive = new byte[] { 0xff, 0xff };
+			_clockRate = clockRate;
+			this.InitializeControl();
 		}
 
 		/// <summary>
@@ -61,7 +202,13 @@ namespace Floe.Net
 		public IPEndPoint LocalEndPoint { get { return (IPEndPoint)_client.Client.LocalEndPoint; } }
 
 		/// <summary>
-		/// Gets the payload size of outgoing packets.
+		/// Gets the source identifier of outgoing packets. Peers that receive through a relay need it to tell this client's
+		/// packets apart from the others.
+		/// </summary>
+		public int Ssrc { get { return (int)_ssrcValue; } }
+
+		/// <summary>
+		/// Gets the maximum payload size of outgoing packets.
 		/// </summary>
 		public int PayloadSize { get { return _payloadSize; } }
 
@@ -74,6 +221,8 @@ namespace Floe.Net
 			_readyEvent = new ManualResetEvent(false);
 			_thread = new Thread(new ThreadStart(ThreadProc));
 			_thread.Start();
+			_sendThread = new Thread(new ThreadStart(SendThreadProc));
+			_sendThread.Start();
 			_readyEvent.WaitOne();
 		}
 
@@ -86,11 +235,44 @@ namespace Floe.Net
 			{
 				_endEvent.Set();
 				_thread.Join();
+				_sendThread.Join();
 			}
 		}
 
 		/// <summary>
-		/// Send a packet to all peers. If there is a problem with the send, the OnError method is called.
+		/// Gets the number of payload bytes that have been copied into outgoing packets.
+		/// </summary>
+		public long BytesCopied { get { return Interlocked.Read(ref _bytesCopied); } }
+
+		/// <summary>
+		/// Gets the number of objects allocated while sending packets. The send queue is allocated by the first send, and
+		/// nothing is allocated after that.
+		/// </summary>
+		public long Allocations { get { return Interlocked.Read(ref _allocations); } }
+
+		/// <summary>
+		/// Gets the number of packets that have been sent to all peers.
+		/// </summary>
+		public long PacketsSent { get { return Interlocked.Read(ref _packetsSent); } }
+
+		/// <summary>
+		/// Gets the number of packets that were dropped because the send thread had fallen too far behind.
+		/// </summary>
+		public long PacketsDropped { get { return Interlocked.Read(ref _packetsDropped); } }
+
+		/// <summary>
+		/// Gets the number of sends to a peer that have failed.
+		/// </summary>
+		/// <param name="endpoint">The public endpoint of the peer.</param>
+		/// <returns>Returns the number of failed sends, or zero if the peer is unknown.</returns>
+		public int GetSendErrors(IPEndPoint endpoint)
+		{
+			PeerState peer;
+			return _peers.TryGetValue(endpoint, out peer) && peer.Route != null ? peer.Route.SendErrors : 0;
+		}
+
+		/// <summary>
+		/// Send a packet to all peers. If there is a problem with the send, the OnError method is called from the send thread.
 		/// </summary>
 		/// <param name="timeStamp">The packet's timestamp.</param>
 		/// <param name="payload">The packet's payload.</param>
@@ -101,50 +283,196 @@ namespace Floe.Net
 				return;
 			}
 
-			if (_sendHandles == null || _sendHandles.Length != _peers.Count)
+			var packet = this.BeginPacket(timeStamp, _payloadType, false);
+			if (packet != null)
 			{
-				_sendHandles = new WaitHandle[_peers.Count];
-				_sendResults = new IAsyncResult[_peers.Count];
+				Array.Copy(payload, 0, packet, HeaderSize, _payloadSize);
+				Interlocked.Add(ref _bytesCopied, _payloadSize);
+				this.EndPacket(HeaderSize + _payloadSize);
 			}
-			if(_sendBuffer == null)
+		}
+
+		/// <summary>
+		/// Send a packet to all peers, reading the payload from unmanaged memory. The payload is copied once, directly
+		/// behind the RTP header in the outgoing packet. If there is a problem with the send, the OnError method is called from
+		/// the send thread.
+		/// </summary>
+		/// <param name="timeStamp">The packet's timestamp.</param>
+		/// <param name="payload">A pointer to the packet's payload.</param>
+		/// <param name="count">The size of the payload in bytes. This may not exceed the payload size given to the constructor.</param>
+		public virtual void Send(int timeStamp, IntPtr payload, int count)
+		{
+			this.Send(timeStamp, payload, count, _payloadType, false);
+		}
+
+		/// <summary>
+		/// Send a packet to all peers with the given payload type, reading the payload from unmanaged memory. This allows
+		/// sending packets of another type (such as comfort noise) within the session, and flagging significant packets
+		/// (such as the first of a talkspurt) with the marker bit. If there is a problem with the send, the OnError method is
+		/// called from the send thread.
+		/// </summary>
+		/// <param name="timeStamp">The packet's timestamp.</param>
+		/// <param name="payload">A pointer to the packet's payload.</param>
+		/// <param name="count">The size of the payload in bytes. This may not exceed the payload size given to the constructor.</param>
+		/// <param name="payloadType">The RTP payload type identifier of this packet.</param>
+		/// <param name="marker">Whether to set the marker bit.</param>
+		public virtual void Send(int timeStamp, IntPtr payload, int count, byte payloadType, bool marker)
+		{
+			if (_peers.Count < 1)
 			{
-				_sendBuffer = new byte[HeaderSize + _payloadSize];
+				return;
+			}
+			if (count > _payloadSize)
+			{
+				throw new ArgumentOutOfRangeException("count");
 			}
 
-			_sendBuffer[0] = 0x80;
-			_sendBuffer[1] = _payloadType;
-			_sendBuffer[2] = (byte)(_seqNumber >> 8);
-			_sendBuffer[3] = (byte)(_seqNumber);
-			_sendBuffer[4] = (byte)(timeStamp >> 24);
-			_sendBuffer[5] = (byte)(timeStamp >> 16);
-			_sendBuffer[6] = (byte)(timeStamp >> 8);
-			_sendBuffer[7] = (byte)(timeStamp);
-			Array.Copy(_ssrc, 0, _sendBuffer, 8, 4);
-			Array.Copy(payload, 0, _sendBuffer, 12, _payloadSize);
-
-			_seqNumber++;
+			var packet = this.BeginPacket(timeStamp, (byte)(payloadType & 0x7f), marker);
+			if (packet != null)
+			{
+				Marshal.Copy(payload, packet, HeaderSize, count);
+				Interlocked.Add(ref _bytesCopied, count);
+				this.EndPacket(HeaderSize + count);
+			}
+		}
 
-			int i = 0;
-			foreach (var peer in _peers)
+		/// <summary>
+		/// Send a packet to a single peer, reading the payload from unmanaged memory. This is for sessions in which each peer
+		/// receives its own stream (such as a mixing hub), so the packet is sent at once from the calling thread, and each
+		/// peer's packets are numbered separately. Only one thread may call this method.
+		/// </summary>
+		/// <param name="endpoint">The public endpoint of the peer.</param>
+		/// <param name="timeStamp">The packet's timestamp.</param>
+		/// <param name="payload">A pointer to the packet's payload.</param>
+		/// <param name="count">The size of the payload in bytes. This may not exceed the payload size given to the constructor.</param>
+		/// <returns>Returns true if the packet was sent, or false if the peer is unknown or the send failed.</returns>
+		protected bool SendTo(IPEndPoint endpoint, int timeStamp, IntPtr payload, int count)
+		{
+			if (count > _payloadSize)
+			{
+				throw new ArgumentOutOfRangeException("count");
+			}
+			var route = _peerTable.Find(endpoint);
+			if (route == null)
 			{
-				_sendResults[i] = _client.Client.BeginSendTo(_sendBuffer, 0, _sendBuffer.Length, SocketFlags.None, peer, null, null);
-				_sendHandles[i] = _sendResults[i].AsyncWaitHandle;
-				i++;
+				return false;
 			}
-			WaitHandle.WaitAll(_sendHandles);
+			if (_directPacket == null)
+			{
+				_directPacket = new byte[HeaderSize + _payloadSize];
+				Interlocked.Increment(ref _allocations);
+			}
+
+			var packet = _directPacket;
+			packet[0] = 0x80;
+			packet[1] = _payloadType;
+			packet[2] = (byte)(route.SendSequence >> 8);
+			packet[3] = (byte)(route.SendSequence);
+			packet[4] = (byte)(timeStamp >> 24);
+			packet[5] = (byte)(timeStamp >> 16);
+			packet[6] = (byte)(timeStamp >> 8);
+			packet[7] = (byte)(timeStamp);
+			Array.Copy(_ssrc, 0, packet, 8, 4);
+			Marshal.Copy(payload, packet, HeaderSize, count);
+			Interlocked.Add(ref _bytesCopied, count);
+			route.SendSequence++;
+			this.OnPacketStamped(timeStamp);
+
 			try
 			{
-				foreach (var ar in _sendResults)
-				{
-					_client.Client.EndSendTo(ar);
-				}
+				_client.Client.SendTo(packet, 0, HeaderSize + count, SocketFlags.None, route.EndPoint);
 			}
 			catch (SocketException ex)
 			{
+				Interlocked.Increment(ref route.SendErrors);
 				this.OnError(ex);
+				return false;
+			}
+			Interlocked.Increment(ref route.PacketsSent);
+			Interlocked.Add(ref route.OctetsSent, count);
+			Interlocked.Increment(ref _packetsSent);
+			return true;
+		}
+
+		// Claims the next free packet in the send queue and writes its header. Returns null if the queue is full. Only
+		// one thread may send at a time.
+		private byte[] BeginPacket(int timeStamp, byte payloadType, bool marker)
+		{
+			if (_sendQueue == null)
+			{
+				_sendQueue = new byte[SendQueueLength][];
+				for (int i = 0; i < SendQueueLength; i++)
+				{
+					_sendQueue[i] = new byte[HeaderSize + _payloadSize];
+				}
+				_sendSizes = new int[SendQueueLength];
+				Interlocked.Add(ref _allocations, SendQueueLength + 2);
+			}
+			if (_sendHead - _sendTail >= SendQueueLength)
+			{
+				Interlocked.Increment(ref _packetsDropped);
+				return null;
+			}
+
+			var packet = _sendQueue[_sendHead & (SendQueueLength - 1)];
+			packet[0] = 0x80;
+			packet[1] = (byte)(marker ? payloadType | 0x80 : payloadType);
+			packet[2] = (byte)(_seqNumber >> 8);
+			packet[3] = (byte)(_seqNumber);
+			packet[4] = (byte)(timeStamp >> 24);
+			packet[5] = (byte)(timeStamp >> 16);
+			packet[6] = (byte)(timeStamp >> 8);
+			packet[7] = (byte)(timeStamp);
+			Array.Copy(_ssrc, 0, packet, 8, 4);
+			this.OnPacketStamped(timeStamp);
+
+			_seqNumber++;
+			return packet;
+		}
+
+		// Hands the packet claimed by BeginPacket over to the send thread.
+		private void EndPacket(int size)
+		{
+			_sendSizes[_sendHead & (SendQueueLength - 1)] = size;
+			_sendHead++;
+			_sendEvent.Set();
+		}
+
+		private void SendThreadProc()
+		{
+			var handles = new WaitHandle[] { _sendEvent, _endEvent };
+			while (WaitHandle.WaitAny(handles) == 0)
+			{
+				while (_sendTail != _sendHead)
+				{
+					int i = _sendTail & (SendQueueLength - 1);
+					this.SendPacket(_sendQueue[i], _sendSizes[i]);
+					_sendTail++;
+				}
 			}
 		}
 
+		private void SendPacket(byte[] packet, int size)
+		{
+			// A datagram send does not wait for the network, so sending to each route in turn is quick. A failure for one
+			// route is counted against it and does not hold up the others. A relay gets a single copy for all of its peers.
+			foreach (var route in _peerTable.Routes)
+			{
+				try
+				{
+					_client.Client.SendTo(packet, 0, size, SocketFlags.None, route.EndPoint);
+					Interlocked.Increment(ref route.PacketsSent);
+					Interlocked.Add(ref route.OctetsSent, size - HeaderSize);
+				}
+				catch (SocketException ex)
+				{
+					Interlocked.Increment(ref route.SendErrors);
+					this.OnError(ex);
+				}
+			}
+			Interlocked.Increment(ref _packetsSent);
+		}
+
 		private void SendKeepAlive(IPEndPoint endpoint)
 		{
 			_client.Client.BeginSendTo(_keepalive, 0, _keepalive.Length, SocketFlags.None, endpoint, (ar) =>
@@ -172,15 +500,35 @@ namespace Floe.Net
 		/// Add a new peer. Packets will be delivered to and accepted from this peer.
 		/// </summary>
 		/// <param name="endpoint">The public endpoint of the peer to add.</param>
-		protected void AddPeer(IPEndPoint endpoint)
+		/// <param name="clockRate">The rate at which the timestamps of the peer's packets advance, in units per second.</param>
+		protected void AddPeer(IPEndPoint endpoint, int clockRate)
 		{
-			if (!_peers.Contains(endpoint))
+			if (!_peers.ContainsKey(endpoint))
 			{
-				_peers.Add(endpoint);
+				_peers.Add(endpoint, new PeerState { EndPoint = endpoint, ClockRate = clockRate });
+				this.UpdatePeerTable();
 			}
 			this.SendKeepAlive(endpoint);
 		}
 
+		/// <summary>
+		/// Add a new peer that is reached through a relay. Packets sent to the relay are forwarded to this peer, and packets
+		/// from the relay that carry the peer's source identifier are delivered as coming from the peer.
+		/// </summary>
+		/// <param name="endpoint">The public endpoint of the peer, which identifies it to the caller.</param>
+		/// <param name="clockRate">The rate at which the timestamps of the peer's packets advance, in units per second.</param>
+		/// <param name="relay">The endpoint of the relay.</param>
+		/// <param name="ssrc">The peer's source identifier (see the Ssrc property).</param>
+		protected void AddPeer(IPEndPoint endpoint, int clockRate, IPEndPoint relay, int ssrc)
+		{
+			if (!_peers.ContainsKey(endpoint))
+			{
+				_peers.Add(endpoint, new PeerState { EndPoint = endpoint, ClockRate = clockRate, Relayed = true, Relay = relay, Ssrc = (uint)ssrc });
+				this.UpdatePeerTable();
+			}
+			this.SendKeepAlive(relay);
+		}
+
 		/// <summary>
 		/// Remove a peer. Packets will no longer be delivered to or accepted from this peer.
 		/// </summary>
@@ -188,7 +536,54 @@ namespace Floe.Net
 		/// <returns>Returns true if the peer was removed, or false if the peer had not been added.</returns>
 		protected bool RemovePeer(IPEndPoint endpoint)
 		{
-			return _peers.Remove(endpoint);
+			if (_peers.Remove(endpoint))
+			{
+				this.UpdatePeerTable();
+				return true;
+			}
+			return false;
+		}
+
+		private void UpdatePeerTable()
+		{
+			// Peers keep their state, such as the last sequence number received, and are grouped by the address that reaches
+			// them. A relay becomes a single route for all of the peers behind it.
+			var old = _peerTable;
+			var routes = new Dictionary<IPEndPoint, List<PeerState>>();
+			foreach (var peer in _peers.Values)
+			{
+				var endpoint = peer.Relayed ? peer.Relay : peer.EndPoint;
+				List<PeerState> list;
+				if (!routes.TryGetValue(endpoint, out list))
+				{
+					routes.Add(endpoint, list = new List<PeerState>());
+				}
+				list.Add(peer);
+			}
+
+			var table = new RouteState[routes.Count];
+			int i = 0;
+			foreach (var pair in routes)
+			{
+				var previous = old.Find(pair.Key);
+				var route = new RouteState
+				{
+					EndPoint = pair.Key,
+					Key = PeerTable.KeyOf(pair.Key),
+					SendErrors = previous != null ? previous.SendErrors : 0,
+					SendSequence = previous != null ? previous.SendSequence : 0,
+					PacketsSent = previous != null ? Interlocked.Read(ref previous.PacketsSent) : 0,
+					OctetsSent = previous != null ? Interlocked.Read(ref previous.OctetsSent) : 0,
+					ReportedPackets = previous != null ? previous.ReportedPackets : 0,
+					Peers = pair.Value.ToArray()
+				};
+				foreach (var peer in route.Peers)
+				{
+					peer.Route = route;
+				}
+				table[i++] = route;
+			}
+			_peerTable = new PeerTable(table);
 		}
 
 		/// <summary>
@@ -199,10 +594,11 @@ namespace Floe.Net
 		/// <param name="payloadType">The numeric payload type.</param>
 		/// <param name="seqNumber">The sequence number generated by the peer, used to detect packet loss.</param>
 		/// <param name="timeStamp">The packet's timestamp.</param>
-		/// <param name="source">The packet's source stream identifier.</param>
-		/// <param name="payload">The packet's payload.</param>
-		/// <param name="count">The size of the payload in bytes.</param>
-		protected abstract void OnReceived(IPEndPoint peer, short payloadType, int seqNumber, int timeStamp, byte[] payload, int count);
+		/// <param name="payload">The buffer holding the packet's payload. It is reused for the next packet, so the payload must be
+		/// copied out if it is kept.</param>
+		/// <param name="offset">The offset of the payload in the buffer.</param>
+		/// <param name="count">The size of the payload in bytes. Packets with no payload are dropped, so this is at least one.</param>
+		protected abstract void OnReceived(IPEndPoint peer, short payloadType, int seqNumber, int timeStamp, byte[] payload, int offset, int count);
 
 		/// <summary>
 		/// When overridden in a dervied class, this method handles errors that occur during asynchronous operations.
@@ -225,81 +621,110 @@ namespace Floe.Net
 
 		private void Loop()
 		{
-			var handles = new WaitHandle[] { null, _endEvent };
+			var socket = _client.Client;
 			var buffer = new byte[HeaderSize + MaxPayloadSize];
+			EndPoint sender = new IPEndPoint(IPAddress.Any, 0);
+			int lastActivity = Environment.TickCount;
+			_readyEvent.Set();
 
-			while (true)
+			while (!_endEvent.WaitOne(0))
 			{
-				EndPoint sender = new IPEndPoint(IPAddress.Any, 0);
-				var arr = _client.Client.BeginReceiveFrom(buffer, 0, HeaderSize + MaxPayloadSize, SocketFlags.None, ref sender, null, null);
-				handles[0] = arr.AsyncWaitHandle;
-				_readyEvent.Set();
-				switch (WaitHandle.WaitAny(handles, KeepAliveInterval))
+				this.SendReportsIfDue();
+				if (!socket.Poll(PollInterval * 1000, SelectMode.SelectRead))
 				{
-					case 0:
-						int count = 0;
-						try
-						{
-							count = _client.Client.EndReceiveFrom(arr, ref sender);
-						}
-						catch (SocketException ex)
-						{
-							// Ignore packets that are too large.
-							if (ex.ErrorCode == 10040)
-							{
-								continue;
-							}
-							else
-							{
-								throw;
-							}
-						}
-						var endpoint = (IPEndPoint)sender;
-						if (_peers.Contains(endpoint))
-						{
-							this.ReadPacket(endpoint, buffer, count);
-						}
-						break;
-					case 1:
-						return;
-					case WaitHandle.WaitTimeout:
-						if (_peers.Count == 0)
+					if (Environment.TickCount - lastActivity >= KeepAliveInterval)
+					{
+						this.SendKeepAlives();
+						lastActivity = Environment.TickCount;
+					}
+					continue;
+				}
+				lastActivity = Environment.TickCount;
+
+				// Drain everything that has arrived before waiting again. ReceiveFrom still allocates a socket address for every
+				// datagram, and a new sender endpoint when the sender changes, but nothing else is allocated for a packet.
+				var peers = _peerTable;
+				do
+				{
+					int count;
+					try
+					{
+						count = socket.ReceiveFrom(buffer, 0, buffer.Length, SocketFlags.None, ref sender);
+					}
+					catch (SocketException ex)
+					{
+						// Ignore packets that are too large, and ICMP port unreachable errors from peers that have gone away.
+						if (ex.ErrorCode == 10040 || ex.ErrorCode == 10054)
 						{
-							this.SendKeepAlive(_keepAliveTarget);
+							continue;
 						}
 						else
 						{
-							foreach (var peer in _peers)
-							{
-								this.SendKeepAlive(peer);
-							}
+							throw;
 						}
-						break;
+					}
+
+					var route = peers.Find((IPEndPoint)sender);
+					if (route != null)
+					{
+						this.ReadPacket(route, buffer, count);
+					}
+				}
+				while (socket.Available > 0);
+			}
+		}
+
+		private void SendKeepAlives()
+		{
+			var routes = _peerTable.Routes;
+			if (routes.Length == 0)
+			{
+				this.SendKeepAlive(_keepAliveTarget);
+			}
+			else
+			{
+				foreach (var route in routes)
+				{
+					this.SendKeepAlive(route.EndPoint);
 				}
 			}
 		}
 
-		private void ReadPacket(IPEndPoint peer, byte[] buffer, int count)
+		private void ReadPacket(RouteState route, byte[] buffer, int count)
 		{
-			if (buffer[0] != 0x80 || (buffer[1] & 0x80) != 0 || count <= HeaderSize)
+			// RTCP packets share the socket and are told apart by their packet types (RFC 5761), which no RTP payload type
+			// used here can be mistaken for.
+			if (count >= 8 && (buffer[0] & 0xc0) == 0x80 && buffer[1] >= 200 && buffer[1] <= 204)
+			{
+				this.ReadControlPacket(route, buffer, count);
+				return;
+			}
+			if (buffer[0] != 0x80 || count <= HeaderSize)
 			{
 				return;
 			}
 
+			// The header is parsed in place and the payload is passed on where it lies. The marker bit (set on the first
+			// packet of a talkspurt) is accepted but not reported.
 			short payloadType = (short)(buffer[1] & 0x7f);
 			ushort seq = (ushort)((buffer[2] << 8) | buffer[3]);
 			int timeStamp = (int)((buffer[4] << 24) | (buffer[5] << 16) | (buffer[6] << 8) | buffer[7]);
-			int source = (int)((buffer[8] << 24) | (buffer[9] << 16) | (buffer[10] << 8) | buffer[11]);
-			Array.Copy(buffer, 12, _payload, 0, count - HeaderSize);
+			uint ssrc = (uint)((buffer[8] << 24) | (buffer[9] << 16) | (buffer[10] << 8) | buffer[11]);
+			var peer = route.FindSource(ssrc);
+			if (peer == null)
+			{
+				return;
+			}
 
-			// The RTP protocol only allocates 16 bits for the sequence number, which means it may "wrap around".
-			// Detect that and append an upper 16 bits.
-			if (!_seq.ContainsKey(peer))
+			// A new source identifier means the peer has restarted its stream, so its numbering starts over.
+			if (!peer.Receiving || ssrc != peer.Ssrc)
 			{
-				_seq.Add(peer, 0);
+				peer.Sequence = 0;
 			}
 
-			int oldSeq = _seq[peer];
+			// The RTP protocol only allocates 16 bits for the sequence number, which means it may "wrap around".
+			// Detect that and append an upper 16 bits.
+			int oldSeq = peer.Sequence;
 			ushort seqLow = (ushort)(oldSeq);
 			ushort seqHigh = (ushort)(oldSeq >> 16);
 			int newSeq;
@@ -319,10 +744,11 @@ namespace Floe.Net
 
 			if (newSeq > oldSeq)
 			{
-				_seq[peer] = newSeq;
+				peer.Sequence = newSeq;
 			}
+			this.UpdateReceptionStatistics(peer, ssrc, newSeq, timeStamp);
 
-			this.OnReceived(peer, payloadType, newSeq, timeStamp, _payload, count - HeaderSize);
+			this.OnReceived(peer.EndPoint, payloadType, newSeq, timeStamp, buffer, HeaderSize, count - HeaderSize);
 		}
 
 		~RtpClient()
@@ -0,0 +1,308 @@
+﻿using System;
+using System.Diagnostics;
+using System.Net;
+using System.Net.Sockets;
+using System.Text;
+using System.Threading;
+
+namespace Floe.Net
+{
+	public abstract partial class RtpClient
+	{
+		private const int ReportInterval = 5000; // milliseconds; the minimum recommended by RFC 3550
+		private const int MaxReportBlocks = 31;
+		private const int MaxControlPacketSize = 28 + MaxReportBlocks * 24 + 64;
+		private const int SenderReport = 200;
+		private const int ReceiverReport = 201;
+		private const int SourceDescription = 202;
+		private const int ReportBlockSize = 24;
+
+		private byte[] _controlPacket, _cname;
+		private uint _ssrcValue;
+		private ulong _ntpBase;
+		private long _startTicks, _stampTicks;
+		private volatile int _lastTimeStamp;
+		private int _nextReport;
+		private Random _reportRandom;
+
+		/// <summary>
+		/// Gets the RTCP statistics for a peer.
+		/// </summary>
+		/// <param name="endpoint">The public endpoint of the peer.</param>
+		/// <returns>Returns a snapshot of the peer's statistics, or null if the peer is unknown.</returns>
+		public RtpPeerStatistics GetPeerStatistics(IPEndPoint endpoint)
+		{
+			PeerState peer;
+			if (!_peers.TryGetValue(endpoint, out peer))
+			{
+				return null;
+			}
+
+			return new RtpPeerStatistics
+			{
+				PacketsReceived = peer.Received,
+				PacketsLost = peer.PacketsLost,
+				FractionLost = peer.FractionLost / 256f,
+				Jitter = peer.ClockRate > 0 ? (float)(peer.Jitter * 1000.0 / peer.ClockRate) : 0f,
+				PacketsSent = peer.SenderPackets,
+				OctetsSent = peer.SenderOctets,
+				RemotePacketsLost = peer.RemotePacketsLost,
+				RemoteFractionLost = peer.RemoteFractionLost / 256f,
+				RemoteJitter = _clockRate > 0 ? peer.RemoteJitter * 1000f / _clockRate : 0f,
+				RoundTripTime = peer.RoundTripTime * 1000f / 65536f
+			};
+		}
+
+		private void InitializeControl()
+		{
+			_controlPacket = new byte[MaxControlPacketSize];
+			_cname = Encoding.ASCII.GetBytes("floe-" + BitConverter.ToString(_ssrc).Replace("-", "").ToLowerInvariant());
+			_ssrcValue = ReadUInt32(_ssrc, 0);
+
+			// The wallclock is only read once. Everything after that is measured with the performance counter, so that
+			// round-trip times are not limited by the resolution of the system clock.
+			ulong ticks = (ulong)(DateTime.UtcNow - new DateTime(1900, 1, 1, 0, 0, 0, DateTimeKind.Utc)).Ticks;
+			ulong second = (ulong)TimeSpan.TicksPerSecond;
+			_ntpBase = ((ticks / second) << 32) | (((ticks % second) << 32) / second);
+			_startTicks = _stampTicks = Stopwatch.GetTimestamp();
+			_reportRandom = new Random();
+			_nextReport = Environment.TickCount + ReportInterval / 2;
+		}
+
+		// Called by the sending thread for each packet, so that a sender report can give the timestamp that corresponds to
+		// its wallclock time.
+		private void OnPacketStamped(int timeStamp)
+		{
+			_lastTimeStamp = timeStamp;
+			Interlocked.Exchange(ref _stampTicks, Stopwatch.GetTimestamp());
+		}
+
+		// The current time in NTP format: seconds since 1900 in the upper 32 bits and the fraction in the lower 32 bits.
+		private ulong GetNtpTime()
+		{
+			long elapsed = Stopwatch.GetTimestamp() - _startTicks;
+			return _ntpBase + (ulong)(elapsed / (double)Stopwatch.Frequency * 4294967296.0);
+		}
+
+		private void UpdateReceptionStatistics(PeerState peer, uint ssrc, int seqNumber, int timeStamp)
+		{
+			// The relative transit time, in timestamp units. Only differences between transit times are used, so the
+			// clocks of the two ends need not agree, and the arithmetic may wrap around.
+			int transit = 0;
+			if (peer.ClockRate > 0)
+			{
+				transit = (int)(long)((double)Stopwatch.GetTimestamp() * peer.ClockRate / Stopwatch.Frequency) - timeStamp;
+			}
+
+			if (!peer.Receiving || ssrc != peer.Ssrc)
+			{
+				peer.Receiving = true;
+				peer.Ssrc = ssrc;
+				peer.BaseSequence = seqNumber;
+				peer.Received = peer.ExpectedPrior = peer.ReceivedPrior = 0;
+				peer.FractionLost = peer.PacketsLost = 0;
+				peer.Jitter = 0.0;
+				peer.LastSenderReport = 0;
+				peer.SenderPackets = peer.SenderOctets = 0;
+			}
+			else
+			{
+				// RFC 3550, section 6.4.1: J += (|D| - J) / 16.
+				double d = Math.Abs((double)(transit - peer.Transit));
+				peer.Jitter += (d - peer.Jitter) / 16.0;
+			}
+			peer.Transit = transit;
+			peer.Received++;
+		}
+
+		private void SendReportsIfDue()
+		{
+			if (Environment.TickCount - _nextReport < 0)
+			{
+				return;
+			}
+
+			// The interval is randomized so that the reports of peers that started together drift apart.
+			_nextReport = Environment.TickCount + _reportRandom.Next(ReportInterval / 2, ReportInterval * 3 / 2);
+			foreach (var route in _peerTable.Routes)
+			{
+				long packetsSent = Interlocked.Read(ref route.PacketsSent);
+				bool isSender = packetsSent != route.ReportedPackets;
+				route.ReportedPackets = packetsSent;
+
+				int size = this.BuildReport(route, isSender);
+				try
+				{
+					_client.Client.SendTo(_controlPacket, 0, size, SocketFlags.None, route.EndPoint);
+				}
+				catch (SocketException ex)
+				{
+					Interlocked.Increment(ref route.SendErrors);
+					this.OnError(ex);
+				}
+			}
+		}
+
+		// Builds a compound RTCP packet for one route: a sender report with the counts for the route if anything has been
+		// sent on it since the last report (or a receiver report otherwise) with a report block about the stream of each peer on the route, followed by the CNAME
+		// that RFC 3550 requires in every compound packet. A relay forwards the packet to all of the peers behind it, and each
+		// of them picks out the block about its own stream.
+		private int BuildReport(RouteState route, bool isSender)
+		{
+			var packet = _controlPacket;
+			packet[1] = (byte)(isSender ? SenderReport : ReceiverReport);
+			Array.Copy(_ssrc, 0, packet, 4, 4);
+			int i = 8;
+
+			if (isSender)
+			{
+				ulong ntp = this.GetNtpTime();
+				long elapsed = Stopwatch.GetTimestamp() - Interlocked.Read(ref _stampTicks);
+				WriteUInt32(packet, i, (uint)(ntp >> 32));
+				WriteUInt32(packet, i + 4, (uint)ntp);
+				WriteUInt32(packet, i + 8, (uint)(_lastTimeStamp + (int)(elapsed * (double)_clockRate / Stopwatch.Frequency)));
+				WriteUInt32(packet, i + 12, (uint)Interlocked.Read(ref route.PacketsSent));
+				WriteUInt32(packet, i + 16, (uint)Interlocked.Read(ref route.OctetsSent));
+				i += 20;
+			}
+			int blocks = 0;
+			foreach (var peer in route.Peers)
+			{
+				if (peer.Receiving && blocks < MaxReportBlocks)
+				{
+					this.WriteReportBlock(peer, packet, i);
+					i += ReportBlockSize;
+					blocks++;
+				}
+			}
+			packet[0] = (byte)(0x80 | blocks);
+			WriteLength(packet, 0, i);
+
+			int start = i;
+			packet[i] = 0x81;
+			packet[i + 1] = SourceDescription;
+			Array.Copy(_ssrc, 0, packet, i + 4, 4);
+			packet[i + 8] = 1; // CNAME
+			packet[i + 9] = (byte)_cname.Length;
+			Array.Copy(_cname, 0, packet, i + 10, _cname.Length);
+			i += 10 + _cname.Length;
+			do
+			{
+				packet[i++] = 0;
+			}
+			while ((i & 3) != 0);
+			WriteLength(packet, start, i - start);
+
+			return i;
+		}
+
+		private void WriteReportBlock(PeerState peer, byte[] packet, int i)
+		{
+			// RFC 3550, appendix A.3.
+			int expected = peer.Sequence - peer.BaseSequence + 1;
+			int lost = expected - peer.Received;
+			lost = lost > 0x7fffff ? 0x7fffff : lost < -0x800000 ? -0x800000 : lost;
+
+			int expectedInterval = expected - peer.ExpectedPrior;
+			int receivedInterval = peer.Received - peer.ReceivedPrior;
+			int lostInterval = expectedInterval - receivedInterval;
+			peer.ExpectedPrior = expected;
+			peer.ReceivedPrior = peer.Received;
+			int fraction = expectedInterval == 0 || lostInterval <= 0 ? 0 : (lostInterval << 8) / expectedInterval;
+			peer.FractionLost = fraction > 255 ? 255 : fraction;
+			peer.PacketsLost = lost;
+
+			uint delay = 0;
+			if (peer.LastSenderReport != 0)
+			{
+				delay = (uint)((Stopwatch.GetTimestamp() - peer.LastSenderReportTicks) * 65536.0 / Stopwatch.Frequency);
+			}
+
+			WriteUInt32(packet, i, peer.Ssrc);
+			WriteUInt32(packet, i + 4, (uint)(peer.FractionLost << 24) | ((uint)lost & 0xffffff));
+			WriteUInt32(packet, i + 8, (uint)peer.Sequence);
+			WriteUInt32(packet, i + 12, (uint)peer.Jitter);
+			WriteUInt32(packet, i + 16, peer.LastSenderReport);
+			WriteUInt32(packet, i + 20, delay);
+		}
+
+		private void ReadControlPacket(RouteState route, byte[] buffer, int count)
+		{
+			// A compound packet holds several RTCP packets back to back. Only the reports are of interest, and they are
+			// matched to a peer by the sender's source identifier.
+			int offset = 0;
+			while (offset + 8 <= count && (buffer[offset] & 0xc0) == 0x80)
+			{
+				int length = (((buffer[offset + 2] << 8) | buffer[offset + 3]) + 1) * 4;
+				if (offset + length > count)
+				{
+					break;
+				}
+
+				int reportCount = buffer[offset] & 0x1f;
+				var peer = route.FindSource(ReadUInt32(buffer, offset + 4));
+				if (peer != null && buffer[offset + 1] == SenderReport && length >= 28)
+				{
+					// The middle 32 bits of the NTP timestamp are echoed back in our next report, and the time we held
+					// them is subtracted by the peer to find the round-trip time.
+					peer.LastSenderReport = ReadUInt32(buffer, offset + 10);
+					peer.LastSenderReportTicks = Stopwatch.GetTimestamp();
+					peer.SenderPackets = ReadUInt32(buffer, offset + 20);
+					peer.SenderOctets = ReadUInt32(buffer, offset + 24);
+					this.ReadReportBlocks(peer, buffer, offset + 28, reportCount, offset + length);
+				}
+				else if (peer != null && buffer[offset + 1] == ReceiverReport)
+				{
+					this.ReadReportBlocks(peer, buffer, offset + 8, reportCount, offset + length);
+				}
+				offset += length;
+			}
+		}
+
+		private void ReadReportBlocks(PeerState peer, byte[] buffer, int offset, int reportCount, int end)
+		{
+			for (int n = 0; n < reportCount && offset + ReportBlockSize <= end; n++, offset += ReportBlockSize)
+			{
+				if (ReadUInt32(buffer, offset) != _ssrcValue)
+				{
+					continue;
+				}
+
+				peer.RemoteFractionLost = buffer[offset + 4];
+				peer.RemotePacketsLost = ((buffer[offset + 5] << 24) | (buffer[offset + 6] << 16) | (buffer[offset + 7] << 8)) >> 8;
+				peer.RemoteJitter = ReadUInt32(buffer, offset + 12);
+
+				uint lastReport = ReadUInt32(buffer, offset + 16);
+				uint delay = ReadUInt32(buffer, offset + 20);
+				if (lastReport != 0)
+				{
+					int rtt = (int)((uint)(this.GetNtpTime() >> 16) - lastReport - delay);
+					if (rtt >= 0)
+					{
+						peer.RoundTripTime = rtt;
+					}
+				}
+			}
+		}
+
+		private static void WriteLength(byte[] packet, int offset, int size)
+		{
+			int words = size / 4 - 1;
+			packet[offset + 2] = (byte)(words >> 8);
+			packet[offset + 3] = (byte)words;
+		}
+
+		private static void WriteUInt32(byte[] buffer, int offset, uint value)
+		{
+			buffer[offset] = (byte)(value >> 24);
+			buffer[offset + 1] = (byte)(value >> 16);
+			buffer[offset + 2] = (byte)(value >> 8);
+			buffer[offset + 3] = (byte)value;
+		}
+
+		private static uint ReadUInt32(byte[] buffer, int offset)
+		{
+			return (uint)((buffer[offset] << 24) | (buffer[offset + 1] << 16) | (buffer[offset + 2] << 8) | buffer[offset + 3]);
+		}
+	}
+}
@@ -0,0 +1,61 @@
+﻿using System;
+
+namespace Floe.Net
+{
+	/// <summary>
+	/// A snapshot of the RTCP statistics for a single RTP peer. The local figures describe the stream received from the peer,
+	/// and the remote figures are the peer's own report of the stream received from us.
+	/// </summary>
+	public class RtpPeerStatistics
+	{
+		/// <summary>
+		/// Gets the number of packets received from the peer.
+		/// </summary>
+		public int PacketsReceived { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of packets from the peer that were lost, as of the last report sent to it.
+		/// </summary>
+		public int PacketsLost { get; internal set; }
+
+		/// <summary>
+		/// Gets the fraction of packets from the peer that were lost in the last reporting interval, between 0 and 1.
+		/// </summary>
+		public float FractionLost { get; internal set; }
+
+		/// <summary>
+		/// Gets the interarrival jitter of the packets received from the peer, in milliseconds.
+		/// </summary>
+		public float Jitter { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of packets that the peer has sent to us, as of its last sender report.
+		/// </summary>
+		public long PacketsSent { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of payload bytes that the peer has sent to us, as of its last sender report.
+		/// </summary>
+		public long OctetsSent { get; internal set; }
+
+		/// <summary>
+		/// Gets the number of our packets that the peer reported as lost.
+		/// </summary>
+		public int RemotePacketsLost { get; internal set; }
+
+		/// <summary>
+		/// Gets the fraction of our packets that the peer reported as lost in its last reporting interval, between 0 and 1.
+		/// </summary>
+		public float RemoteFractionLost { get; internal set; }
+
+		/// <summary>
+		/// Gets the interarrival jitter of our packets as reported by the peer, in milliseconds.
+		/// </summary>
+		public float RemoteJitter { get; internal set; }
+
+		/// <summary>
+		/// Gets the round-trip time to the peer, in milliseconds, or zero if it has not been measured yet.
+		/// </summary>
+		public float RoundTripTime { get; internal set; }
+	}
+}
@@ -0,0 +1,416 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Net;
+using System.Net.Sockets;
+using System.Threading;
+
+namespace Floe.Net
+{
+	/// <summary>
+	/// Forwards RTP and RTCP packets between the members of a multi-party session, so that each member sends its stream
+	/// only once, to the relay, instead of once to every other member. The relay acts as an RTP translator: the members
+	/// tell the streams apart by their source identifiers, and only the sequence numbers and the counts in the reports are
+	/// changed on the way through.
+	/// </summary>
+	/// <remarks>
+	/// Only the streams of the members that are currently talking are forwarded. A member becomes a speaker when it sends
+	/// an audio packet and fewer than MaxSpeakers others are talking; it stops being one when it has sent no audio packets
+	/// for a short while. Packets from other members, including the comfort noise packets that are sent during silence,
+	/// are dropped. The packets of each stream that are forwarded are renumbered to follow on from each other, so that the
+	/// receivers do not count the dropped packets as lost, and the reports are changed to match (RFC 3550, section 7.2).
+	/// The relay may be hosted by one of the members or by a separate process.
+	/// </remarks>
+	public sealed class RtpRelay : IDisposable
+	{
+		private const int MaxPacketSize = 2048;
+		private const int PollInterval = 100; // milliseconds
+		private const int SpeakerTimeout = 1000; // milliseconds
+		private const int ComfortNoisePayloadType = 13; // RFC 3389
+		private const int HeaderSize = 12;
+		private const int SenderReport = 200;
+		private const int ReceiverReport = 201;
+		private const int ReportBlockSize = 24;
+
+		private class Member
+		{
+			public IPEndPoint EndPoint;
+			public bool Speaking;
+			public int LastAudio;
+
+			// The member's stream as the others see it: the packets and bytes that have been dropped so far are taken off
+			// its sequence numbers and its sender reports.
+			public uint Ssrc;
+			public int Dropped;
+			public uint DroppedOctets;
+		}
+
+		private UdpClient _client;
+		private Dictionary<IPEndPoint, Member> _members;
+		private volatile Member[] _memberList;
+		private volatile Dictionary<IPEndPoint, Member> _memberTable;
+		private ManualResetEvent _endEvent;
+		private Thread _thread;
+		private int _maxSpeakers = 4;
+		private long _packetsReceived, _packetsForwarded, _packetsDropped, _bytesReceived, _bytesSent;
+
+		/// <summary>
+		/// Constructs a new relay.
+		/// </summary>
+		/// <param name="client">An optional already-bound UdpClient to use for communication.</param>
+		public RtpRelay(UdpClient client = null)
+		{
+			_client = client ?? new UdpClient(0);
+			_members = new Dictionary<IPEndPoint, Member>();
+			_memberList = new Member[0];
+			_memberTable = new Dictionary<IPEndPoint, Member>();
+		}
+
+		/// <summary>
+		/// Gets the local endpoint that the relay is bound to.
+		/// </summary>
+		public IPEndPoint LocalEndPoint { get { return (IPEndPoint)_client.Client.LocalEndPoint; } }
+
+		/// <summary>
+		/// Gets or sets the number of members whose streams are forwarded at the same time.
+		/// </summary>
+		public int MaxSpeakers
+		{
+			get { return _maxSpeakers; }
+			set
+			{
+				if (value < 1)
+				{
+					throw new ArgumentOutOfRangeException("value");
+				}
+				_maxSpeakers = value;
+			}
+		}
+
+		/// <summary>
+		/// Gets the number of packets received from members.
+		/// </summary>
+		public long PacketsReceived { get { return Interlocked.Read(ref _packetsReceived); } }
+
+		/// <summary>
+		/// Gets the number of packets sent to members. A packet forwarded to several members is counted once for each.
+		/// </summary>
+		public long PacketsForwarded { get { return Interlocked.Read(ref _packetsForwarded); } }
+
+		/// <summary>
+		/// Gets the number of packets that were not forwarded because their sender was not one of the speakers.
+		/// </summary>
+		public long PacketsDropped { get { return Interlocked.Read(ref _packetsDropped); } }
+
+		/// <summary>
+		/// Gets the number of bytes received from members.
+		/// </summary>
+		public long BytesReceived { get { return Interlocked.Read(ref _bytesReceived); } }
+
+		/// <summary>
+		/// Gets the number of bytes sent to members.
+		/// </summary>
+		public long BytesSent { get { return Interlocked.Read(ref _bytesSent); } }
+
+		/// <summary>
+		/// Occurs when a packet could not be received or forwarded. This event is raised from the relay's worker thread.
+		/// </summary>
+		public event EventHandler<ErrorEventArgs> Error;
+
+		/// <summary>
+		/// Start forwarding packets.
+		/// </summary>
+		public void Open()
+		{
+			_endEvent = new ManualResetEvent(false);
+			_thread = new Thread(new ThreadStart(ThreadProc));
+			_thread.Start();
+		}
+
+		/// <summary>
+		/// Stop forwarding packets.
+		/// </summary>
+		public void Close()
+		{
+			if (_thread != null)
+			{
+				_endEvent.Set();
+				_thread.Join();
+				_thread = null;
+			}
+		}
+
+		/// <summary>
+		/// Add a member to the session. Packets are accepted from the member and forwarded to it.
+		/// </summary>
+		/// <param name="endpoint">The public endpoint of the member.</param>
+		public void AddMember(IPEndPoint endpoint)
+		{
+			if (!_members.ContainsKey(endpoint))
+			{
+				_members.Add(endpoint, new Member { EndPoint = endpoint });
+				this.UpdateMembers();
+			}
+		}
+
+		/// <summary>
+		/// Remove a member from the session.
+		/// </summary>
+		/// <param name="endpoint">The public endpoint of the member.</param>
+		/// <returns>Returns true if the member was removed, false if it was not found.</returns>
+		public bool RemoveMember(IPEndPoint endpoint)
+		{
+			if (_members.Remove(endpoint))
+			{
+				this.UpdateMembers();
+				return true;
+			}
+			return false;
+		}
+
+		/// <summary>
+		/// Dispose and close this object.
+		/// </summary>
+		public void Dispose()
+		{
+			this.Close();
+			_client.Close();
+		}
+
+		private void UpdateMembers()
+		{
+			// The worker thread reads its own copy of the members, which is replaced rather than changed.
+			_memberList = new List<Member>(_members.Values).ToArray();
+			_memberTable = new Dictionary<IPEndPoint, Member>(_members);
+		}
+
+		private void ThreadProc()
+		{
+			try
+			{
+				this.Loop();
+			}
+			catch (SocketException ex)
+			{
+				this.OnError(ex);
+			}
+		}
+
+		private void Loop()
+		{
+			var socket = _client.Client;
+			var buffer = new byte[MaxPacketSize];
+			EndPoint sender = new IPEndPoint(IPAddress.Any, 0);
+
+			while (!_endEvent.WaitOne(0))
+			{
+				if (!socket.Poll(PollInterval * 1000, SelectMode.SelectRead))
+				{
+					continue;
+				}
+
+				do
+				{
+					int count;
+					try
+					{
+						count = socket.ReceiveFrom(buffer, 0, buffer.Length, SocketFlags.None, ref sender);
+					}
+					catch (SocketException ex)
+					{
+						// Ignore packets that are too large, and ICMP port unreachable errors from members that have gone away.
+						if (ex.ErrorCode == 10040 || ex.ErrorCode == 10054)
+						{
+							continue;
+						}
+						else
+						{
+							throw;
+						}
+					}
+
+					Member member;
+					if (_memberTable.TryGetValue((IPEndPoint)sender, out member))
+					{
+						Interlocked.Increment(ref _packetsReceived);
+						Interlocked.Add(ref _bytesReceived, count);
+						this.Relay(member, buffer, count);
+					}
+				}
+				while (socket.Available > 0);
+			}
+		}
+
+		private void Relay(Member member, byte[] buffer, int count)
+		{
+			// Keepalives and anything else that is not RTP version 2 stay here.
+			if (count < 12 || (buffer[0] & 0xc0) != 0x80)
+			{
+				return;
+			}
+
+			// RTCP reports are always forwarded, since round-trip times and loss are measured end to end.
+			bool isControl = buffer[1] >= 200 && buffer[1] <= 204;
+			if (isControl)
+			{
+				this.TranslateReports(member, buffer, count);
+			}
+			else
+			{
+				uint ssrc = ReadUInt32(buffer, 8);
+				if (ssrc != member.Ssrc)
+				{
+					member.Ssrc = ssrc;
+					member.Dropped = 0;
+					member.DroppedOctets = 0;
+				}
+				if (!this.IsSpeaking(member, buffer[1] & 0x7f))
+				{
+					member.Dropped++;
+					member.DroppedOctets += (uint)(count - HeaderSize);
+					Interlocked.Increment(ref _packetsDropped);
+					return;
+				}
+				int seq = ((buffer[2] << 8) | buffer[3]) - member.Dropped;
+				buffer[2] = (byte)(seq >> 8);
+				buffer[3] = (byte)seq;
+			}
+
+			var socket = _client.Client;
+			foreach (var other in _memberList)
+			{
+				if (other == member)
+				{
+					continue;
+				}
+				try
+				{
+					socket.SendTo(buffer, 0, count, SocketFlags.None, other.EndPoint);
+					Interlocked.Increment(ref _packetsForwarded);
+					Interlocked.Add(ref _bytesSent, count);
+				}
+				catch (SocketException ex)
+				{
+					this.OnError(ex);
+				}
+			}
+		}
+
+		private void TranslateReports(Member member, byte[] buffer, int count)
+		{
+			// The sender's own counts leave out what was dropped, and each report block about a stream has the extended
+			// highest sequence number put back into the numbering of the stream's sender. The loss in a block is counted
+			// against the renumbered stream, so it is only what the network lost, and stays as the receiver reported it.
+			int offset = 0;
+			while (offset + 8 <= count && (buffer[offset] & 0xc0) == 0x80)
+			{
+				int length = (((buffer[offset + 2] << 8) | buffer[offset + 3]) + 1) * 4;
+				if (offset + length > count)
+				{
+					break;
+				}
+
+				int type = buffer[offset + 1];
+				int blocks = offset + 8;
+				if (type == SenderReport && length >= 28)
+				{
+					if (member.Dropped != 0 && ReadUInt32(buffer, offset + 4) == member.Ssrc)
+					{
+						WriteUInt32(buffer, offset + 20, ReadUInt32(buffer, offset + 20) - (uint)member.Dropped);
+						WriteUInt32(buffer, offset + 24, ReadUInt32(buffer, offset + 24) - member.DroppedOctets);
+					}
+					blocks = offset + 28;
+				}
+				if (type == SenderReport || type == ReceiverReport)
+				{
+					int reportCount = buffer[offset] & 0x1f;
+					for (int n = 0; n < reportCount && blocks + ReportBlockSize <= offset + length; n++, blocks += ReportBlockSize)
+					{
+						var source = this.FindSource(ReadUInt32(buffer, blocks));
+						if (source != null && source.Dropped != 0)
+						{
+							WriteUInt32(buffer, blocks + 8, ReadUInt32(buffer, blocks + 8) + (uint)source.Dropped);
+						}
+					}
+				}
+				offset += length;
+			}
+		}
+
+		private Member FindSource(uint ssrc)
+		{
+			foreach (var member in _memberList)
+			{
+				if (member.Ssrc == ssrc && ssrc != 0)
+				{
+					return member;
+				}
+			}
+			return null;
+		}
+
+		private bool IsSpeaking(Member member, int payloadType)
+		{
+			int now = Environment.TickCount;
+			if (payloadType != ComfortNoisePayloadType)
+			{
+				member.LastAudio = now;
+			}
+			else if (!member.Speaking)
+			{
+				return false;
+			}
+
+			if (member.Speaking)
+			{
+				if (now - member.LastAudio < SpeakerTimeout)
+				{
+					return true;
+				}
+				member.Speaking = false;
+				return false;
+			}
+
+			// Take a free place among the speakers, after releasing the places of those that have fallen silent.
+			int speakers = 0;
+			foreach (var other in _memberList)
+			{
+				if (other.Speaking && now - other.LastAudio >= SpeakerTimeout)
+				{
+					other.Speaking = false;
+				}
+				if (other.Speaking)
+				{
+					speakers++;
+				}
+			}
+			if (speakers < _maxSpeakers)
+			{
+				member.Speaking = true;
+			}
+			return member.Speaking;
+		}
+
+		private void OnError(Exception ex)
+		{
+			var handler = this.Error;
+			if (handler != null)
+			{
+				handler(this, new ErrorEventArgs(ex));
+			}
+		}
+
+		private static void WriteUInt32(byte[] buffer, int offset, uint value)
+		{
+			buffer[offset] = (byte)(value >> 24);
+			buffer[offset + 1] = (byte)(value >> 16);
+			buffer[offset + 2] = (byte)(value >> 8);
+			buffer[offset + 3] = (byte)value;
+		}
+
+		private static uint ReadUInt32(byte[] buffer, int offset)
+		{
+			return (uint)((buffer[offset] << 24) | (buffer[offset + 1] << 16) | (buffer[offset + 2] << 8) | buffer[offset + 3]);
+		}
+	}
+}
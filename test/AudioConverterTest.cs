@@ -0,0 +1,347 @@
+﻿using System;
+using System.IO;
+using System.Runtime.InteropServices;
+using Floe.Audio;
+using Floe.Interop;
+
+namespace test
+{
+	// Counts what AudioConverter copies to convert a stream, against a copy of the conversion it made before its stages
+	// shared buffers, in which every stage moved what it had left to the front of its own source buffer and copied its
+	// input in behind it. Both run over the same ACM drivers and are fed the same input in the same pieces: the GSM encoder
+	// and decoder that CodecInfo gives, a packet at a time, the encoder behind a rate conversion from 16 kHz, fed pieces
+	// that line up with the blocks of neither stage, and the decoder ahead of a rate conversion to 16 kHz.
+	//
+	// The new converter is fed twice, once from a buffer of the caller's and once with the input written at SourceBuffer.
+	// For each, the table gives the copies and the bytes copied for each call, and the bytes copied for each byte
+	// converted. All three must give the same output, the new converter must copy no more than the old, and less when
+	// the input is written in place.
+	//
+	// usage: test converter [seconds]
+	static class AudioConverterTest
+	{
+		private const int SampleRate = 8000;
+		private const int WideRate = 16000;
+		private const int OutputSize = 65536; // bytes, more than any call here produces
+		private const int ResampledChunk = 1002; // bytes, an odd number of samples, and not a whole GSM block either
+
+		// The old converter gave each later stage only as much room as the stage before could fill, with nothing over for
+		// what it had left from the call before, so the rate conversions are made with room for twice the piece they are fed.
+		private const int ResampledSize = ResampledChunk * 2;
+
+		// The conversion that AudioConverter made before, over the same ACM calls, counting each copy it made.
+		private class OldConverter : IDisposable
+		{
+			private const int HeaderSize = 128; // enough for ACMSTREAMHEADER on either platform
+			private const int ConvertBlockAlign = 0x4;
+			private static readonly int SrcOffset = 8 + IntPtr.Size;
+			private static readonly int SrcLengthOffset = 8 + IntPtr.Size * 2;
+			private static readonly int SrcUsedOffset = 12 + IntPtr.Size * 2;
+			private static readonly int DstOffset = 16 + IntPtr.Size * 3;
+			private static readonly int DstLengthOffset = 16 + IntPtr.Size * 4;
+			private static readonly int DstUsedOffset = 20 + IntPtr.Size * 4;
+
+			[DllImport("msacm32.dll")]
+			private static extern int acmStreamOpen(out IntPtr stream, IntPtr driver, IntPtr srcFormat, IntPtr dstFormat,
+				IntPtr filter, IntPtr callback, IntPtr instance, int flags);
+
+			[DllImport("msacm32.dll")]
+			private static extern int acmStreamSize(IntPtr stream, int input, out int output, int flags);
+
+			[DllImport("msacm32.dll")]
+			private static extern int acmStreamPrepareHeader(IntPtr stream, IntPtr header, int flags);
+
+			[DllImport("msacm32.dll")]
+			private static extern int acmStreamConvert(IntPtr stream, IntPtr header, int flags);
+
+			[DllImport("msacm32.dll")]
+			private static extern int acmStreamUnprepareHeader(IntPtr stream, IntPtr header, int flags);
+
+			[DllImport("msacm32.dll")]
+			private static extern int acmStreamClose(IntPtr stream, int flags);
+
+			[DllImport("kernel32.dll")]
+			private static extern void RtlMoveMemory(IntPtr dst, IntPtr src, IntPtr count);
+
+			private IntPtr[] _streams, _headers;
+			private int[] _srcSizes, _dstSizes;
+
+			public long BytesCopied, Copies;
+
+			public OldConverter(int maxSrcSize, WaveFormat srcFormat, params WaveFormat[] dstFormats)
+			{
+				int count = dstFormats.Length;
+				_streams = new IntPtr[count];
+				_headers = new IntPtr[count];
+				_srcSizes = new int[count];
+				_dstSizes = new int[count];
+				for (int i = 0; i < count; i++)
+				{
+					Succeed(acmStreamOpen(out _streams[i], IntPtr.Zero, i == 0 ? srcFormat.Handle : dstFormats[i - 1].Handle,
+						dstFormats[i].Handle, IntPtr.Zero, IntPtr.Zero, IntPtr.Zero, 0));
+					int srcSize = i == 0 ? maxSrcSize * 2 : _dstSizes[i - 1], dstSize;
+					Succeed(acmStreamSize(_streams[i], srcSize, out dstSize, 0));
+					_srcSizes[i] = srcSize;
+					_dstSizes[i] = dstSize;
+
+					var header = _headers[i] = Marshal.AllocHGlobal(HeaderSize);
+					for (int n = 0; n < HeaderSize; n += 4)
+					{
+						Marshal.WriteInt32(header, n, 0);
+					}
+					Marshal.WriteInt32(header, 0, HeaderSize);
+					Marshal.WriteIntPtr(header, SrcOffset, Marshal.AllocHGlobal(srcSize));
+					Marshal.WriteInt32(header, SrcLengthOffset, srcSize);
+					Marshal.WriteIntPtr(header, DstOffset, Marshal.AllocHGlobal(dstSize));
+					Marshal.WriteInt32(header, DstLengthOffset, dstSize);
+					Succeed(acmStreamPrepareHeader(_streams[i], header, 0));
+					Marshal.WriteInt32(header, SrcUsedOffset, srcSize);
+				}
+			}
+
+			public int Convert(IntPtr srcBuffer, int size, out IntPtr dstBuffer)
+			{
+				for (int i = 0; i < _streams.Length; i++)
+				{
+					var header = _headers[i];
+					var src = Marshal.ReadIntPtr(header, SrcOffset);
+					int remainder = Marshal.ReadInt32(header, SrcLengthOffset) - Marshal.ReadInt32(header, SrcUsedOffset);
+					if (remainder > 0)
+					{
+						RtlMoveMemory(src, src + Marshal.ReadInt32(header, SrcUsedOffset), (IntPtr)remainder);
+						this.Count(remainder);
+					}
+					int length = i == 0 ? size : Marshal.ReadInt32(_headers[i - 1], DstUsedOffset);
+					RtlMoveMemory(src + remainder, i == 0 ? srcBuffer : Marshal.ReadIntPtr(_headers[i - 1], DstOffset), (IntPtr)length);
+					this.Count(length);
+					Marshal.WriteInt32(header, SrcLengthOffset, length + remainder);
+					Succeed(acmStreamConvert(_streams[i], header, ConvertBlockAlign));
+				}
+				var last = _headers[_headers.Length - 1];
+				dstBuffer = Marshal.ReadIntPtr(last, DstOffset);
+				return Marshal.ReadInt32(last, DstUsedOffset);
+			}
+
+			public int Convert(IntPtr srcBuffer, int size, IntPtr dstBuffer, int dstSize)
+			{
+				IntPtr converted;
+				size = this.Convert(srcBuffer, size, out converted);
+				if (dstSize < size)
+				{
+					throw new InvalidOperationException("Destination buffer too small.");
+				}
+				RtlMoveMemory(dstBuffer, converted, (IntPtr)size);
+				this.Count(size);
+				return size;
+			}
+
+			public void Dispose()
+			{
+				for (int i = 0; i < _streams.Length; i++)
+				{
+					var header = _headers[i];
+					Marshal.WriteInt32(header, SrcLengthOffset, _srcSizes[i]);
+					Marshal.WriteInt32(header, DstLengthOffset, _dstSizes[i]);
+					acmStreamUnprepareHeader(_streams[i], header, 0);
+					acmStreamClose(_streams[i], 0);
+					Marshal.FreeHGlobal(Marshal.ReadIntPtr(header, SrcOffset));
+					Marshal.FreeHGlobal(Marshal.ReadIntPtr(header, DstOffset));
+					Marshal.FreeHGlobal(header);
+				}
+			}
+
+			private void Count(int bytes)
+			{
+				this.BytesCopied += bytes;
+				this.Copies++;
+			}
+
+			private static void Succeed(int result)
+			{
+				if (result != 0)
+				{
+					throw new InvalidOperationException(string.Format("ACM error {0}.", result));
+				}
+			}
+		}
+
+		// How a converter did over one run.
+		private class Result
+		{
+			public byte[] Output;
+			public int Calls;
+			public long Copies, BytesCopied, BytesConverted;
+		}
+
+		public static void Run(string[] args)
+		{
+			double seconds = args.Length > 0 ? double.Parse(args[0]) : 10.0;
+			var codec = new CodecInfo(VoiceCodec.Gsm610, SampleRate);
+			var narrow = new WaveFormatPcm(SampleRate, 16, 1);
+			var wide = new WaveFormatPcm(WideRate, 16, 1);
+			var gsm = new WaveFormatGsm610(SampleRate);
+
+			var pcm = MakeTone(SampleRate, seconds);
+			var widePcm = MakeTone(WideRate, seconds);
+			byte[] encoded;
+			using (var encoder = codec.GetEncoder())
+			{
+				encoded = ConvertNew(encoder, pcm, codec.DecodedBufferSize, false, false).Output;
+			}
+
+			Console.WriteLine("{0,-16} {1,-8} {2,6} {3,12} {4,12} {5,12} {6,9}", "chain", "path", "calls", "copies/call",
+				"bytes/call", "bytes/byte", "out bytes");
+			Compare("encode", pcm, codec.DecodedBufferSize, false, () => codec.GetEncoder(),
+				() => new OldConverter(codec.DecodedBufferSize, codec.DecodedFormat, codec.EncodedFormat));
+			Compare("decode", encoded, codec.EncodedBufferSize, true, () => codec.GetDecoder(),
+				() => new OldConverter(codec.EncodedBufferSize, codec.EncodedFormat, codec.DecodedFormat));
+			Compare("16k > 8k > gsm", widePcm, ResampledChunk, false, () => new AudioConverter(ResampledSize, wide, narrow, gsm),
+				() => new OldConverter(ResampledSize, wide, narrow, gsm));
+			Compare("gsm > 8k > 16k", encoded, codec.EncodedBufferSize, true,
+				() => new AudioConverter(codec.EncodedBufferSize * 2, gsm, narrow, wide),
+				() => new OldConverter(codec.EncodedBufferSize * 2, gsm, narrow, wide));
+		}
+
+		// Runs the input through the old converter and twice through the new, and compares them. Output is taken in the
+		// converter's own buffer, or copied into one of the caller's as a decoder's output is.
+		private static void Compare(string name, byte[] input, int chunk, bool intoCaller, Func<AudioConverter> makeNew,
+			Func<OldConverter> makeOld)
+		{
+			Result old;
+			using (var converter = makeOld())
+			{
+				old = ConvertOld(converter, input, chunk, intoCaller);
+			}
+			Result copied, inPlace;
+			using (var converter = makeNew())
+			{
+				copied = ConvertNew(converter, input, chunk, false, intoCaller);
+			}
+			using (var converter = makeNew())
+			{
+				inPlace = ConvertNew(converter, input, chunk, true, intoCaller);
+			}
+
+			Print(name, "old", old);
+			Print("", "new", copied);
+			Print("", "in place", inPlace);
+			Check.That(Same(old.Output, copied.Output) && Same(old.Output, inPlace.Output), "{0}: the output differed, with {1}, " +
+				"{2} and {3} bytes", name, old.Output.Length, copied.Output.Length, inPlace.Output.Length);
+			Check.That(copied.Copies <= old.Copies && copied.BytesCopied <= old.BytesCopied, "{0}: {1} copies of {2} bytes, " +
+				"and {3} of {4} before", name, copied.Copies, copied.BytesCopied, old.Copies, old.BytesCopied);
+			Check.That(inPlace.Copies < old.Copies && inPlace.BytesCopied < old.BytesCopied, "{0}: {1} copies of {2} bytes in " +
+				"place, and {3} of {4} before", name, inPlace.Copies, inPlace.BytesCopied, old.Copies, old.BytesCopied);
+		}
+
+		private static Result ConvertOld(OldConverter converter, byte[] input, int chunk, bool intoCaller)
+		{
+			var src = Marshal.AllocHGlobal(chunk);
+			var dst = Marshal.AllocHGlobal(OutputSize);
+			var output = new MemoryStream();
+			int calls = 0;
+			try
+			{
+				for (int offset = 0; offset < input.Length; offset += chunk)
+				{
+					int count = Math.Min(chunk, input.Length - offset);
+					Marshal.Copy(input, offset, src, count);
+					IntPtr converted = dst;
+					int size = intoCaller ? converter.Convert(src, count, dst, OutputSize) : converter.Convert(src, count, out converted);
+					Append(output, converted, size);
+					calls++;
+				}
+				return new Result
+				{
+					Output = output.ToArray(),
+					Calls = calls,
+					Copies = converter.Copies,
+					BytesCopied = converter.BytesCopied,
+					BytesConverted = input.Length
+				};
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(src);
+				Marshal.FreeHGlobal(dst);
+			}
+		}
+
+		private static Result ConvertNew(AudioConverter converter, byte[] input, int chunk, bool inPlace, bool intoCaller)
+		{
+			var src = Marshal.AllocHGlobal(chunk);
+			var dst = Marshal.AllocHGlobal(OutputSize);
+			var output = new MemoryStream();
+			int calls = 0;
+			try
+			{
+				for (int offset = 0; offset < input.Length; offset += chunk)
+				{
+					int count = Math.Min(chunk, input.Length - offset);
+					var from = inPlace ? converter.SourceBuffer : src;
+					Marshal.Copy(input, offset, from, count);
+					IntPtr converted = dst;
+					int size = intoCaller ? converter.Convert(from, count, dst, OutputSize) : converter.Convert(from, count, out converted);
+					Append(output, converted, size);
+					calls++;
+				}
+				return new Result
+				{
+					Output = output.ToArray(),
+					Calls = calls,
+					Copies = converter.Copies,
+					BytesCopied = converter.BytesCopied,
+					BytesConverted = converter.BytesConverted
+				};
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(src);
+				Marshal.FreeHGlobal(dst);
+			}
+		}
+
+		private static void Append(MemoryStream output, IntPtr buffer, int size)
+		{
+			var bytes = new byte[size];
+			Marshal.Copy(buffer, bytes, 0, size);
+			output.Write(bytes, 0, size);
+		}
+
+		private static void Print(string name, string path, Result result)
+		{
+			Console.WriteLine("{0,-16} {1,-8} {2,6} {3,12:F2} {4,12:F1} {5,12:F3} {6,9}", name, path, result.Calls,
+				(double)result.Copies / result.Calls, (double)result.BytesCopied / result.Calls,
+				(double)result.BytesCopied / result.BytesConverted, result.Output.Length);
+		}
+
+		private static bool Same(byte[] a, byte[] b)
+		{
+			if (a.Length != b.Length)
+			{
+				return false;
+			}
+			for (int i = 0; i < a.Length; i++)
+			{
+				if (a[i] != b[i])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// A tone with a little noise, as 16-bit mono samples.
+		private static byte[] MakeTone(int rate, double seconds)
+		{
+			var random = new Random(1);
+			var bytes = new byte[(int)(rate * seconds) * 2];
+			for (int i = 0; i < bytes.Length / 2; i++)
+			{
+				short sample = (short)(Math.Sin(2 * Math.PI * 440 * i / rate) * 8000 + random.Next(-200, 200));
+				bytes[i * 2] = (byte)sample;
+				bytes[i * 2 + 1] = (byte)(sample >> 8);
+			}
+			return bytes;
+		}
+	}
+}
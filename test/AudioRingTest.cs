@@ -0,0 +1,424 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Threading;
+using Floe.Interop;
+
+namespace test
+{
+	// Passes audio from one thread to another through an AudioRing, and through a copy of the FifoStream that
+	// VoiceLoopback used before it, and compares how fast each moves it and how much each allocates to do so.
+	//
+	// The writer sends chunks of 64, 320, 1920 and 8192 bytes, and the reader takes whole 20 ms packets of 48 kHz audio,
+	// as the output device does. The ring holds eight packets, as in VoiceLoopback. The writer never lets more than that
+	// be queued in either, since the ring drops what does not fit, and FifoStream would otherwise grow without bound.
+	// Every byte carries its place in the stream, and the reader must get them all back in order. Allocations are counted
+	// for the whole process while the bytes are moved, which takes in a few KB that the runtime allocates for itself, so
+	// the ring is allowed less than a byte for every KB that it moves. One small object for each packet would be ten times
+	// that.
+	//
+	// Before that, the same is done through a ring of 1000 bytes in pieces of odd sizes, through the Stream methods and
+	// through the Acquire and Commit spans, so that every piece wraps around the end sooner or later. Last, the ring must
+	// count writes that do not fit as overruns, pad short wave source reads with silence and count them as underruns, and
+	// let a blocked Read return what is queued once Complete is called.
+	//
+	// usage: test ring [seconds per row]
+	static class AudioRingTest
+	{
+		private const int PacketSize = 1920;
+		private const int RingPackets = 8; // as in VoiceLoopback
+		private const int Period = 251;
+
+		// The FifoStream that VoiceLoopback used before AudioRing, as it was.
+		private class OldFifo : Stream
+		{
+			private const int BlockSize = 8192;
+
+			private LinkedList<byte[]> _blocks;
+			private int _readIdx, _writeIdx;
+			private ManualResetEventSlim _pulse;
+			private bool _isDisposed;
+
+			public OldFifo()
+			{
+				_blocks = new LinkedList<byte[]>();
+				_pulse = new ManualResetEventSlim(false);
+			}
+
+			public override bool CanRead { get { return true; } }
+			public override bool CanSeek { get { return false; } }
+			public override bool CanWrite { get { return true; } }
+			public override void Flush() { throw new NotImplementedException(); }
+			public override long Length { get { throw new NotImplementedException(); } }
+			public override long Position { get { throw new NotImplementedException(); } set { throw new NotImplementedException(); } }
+			public override long Seek(long offset, SeekOrigin origin) { throw new NotImplementedException(); }
+			public override void SetLength(long value) { throw new NotImplementedException(); }
+
+			public override int Read(byte[] buffer, int offset, int count)
+			{
+				_pulse.Wait();
+				if (_isDisposed)
+				{
+					return 0;
+				}
+				int total = 0;
+				lock (_blocks)
+				{
+					while (count > 0)
+					{
+						int written;
+						written = Math.Min(count, (_blocks.First == _blocks.Last ? _writeIdx : BlockSize) - _readIdx);
+						Array.Copy(_blocks.First.Value, _readIdx, buffer, offset, written);
+						count -= written;
+						offset += written;
+						_readIdx += written;
+
+						if (_readIdx >= BlockSize)
+						{
+							_blocks.RemoveFirst();
+							_readIdx = 0;
+						}
+						total += written;
+
+						if (_blocks.First == null ||
+							(_blocks.First == _blocks.Last && _readIdx >= _writeIdx))
+						{
+							_pulse.Reset();
+							break;
+						}
+					}
+				}
+				return total;
+			}
+
+			public override void Write(byte[] buffer, int offset, int count)
+			{
+				if (count < 1)
+				{
+					return;
+				}
+
+				lock (_blocks)
+				{
+					while (count > 0)
+					{
+						if (_blocks.Last == null || _writeIdx >= BlockSize)
+						{
+							_blocks.AddLast(new byte[BlockSize]);
+							_writeIdx = 0;
+						}
+						int written = Math.Min(count, BlockSize - _writeIdx);
+						Array.Copy(buffer, offset, _blocks.Last.Value, _writeIdx, written);
+						count -= written;
+						offset += written;
+						_writeIdx += written;
+						_pulse.Set();
+					}
+				}
+			}
+
+			public override void Close()
+			{
+				base.Close();
+				_isDisposed = true;
+				_pulse.Set();
+			}
+		}
+
+		private class Outcome
+		{
+			public long Bytes, Errors;
+			public double MegabytesPerSecond, BytesPerKilobyte;
+		}
+
+		public static void Run(string[] args)
+		{
+			double seconds = args.Length > 0 ? double.Parse(args[0]) : 1.0;
+			AppDomain.MonitoringIsEnabled = true;
+
+			// The pattern that the writer copies from: byte i of the stream is i modulo a prime, so that no chunk or packet
+			// size lines up with it.
+			var pattern = new byte[Period * (8192 / Period + 2)];
+			for (int i = 0; i < pattern.Length; i++)
+			{
+				pattern[i] = (byte)(i % Period);
+			}
+
+			CheckOddPieces(pattern, seconds / 4);
+			CheckSpans(seconds / 4);
+			CheckEdges();
+
+			Console.WriteLine("{0,6} {1,10} {2,12} {3,10} {4,12}", "chunk", "ring MB/s", "ring B/KB", "old MB/s", "old B/KB");
+			foreach (int chunk in new int[] { 64, 320, 1920, 8192 })
+			{
+				Outcome outcome, old;
+				using (var ring = new AudioRing(PacketSize * RingPackets))
+				{
+					outcome = Pass(ring, ring.Capacity, pattern, chunk, PacketSize, seconds);
+				}
+				using (var fifo = new OldFifo())
+				{
+					old = Pass(fifo, PacketSize * RingPackets, pattern, chunk, PacketSize, seconds);
+				}
+				Console.WriteLine("{0,6} {1,10:F1} {2,12:F2} {3,10:F1} {4,12:F2}", chunk, outcome.MegabytesPerSecond,
+					outcome.BytesPerKilobyte, old.MegabytesPerSecond, old.BytesPerKilobyte);
+
+				string name = string.Format("{0}-byte chunks", chunk);
+				Check.That(outcome.Errors == 0 && old.Errors == 0, "{0}: {1} bytes came out of the ring wrong, and {2} out of FifoStream",
+					name, outcome.Errors, old.Errors);
+				Check.That(outcome.BytesPerKilobyte < 1, "{0}: the ring allocated {1:F2} bytes for every KB it moved", name,
+					outcome.BytesPerKilobyte);
+			}
+		}
+
+		// Writes chunks of the given size on one thread and reads packets of the given size on another for about the given
+		// time, never letting more than the limit be queued. The reader checks every byte against the pattern. FifoStream
+		// returns what it has rather than waiting for the whole count, so reads are repeated until the packet is whole.
+		private static Outcome Pass(Stream stream, int limit, byte[] pattern, int chunk, int packet, double seconds)
+		{
+			long written = 0, read = 0, errors = 0;
+			var reader = new Thread(() =>
+			{
+				var buffer = new byte[packet];
+				while (true)
+				{
+					int count = 0;
+					while (count < packet)
+					{
+						int size = stream.Read(buffer, count, packet - count);
+						if (size == 0)
+						{
+							break;
+						}
+						count += size;
+					}
+					if (count == 0)
+					{
+						return;
+					}
+					long position = Interlocked.Read(ref read);
+					for (int i = 0; i < count; i++)
+					{
+						if (buffer[i] != (byte)((position + i) % Period))
+						{
+							errors++;
+						}
+					}
+					Interlocked.Add(ref read, count);
+				}
+			});
+			reader.Start();
+
+			GC.Collect();
+			long allocated = AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize;
+			var clock = Stopwatch.StartNew();
+			while (clock.Elapsed.TotalSeconds < seconds || written % packet != 0)
+			{
+				int size = chunk;
+				if (clock.Elapsed.TotalSeconds >= seconds)
+				{
+					// Finish on a whole packet, so that the reader is not left waiting for the rest of one.
+					size = Math.Min(chunk, packet - (int)(written % packet));
+				}
+				if (written + size - Interlocked.Read(ref read) > limit)
+				{
+					Thread.Yield();
+					continue;
+				}
+				stream.Write(pattern, (int)(written % Period), size);
+				written += size;
+			}
+			while (Interlocked.Read(ref read) < written && clock.Elapsed.TotalSeconds < seconds + 2)
+			{
+				Thread.Yield();
+			}
+			double elapsed = clock.Elapsed.TotalSeconds;
+			long bytes = AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize - allocated;
+
+			bool done = Interlocked.Read(ref read) == written;
+			if (stream is AudioRing)
+			{
+				((AudioRing)stream).Complete();
+			}
+			else
+			{
+				stream.Close();
+			}
+			reader.Join();
+
+			var outcome = new Outcome();
+			outcome.Bytes = written;
+			outcome.Errors = errors + (done ? 0 : written - read);
+			outcome.MegabytesPerSecond = written / elapsed / 1e6;
+			outcome.BytesPerKilobyte = (double)bytes / written * 1024;
+			return outcome;
+		}
+
+		private static void CheckOddPieces(byte[] pattern, double seconds)
+		{
+			// Writes of 1 to 333 bytes and reads of 1 to 509 bytes, against a capacity of 1024, each thread with its own
+			// sequence of sizes.
+			using (var ring = new AudioRing(1000))
+			{
+				Check.That(ring.Capacity == 1024, "a ring of 1000 bytes was given a capacity of {0}", ring.Capacity);
+				long written = 0, read = 0, errors = 0;
+				var reader = new Thread(() =>
+				{
+					var random = new Random(2);
+					var buffer = new byte[509];
+					while (true)
+					{
+						int size = ring.Read(buffer, 0, random.Next(1, buffer.Length + 1));
+						if (size == 0)
+						{
+							return;
+						}
+						for (int i = 0; i < size; i++)
+						{
+							if (buffer[i] != (byte)((read + i) % Period))
+							{
+								errors++;
+							}
+						}
+						Interlocked.Add(ref read, size);
+					}
+				});
+				reader.Start();
+
+				var sizes = new Random(1);
+				var clock = Stopwatch.StartNew();
+				while (clock.Elapsed.TotalSeconds < seconds)
+				{
+					int size = sizes.Next(1, 334);
+					while (written + size - Interlocked.Read(ref read) > ring.Capacity)
+					{
+						Thread.Yield();
+					}
+					ring.Write(pattern, (int)(written % Period), size);
+					written += size;
+				}
+				ring.Complete();
+				reader.Join();
+
+				Console.WriteLine("odd pieces: {0} bytes through a ring of {1}", written, ring.Capacity);
+				Check.That(read == written && errors == 0 && ring.Overruns == 0,
+					"odd pieces: {0} of {1} bytes were read, {2} of them wrong, with {3} overruns", read, written, errors,
+					ring.Overruns);
+			}
+		}
+
+		private static void CheckSpans(double seconds)
+		{
+			// The writer fills whatever span it is given, up to a size of its own choosing, in place; so does the reader.
+			using (var ring = new AudioRing(1000))
+			{
+				long written = 0, read = 0, errors = 0;
+				int stop = 0;
+				var reader = new Thread(() =>
+				{
+					var random = new Random(2);
+					while (true)
+					{
+						int span;
+						var source = ring.AcquireRead(out span);
+						if (span == 0)
+						{
+							// Everything has been read once the writer has stopped and nothing more was written before it did.
+							if (Thread.VolatileRead(ref stop) != 0 && Thread.VolatileRead(ref written) == read)
+							{
+								return;
+							}
+							Thread.Yield();
+							continue;
+						}
+						int size = Math.Min(span, random.Next(1, 510));
+						for (int i = 0; i < size; i++)
+						{
+							if (Marshal.ReadByte(source, i) != (byte)((read + i) % Period))
+							{
+								errors++;
+							}
+						}
+						ring.CommitRead(size);
+						read += size;
+					}
+				});
+				reader.Start();
+
+				var sizes = new Random(1);
+				var clock = Stopwatch.StartNew();
+				while (clock.Elapsed.TotalSeconds < seconds)
+				{
+					int span;
+					var target = ring.AcquireWrite(out span);
+					if (span == 0)
+					{
+						Thread.Yield();
+						continue;
+					}
+					int size = Math.Min(span, sizes.Next(1, 334));
+					for (int i = 0; i < size; i++)
+					{
+						Marshal.WriteByte(target, i, (byte)((written + i) % Period));
+					}
+					ring.CommitWrite(size);
+					Thread.VolatileWrite(ref written, written + size);
+				}
+				Thread.VolatileWrite(ref stop, 1);
+				reader.Join();
+
+				Console.WriteLine("spans: {0} bytes through a ring of {1}", written, ring.Capacity);
+				Check.That(read == written && errors == 0, "spans: {0} of {1} bytes were read, {2} of them wrong", read, written,
+					errors);
+			}
+		}
+
+		private static void CheckEdges()
+		{
+			var buffer = Marshal.AllocHGlobal(256);
+			try
+			{
+				using (var ring = new AudioRing(256))
+				{
+					var bytes = new byte[200];
+					for (int i = 0; i < bytes.Length; i++)
+					{
+						bytes[i] = (byte)(i + 1);
+					}
+
+					// 200 and then 100 bytes into 256: the second write is cut short.
+					ring.Write(bytes, 0, 200);
+					ring.Write(bytes, 0, 100);
+					Check.That(ring.Count == 256 && ring.Overruns == 1, "a full ring held {0} bytes with {1} overruns", ring.Count,
+						ring.Overruns);
+
+					// The wave source gives the 256 bytes and then 100 more of silence.
+					var source = (IWaveSource)ring;
+					Check.That(source.Read(buffer, 256) == 256 && ring.Underruns == 0, "reading a full ring was an underrun");
+					ring.Write(bytes, 0, 156);
+					Check.That(source.Read(buffer, 256) == 256 && ring.Underruns == 1 && Marshal.ReadByte(buffer, 155) == 156 &&
+						Marshal.ReadByte(buffer, 156) == 0 && Marshal.ReadByte(buffer, 255) == 0,
+						"a short wave source read was not padded with silence and counted");
+
+					// A Read blocked for more than is queued gives what there is once the ring is completed, and then nothing.
+					ring.Write(bytes, 0, 50);
+					int size = -1;
+					var reader = new Thread(() => size = ring.Read(bytes, 0, 200));
+					reader.Start();
+					Thread.Sleep(50);
+					Check.That(size == -1, "Read returned before the whole count was queued");
+					ring.Complete();
+					reader.Join();
+					Check.That(size == 50 && ring.Read(bytes, 0, 200) == 0 && source.Read(buffer, 256) == 0,
+						"after Complete, Read gave {0} of the 50 bytes queued, and then did not stop", size);
+				}
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(buffer);
+			}
+		}
+	}
+}
@@ -0,0 +1,37 @@
+﻿using System;
+using System.Net;
+using System.Runtime.InteropServices;
+using Floe.Audio;
+
+namespace test
+{
+	// Opens a voice session with a single peer, for listening to the codecs and devices by hand. The A key is push to talk.
+	static class CallTest
+	{
+		[DllImport("user32.dll", CharSet = CharSet.Auto, ExactSpelling = true)]
+		private static extern short GetKeyState(int keyCode);
+
+		public static void Run(string[] args)
+		{
+			if (args.Length < 2)
+			{
+				Console.WriteLine("usage: test call <host> <port> [sample rate]");
+				return;
+			}
+			int sampleRate = args.Length > 2 ? int.Parse(args[2]) : 21760;
+			var endpoint = new IPEndPoint(Dns.GetHostEntry(args[0]).AddressList[0], int.Parse(args[1]));
+
+			var client = new VoiceClient(new CodecInfo(VoiceCodec.Gsm610, sampleRate), null,
+				() =>
+				{
+					return (GetKeyState(0x41) & 0x8000) > 0;
+				});
+			client.AddPeer(VoiceCodec.Gsm610, sampleRate, endpoint);
+			client.Open();
+			Console.ReadLine();
+			client.InputGain = 10;
+			Console.ReadLine();
+			client.Dispose();
+		}
+	}
+}
@@ -0,0 +1,212 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using System.Threading;
+using Floe.Audio;
+using Floe.Interop;
+
+namespace test
+{
+	// Feeds a made-up microphone through VoiceIn a packet at a time, as WaveIn lends each recorded buffer to its sink, and
+	// sends what it encodes to a peer over loopback, using GSM at 8 kHz with a gain of 6 dB and no voice activity detection.
+	// The same input is then sent the way capture used to go: each buffer copied out into a managed array, the gain
+	// applied there, the array encoded by the ACM encoder, which copies it in and the result out, and that sent from a
+	// managed array. Both send through the same RtpClient, and last the packets are sent from it alone, to see what the
+	// sending and receiving allocate by themselves.
+	//
+	// VoiceIn must work on the buffer it is lent: once Write returns, the buffer must hold the input with the gain
+	// applied. The peer must receive every packet. The table gives the bytes copied and the bytes allocated by the whole
+	// process for each packet. VoiceIn must copy the payload into the outgoing packet and nothing else, which is less than
+	// the old path copies, the RtpClient must allocate nothing after the first send, and VoiceIn must allocate next to
+	// nothing beyond what sending alone does.
+	//
+	// usage: test capture [packets]
+	static class CaptureTest
+	{
+		private const int SampleRate = 8000;
+		private const float GainDb = 6f;
+		private const int Timeout = 5000; // milliseconds
+		private const int Window = 4; // packets, half the send queue
+		private const double MaxAllocation = 8; // bytes a packet, above what sending alone allocates
+
+		private enum Path
+		{
+			VoiceIn,
+			Old,
+			SendOnly
+		}
+
+		private class Result
+		{
+			public long Copied, Allocated, Received;
+			public long Allocations, FirstAllocations;
+		}
+
+		public static void Run(string[] args)
+		{
+			int packets = args.Length > 0 ? int.Parse(args[0]) : 2000;
+			AppDomain.MonitoringIsEnabled = true;
+			var codec = new CodecInfo(VoiceCodec.Gsm610, SampleRate);
+			var input = MakeInput(codec, packets);
+
+			Console.WriteLine("{0,-8} {1,8} {2,8} {3,12} {4,12} {5,12}", "path", "packets", "received", "copied/pkt",
+				"alloc B/pkt", "rtp allocs");
+			var now = Capture(codec, input, Path.VoiceIn);
+			var old = Capture(codec, input, Path.Old);
+			var send = Capture(codec, input, Path.SendOnly);
+			Print("voicein", packets, now);
+			Print("old", packets, old);
+			Print("send", packets, send);
+
+			Check.That(now.Received == packets && old.Received == packets && send.Received == packets, "the peer received " +
+				"{0}, {1} and {2} of {3} packets", now.Received, old.Received, send.Received, packets);
+			Check.That(now.Copied == (long)packets * codec.EncodedBufferSize, "VoiceIn copied {0} bytes for {1} packets of " +
+				"{2} bytes", now.Copied, packets, codec.EncodedBufferSize);
+			Check.That(now.Allocations == now.FirstAllocations, "the RtpClient allocated {0} objects after the first send",
+				now.Allocations - now.FirstAllocations);
+			Check.That(now.Copied < old.Copied, "VoiceIn copied {0} bytes, and the old path {1}", now.Copied, old.Copied);
+			Check.That(now.Allocated - send.Allocated < packets * MaxAllocation, "VoiceIn allocated {0:F1} bytes a packet more " +
+				"than sending alone", (double)(now.Allocated - send.Allocated) / packets);
+		}
+
+		// Sends every packet of the input to a peer on loopback, through VoiceIn or the old path, and waits for the peer to
+		// receive them. What is allocated before the first packet is sent is left out.
+		private static Result Capture(CodecInfo codec, short[][] input, Path path)
+		{
+			var result = new Result();
+			var buffer = Marshal.AllocHGlobal(codec.DecodedBufferSize);
+			var bytes = new byte[codec.DecodedBufferSize];
+			var payload = new byte[codec.EncodedBufferSize];
+			float gain = (float)Math.Pow(10, GainDb / 20f);
+			var receiver = new TestPeer(codec.EncodedBufferSize);
+			var sender = new TestPeer(codec.EncodedBufferSize);
+			VoiceIn voiceIn = null;
+			AudioConverter encoder = null;
+			try
+			{
+				receiver.AddPeer(sender.LocalEndPoint);
+				sender.AddPeer(receiver.LocalEndPoint);
+				receiver.Open();
+				sender.Open();
+				if (path == Path.Old)
+				{
+					encoder = codec.GetEncoder();
+				}
+				else if (path == Path.VoiceIn)
+				{
+					voiceIn = new VoiceIn(codec, sender, null);
+					voiceIn.VoiceActivityDetection = false;
+					voiceIn.Gain = GainDb;
+				}
+
+				long allocated = 0, copied = 0;
+				for (int frame = 0; frame < input.Length; frame++)
+				{
+					if (frame == 1)
+					{
+						GC.Collect();
+						allocated = AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize;
+						result.FirstAllocations = sender.Allocations;
+					}
+					// A packet time is not waited out between packets, but the next is not sent until the last few have
+					// arrived, so that none is dropped for want of room in the send queue or the socket.
+					while (frame - Received(receiver, codec) >= Window)
+					{
+						Thread.Yield();
+					}
+					Marshal.Copy(input[frame], 0, buffer, codec.SamplesPerPacket);
+					if (path == Path.SendOnly)
+					{
+						sender.Send(frame * codec.SamplesPerPacket, false);
+						continue;
+					}
+					if (path == Path.Old)
+					{
+						Marshal.Copy(buffer, bytes, 0, codec.DecodedBufferSize);
+						copied += codec.DecodedBufferSize;
+						WavProcess.ApplyGain(gain, bytes, codec.DecodedBufferSize);
+						encoder.Convert(bytes, codec.DecodedBufferSize, payload);
+						sender.Send(frame * codec.SamplesPerPacket, payload);
+						continue;
+					}
+
+					voiceIn.Write(buffer, codec.DecodedBufferSize);
+					for (int i = 0; i < codec.SamplesPerPacket; i++)
+					{
+						short sample = Marshal.ReadInt16(buffer, i * 2), expected = Amplify(input[frame][i], gain);
+						if (sample != expected)
+						{
+							Check.That(false, "sample {0} of packet {1} was {2} after Write, and {3} with the gain applied", i,
+								frame, sample, expected);
+							break;
+						}
+					}
+				}
+
+				var start = DateTime.UtcNow;
+				while (Received(receiver, codec) < input.Length && (DateTime.UtcNow - start).TotalMilliseconds < Timeout)
+				{
+					Thread.Sleep(1);
+				}
+				var stream = receiver.GetStream(sender.LocalEndPoint);
+				result.Received = stream != null ? stream.Received : 0;
+				result.Allocated = AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize - allocated;
+				result.Allocations = sender.Allocations;
+				result.Copied = path == Path.VoiceIn ? voiceIn.GetStatistics().BytesCopied : path == Path.Old ?
+					copied + encoder.BytesCopied + sender.BytesCopied : sender.BytesCopied;
+				return result;
+			}
+			finally
+			{
+				if (voiceIn != null)
+				{
+					voiceIn.Dispose();
+				}
+				if (encoder != null)
+				{
+					encoder.Dispose();
+				}
+				sender.Dispose();
+				receiver.Dispose();
+				Marshal.FreeHGlobal(buffer);
+			}
+		}
+
+		// The number of packets the peer has received, counted without allocating.
+		private static long Received(TestPeer receiver, CodecInfo codec)
+		{
+			return receiver.BytesReceived / (TestPeer.HeaderSize + codec.EncodedBufferSize);
+		}
+
+		private static void Print(string name, int packets, Result result)
+		{
+			Console.WriteLine("{0,-8} {1,8} {2,8} {3,12:F1} {4,12:F1} {5,12}", name, packets, result.Received,
+				(double)result.Copied / packets, (double)result.Allocated / Math.Max(1, packets - 1), result.Allocations);
+		}
+
+		// A sample with the gain applied as the gain kernel does it, with halves rounded away from zero.
+		private static short Amplify(short sample, float gain)
+		{
+			float value = sample * gain;
+			return (short)Math.Max(short.MinValue, Math.Min(short.MaxValue, Math.Round(value, MidpointRounding.AwayFromZero)));
+		}
+
+		// A voiced sound with a little noise, loud enough that the gain takes some of its peaks past full scale.
+		private static short[][] MakeInput(CodecInfo codec, int packets)
+		{
+			var random = new Random(1);
+			var input = new short[packets][];
+			double phase = 0;
+			for (int frame = 0; frame < packets; frame++)
+			{
+				input[frame] = new short[codec.SamplesPerPacket];
+				for (int i = 0; i < codec.SamplesPerPacket; i++)
+				{
+					phase += 2 * Math.PI * 150 / codec.SampleRate;
+					double sample = 20000 * Math.Sin(phase) + 4000 * Math.Sin(3 * phase) + random.Next(-300, 300);
+					input[frame][i] = (short)Math.Round(sample);
+				}
+			}
+			return input;
+		}
+	}
+}
@@ -0,0 +1,19 @@
+﻿using System;
+
+namespace test
+{
+	// Counts the checks that fail, and says which ones they were.
+	static class Check
+	{
+		public static int Failures { get; private set; }
+
+		public static void That(bool condition, string format, params object[] args)
+		{
+			if (!condition)
+			{
+				Failures++;
+				Console.WriteLine("FAILED: " + string.Format(format, args));
+			}
+		}
+	}
+}
@@ -0,0 +1,227 @@
+﻿using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using Floe.Interop;
+
+namespace test
+{
+	// Replays signals with packets knocked out of them through a LossConcealer, as JitterBuffer does, and measures how
+	// close the concealed frames come to what was lost, whether the gaps click, and what concealment costs.
+	//
+	// There are two signals at 8 and at 48 kHz: a steady tone of two harmonics, which pitch repetition should carry
+	// across a gap almost perfectly, and a voice-like pulse train with a gliding pitch and moving formant, which it can
+	// only approximate. Each is played with single losses, pairs and bursts of six 20 ms packets. Playing silence in the
+	// gaps, as the jitter buffer used to, would score 0 dB on every lost frame.
+	//
+	// A click shows up as a jump between two samples larger than the signal makes on its own, so the largest jump at the
+	// edges of each gap is compared with the largest in the signal. Bursts of six must fade out and then be given up,
+	// leaving the rest of the gap silent, and ConcealedFrames must count exactly the frames that were filled.
+	//
+	// usage: test conceal [seconds]
+	static class ConcealmentTest
+	{
+		private const int PacketMilliseconds = 20;
+
+		private class Pattern
+		{
+			public string Name;
+			public int Burst, Every;
+
+			public Pattern(string name, int burst, int every)
+			{
+				this.Name = name;
+				this.Burst = burst;
+				this.Every = every;
+			}
+		}
+
+		private class Outcome
+		{
+			public double FirstSnr, LaterSnr, EdgeStep, SignalStep;
+			public int Concealed, Counted, GivenUp;
+			public double ConcealMicroseconds, UpdateMicroseconds;
+		}
+
+		public static void Run(string[] args)
+		{
+			double seconds = args.Length > 0 ? double.Parse(args[0]) : 10.0;
+			var patterns = new Pattern[]
+			{
+				new Pattern("single", 1, 10),
+				new Pattern("pairs", 2, 20),
+				new Pattern("bursts", 6, 30)
+			};
+
+			Console.WriteLine("{0,-6} {1,6} {2,-7} {3,10} {4,10} {5,7} {6,9} {7,10} {8,10}", "signal", "rate", "losses", "first dB",
+				"later dB", "edge", "given up", "conceal us", "update us");
+			foreach (int rate in new int[] { 8000, 48000 })
+			{
+				foreach (bool voice in new bool[] { false, true })
+				{
+					var signal = voice ? MakeVoice(rate, seconds) : MakeTone(rate, seconds);
+					string name = voice ? "voice" : "tone";
+					foreach (var pattern in patterns)
+					{
+						var outcome = Play(signal, rate, pattern);
+						Console.WriteLine("{0,-6} {1,6} {2,-7} {3,10:F1} {4,10:F1} {5,7:F2} {6,9} {7,10:F2} {8,10:F2}", name, rate,
+							pattern.Name, outcome.FirstSnr, outcome.LaterSnr, outcome.EdgeStep / outcome.SignalStep, outcome.GivenUp,
+							outcome.ConcealMicroseconds, outcome.UpdateMicroseconds);
+
+						string label = string.Format("{0} at {1} with {2} losses", name, rate, pattern.Name);
+						Check.That(outcome.FirstSnr > (voice ? 5.0 : 15.0), "{0}: the first lost frame was {1:F1} dB from the original",
+							label, outcome.FirstSnr);
+						Check.That(outcome.EdgeStep <= 1.1 * outcome.SignalStep,
+							"{0}: a jump of {1:F0} at the edge of a gap, where the signal jumps by at most {2:F0}", label, outcome.EdgeStep,
+							outcome.SignalStep);
+						Check.That(outcome.Counted == outcome.Concealed, "{0}: {1} frames were concealed but {2} counted", label,
+							outcome.Concealed, outcome.Counted);
+						Check.That(pattern.Burst < 4 ? outcome.GivenUp == 0 : outcome.GivenUp > 0, "{0}: {1} frames were left silent",
+							label, outcome.GivenUp);
+					}
+				}
+			}
+		}
+
+		// 150 Hz and its third harmonic.
+		private static short[] MakeTone(int rate, double seconds)
+		{
+			var samples = new short[(int)(rate * seconds)];
+			for (int i = 0; i < samples.Length; i++)
+			{
+				double t = (double)i / rate;
+				samples[i] = (short)(8000 * Math.Sin(2 * Math.PI * 150 * t) + 3000 * Math.Sin(2 * Math.PI * 450 * t));
+			}
+			return samples;
+		}
+
+		// A pulse train with a pitch that glides between 100 and 160 Hz, smoothed and passed through a resonance that
+		// moves, so that it sounds much the same at either rate. It is scaled to a peak of about a third of full scale.
+		private static short[] MakeVoice(int rate, double seconds)
+		{
+			var values = new double[(int)(rate * seconds)];
+			double phase = 0, smooth = 0, y1 = 0, y2 = 0, peak = 0;
+			double a = Math.Exp(-2 * Math.PI * 2500.0 / rate), r = Math.Exp(-Math.PI * 100.0 / rate);
+			for (int i = 0; i < values.Length; i++)
+			{
+				double t = (double)i / rate;
+				phase += (130 + 30 * Math.Sin(2 * Math.PI * 0.5 * t)) / rate;
+				double x = 0;
+				if (phase >= 1)
+				{
+					phase -= 1;
+					x = 1;
+				}
+				smooth = smooth * a + x * (1 - a);
+				double f = 700 + 200 * Math.Sin(2 * Math.PI * 0.3 * t);
+				double y = smooth + 2 * r * Math.Cos(2 * Math.PI * f / rate) * y1 - r * r * y2;
+				y2 = y1;
+				y1 = y;
+				values[i] = y;
+				peak = Math.Max(peak, Math.Abs(y));
+			}
+
+			var samples = new short[values.Length];
+			for (int i = 0; i < values.Length; i++)
+			{
+				samples[i] = (short)(values[i] * 10000 / peak);
+			}
+			return samples;
+		}
+
+		private static Outcome Play(short[] signal, int rate, Pattern pattern)
+		{
+			var outcome = new Outcome();
+			int frameSize = rate * PacketMilliseconds / 1000;
+			int frames = signal.Length / frameSize;
+			var output = new short[frames * frameSize];
+			var concealer = new LossConcealer(rate);
+			var buffer = Marshal.AllocHGlobal(frameSize * 2);
+			var conceal = new Stopwatch();
+			var update = new Stopwatch();
+			double firstSnr = 0, laterSnr = 0;
+			int firstCount = 0, laterCount = 0, updates = 0;
+			try
+			{
+				for (int i = 0; i < frames; i++)
+				{
+					// The first packets of each pattern period are lost, after a second to get going.
+					int inPeriod = i % pattern.Every;
+					bool lost = i >= 1000 / PacketMilliseconds && inPeriod < pattern.Burst;
+					int size;
+					if (lost)
+					{
+						conceal.Start();
+						size = concealer.Conceal(buffer, frameSize * 2);
+						conceal.Stop();
+						if (size > 0)
+						{
+							outcome.Concealed++;
+							Marshal.Copy(buffer, output, i * frameSize, frameSize);
+						}
+						else
+						{
+							outcome.GivenUp++;
+						}
+
+						double snr = Snr(signal, output, i * frameSize, frameSize);
+						if (inPeriod == 0)
+						{
+							firstSnr += snr;
+							firstCount++;
+						}
+						else if (size > 0)
+						{
+							laterSnr += snr;
+							laterCount++;
+						}
+					}
+					else
+					{
+						Marshal.Copy(signal, i * frameSize, buffer, frameSize);
+						update.Start();
+						concealer.Update(buffer, frameSize * 2);
+						update.Stop();
+						updates++;
+						Marshal.Copy(buffer, output, i * frameSize, frameSize);
+					}
+
+					// The edges of a gap are its first sample and the first sample after it.
+					if (i > 0 && i >= 1000 / PacketMilliseconds && (inPeriod == 0 || inPeriod == pattern.Burst))
+					{
+						int n = i * frameSize;
+						outcome.EdgeStep = Math.Max(outcome.EdgeStep, Math.Abs(output[n] - output[n - 1]));
+					}
+				}
+				outcome.Counted = concealer.ConcealedFrames;
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(buffer);
+				concealer.Dispose();
+			}
+
+			for (int i = 1; i < output.Length; i++)
+			{
+				outcome.SignalStep = Math.Max(outcome.SignalStep, Math.Abs(signal[i] - signal[i - 1]));
+			}
+			outcome.FirstSnr = firstCount > 0 ? firstSnr / firstCount : 0;
+			outcome.LaterSnr = laterCount > 0 ? laterSnr / laterCount : 0;
+			int calls = outcome.Concealed + outcome.GivenUp;
+			outcome.ConcealMicroseconds = calls > 0 ? conceal.Elapsed.TotalMilliseconds * 1000 / calls : 0;
+			outcome.UpdateMicroseconds = updates > 0 ? update.Elapsed.TotalMilliseconds * 1000 / updates : 0;
+			return outcome;
+		}
+
+		// The ratio of the power of the original frame to that of the difference, in dB.
+		private static double Snr(short[] expected, short[] actual, int offset, int count)
+		{
+			double signal = 0, noise = 0;
+			for (int i = offset; i < offset + count; i++)
+			{
+				signal += (double)expected[i] * expected[i];
+				noise += (double)(expected[i] - actual[i]) * (expected[i] - actual[i]);
+			}
+			return 10 * Math.Log10((signal + 1) / (noise + 1));
+		}
+	}
+}
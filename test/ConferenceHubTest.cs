@@ -0,0 +1,552 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Net;
+using System.Net.Sockets;
+using System.Runtime.InteropServices;
+using System.Threading;
+using Floe.Audio;
+using Floe.Interop;
+
+namespace test
+{
+	// Measures what a mixing VoiceHub costs and how much delay it adds, for conferences of 8, 32 and 128 members using
+	// GSM at 8 kHz.
+	//
+	// ConferenceMixer is checked first against sums in C#: the loudest inputs must be chosen as speakers, listeners must
+	// hear the saturated sum of the speakers, and each speaker the sum of the others. A speaker must keep its place
+	// against a stream that is only a little louder, lose it to one that is much louder, and give it up at once when its
+	// input is reset.
+	//
+	// The cost of one round, as the hub makes it once per packet, is then measured outside the hub: every member's
+	// packet decoded, the mix, and the encoding of the common mix and of each speaker's. Last, a real hub is run over
+	// loopback, with every member sending a packet each period from a socket of its own. One member talks in bursts and
+	// the others send silence. The added latency is the time from sending the first packet of a burst to the arrival at
+	// another member of the first packet in which it can be heard. Every listener must get every packet of every burst,
+	// the talking member must not hear itself, nobody may hear anything but silence while nobody talks, and the hub must
+	// never fall behind.
+	//
+	// usage: test hub [seconds per row]
+	static class ConferenceHubTest
+	{
+		private const int SampleRate = 8000;
+		private const int MaxSpeakers = 3;
+		private const int Bursts = 5;
+		private const int BurstLength = 15; // packets
+		private const int BurstEvery = 40; // packets
+		private const int LeadIn = 25; // packets
+		private const double Heard = 1000; // RMS
+		private const double Silent = 100; // RMS
+
+		// The sockets of the members of a hub, which keep the packets from the hub that arrive at each, decoding those
+		// that arrive at the first two.
+		private class Members : IDisposable
+		{
+			private Socket[] _sockets;
+			private int[] _received;
+			private Gsm610Codec[] _decoders;
+			private List<KeyValuePair<long, double>>[] _heard;
+			private Thread _thread;
+			private volatile bool _stop;
+
+			public Members(int count, IPEndPoint hub)
+			{
+				_sockets = new Socket[count];
+				_received = new int[count];
+				_decoders = new Gsm610Codec[] { new Gsm610Codec(), new Gsm610Codec() };
+				_heard = new List<KeyValuePair<long, double>>[] { new List<KeyValuePair<long, double>>(), new List<KeyValuePair<long, double>>() };
+				for (int i = 0; i < count; i++)
+				{
+					_sockets[i] = new Socket(AddressFamily.InterNetwork, SocketType.Dgram, ProtocolType.Udp);
+					_sockets[i].ReceiveBufferSize = 1 << 18;
+					_sockets[i].Bind(new IPEndPoint(IPAddress.Loopback, 0));
+					_sockets[i].Connect(hub);
+				}
+				_thread = new Thread(this.Loop);
+				_thread.IsBackground = true;
+				_thread.Start();
+			}
+
+			public IPEndPoint GetEndPoint(int i)
+			{
+				return (IPEndPoint)_sockets[i].LocalEndPoint;
+			}
+
+			public void Send(int i, byte[] packet)
+			{
+				_sockets[i].Send(packet);
+			}
+
+			public int GetReceived(int i)
+			{
+				return Thread.VolatileRead(ref _received[i]);
+			}
+
+			// The arrival time and decoded RMS of each packet that has arrived at one of the first two members.
+			public KeyValuePair<long, double>[] GetHeard(int i)
+			{
+				lock (_heard[i])
+				{
+					return _heard[i].ToArray();
+				}
+			}
+
+			public void Dispose()
+			{
+				_stop = true;
+				_thread.Join();
+				foreach (var socket in _sockets)
+				{
+					socket.Close();
+				}
+				foreach (var decoder in _decoders)
+				{
+					decoder.Dispose();
+				}
+			}
+
+			private void Loop()
+			{
+				var buffer = new byte[2048];
+				var decoded = Marshal.AllocHGlobal(4096);
+				var samples = new short[2048];
+				var ready = new List<Socket>();
+				try
+				{
+					while (!_stop)
+					{
+						ready.Clear();
+						ready.AddRange(_sockets);
+						Socket.Select(ready, null, null, 50000);
+						long now = Stopwatch.GetTimestamp();
+						foreach (var socket in ready)
+						{
+							int i = Array.IndexOf(_sockets, socket);
+							while (socket.Available > 0)
+							{
+								// The hub's RTCP reports are left out.
+								int size = socket.Receive(buffer);
+								if (size <= TestPeer.HeaderSize || (buffer[1] & 0x7f) != TestPeer.AudioPayloadType)
+								{
+									continue;
+								}
+								Interlocked.Increment(ref _received[i]);
+								if (i < _decoders.Length)
+								{
+									var payload = Marshal.AllocHGlobal(size);
+									Marshal.Copy(buffer, TestPeer.HeaderSize, payload, size - TestPeer.HeaderSize);
+									int count = _decoders[i].Decode(payload, size - TestPeer.HeaderSize, decoded, 4096) / 2;
+									Marshal.FreeHGlobal(payload);
+									Marshal.Copy(decoded, samples, 0, count);
+									lock (_heard[i])
+									{
+										_heard[i].Add(new KeyValuePair<long, double>(now, Rms(samples, 0, count)));
+									}
+								}
+							}
+						}
+					}
+				}
+				finally
+				{
+					Marshal.FreeHGlobal(decoded);
+				}
+			}
+		}
+
+		private class Latency
+		{
+			public double Mean, Max, HeardSelf, HeardIdle;
+			public int Missed, LeastReceived;
+			public long LateMixes;
+			public float MixTime;
+		}
+
+		public static void Run(string[] args)
+		{
+			double seconds = args.Length > 0 ? double.Parse(args[0]) : 1.0;
+			var random = new Random(1);
+			var codec = new CodecInfo(VoiceCodec.Gsm610, SampleRate);
+
+			CheckMix(random, codec.SamplesPerPacket);
+			CheckSelection(random, codec.SamplesPerPacket);
+
+			double period = codec.SamplesPerPacket * 1000.0 / SampleRate;
+			Console.WriteLine("{0,7} {1,10} {2,9} {3,7} {4,8} {5,9} {6,8} {7,9} {8,9}", "members", "round us", "mixes/s", "load %",
+				"mix us", "hub us", "mean ms", "max ms", "late");
+			foreach (int members in new int[] { 8, 32, 128 })
+			{
+				double mixOnly;
+				double round = MeasureRound(random, codec, members, seconds, out mixOnly);
+				var latency = Converse(codec, members);
+				Console.WriteLine("{0,7} {1,10:F1} {2,9:F0} {3,7:F2} {4,8:F2} {5,9:F2} {6,8:F1} {7,9:F1} {8,9}", members, round,
+					1e6 / round, round / (period * 10), mixOnly, latency.MixTime, latency.Mean, latency.Max, latency.LateMixes);
+
+				string name = string.Format("{0} members", members);
+				Check.That(latency.Missed == 0, "{0}: {1} of {2} bursts were never heard", name, latency.Missed, Bursts);
+				Check.That(latency.Max < 4 * period, "{0}: a burst took {1:F1} ms to be heard", name, latency.Max);
+				Check.That(latency.HeardSelf < Silent, "{0}: the talking member heard itself at an RMS of {1:F0}", name,
+					latency.HeardSelf);
+				Check.That(latency.HeardIdle < Silent, "{0}: a listener heard an RMS of {1:F0} with nobody talking", name,
+					latency.HeardIdle);
+				Check.That(latency.LeastReceived >= Bursts * BurstLength, "{0}: a listener got {1} packets for {2} packets of talk",
+					name, latency.LeastReceived, Bursts * BurstLength);
+				Check.That(latency.LateMixes == 0, "{0}: the hub fell behind {1} times", name, latency.LateMixes);
+			}
+		}
+
+		// Random samples of plus or minus the amplitude, so that the RMS is the amplitude.
+		private static short[] MakeSamples(Random random, int count, int amplitude)
+		{
+			var samples = new short[count];
+			for (int i = 0; i < count; i++)
+			{
+				samples[i] = (short)(random.Next(2) == 0 ? amplitude : -amplitude);
+			}
+			return samples;
+		}
+
+		private static double Rms(short[] samples, int offset, int count)
+		{
+			double sum = 0;
+			for (int i = offset; i < offset + count; i++)
+			{
+				sum += (double)samples[i] * samples[i];
+			}
+			return count > 0 ? Math.Sqrt(sum / count) : 0;
+		}
+
+		private static void SetInput(ConferenceMixer mixer, int index, short[] samples, int count)
+		{
+			Marshal.Copy(samples, 0, mixer.GetInput(index), count);
+			mixer.SetInputLength(index, count * 2);
+		}
+
+		private static short[] GetOutput(ConferenceMixer mixer, int index, int count)
+		{
+			var output = new short[count];
+			Marshal.Copy(mixer.GetOutput(index), output, 0, count);
+			return output;
+		}
+
+		private static void CheckMix(Random random, int samples)
+		{
+			const int inputs = 16;
+			var mixer = new ConferenceMixer(samples, inputs, MaxSpeakers);
+			try
+			{
+				// Distinct levels in a random order, loud enough that the mixes saturate, and one input that comes up short
+				// and is silent for the rest of the packet.
+				var levels = new int[inputs];
+				var signals = new short[inputs][];
+				for (int i = 0; i < inputs; i++)
+				{
+					levels[i] = 1500 * (i + 1);
+				}
+				for (int i = inputs - 1; i > 0; i--)
+				{
+					int j = random.Next(i + 1);
+					int swap = levels[i];
+					levels[i] = levels[j];
+					levels[j] = swap;
+				}
+				for (int i = 0; i < inputs; i++)
+				{
+					signals[i] = MakeSamples(random, samples, levels[i]);
+					SetInput(mixer, i, signals[i], i == 5 ? samples / 3 : samples);
+				}
+				Array.Clear(signals[5], samples / 3, samples - samples / 3);
+				mixer.Mix(inputs);
+
+				var order = new int[inputs];
+				var rms = new double[inputs];
+				for (int i = 0; i < inputs; i++)
+				{
+					order[i] = i;
+					rms[i] = Rms(signals[i], 0, samples);
+				}
+				Array.Sort((double[])rms.Clone(), order);
+				Array.Reverse(order);
+				var speakers = new List<int>(order).GetRange(0, MaxSpeakers);
+
+				Check.That(mixer.SpeakerCount == MaxSpeakers, "the mixer chose {0} speakers of {1}", mixer.SpeakerCount, inputs);
+				for (int i = 0; i < inputs; i++)
+				{
+					bool speaking = mixer.GetSpeakerSlot(i) >= 0;
+					Check.That(speaking == speakers.Contains(i), "input {0} at an RMS of {1:F0} was {2}chosen", i, rms[i],
+						speaking ? "" : "not ");
+
+					var output = GetOutput(mixer, i, samples);
+					for (int n = 0; n < samples; n++)
+					{
+						int sum = 0;
+						foreach (int s in speakers)
+						{
+							if (s != i)
+							{
+								sum += signals[s][n];
+							}
+						}
+						int expected = Math.Max(short.MinValue, Math.Min(short.MaxValue, sum));
+						if (output[n] != expected)
+						{
+							Check.That(false, "input {0} heard {1} at sample {2}, expected {3}", i, output[n], n, expected);
+							break;
+						}
+					}
+				}
+			}
+			finally
+			{
+				mixer.Dispose();
+			}
+		}
+
+		private static void CheckSelection(Random random, int samples)
+		{
+			var mixer = new ConferenceMixer(samples, 8, 2);
+			try
+			{
+				// Inputs 0 and 1 speak first. Input 2 at one and a half times input 1 is not enough to take its place, and
+				// at two and a half times it is.
+				var rounds = new int[][] { new int[] { 8000, 2000, 1000 }, new int[] { 8000, 2000, 3000 }, new int[] { 8000, 2000, 5000 } };
+				var expected = new int[][] { new int[] { 0, 1 }, new int[] { 0, 1 }, new int[] { 0, 2 } };
+				for (int r = 0; r < rounds.Length; r++)
+				{
+					for (int i = 0; i < rounds[r].Length; i++)
+					{
+						SetInput(mixer, i, MakeSamples(random, samples, rounds[r][i]), samples);
+					}
+					mixer.Mix(8);
+					Check.That(mixer.SpeakerCount == 2 && mixer.GetSpeakerSlot(expected[r][0]) >= 0 && mixer.GetSpeakerSlot(expected[r][1]) >= 0,
+						"round {0}: inputs {1} and {2} were not the speakers", r + 1, expected[r][0], expected[r][1]);
+				}
+
+				// A reset input gives up its place before the next mix, and nothing below the floor is chosen.
+				mixer.ResetInput(0);
+				Check.That(mixer.SpeakerCount == 1 && mixer.GetSpeakerSlot(0) < 0 && mixer.GetSpeakerSlot(2) >= 0,
+					"a reset input kept its place");
+				SetInput(mixer, 1, new short[samples], samples);
+				SetInput(mixer, 2, MakeSamples(random, samples, 5000), samples);
+				for (int r = 0; r < 30; r++)
+				{
+					mixer.Mix(8);
+				}
+				Check.That(mixer.SpeakerCount == 1 && mixer.GetSpeakerSlot(2) >= 0, "{0} speakers were chosen with one input talking",
+					mixer.SpeakerCount);
+			}
+			finally
+			{
+				mixer.Dispose();
+			}
+		}
+
+		// Returns the time taken by one round of the hub's work, and the part of it taken by the mix, in microseconds. Three
+		// members talk and the rest send quiet noise below the mixer's floor.
+		private static double MeasureRound(Random random, CodecInfo codec, int members, double seconds, out double mixOnly)
+		{
+			var mixer = new ConferenceMixer(codec.SamplesPerPacket, members, MaxSpeakers);
+			var decoders = new IAudioCodec[members];
+			var encoders = new IAudioCodec[MaxSpeakers + 1];
+			var packets = new IntPtr[members];
+			var encoded = Marshal.AllocHGlobal(codec.EncodedBufferSize);
+			var pcm = Marshal.AllocHGlobal(codec.DecodedBufferSize);
+			try
+			{
+				for (int i = 0; i < encoders.Length; i++)
+				{
+					encoders[i] = codec.GetCodec();
+				}
+				for (int i = 0; i < members; i++)
+				{
+					decoders[i] = codec.GetCodec();
+					Marshal.Copy(MakeSamples(random, codec.SamplesPerPacket, i < MaxSpeakers ? 4000 : 20), 0, pcm, codec.SamplesPerPacket);
+					packets[i] = Marshal.AllocHGlobal(codec.EncodedBufferSize);
+					encoders[0].Encode(pcm, codec.DecodedBufferSize, packets[i], codec.EncodedBufferSize);
+				}
+
+				long mixTicks = 0, rounds = 0;
+				var clock = Stopwatch.StartNew();
+				do
+				{
+					for (int i = 0; i < members; i++)
+					{
+						int count = decoders[i].Decode(packets[i], codec.EncodedBufferSize, mixer.GetInput(i), codec.DecodedBufferSize);
+						mixer.SetInputLength(i, count);
+					}
+					long start = Stopwatch.GetTimestamp();
+					mixer.Mix(members);
+					mixTicks += Stopwatch.GetTimestamp() - start;
+
+					encoders[0].Encode(mixer.GetOutput(members - 1), codec.DecodedBufferSize, encoded, codec.EncodedBufferSize);
+					for (int i = 0; i < members; i++)
+					{
+						int slot = mixer.GetSpeakerSlot(i);
+						if (slot >= 0)
+						{
+							encoders[slot + 1].Encode(mixer.GetOutput(i), codec.DecodedBufferSize, encoded, codec.EncodedBufferSize);
+						}
+					}
+					rounds++;
+				}
+				while (clock.Elapsed.TotalSeconds < seconds);
+
+				mixOnly = mixTicks * 1e6 / Stopwatch.Frequency / rounds;
+				return clock.Elapsed.TotalMilliseconds * 1000 / rounds;
+			}
+			finally
+			{
+				foreach (var packet in packets)
+				{
+					Marshal.FreeHGlobal(packet);
+				}
+				Marshal.FreeHGlobal(encoded);
+				Marshal.FreeHGlobal(pcm);
+				foreach (var c in decoders)
+				{
+					((IDisposable)c).Dispose();
+				}
+				foreach (var c in encoders)
+				{
+					((IDisposable)c).Dispose();
+				}
+				mixer.Dispose();
+			}
+		}
+
+		// Runs a hub over loopback while member 0 talks in bursts, and measures how long each burst takes to reach member 1.
+		private static Latency Converse(CodecInfo codec, int count)
+		{
+			int rounds = LeadIn + Bursts * BurstEvery;
+			double period = codec.SamplesPerPacket * 1000.0 / SampleRate;
+			var silence = EncodePackets(codec, 1, 0);
+			var tone = EncodePackets(codec, BurstLength, 8000);
+			var onsets = new long[Bursts];
+			var latency = new Latency();
+
+			var hub = new VoiceHub(codec, count, MaxSpeakers, new UdpClient(new IPEndPoint(IPAddress.Loopback, 0)));
+			try
+			{
+				using (var members = new Members(count, hub.LocalEndPoint))
+				{
+					for (int i = 0; i < count; i++)
+					{
+						hub.AddMember(members.GetEndPoint(i));
+					}
+					hub.Open();
+
+					var packet = new byte[TestPeer.HeaderSize + codec.EncodedBufferSize];
+					packet[0] = 0x80;
+					packet[1] = TestPeer.AudioPayloadType;
+					var clock = Stopwatch.StartNew();
+					for (int r = 0; r < rounds; r++)
+					{
+						int wait = (int)(r * period - clock.Elapsed.TotalMilliseconds);
+						if (wait > 0)
+						{
+							Thread.Sleep(wait);
+						}
+						packet[2] = (byte)(r >> 8);
+						packet[3] = (byte)r;
+						int timeStamp = r * codec.SamplesPerPacket;
+						packet[4] = (byte)(timeStamp >> 24);
+						packet[5] = (byte)(timeStamp >> 16);
+						packet[6] = (byte)(timeStamp >> 8);
+						packet[7] = (byte)timeStamp;
+
+						int inBurst = (r - LeadIn) % BurstEvery;
+						for (int i = 0; i < count; i++)
+						{
+							bool talking = i == 0 && r >= LeadIn && inBurst < BurstLength;
+							Buffer.BlockCopy(talking ? tone[inBurst] : silence[0], 0, packet, TestPeer.HeaderSize, codec.EncodedBufferSize);
+							packet[11] = (byte)(i + 1);
+							if (talking && inBurst == 0)
+							{
+								onsets[(r - LeadIn) / BurstEvery] = Stopwatch.GetTimestamp();
+							}
+							members.Send(i, packet);
+						}
+					}
+					Thread.Sleep(300);
+					hub.Close();
+
+					var listener = members.GetHeard(1);
+					var speaker = members.GetHeard(0);
+					double sum = 0;
+					for (int b = 0; b < Bursts; b++)
+					{
+						var heard = Array.Find(listener, (p) => p.Key >= onsets[b] && p.Value > Heard);
+						if (heard.Key == 0)
+						{
+							latency.Missed++;
+							continue;
+						}
+						double ms = (heard.Key - onsets[b]) * 1000.0 / Stopwatch.Frequency;
+						sum += ms;
+						latency.Max = Math.Max(latency.Max, ms);
+
+						// The last of the previous burst has long gone by a few packets before this one, and until it is heard
+						// there is nobody talking.
+						long quiet = onsets[b] - (long)(5 * period * Stopwatch.Frequency / 1000);
+						foreach (var p in listener)
+						{
+							if (p.Key >= quiet && p.Key < heard.Key)
+							{
+								latency.HeardIdle = Math.Max(latency.HeardIdle, p.Value);
+							}
+						}
+					}
+					latency.Mean = Bursts > latency.Missed ? sum / (Bursts - latency.Missed) : 0;
+					foreach (var p in speaker)
+					{
+						latency.HeardSelf = Math.Max(latency.HeardSelf, p.Value);
+					}
+
+					latency.LeastReceived = int.MaxValue;
+					for (int i = 1; i < count; i++)
+					{
+						latency.LeastReceived = Math.Min(latency.LeastReceived, members.GetReceived(i));
+					}
+					latency.LateMixes = hub.LateMixes;
+					latency.MixTime = hub.AverageMixTime * 1000;
+				}
+			}
+			finally
+			{
+				hub.Dispose();
+			}
+			return latency;
+		}
+
+		// Encodes packets of a 400 Hz tone at the given amplitude, one after the other with the same encoder.
+		private static byte[][] EncodePackets(CodecInfo codec, int count, int amplitude)
+		{
+			var encoder = codec.GetCodec();
+			var pcm = Marshal.AllocHGlobal(codec.DecodedBufferSize);
+			var encoded = Marshal.AllocHGlobal(codec.EncodedBufferSize);
+			var samples = new short[codec.SamplesPerPacket];
+			var packets = new byte[count][];
+			try
+			{
+				for (int p = 0; p < count; p++)
+				{
+					for (int n = 0; n < samples.Length; n++)
+					{
+						samples[n] = (short)(amplitude * Math.Sin(2 * Math.PI * 400 * (p * samples.Length + n) / SampleRate));
+					}
+					Marshal.Copy(samples, 0, pcm, samples.Length);
+					encoder.Encode(pcm, codec.DecodedBufferSize, encoded, codec.EncodedBufferSize);
+					packets[p] = new byte[codec.EncodedBufferSize];
+					Marshal.Copy(encoded, packets[p], 0, packets[p].Length);
+				}
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(pcm);
+				Marshal.FreeHGlobal(encoded);
+				((IDisposable)encoder).Dispose();
+			}
+			return packets;
+		}
+	}
+}
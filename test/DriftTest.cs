@@ -0,0 +1,179 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using Floe.Audio;
+
+namespace test
+{
+	// Plays a stream from a simulated peer whose clock drifts against a simulated output device, through the same
+	// JitterBuffer a voice session uses, on a simulated clock. Sends, arrivals and device reads are events on one timeline,
+	// and the buffer's clock is set to the time of each before it is run, so hours of playout take a few seconds.
+	//
+	// Each case is played with drift compensation and without it. With compensation, the drift the buffer estimates by the
+	// end must be close to the one that was put in, and it must never run dry or start over. Without it, a peer that runs
+	// fast builds up delay and one that runs slow runs the buffer dry, which the table shows.
+	//
+	// usage: test drift [hours]
+	static class DriftTest
+	{
+		private const int SampleRate = 8000;
+		private const double NetworkDelay = 0.03; // seconds
+		private const double Jitter = 0.005; // seconds, the mean of the exponentially distributed network jitter
+		private const double MaxJitter = 0.03; // seconds, less than a packet
+		private const double DeviceLateness = 0.002; // seconds, the mean delay of the playback thread
+		private const double ToneFrequency = 440.0;
+		private const double MaxError = 2.0; // parts per million
+
+		private class Result
+		{
+			public float Drift;
+			public int Underruns, Resets, ConcealedPackets;
+			public double MinDelay, AverageDelay, MaxDelay, RunTime;
+		}
+
+		public static void Run(string[] args)
+		{
+			double hours = args.Length > 0 ? double.Parse(args[0]) : 2.0;
+			var codec = new CodecInfo(VoiceCodec.Gsm610, SampleRate);
+			var cases = new float[][]
+			{
+				new float[] { 120f, 0f },
+				new float[] { 0f, 180f },
+				new float[] { -60f, 60f },
+				new float[] { 0f, 0f }
+			};
+
+			Console.WriteLine("{0,7} {1,7} {2,4} {3,9} {4,9} {5,7} {6,6} {7,9} {8,7} {9,7} {10,7} {11,8}", "sender", "device",
+				"comp", "true ppm", "est ppm", "underr", "resets", "concealed", "min ms", "avg ms", "max ms", "run ms");
+			foreach (var drifts in cases)
+			{
+				float expected = (float)(((1.0 + drifts[0] * 1e-6) / (1.0 + drifts[1] * 1e-6) - 1.0) * 1e6);
+				foreach (bool compensate in new bool[] { true, false })
+				{
+					var result = Play(codec, drifts[0], drifts[1], hours * 3600.0, compensate, 0);
+					Console.WriteLine("{0,7:F0} {1,7:F0} {2,4} {3,9:F1} {4,9:F1} {5,7} {6,6} {7,9} {8,7:F0} {9,7:F1} {10,7:F0} {11,8:F0}",
+						drifts[0], drifts[1], compensate ? "on" : "off", expected, result.Drift, result.Underruns, result.Resets,
+						result.ConcealedPackets, result.MinDelay, result.AverageDelay, result.MaxDelay, result.RunTime);
+					if (compensate)
+					{
+						Check.That(Math.Abs(result.Drift - expected) <= MaxError, "{0:F0}/{1:F0} ppm: the drift was estimated at " +
+							"{2:F1} ppm, and was {3:F1} ppm", drifts[0], drifts[1], result.Drift, expected);
+						Check.That(result.Underruns == 0, "{0:F0}/{1:F0} ppm: the buffer ran dry {2} times", drifts[0], drifts[1],
+							result.Underruns);
+						Check.That(result.Resets == 0, "{0:F0}/{1:F0} ppm: the buffer started over {2} times", drifts[0],
+							drifts[1], result.Resets);
+					}
+				}
+			}
+		}
+
+		// Plays the tone from a peer whose clock runs senderDrift parts per million fast to a device whose clock runs
+		// deviceDrift fast, for the given number of seconds of simulated time. The delays are counted after the first
+		// tenth of the run, once the buffer has had time to settle.
+		private static Result Play(CodecInfo codec, float senderDrift, float deviceDrift, double seconds, bool compensate,
+			int seed)
+		{
+			var random = new Random(seed);
+			var buffer = new JitterBuffer(codec);
+			buffer.Adaptive = false;
+			buffer.DriftCompensation = compensate;
+			var packet = Marshal.AllocHGlobal(codec.DecodedBufferSize);
+			var payload = Marshal.AllocHGlobal(codec.EncodedBufferSize);
+			var encoder = codec.GetCodec();
+			try
+			{
+				// Every packet carries the same tone, so it only needs to be encoded once.
+				for (int i = 0; i < codec.SamplesPerPacket; i++)
+				{
+					double phase = 2.0 * Math.PI * ToneFrequency * i / codec.SampleRate;
+					Marshal.WriteInt16(packet, i * 2, (short)(Math.Sin(phase) * 8192.0));
+				}
+				int size = encoder.Encode(packet, codec.DecodedBufferSize, payload, codec.EncodedBufferSize);
+				var bytes = new byte[Math.Max(size, 0)];
+				Marshal.Copy(payload, bytes, 0, bytes.Length);
+
+				// Arrivals are kept in time order, since jitter can reorder packets. The jitter is cut off short of a packet, so
+				// that the two packets the buffer holds back are always enough to cover it, and any underrun is down to drift.
+				double period = (double)codec.SamplesPerPacket / codec.SampleRate;
+				double senderPeriod = period / (1.0 + senderDrift * 1e-6);
+				double devicePeriod = period / (1.0 + deviceDrift * 1e-6);
+				double settle = seconds / 10.0;
+				var arrivals = new List<KeyValuePair<double, int>>();
+				long sent = 0, reads = 0, delayCount = 0;
+				int minQueue = int.MaxValue, maxQueue = 0;
+				double queueSum = 0.0;
+				long start = Stopwatch.GetTimestamp();
+				while (true)
+				{
+					double nextSend = sent * senderPeriod;
+					double nextRead = reads * devicePeriod;
+					if (nextRead > seconds)
+					{
+						break;
+					}
+					if (nextSend < nextRead)
+					{
+						double arrival = nextSend + NetworkDelay + Math.Min(Exponential(random, Jitter), MaxJitter);
+						int index = arrivals.Count;
+						while (index > 0 && arrivals[index - 1].Key > arrival)
+						{
+							index--;
+						}
+						arrivals.Insert(index, new KeyValuePair<double, int>(arrival, (int)(sent * codec.SamplesPerPacket)));
+						sent++;
+					}
+
+					double next = Math.Min(nextSend, nextRead);
+					while (arrivals.Count > 0 && arrivals[0].Key <= next)
+					{
+						buffer.SetClock(arrivals[0].Key);
+						buffer.Enqueue(arrivals[0].Value, bytes, 0, bytes.Length);
+						arrivals.RemoveAt(0);
+					}
+
+					if (nextRead <= nextSend)
+					{
+						buffer.SetClock(nextRead + Exponential(random, DeviceLateness));
+						buffer.Read(packet, codec.DecodedBufferSize);
+						if (nextRead >= settle)
+						{
+							int queue = buffer.Count;
+							minQueue = Math.Min(minQueue, queue);
+							maxQueue = Math.Max(maxQueue, queue);
+							queueSum += queue;
+							delayCount++;
+						}
+						reads++;
+					}
+				}
+				long ticks = Stopwatch.GetTimestamp() - start;
+
+				double packetTime = period * 1000.0;
+				return new Result
+				{
+					Drift = buffer.Drift,
+					Underruns = buffer.Underruns,
+					Resets = buffer.Resets,
+					ConcealedPackets = buffer.ConcealedPackets,
+					MinDelay = delayCount > 0 ? minQueue * packetTime : 0,
+					AverageDelay = delayCount > 0 ? queueSum / delayCount * packetTime : 0,
+					MaxDelay = delayCount > 0 ? maxQueue * packetTime : 0,
+					RunTime = ticks * 1000.0 / Stopwatch.Frequency
+				};
+			}
+			finally
+			{
+				((IDisposable)encoder).Dispose();
+				buffer.Dispose();
+				Marshal.FreeHGlobal(packet);
+				Marshal.FreeHGlobal(payload);
+			}
+		}
+
+		private static double Exponential(Random random, double mean)
+		{
+			return -mean * Math.Log(1.0 - random.NextDouble());
+		}
+	}
+}
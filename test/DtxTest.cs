@@ -0,0 +1,254 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Net;
+using System.Runtime.InteropServices;
+using Floe.Audio;
+using Floe.Interop;
+using Floe.Net;
+
+namespace test
+{
+	// Feeds a made-up microphone through VoiceIn, a packet at a time as WaveIn would hand it over, and checks what it sends:
+	// quiet background noise at about -60 dBFS, broken by two talkspurts of a voiced sound at about -25 dBFS, using GSM at
+	// 8 kHz. Nothing goes out on a network; the RtpClient keeps a list of the packets it is given.
+	//
+	// With voice activity detection, every packet of a talkspurt must be sent as audio, the first with the marker bit and
+	// the rest without, and audio must stop within the detector's hangover once the talker does. During silence only comfort
+	// noise goes out: the first on the first silent packet, then one every ten, each giving the level of the background.
+	// Without voice activity detection, every packet is sent as audio, with the marker on the first alone, and while the
+	// transmit predicate says no nothing is sent at all, and the first packet after it says yes again has the marker.
+	//
+	// usage: test dtx
+	static class DtxTest
+	{
+		private const int SampleRate = 8000;
+		private const int ComfortNoiseInterval = 10; // packets, as in VoiceIn
+		private const int HangoverLength = 200; // milliseconds, as in VoiceDetector
+		private const double NoiseLevel = 30; // RMS, about -61 dBFS
+		private const double SpeechLevel = 3000; // the peak of the fundamental, with about -26 dBFS in all
+		private const double Pitch = 150; // Hz
+
+		// The first packet of each talkspurt, and the first after it.
+		private static readonly int[][] Spurts = new int[][] { new int[] { 50, 75 }, new int[] { 135, 160 } };
+		private const int Length = 200; // packets
+
+		private class Packet
+		{
+			public int TimeStamp, Count;
+			public byte PayloadType, Level;
+			public bool Marker;
+		}
+
+		// An RtpClient that keeps what it is asked to send instead of sending it.
+		private class Recorder : RtpClient
+		{
+			public List<Packet> Packets = new List<Packet>();
+
+			public Recorder(CodecInfo codec)
+				: base((byte)codec.PayloadType, codec.EncodedBufferSize, codec.SampleRate, new IPEndPoint(IPAddress.Loopback, 9))
+			{
+			}
+
+			public override void Send(int timeStamp, IntPtr payload, int count, byte payloadType, bool marker)
+			{
+				this.Packets.Add(new Packet
+				{
+					TimeStamp = timeStamp,
+					Count = count,
+					PayloadType = payloadType,
+					Level = Marshal.ReadByte(payload),
+					Marker = marker
+				});
+			}
+
+			protected override void OnReceived(IPEndPoint peer, short payloadType, int seqNumber, int timeStamp, byte[] payload, int offset, int count)
+			{
+			}
+
+			protected override void OnError(Exception ex)
+			{
+			}
+		}
+
+		public static void Run(string[] args)
+		{
+			var codec = new CodecInfo(VoiceCodec.Gsm610, SampleRate);
+			var input = MakeInput(codec);
+			Console.WriteLine("{0,-10} {1,7} {2,7} {3,7} {4,7} {5,9} {6,8}", "case", "packets", "audio", "noise", "markers",
+				"bytes", "of full %");
+			CheckDetection(codec, input);
+			CheckContinuous(codec, input);
+		}
+
+		private static void CheckDetection(CodecInfo codec, short[][] input)
+		{
+			VoiceCaptureStatistics statistics;
+			var packets = Feed(codec, input, true, null, out statistics);
+			Print("vad", codec, packets, statistics);
+
+			int hangover = (HangoverLength * codec.SampleRate / 1000 + codec.SamplesPerPacket - 1) / codec.SamplesPerPacket;
+			var byFrame = new Packet[Length];
+			foreach (var packet in packets)
+			{
+				int frame = packet.TimeStamp / codec.SamplesPerPacket;
+				Check.That(packet.TimeStamp % codec.SamplesPerPacket == 0 && frame < Length && byFrame[frame] == null,
+					"a packet was sent with a timestamp of {0}", packet.TimeStamp);
+				if (frame < Length)
+				{
+					byFrame[frame] = packet;
+				}
+			}
+
+			// Each stretch of silence runs from the end of one spurt, or the start, to the beginning of the next, or the end.
+			int start = 0;
+			for (int s = 0; s <= Spurts.Length; s++)
+			{
+				int end = s < Spurts.Length ? Spurts[s][0] : Length;
+				int audio = 0, lastNoise = -1, firstNoise = -1;
+				for (int frame = start; frame < end; frame++)
+				{
+					var packet = byFrame[frame];
+					if (packet == null)
+					{
+						continue;
+					}
+					if (packet.PayloadType == CodecInfo.ComfortNoisePayloadType)
+					{
+						Check.That(lastNoise < 0 || frame - lastNoise == ComfortNoiseInterval, "comfort noise was sent at packet " +
+							"{0}, {1} packets after the last", frame, frame - lastNoise);
+						Check.That(Math.Abs(packet.Level - 61) <= 3, "comfort noise at packet {0} gave a level of -{1} dBov",
+							frame, packet.Level);
+						Check.That(!packet.Marker, "comfort noise at packet {0} had the marker bit", frame);
+						firstNoise = firstNoise < 0 ? frame : firstNoise;
+						lastNoise = frame;
+					}
+					else
+					{
+						Check.That(firstNoise < 0 && frame - start < hangover, "audio was sent at packet {0}, {1} packets into " +
+							"the silence", frame, frame - start);
+						audio++;
+					}
+				}
+				Check.That(firstNoise == start + audio, "the first comfort noise after packet {0} came at packet {1}", start,
+					firstNoise);
+				Check.That(end - lastNoise <= ComfortNoiseInterval, "no comfort noise was sent for the last {0} packets before " +
+					"packet {1}", end - lastNoise - 1, end);
+
+				if (s < Spurts.Length)
+				{
+					for (int frame = Spurts[s][0]; frame < Spurts[s][1]; frame++)
+					{
+						var packet = byFrame[frame];
+						if (packet == null || packet.PayloadType != codec.PayloadType)
+						{
+							Check.That(false, "packet {0} of talkspurt {1} was not sent as audio", frame, s + 1);
+							break;
+						}
+						Check.That(packet.Marker == (frame == Spurts[s][0]), "packet {0} of talkspurt {1} {2} the marker bit",
+							frame, s + 1, packet.Marker ? "had" : "did not have");
+					}
+					start = Spurts[s][1];
+				}
+			}
+
+			int audioPackets = packets.FindAll((p) => p.PayloadType == codec.PayloadType).Count;
+			Check.That(statistics.Frames == Length && statistics.EncodedFrames == audioPackets &&
+				statistics.ComfortNoisePackets == packets.Count - audioPackets, "the statistics counted {0} frames, {1} encoded " +
+				"and {2} comfort noise", statistics.Frames, statistics.EncodedFrames, statistics.ComfortNoisePackets);
+		}
+
+		private static void CheckContinuous(CodecInfo codec, short[][] input)
+		{
+			VoiceCaptureStatistics statistics;
+			var packets = Feed(codec, input, false, null, out statistics);
+			Print("always", codec, packets, statistics);
+			Check.That(packets.Count == Length && packets.TrueForAll((p) => p.PayloadType == codec.PayloadType),
+				"without detection, {0} packets were sent for {1}", packets.Count, Length);
+			Check.That(packets.FindAll((p) => p.Marker).Count == 1 && packets[0].Marker, "without detection, the marker bit " +
+				"was not on the first packet alone");
+
+			// Push to talk, over the first talkspurt and a little either side of it.
+			int from = Spurts[0][0] - 10, to = Spurts[0][1] + 10;
+			packets = Feed(codec, input, false, (frame) => frame >= from && frame < to, out statistics);
+			Print("push", codec, packets, statistics);
+			Check.That(packets.Count == to - from && packets.TrueForAll((p) => p.PayloadType == codec.PayloadType &&
+				p.TimeStamp >= from * codec.SamplesPerPacket && p.TimeStamp < to * codec.SamplesPerPacket),
+				"with the predicate set from packet {0} to {1}, {2} packets were sent", from, to, packets.Count);
+			Check.That(packets.Count > 0 && packets[0].Marker && packets.FindAll((p) => p.Marker).Count == 1,
+				"with the predicate set, the marker bit was not on the first packet alone");
+		}
+
+		// Feeds every packet of the input through a new VoiceIn, and returns what it sent.
+		private static List<Packet> Feed(CodecInfo codec, short[][] input, bool detect, Func<int, bool> transmit,
+			out VoiceCaptureStatistics statistics)
+		{
+			var client = new Recorder(codec);
+			int frame = 0;
+			var voiceIn = new VoiceIn(codec, client, transmit != null ? new TransmitPredicate(() => transmit(frame)) : null);
+			var buffer = Marshal.AllocHGlobal(codec.DecodedBufferSize);
+			try
+			{
+				voiceIn.VoiceActivityDetection = detect;
+				for (; frame < input.Length; frame++)
+				{
+					Marshal.Copy(input[frame], 0, buffer, codec.SamplesPerPacket);
+					voiceIn.Write(buffer, codec.DecodedBufferSize);
+				}
+				statistics = voiceIn.GetStatistics();
+				return client.Packets;
+			}
+			finally
+			{
+				voiceIn.Dispose();
+				client.Dispose();
+				Marshal.FreeHGlobal(buffer);
+			}
+		}
+
+		private static void Print(string name, CodecInfo codec, List<Packet> packets, VoiceCaptureStatistics statistics)
+		{
+			int audio = 0, noise = 0, markers = 0;
+			long bytes = 0;
+			foreach (var packet in packets)
+			{
+				audio += packet.PayloadType == codec.PayloadType ? 1 : 0;
+				noise += packet.PayloadType == CodecInfo.ComfortNoisePayloadType ? 1 : 0;
+				markers += packet.Marker ? 1 : 0;
+				bytes += packet.Count;
+			}
+			Console.WriteLine("{0,-10} {1,7} {2,7} {3,7} {4,7} {5,9} {6,8:F1}", name, statistics.Frames, audio, noise, markers,
+				bytes, bytes * 100.0 / ((long)Length * codec.EncodedBufferSize));
+		}
+
+		// White noise throughout, with a buzz at the pitch and its harmonics added over each talkspurt.
+		private static short[][] MakeInput(CodecInfo codec)
+		{
+			var random = new Random(1);
+			var input = new short[Length][];
+			double phase = 0, noise = NoiseLevel * Math.Sqrt(3);
+			for (int frame = 0; frame < Length; frame++)
+			{
+				bool talking = false;
+				foreach (var spurt in Spurts)
+				{
+					talking |= frame >= spurt[0] && frame < spurt[1];
+				}
+				input[frame] = new short[codec.SamplesPerPacket];
+				for (int i = 0; i < codec.SamplesPerPacket; i++)
+				{
+					double sample = (random.NextDouble() * 2 - 1) * noise;
+					phase += 2 * Math.PI * Pitch / codec.SampleRate;
+					if (talking)
+					{
+						for (int h = 1; h <= 10; h++)
+						{
+							sample += SpeechLevel * 0.6 / h * Math.Sin(h * phase);
+						}
+					}
+					input[frame][i] = (short)Math.Round(sample);
+				}
+			}
+			return input;
+		}
+	}
+}
@@ -0,0 +1,203 @@
+﻿using System;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+using Floe.Interop;
+
+namespace test
+{
+	// Runs echo cancellation over a pair of recordings, as it would run in a voice session: what was played through the
+	// speakers (the far end) and what the microphone heard at the same time (the near end), starting at the same moment.
+	// Both are read through WavReader, mixed down to mono, and fed to an AcousticEchoCanceller a frame of four 128-sample
+	// blocks at a time, the far end a frame ahead of the near end, as a device plays ahead of what it captures.
+	//
+	// The ERLE is measured over the frames where the far end is playing and the canceller does not think the near end is
+	// talking, which are the frames that hold only echo, once the canceller has had five seconds to find the delay and
+	// converge, and must reach a minimum. Each frame must also be processed in a small part of the time it lasts, on
+	// average and at worst.
+	//
+	// With no files, the pair is made up and written out first: twenty seconds of talk spurts played into a room that
+	// answers 30 ms later and rings for 100 ms. The delay that the canceller settles on is then known, and is checked too.
+	//
+	// usage: test echo [far.wav near.wav [minimum ERLE in dB]]
+	static class EchoTest
+	{
+		private const int BlockSize = 128; // samples
+		private const int FrameBlocks = 4;
+		private const int FrameSize = BlockSize * FrameBlocks;
+		private const int TailLength = 150; // milliseconds, as in VoiceClient
+		private const int FarFloor = 900; // mean square of a sample, about -60 dBFS
+		private const int SampleRate = 16000;
+		private const double RoomDelay = 0.03; // seconds
+		private const double RoomLength = 0.1;
+		private const double MaxLoad = 0.05; // of the length of a frame, on average
+		private const double MaxFrameLoad = 0.5; // at worst
+		private const double SettleTime = 5.0; // seconds
+
+		public static void Run(string[] args)
+		{
+			double minErle = args.Length > 2 ? double.Parse(args[2]) : 20.0;
+			if (args.Length >= 2)
+			{
+				Process(args[0], args[1], minErle, -1);
+				return;
+			}
+
+			var random = new Random(1);
+			var far = MakeTalk(random, SampleRate, 20.0);
+			var near = MakeEcho(random, far);
+
+			string farPath = Path.GetTempFileName(), nearPath = Path.GetTempFileName();
+			try
+			{
+				WavFile.Write(farPath, SampleRate, far);
+				WavFile.Write(nearPath, SampleRate, near);
+				Process(farPath, nearPath, minErle, (int)(RoomDelay * SampleRate));
+			}
+			finally
+			{
+				File.Delete(farPath);
+				File.Delete(nearPath);
+			}
+		}
+
+		private static void Process(string farPath, string nearPath, double minErle, int delay)
+		{
+			int farRate, nearRate;
+			var far = WavFile.Read(farPath, out farRate);
+			var near = WavFile.Read(nearPath, out nearRate);
+			if (farRate != nearRate)
+			{
+				Check.That(false, "the far end is at {0} Hz and the near end at {1} Hz", farRate, nearRate);
+				return;
+			}
+
+			var buffer = Marshal.AllocHGlobal(FrameSize * 2);
+			var canceller = new AcousticEchoCanceller(nearRate, BlockSize, TailLength);
+			try
+			{
+				var output = new short[FrameSize];
+				int frames = 0;
+				long totalTicks = 0, maxTicks = 0;
+				double echoEnergy = 0, residualEnergy = 0;
+				int length = Math.Min(far.Length, near.Length) / FrameSize * FrameSize;
+				for (int offset = 0; offset < length; offset += FrameSize)
+				{
+					// A device takes what it is to play a buffer ahead of what it has captured, and the canceller waits
+					// for a whole buffer of reference to be queued before it starts to use it, so the far end is handed
+					// over a frame early.
+					if (offset == 0)
+					{
+						Marshal.Copy(far, 0, buffer, FrameSize);
+						canceller.AddReference(buffer, FrameSize * 2);
+					}
+					if (offset + FrameSize < length)
+					{
+						Marshal.Copy(far, offset + FrameSize, buffer, FrameSize);
+						canceller.AddReference(buffer, FrameSize * 2);
+					}
+					Marshal.Copy(near, offset, buffer, FrameSize);
+
+					long start = Stopwatch.GetTimestamp();
+					canceller.Process(buffer, FrameSize * 2);
+					long ticks = Stopwatch.GetTimestamp() - start;
+					totalTicks += ticks;
+					maxTicks = Math.Max(maxTicks, ticks);
+					frames++;
+
+					Marshal.Copy(buffer, output, 0, FrameSize);
+					if (offset >= SettleTime * nearRate && !canceller.IsDoubleTalk &&
+						Energy(far, offset, FrameSize) > (double)FarFloor * FrameSize)
+					{
+						echoEnergy += Energy(near, offset, FrameSize);
+						residualEnergy += Energy(output, 0, FrameSize);
+					}
+				}
+
+				double erle = residualEnergy > 0 ? 10 * Math.Log10(echoEnergy / residualEnergy) : 0;
+				double frameTime = FrameSize * 1000.0 / nearRate;
+				double averageTime = frames > 0 ? totalTicks * 1000.0 / Stopwatch.Frequency / frames : 0;
+				double maxTime = maxTicks * 1000.0 / Stopwatch.Frequency;
+				Console.WriteLine("{0,6} {1,8} {2,8} {3,9} {4,9} {5,8}", "frames", "ERLE dB", "delay ms", "avg ms", "max ms",
+					"load %");
+				Console.WriteLine("{0,6} {1,8:F1} {2,8:F1} {3,9:F3} {4,9:F3} {5,8:F2}", frames, erle,
+					canceller.Delay * 1000.0 / nearRate, averageTime, maxTime, averageTime / frameTime * 100);
+
+				Check.That(erle >= minErle, "the echo was taken down by {0:F1} dB, less than {1:F1} dB", erle, minErle);
+				Check.That(averageTime < frameTime * MaxLoad, "a {0:F0} ms frame took {1:F3} ms on average", frameTime,
+					averageTime);
+				Check.That(maxTime < frameTime * MaxFrameLoad, "a {0:F0} ms frame took {1:F3} ms at worst", frameTime, maxTime);
+				if (delay >= 0)
+				{
+					Check.That(Math.Abs(canceller.Delay - delay) <= BlockSize, "the canceller settled on a delay of {0} samples, " +
+						"and the echo came {1} samples late", canceller.Delay, delay);
+				}
+			}
+			finally
+			{
+				canceller.Dispose();
+				Marshal.FreeHGlobal(buffer);
+			}
+		}
+
+		private static double Energy(short[] samples, int offset, int count)
+		{
+			double energy = 0;
+			for (int i = offset; i < offset + count; i++)
+			{
+				energy += (double)samples[i] * samples[i];
+			}
+			return energy;
+		}
+
+		// Noise shaped like speech and cut into spurts of a fraction of a second to a second and a half.
+		private static short[] MakeTalk(Random random, int rate, double seconds)
+		{
+			var samples = new short[(int)(rate * seconds)];
+			double y1 = 0, y2 = 0, envelope = 0, phase = 0;
+			bool on = true;
+			int left = 0;
+			for (int i = 0; i < samples.Length; i++)
+			{
+				if (--left <= 0)
+				{
+					on = !on;
+					left = (int)(rate * (on ? 0.3 + random.NextDouble() * 1.2 : 0.1 + random.NextDouble() * 0.4));
+				}
+				envelope += ((on ? 1.0 : 0.0) - envelope) * 0.002;
+				double x = random.NextDouble() * 2 - 1;
+				double y = x + 1.3 * y1 - 0.6 * y2;
+				y2 = y1;
+				y1 = y;
+				phase += 2 * Math.PI * (120 + 30 * Math.Sin(i * 2e-4)) / rate;
+				samples[i] = (short)(envelope * 3000 * (0.5 * y + 0.8 * Math.Sin(phase) * (1 + 0.3 * y)));
+			}
+			return samples;
+		}
+
+		// What a microphone hears of the far end in a room: nothing for the delay, then reflections that die away by 60 dB
+		// over the length of the room's response, and a little noise.
+		private static short[] MakeEcho(Random random, short[] far)
+		{
+			int delay = (int)(RoomDelay * SampleRate), length = (int)(RoomLength * SampleRate);
+			var room = new double[delay + length];
+			for (int i = 0; i < length; i++)
+			{
+				room[delay + i] = (random.NextDouble() * 2 - 1) * 0.15 * Math.Pow(10, -3.0 * i / length);
+			}
+			room[delay] = 0.5;
+
+			var near = new short[far.Length];
+			for (int n = 0; n < near.Length; n++)
+			{
+				double sum = (random.NextDouble() * 2 - 1) * 4;
+				for (int k = delay; k < room.Length && k <= n; k++)
+				{
+					sum += room[k] * far[n - k];
+				}
+				near[n] = (short)Math.Max(short.MinValue, Math.Min(short.MaxValue, Math.Round(sum)));
+			}
+			return near;
+		}
+	}
+}
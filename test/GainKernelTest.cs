@@ -0,0 +1,210 @@
+﻿using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using Floe.Interop;
+
+namespace test
+{
+	// Checks every version of the gain and level kernel behind Dsp.ApplyGain that this CPU can run against a plain C#
+	// version of the same sums, and then measures how many samples each can process in a second, next to the managed loop
+	// that WavProcess.ApplyGain used to run.
+	//
+	// The buffers are random, with full scale samples mixed in, and of every length up to a few vectors of AVX2 as well as
+	// of a whole packet, so that the vector loops and the tails that finish them are both covered. Each sample must come
+	// out as the input times the gain, rounded with halves away from zero and saturated to 16 bits, whichever version made
+	// it. A run of odd samples at gains of a half and one and a half, which land on a half every time, checks the rounding
+	// of halves in the vector loops on its own. The reported RMS and peak must be those of the samples that came out, and
+	// nothing past the end of the buffer may be touched.
+	//
+	// usage: test gain [seconds]
+	static class GainKernelTest
+	{
+		private const int PacketSamples = 960;
+		private const int Guard = 16;
+		private const short GuardValue = 0x5a5a;
+
+		public static void Run(string[] args)
+		{
+			double seconds = args.Length > 0 ? double.Parse(args[0]) : 1.0;
+			var paths = new DspPath[] { DspPath.Scalar, DspPath.Sse2, DspPath.Avx2, DspPath.Best };
+			var gains = new float[] { 0f, 0.25f, 0.7071f, 1f, 1.5f, 40f };
+			var random = new Random(1);
+
+			foreach (var path in paths)
+			{
+				if (!Dsp.IsSupported(path))
+				{
+					Console.WriteLine("{0}: not supported here", path);
+					continue;
+				}
+				int failures = Check.Failures;
+				for (int count = 0; count <= PacketSamples + 1 && Check.Failures == failures; count++)
+				{
+					// Every length up to four AVX2 vectors and a bit, and then a packet, and a packet and one.
+					if (count > 4 * 16 + 3 && count < PacketSamples)
+					{
+						count = PacketSamples;
+					}
+					foreach (float gain in gains)
+					{
+						CheckBuffer(path, MakeSamples(random, count), gain);
+					}
+				}
+
+				// Full scale in both directions, to be sure that -32768 neither wraps when it is boosted nor has a peak
+				// above 1.
+				var extremes = new short[] { short.MinValue, short.MaxValue, short.MinValue, -1, 1, short.MaxValue, 0, short.MinValue, 16384 };
+				var level = Apply(path, extremes, 8f);
+				Check.That(level.Peak == 1f && extremes[0] == short.MinValue && extremes[1] == short.MaxValue && extremes[8] == short.MaxValue,
+					"{0}: full scale samples did not saturate", path);
+
+				// Long enough for two AVX2 vectors and a tail, so that every version rounds halves in its vector loop.
+				var halves = new short[35];
+				for (int i = 0; i < halves.Length; i++)
+				{
+					halves[i] = (short)((i % 2 == 0 ? 1 : -1) * (2 * (i * 997 % 16384) + 1));
+				}
+				foreach (float gain in new float[] { 0.5f, 1.5f })
+				{
+					CheckBuffer(path, halves, gain);
+				}
+			}
+
+			var buffer = MakeSamples(random, PacketSamples);
+			var bytes = new byte[PacketSamples * 2];
+			Buffer.BlockCopy(buffer, 0, bytes, 0, bytes.Length);
+			double managed = Measure(seconds, () => ManagedApplyGain(0.8f, bytes, bytes.Length));
+			Console.WriteLine("{0,-8} {1,8:F1} Msamples/s", "managed", managed / 1e6);
+			var pointer = Marshal.AllocHGlobal(PacketSamples * 2);
+			try
+			{
+				Marshal.Copy(buffer, 0, pointer, PacketSamples);
+				foreach (var path in paths)
+				{
+					if (!Dsp.IsSupported(path))
+					{
+						continue;
+					}
+					var p = path;
+					double scaled = Measure(seconds, () => Dsp.ApplyGain(pointer, PacketSamples * 2, 0.8f, p));
+					double measured = Measure(seconds, () => Dsp.ApplyGain(pointer, PacketSamples * 2, 1f, p));
+					Console.WriteLine("{0,-8} {1,8:F1} Msamples/s ({2:F0}x managed), {3,8:F1} Msamples/s measuring only",
+						path, scaled / 1e6, scaled / managed, measured / 1e6);
+				}
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(pointer);
+			}
+		}
+
+		private static short[] MakeSamples(Random random, int count)
+		{
+			var samples = new short[count];
+			for (int i = 0; i < count; i++)
+			{
+				int kind = random.Next(8);
+				samples[i] = kind == 0 ? short.MinValue : kind == 1 ? short.MaxValue : (short)random.Next(short.MinValue, short.MaxValue + 1);
+			}
+			return samples;
+		}
+
+		// Runs the kernel over a copy of the samples with guard samples after it, and compares the result with what it
+		// should be.
+		private static void CheckBuffer(DspPath path, short[] input, float gain)
+		{
+			var output = (short[])input.Clone();
+			var level = Apply(path, output, gain);
+
+			double sumSquares = 0;
+			int peak = 0;
+			for (int i = 0; i < input.Length; i++)
+			{
+				float value = input[i] * gain;
+				int expected = gain == 1f ? input[i] : Saturate(Math.Round(value, MidpointRounding.AwayFromZero));
+				if (output[i] != expected)
+				{
+					Check.That(false, "{0}: {1} times {2} came out as {3} at {4} of {5}", path, input[i], gain, output[i], i, input.Length);
+					return;
+				}
+				sumSquares += (double)output[i] * output[i];
+				peak = Math.Max(peak, Math.Abs((int)output[i]));
+			}
+
+			double rms = input.Length > 0 ? Math.Sqrt(sumSquares / input.Length) / 32768.0 : 0.0;
+			Check.That(Math.Abs(level.Rms - rms) <= 1e-6 + rms * 1e-5 && level.Peak == peak / 32768f,
+				"{0}: {1} samples at gain {2} measured RMS {3} and peak {4}, expected {5} and {6}", path, input.Length, gain,
+				level.Rms, level.Peak, rms, peak / 32768.0);
+		}
+
+		private static SignalLevel Apply(DspPath path, short[] samples, float gain)
+		{
+			var buffer = Marshal.AllocHGlobal((samples.Length + Guard) * 2);
+			try
+			{
+				var guard = new short[Guard];
+				for (int i = 0; i < Guard; i++)
+				{
+					guard[i] = GuardValue;
+				}
+				Marshal.Copy(samples, 0, buffer, samples.Length);
+				Marshal.Copy(guard, 0, buffer + samples.Length * 2, Guard);
+
+				var level = Dsp.ApplyGain(buffer, samples.Length * 2, gain, path);
+				Marshal.Copy(buffer, samples, 0, samples.Length);
+				Marshal.Copy(buffer + samples.Length * 2, guard, 0, Guard);
+				Check.That(Array.TrueForAll(guard, (s) => s == GuardValue), "{0}: wrote past the end of {1} samples", path,
+					samples.Length);
+				return level;
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(buffer);
+			}
+		}
+
+		private static int Saturate(double value)
+		{
+			return (int)Math.Max(short.MinValue, Math.Min(short.MaxValue, value));
+		}
+
+		// The loop that WavProcess.ApplyGain ran before the kernel, to compare speeds with.
+		private static float ManagedApplyGain(float gain, byte[] buffer, int count)
+		{
+			float sum = 0f;
+			double min = (double)short.MinValue;
+			double max = (double)short.MaxValue;
+			for (int i = 0; i < count; i += 2)
+			{
+				short sample = BitConverter.ToInt16(buffer, i);
+				if (gain != 1f)
+				{
+					double adj = Math.Max(min, Math.Min(max, (double)sample * gain));
+					sample = (short)adj;
+					buffer[i] = (byte)sample;
+					buffer[i + 1] = (byte)(sample >> 8);
+				}
+				sum += (float)Math.Pow(2, (double)sample / (double)short.MaxValue);
+			}
+			return (float)Math.Sqrt(sum);
+		}
+
+		// Runs the action over a packet over and over for about the given time, and returns the samples per second.
+		private static double Measure(double seconds, Action action)
+		{
+			action();
+			long runs = 0;
+			var clock = Stopwatch.StartNew();
+			do
+			{
+				for (int i = 0; i < 100; i++)
+				{
+					action();
+				}
+				runs += 100;
+			}
+			while (clock.Elapsed.TotalSeconds < seconds);
+			return (double)runs * PacketSamples / clock.Elapsed.TotalSeconds;
+		}
+	}
+}
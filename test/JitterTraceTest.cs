@@ -0,0 +1,308 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using Floe.Interop;
+
+namespace test
+{
+	// Replays fixed traces of packet arrivals through a JitterRing on a simulated clock, one playback buffer per packet
+	// time, and checks what comes out. Each trace is then replayed many times to measure how long Insert, Acquire,
+	// Release and Reset take.
+	//
+	// With a delay of two packets, the first packet plays two ticks after it arrives, and each packet after it is in time
+	// if it arrives no later than two ticks after its own. The end of every trace runs the buffer dry once.
+	//
+	// usage: test jitter [repeats]
+	static class JitterTraceTest
+	{
+		private const int Span = 160;
+		private const int ClockRate = 8000;
+		private const int Capacity = 256;
+		private const int Delay = 2;
+		private const int PacketSize = 8;
+
+		private class Trace
+		{
+			public string Name;
+			public uint FirstTimeStamp;
+			public List<int>[] Arrivals;
+			public int ResetAt = -1;
+
+			// What should happen.
+			public int[] Missing;
+			public int Late, Underruns, Recovered;
+
+			public Trace(string name, int ticks, uint firstTimeStamp)
+			{
+				this.Name = name;
+				this.FirstTimeStamp = firstTimeStamp;
+				this.Arrivals = new List<int>[ticks];
+				for (int i = 0; i < ticks; i++)
+				{
+					this.Arrivals[i] = new List<int>();
+				}
+				this.Missing = new int[0];
+			}
+		}
+
+		private class Latency
+		{
+			private List<long> _ticks = new List<long>();
+
+			public void Add(long ticks)
+			{
+				_ticks.Add(ticks);
+			}
+
+			public void Print(string name)
+			{
+				if (_ticks.Count == 0)
+				{
+					return;
+				}
+				_ticks.Sort();
+				double ns = 1e9 / Stopwatch.Frequency;
+				long sum = 0;
+				foreach (long t in _ticks)
+				{
+					sum += t;
+				}
+				Console.WriteLine("{0,-8} {1,9} {2,9:F0} {3,9:F0} {4,9:F0} {5,9:F0}", name, _ticks.Count, sum * ns / _ticks.Count,
+					_ticks[_ticks.Count / 2] * ns, _ticks[_ticks.Count * 99 / 100] * ns, _ticks[_ticks.Count - 1] * ns);
+			}
+		}
+
+		private class Timings
+		{
+			public Latency Insert = new Latency(), Acquire = new Latency(), Release = new Latency(), Reset = new Latency();
+		}
+
+		public static void Run(string[] args)
+		{
+			int repeats = args.Length > 0 ? int.Parse(args[0]) : 200;
+			var traces = new Trace[] { InOrder(), Reorder(), Duplicate(), Late(), WrapAround(), Reset() };
+
+			foreach (var trace in traces)
+			{
+				Verify(trace);
+			}
+
+			var timings = new Timings();
+			for (int i = 0; i < repeats; i++)
+			{
+				foreach (var trace in traces)
+				{
+					Replay(trace, timings);
+				}
+			}
+			Console.WriteLine("{0,-8} {1,9} {2,9} {3,9} {4,9} {5,9}", "ns", "calls", "mean", "median", "99th", "max");
+			timings.Insert.Print("Insert");
+			timings.Acquire.Print("Acquire");
+			timings.Release.Print("Release");
+			timings.Reset.Print("Reset");
+		}
+
+		private static Trace InOrder()
+		{
+			var trace = new Trace("in order", 100, 1000);
+			for (int t = 0; t < 100; t++)
+			{
+				trace.Arrivals[t].Add(t);
+			}
+			trace.Underruns = 1;
+			return trace;
+		}
+
+		private static Trace Reorder()
+		{
+			// Packets 1 and 2 swap places, then 3 and 4, and so on.
+			var trace = new Trace("reorder", 100, 1000);
+			for (int t = 0; t < 100; t++)
+			{
+				trace.Arrivals[t].Add(t == 0 || t == 99 ? t : ((t - 1) ^ 1) + 1);
+			}
+			trace.Underruns = 1;
+			return trace;
+		}
+
+		private static Trace Duplicate()
+		{
+			// Every fifth packet arrives twice at once, and every seventh packet arrives again four ticks later, after it
+			// has been played, which counts as late.
+			var trace = new Trace("duplicate", 100, 1000);
+			for (int t = 0; t < 100; t++)
+			{
+				trace.Arrivals[t].Add(t);
+				if (t % 5 == 0)
+				{
+					trace.Arrivals[t].Add(t);
+				}
+				if (t % 7 == 0 && t >= 4)
+				{
+					trace.Arrivals[t].Add(t - 4);
+				}
+			}
+			trace.Late = 14;
+			trace.Underruns = 1;
+			return trace;
+		}
+
+		private static Trace Late()
+		{
+			// Packet 10 arrives ten ticks late, and is recovered from packet 11. Packet 30 is a tick late, but still in
+			// time. Packets 50 and 51 are both late, so 50 cannot be recovered.
+			var trace = new Trace("late", 100, 1000);
+			for (int t = 0; t < 100; t++)
+			{
+				if (t != 10 && t != 30 && t != 50 && t != 51)
+				{
+					trace.Arrivals[t].Add(t);
+				}
+			}
+			trace.Arrivals[20].Add(10);
+			trace.Arrivals[31].Add(30);
+			trace.Arrivals[60].Add(50);
+			trace.Arrivals[60].Add(51);
+			trace.Missing = new int[] { 10, 50, 51 };
+			trace.Late = 3;
+			trace.Underruns = 3;
+			trace.Recovered = 2;
+			return trace;
+		}
+
+		private static Trace WrapAround()
+		{
+			// The timestamp wraps around halfway through, at a point that is not a whole number of spans, and the trace is
+			// longer than the ring, so the slots wrap around too. Pairs are swapped as in the reorder trace.
+			var trace = new Trace("wrap", 600, unchecked(0u - 300u * Span - 37u));
+			for (int t = 0; t < 600; t++)
+			{
+				trace.Arrivals[t].Add(t == 0 || t == 599 ? t : ((t - 1) ^ 1) + 1);
+			}
+			trace.Underruns = 1;
+			return trace;
+		}
+
+		private static Trace Reset()
+		{
+			// The playback thread resets the buffer at tick 50, which throws away the packets it holds, and starts again
+			// with the full delay from the next packet to arrive.
+			var trace = new Trace("reset", 100, 1000);
+			for (int t = 0; t < 100; t++)
+			{
+				trace.Arrivals[t].Add(t);
+			}
+			trace.ResetAt = 50;
+			trace.Missing = new int[] { 48, 49, 50 };
+			trace.Underruns = 1;
+			return trace;
+		}
+
+		private static void Verify(Trace trace)
+		{
+			var outcome = Replay(trace, null);
+			var order = outcome.Played;
+			bool ordered = true;
+			for (int i = 0; i < order.Count; i++)
+			{
+				ordered &= i == 0 || order[i] > order[i - 1];
+			}
+
+			var expected = new List<int>();
+			for (int p = 0; p < trace.Arrivals.Length; p++)
+			{
+				if (Array.IndexOf(trace.Missing, p) < 0)
+				{
+					expected.Add(p);
+				}
+			}
+			bool same = expected.Count == order.Count && expected.TrueForAll((p) => order.Contains(p));
+
+			Console.WriteLine("{0,-10} played {1}, late {2}, underruns {3}, recovered {4}", trace.Name, order.Count, outcome.Late,
+				outcome.Underruns, outcome.Recovered);
+			Check.That(ordered, "{0}: packets were played out of order", trace.Name);
+			Check.That(same, "{0}: played {1} packets, expected {2}", trace.Name, order.Count, expected.Count);
+			Check.That(outcome.Late == trace.Late, "{0}: {1} late packets, expected {2}", trace.Name, outcome.Late, trace.Late);
+			Check.That(outcome.Underruns == trace.Underruns, "{0}: {1} underruns, expected {2}", trace.Name, outcome.Underruns,
+				trace.Underruns);
+			Check.That(outcome.Recovered == trace.Recovered, "{0}: {1} packets recovered, expected {2}", trace.Name, outcome.Recovered,
+				trace.Recovered);
+			Check.That(outcome.Count == 0, "{0}: {1} packets left in the buffer", trace.Name, outcome.Count);
+		}
+
+		private class Outcome
+		{
+			public List<int> Played = new List<int>();
+			public int Recovered, Late, Underruns, Count;
+		}
+
+		private static Outcome Replay(Trace trace, Timings timings)
+		{
+			var outcome = new Outcome();
+			var payload = new byte[PacketSize];
+			var ring = new JitterRing(Span, ClockRate, PacketSize, Capacity, Delay);
+			try
+			{
+				int ticks = trace.Arrivals.Length + Delay + 4;
+				for (int t = 0; t < ticks; t++)
+				{
+					ring.SetClock((double)t * Span / ClockRate);
+					if (t < trace.Arrivals.Length)
+					{
+						foreach (int p in trace.Arrivals[t])
+						{
+							BitConverter.GetBytes(p).CopyTo(payload, 0);
+							int timeStamp = unchecked((int)(trace.FirstTimeStamp + (uint)p * Span));
+							long start = Stopwatch.GetTimestamp();
+							ring.Insert(timeStamp, payload, 0, PacketSize);
+							Record(timings != null ? timings.Insert : null, start);
+						}
+					}
+					if (t == trace.ResetAt)
+					{
+						long start = Stopwatch.GetTimestamp();
+						ring.Reset();
+						Record(timings != null ? timings.Reset : null, start);
+					}
+
+					int size;
+					bool recovery;
+					long acquired = Stopwatch.GetTimestamp();
+					var data = ring.Acquire(out size, out recovery);
+					Record(timings != null ? timings.Acquire : null, acquired);
+					if (data != IntPtr.Zero)
+					{
+						if (recovery)
+						{
+							outcome.Recovered++;
+						}
+						else
+						{
+							outcome.Played.Add(Marshal.ReadInt32(data));
+						}
+					}
+					long released = Stopwatch.GetTimestamp();
+					ring.Release();
+					Record(timings != null ? timings.Release : null, released);
+				}
+				outcome.Late = ring.LatePackets;
+				outcome.Underruns = ring.Underruns;
+				outcome.Count = ring.Count;
+			}
+			finally
+			{
+				ring.Dispose();
+			}
+			return outcome;
+		}
+
+		private static void Record(Latency latency, long start)
+		{
+			if (latency != null)
+			{
+				latency.Add(Stopwatch.GetTimestamp() - start);
+			}
+		}
+	}
+}
@@ -0,0 +1,136 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Net;
+using System.Net.Sockets;
+using System.Threading;
+
+namespace test
+{
+	// Stands between a client and whatever it talks to, and passes datagrams both ways, dropping some of the RTP packets
+	// that go towards the client. The client sends to Near, and the other end sees the client as Far. The drops follow a
+	// fixed random sequence and never reorder anything, so the loss that the client should report is known exactly.
+	class LossyLink : IDisposable
+	{
+		private const int MaxPacketSize = 2048;
+		private const int SkipPackets = 5;
+
+		private UdpClient _near, _far;
+		private IPEndPoint _client, _remote;
+		private double _lossRate;
+		private Random _random;
+		private Thread _thread;
+		private volatile bool _closing;
+		private Dictionary<uint, List<int>> _dropped;
+		private Dictionary<uint, int> _highest, _packets;
+
+		public LossyLink(IPEndPoint client, IPEndPoint remote, double lossRate, int seed)
+		{
+			_near = new UdpClient(new IPEndPoint(IPAddress.Loopback, 0));
+			_far = new UdpClient(new IPEndPoint(IPAddress.Loopback, 0));
+			_client = client;
+			_remote = remote;
+			_lossRate = lossRate;
+			_random = new Random(seed);
+			_dropped = new Dictionary<uint, List<int>>();
+			_highest = new Dictionary<uint, int>();
+			_packets = new Dictionary<uint, int>();
+			_thread = new Thread(new ThreadStart(ThreadProc));
+			_thread.Start();
+		}
+
+		public IPEndPoint Near { get { return (IPEndPoint)_near.Client.LocalEndPoint; } }
+
+		public IPEndPoint Far { get { return (IPEndPoint)_far.Client.LocalEndPoint; } }
+
+		// Returns the number of packets of a source that were dropped before the last one that got through, which is what a
+		// receiver counts as lost.
+		public int GetLost(int ssrc)
+		{
+			lock (_dropped)
+			{
+				List<int> dropped;
+				int highest;
+				if (!_dropped.TryGetValue((uint)ssrc, out dropped) || !_highest.TryGetValue((uint)ssrc, out highest))
+				{
+					return 0;
+				}
+				return dropped.FindAll((seq) => seq < highest).Count;
+			}
+		}
+
+		public void Dispose()
+		{
+			_closing = true;
+			_thread.Join();
+			_near.Close();
+			_far.Close();
+		}
+
+		private void ThreadProc()
+		{
+			var buffer = new byte[MaxPacketSize];
+			var sockets = new List<Socket>();
+			EndPoint sender = new IPEndPoint(IPAddress.Any, 0);
+			while (!_closing)
+			{
+				sockets.Clear();
+				sockets.Add(_near.Client);
+				sockets.Add(_far.Client);
+				Socket.Select(sockets, null, null, 100000);
+				foreach (var socket in sockets)
+				{
+					int count;
+					try
+					{
+						count = socket.ReceiveFrom(buffer, ref sender);
+					}
+					catch (SocketException)
+					{
+						continue;
+					}
+					if (socket == _near.Client)
+					{
+						_far.Client.SendTo(buffer, 0, count, SocketFlags.None, _remote);
+					}
+					else if (!this.ShouldDrop(buffer, count))
+					{
+						_near.Client.SendTo(buffer, 0, count, SocketFlags.None, _client);
+					}
+				}
+			}
+		}
+
+		private bool ShouldDrop(byte[] buffer, int count)
+		{
+			// Keepalives and RTCP always get through.
+			if (count <= TestPeer.HeaderSize || buffer[0] != 0x80 || (buffer[1] >= 200 && buffer[1] <= 204))
+			{
+				return false;
+			}
+			int seq = (buffer[2] << 8) | buffer[3];
+			uint ssrc = (uint)((buffer[8] << 24) | (buffer[9] << 16) | (buffer[10] << 8) | buffer[11]);
+			lock (_dropped)
+			{
+				// The first few packets of each source get through, so that the receiver knows where the stream starts.
+				int packets;
+				_packets.TryGetValue(ssrc, out packets);
+				_packets[ssrc] = packets + 1;
+				bool drop = packets >= SkipPackets && _random.NextDouble() < _lossRate;
+				if (drop)
+				{
+					List<int> dropped;
+					if (!_dropped.TryGetValue(ssrc, out dropped))
+					{
+						_dropped.Add(ssrc, dropped = new List<int>());
+					}
+					dropped.Add(seq);
+				}
+				else
+				{
+					_highest[ssrc] = seq;
+				}
+				return drop;
+			}
+		}
+	}
+}
@@ -0,0 +1,201 @@
+﻿using System;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+using Floe.Interop;
+
+namespace test
+{
+	// Measures how long AudioMixer takes to mix one playback buffer as the number of peers grows from 1 to 64, for the
+	// 20 ms buffers of GSM at 8 kHz and of 48 kHz audio. Each peer is a source that copies a prepared frame into the
+	// mixer, so that what is measured is the mixer and not a decoder.
+	//
+	// Before that, the mix is checked against a sum in C#: every input scaled by its gain, rounded and added, and the total
+	// saturated to 16 bits, with halves rounded away from zero by the vector kernels as by the scalar one. The checks
+	// cover muted inputs, which must still be read so that their jitter buffers keep pace, inputs that return less than a
+	// full buffer, an input that is a Stream, enough loud inputs to saturate, and removing an input.
+	//
+	// usage: test mixer [seconds per row]
+	static class MixerLoadTest
+	{
+		private const int PacketMilliseconds = 20;
+
+		private class ToneSource : IWaveSource
+		{
+			private short[] _samples;
+			private int _available;
+
+			public int Reads;
+
+			public ToneSource(short[] samples, int available)
+			{
+				_samples = samples;
+				_available = available;
+			}
+
+			public short[] Samples
+			{
+				get
+				{
+					return _samples;
+				}
+			}
+
+			public int Available
+			{
+				get
+				{
+					return _available;
+				}
+			}
+
+			public int Read(IntPtr buffer, int count)
+			{
+				this.Reads++;
+				int samples = Math.Min(_available, count / 2);
+				Marshal.Copy(_samples, 0, buffer, samples);
+				return samples * 2;
+			}
+		}
+
+		public static void Run(string[] args)
+		{
+			double seconds = args.Length > 0 ? double.Parse(args[0]) : 0.25;
+			var random = new Random(1);
+
+			foreach (int peers in new int[] { 1, 2, 3, 8, 64 })
+			{
+				CheckMix(random, peers, 160, 1000);
+				CheckMix(random, peers, 961, 8000);
+			}
+			CheckMix(random, 64, 960, 32767);
+
+			Console.WriteLine("{0,6} {1,12} {2,12} {3,12} {4,12}", "peers", "8 kHz us", "per peer us", "48 kHz us", "per peer us");
+			foreach (int peers in new int[] { 1, 2, 4, 8, 16, 32, 64 })
+			{
+				double narrow = Measure(random, peers, 8000 * PacketMilliseconds / 1000, seconds);
+				double wide = Measure(random, peers, 48000 * PacketMilliseconds / 1000, seconds);
+				Console.WriteLine("{0,6} {1,12:F2} {2,12:F3} {3,12:F2} {4,12:F3}", peers, narrow, narrow / peers, wide, wide / peers);
+				if (peers == 64)
+				{
+					Check.That(wide < PacketMilliseconds * 1000 * 0.05, "mixing 64 peers at 48 kHz took {0:F0} us of every {1} ms",
+						wide, PacketMilliseconds);
+				}
+			}
+		}
+
+		private static short[] MakeSamples(Random random, int count, int amplitude)
+		{
+			var samples = new short[count];
+			for (int i = 0; i < count; i++)
+			{
+				samples[i] = (short)random.Next(-amplitude, amplitude + 1);
+			}
+			return samples;
+		}
+
+		private static void CheckMix(Random random, int peers, int count, int amplitude)
+		{
+			string name = string.Format("{0} peers, {1} samples", peers, count);
+			var mixer = new AudioMixer(count * 2);
+			var sources = new ToneSource[peers];
+			var inputs = new MixerInput[peers];
+			var gains = new float[peers];
+			for (int i = 0; i < peers; i++)
+			{
+				// Every fourth input is muted, and every fifth comes up short.
+				sources[i] = new ToneSource(MakeSamples(random, count, amplitude), i % 5 == 4 ? count / 3 : count);
+				gains[i] = i % 4 == 3 ? 0f : (float)Math.Round(random.NextDouble() * 2, 3);
+				inputs[i] = mixer.AddInput(sources[i]);
+				inputs[i].Gain = gains[i];
+			}
+
+			// One more input, at unity gain, is a stream.
+			var streamed = MakeSamples(random, count, amplitude);
+			var bytes = new byte[count * 2];
+			Buffer.BlockCopy(streamed, 0, bytes, 0, bytes.Length);
+			var stream = new MemoryStream();
+			stream.Write(bytes, 0, bytes.Length);
+			stream.Write(bytes, 0, bytes.Length);
+			stream.Position = 0;
+			mixer.AddInput(stream);
+
+			var buffer = Marshal.AllocHGlobal(count * 2);
+			try
+			{
+				var output = new short[count];
+				Check.That(mixer.Read(buffer, count * 2) == count * 2, "{0}: the mix was short", name);
+				Marshal.Copy(buffer, output, 0, count);
+				Compare(name, output, sources, gains, streamed);
+				Check.That(Array.TrueForAll(sources, (s) => s.Reads == 1), "{0}: not every input was read once", name);
+
+				mixer.RemoveInput(inputs[0]);
+				gains[0] = 0f;
+				Check.That(mixer.Read(buffer, count * 2) == count * 2 && mixer.InputCount == peers,
+					"{0}: the mix after removing an input was short", name);
+				Marshal.Copy(buffer, output, 0, count);
+				Compare(name + " less one", output, sources, gains, streamed);
+				Check.That(sources[0].Reads == 1, "{0}: a removed input was still read", name);
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(buffer);
+				mixer.Dispose();
+			}
+		}
+
+		private static void Compare(string name, short[] output, ToneSource[] sources, float[] gains, short[] streamed)
+		{
+			for (int i = 0; i < output.Length; i++)
+			{
+				long expected = streamed[i];
+				for (int j = 0; j < sources.Length; j++)
+				{
+					if (gains[j] == 0f || i >= sources[j].Available)
+					{
+						continue;
+					}
+					expected += (long)Math.Round(sources[j].Samples[i] * gains[j], MidpointRounding.AwayFromZero);
+				}
+				expected = Math.Max(short.MinValue, Math.Min(short.MaxValue, expected));
+				if (output[i] != expected)
+				{
+					Check.That(false, "{0}: sample {1} was {2}, expected {3}", name, i, output[i], expected);
+					return;
+				}
+			}
+		}
+
+		// Returns the time taken by one mix, in microseconds.
+		private static double Measure(Random random, int peers, int count, double seconds)
+		{
+			var mixer = new AudioMixer(count * 2);
+			for (int i = 0; i < peers; i++)
+			{
+				mixer.AddInput(new ToneSource(MakeSamples(random, count, 4000), count)).Gain = 0.8f;
+			}
+			var buffer = Marshal.AllocHGlobal(count * 2);
+			try
+			{
+				mixer.Read(buffer, count * 2);
+				long mixes = 0;
+				var clock = Stopwatch.StartNew();
+				do
+				{
+					for (int i = 0; i < 100; i++)
+					{
+						mixer.Read(buffer, count * 2);
+					}
+					mixes += 100;
+				}
+				while (clock.Elapsed.TotalSeconds < seconds);
+				return clock.Elapsed.TotalMilliseconds * 1000 / mixes;
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(buffer);
+				mixer.Dispose();
+			}
+		}
+	}
+}
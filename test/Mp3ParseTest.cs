@@ -0,0 +1,590 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+using Floe.Interop;
+
+namespace test
+{
+	// Writes MPEG audio files whose frames are known, opens them with Mp3Reader, and checks that it finds every frame and
+	// nothing else, then measures how fast it indexes a large file and hands out its frames.
+	//
+	// The frames hold random bytes after their headers, so they are full of stray sync words, as real audio is. The small
+	// files cover an ID3v2.2 tag; a v2.3 tag with an extended header before a Xing header and variable bit rate frames,
+	// with junk between some of them; two tags in a row, the second a v2.4 tag with a footer, before an Info header and
+	// MPEG-2 layer III frames; and layer II with no tag at all but an ID3v1 tag at the end. The tags are filled with bytes
+	// that look like frame headers. For each file, the frame count, format and average bit rate must be right, the VBR
+	// header frame must be left out, reads must give back exactly the frames in the file and only whole ones, and seeking
+	// by frame and by time must land on the right frame. A file read through a stream must give the same as one mapped.
+	//
+	// The large file is variable bit rate MPEG-1 layer III with a v2.3 tag that the old Mp3FileStream could read. The
+	// time to open it, mapped and through a FileStream, is compared with the time that the old stream took to step through
+	// it a frame at a time, with a ReadByte for every byte of each header and a seek back over it.
+	//
+	// usage: test mp3 [megabytes]
+	static class Mp3ParseTest
+	{
+		private const int BufferMilliseconds = 200; // as in FilePlayer
+
+		private static readonly short[] Mpeg1Layer3BitRates = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 };
+		private static readonly short[] Mpeg1Layer2BitRates = { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 };
+		private static readonly short[] Mpeg2Layer3BitRates = { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 };
+
+		// Builds a file in memory, and keeps the place and size of every audio frame written to it.
+		private class Mp3Builder
+		{
+			private MemoryStream _data;
+			private Random _random;
+
+			public List<int> Offsets = new List<int>();
+			public List<int> Sizes = new List<int>();
+			public long AudioBytes;
+
+			public Mp3Builder(int seed)
+			{
+				_data = new MemoryStream();
+				_random = new Random(seed);
+			}
+
+			public byte[] ToArray()
+			{
+				return _data.ToArray();
+			}
+
+			public int Length
+			{
+				get
+				{
+					return (int)_data.Length;
+				}
+			}
+
+			// An ID3v2 tag of the given version and flags, with a body of the given size that looks like frame headers.
+			public void Id3(int version, int flags, int size, bool footer)
+			{
+				this.Id3Header("ID3", version, flags, size);
+				for (int i = 0; i < size; i++)
+				{
+					_data.WriteByte(i % 3 == 0 ? (byte)0xff : (byte)0xfb);
+				}
+				if (footer)
+				{
+					this.Id3Header("3DI", version, flags, size);
+				}
+			}
+
+			private void Id3Header(string id, int version, int flags, int size)
+			{
+				foreach (char c in id)
+				{
+					_data.WriteByte((byte)c);
+				}
+				_data.WriteByte((byte)version);
+				_data.WriteByte(0);
+				_data.WriteByte((byte)flags);
+				for (int shift = 21; shift >= 0; shift -= 7)
+				{
+					_data.WriteByte((byte)((size >> shift) & 0x7f));
+				}
+			}
+
+			// Bytes that hold sync words but no frame that is followed by another.
+			public void Junk(int size)
+			{
+				for (int i = 0; i < size; i++)
+				{
+					_data.WriteByte(i % 3 != 0 ? (byte)0xff : (byte)0xe3);
+				}
+			}
+
+			// A frame with the given header bytes and size, filled with random bytes.
+			public void Frame(byte b1, byte b2, byte b3, int size)
+			{
+				var frame = this.MakeFrame(b1, b2, b3, size);
+				this.Offsets.Add((int)_data.Length);
+				this.Sizes.Add(size);
+				this.AudioBytes += size;
+				_data.Write(frame, 0, size);
+			}
+
+			private byte[] MakeFrame(byte b1, byte b2, byte b3, int size)
+			{
+				var frame = new byte[size];
+				_random.NextBytes(frame);
+				frame[0] = 0xff;
+				frame[1] = b1;
+				frame[2] = b2;
+				frame[3] = b3;
+				return frame;
+			}
+
+			public void Mpeg1Layer3(int bitRateIndex, bool padding)
+			{
+				int size = 144 * Mpeg1Layer3BitRates[bitRateIndex] * 1000 / 44100 + (padding ? 1 : 0);
+				this.Frame(0xfb, (byte)(bitRateIndex << 4 | (padding ? 2 : 0)), 0x44, size);
+			}
+
+			public void Mpeg1Layer2(int bitRateIndex, bool padding)
+			{
+				int size = 144 * Mpeg1Layer2BitRates[bitRateIndex] * 1000 / 48000 + (padding ? 1 : 0);
+				this.Frame(0xfd, (byte)(bitRateIndex << 4 | 1 << 2 | (padding ? 2 : 0)), 0x04, size);
+			}
+
+			public void Mpeg2Layer3(int bitRateIndex, bool padding)
+			{
+				int size = 72 * Mpeg2Layer3BitRates[bitRateIndex] * 1000 / 22050 + (padding ? 1 : 0);
+				this.Frame(0xf3, (byte)(bitRateIndex << 4 | (padding ? 2 : 0)), 0xc4, size);
+			}
+
+			// A frame that holds no audio, but a Xing or Info header giving the number of frames that follow. The header
+			// comes after the side information, which is 32 bytes for MPEG-1 stereo and 9 for MPEG-2 mono.
+			public void VbrHeader(string tag, bool mpeg1, int frames)
+			{
+				int offset = 4 + (mpeg1 ? 32 : 9);
+				var frame = mpeg1 ? this.MakeFrame(0xfb, 9 << 4, 0x44, 417) : this.MakeFrame(0xf3, 8 << 4, 0xc4, 208);
+				for (int i = 0; i < 4; i++)
+				{
+					frame[offset + i] = (byte)tag[i];
+				}
+				frame[offset + 7] = 1;
+				for (int i = 0; i < 4; i++)
+				{
+					frame[offset + 8 + i] = (byte)(frames >> (24 - 8 * i));
+				}
+				_data.Write(frame, 0, frame.Length);
+			}
+
+			public void Id3v1()
+			{
+				_data.Write(new byte[] { (byte)'T', (byte)'A', (byte)'G' }, 0, 3);
+				for (int i = 3; i < 128; i++)
+				{
+					_data.WriteByte(0xff);
+				}
+			}
+
+			public int Next(int max)
+			{
+				return _random.Next(max);
+			}
+		}
+
+		// The Mp3FileStream that FilePlayer used before Mp3Reader, less its wave format and its checks of the ID3 tag.
+		private class OldMp3FileStream : Stream
+		{
+			private static readonly short[, ,] MpegBitRates = new short[2, 3, 16]
+			{
+				{
+					{ 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },
+					{ 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },
+					{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 }
+				},
+				{
+					{ 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
+					{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+					{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 }
+				}
+			};
+
+			private static readonly int[,] MpegSampleRates = new int[3, 4]
+			{
+				{
+					44100, 48000, 32000, 0
+				},
+				{
+					22050, 24000, 16000, 0
+				},
+				{
+					11025, 12000, 8000, 0
+				}
+			};
+
+			private Stream _stream;
+
+			public OldMp3FileStream(Stream stream)
+			{
+				_stream = stream;
+				var bytes = new byte[10];
+				_stream.Read(bytes, 0, 10);
+				_stream.Seek((bytes[6] << 21) | (bytes[7] << 14) | (bytes[8] << 7) | bytes[9], SeekOrigin.Current);
+
+				int channels, bitRate, sampleRate;
+				this.ReadFrameHeader(out channels, out sampleRate, out bitRate);
+			}
+
+			public override bool CanRead { get { return true; } }
+			public override bool CanSeek { get { return false; } }
+			public override bool CanWrite { get { return false; } }
+			public override void Flush() { throw new NotImplementedException(); }
+			public override long Length { get { throw new NotImplementedException(); } }
+			public override long Position { get { throw new NotImplementedException(); } set { throw new NotImplementedException(); } }
+			public override long Seek(long offset, SeekOrigin origin) { throw new NotImplementedException(); }
+			public override void SetLength(long value) { throw new NotImplementedException(); }
+			public override void Write(byte[] buffer, int offset, int count) { throw new NotImplementedException(); }
+
+			public override int Read(byte[] buffer, int offset, int count)
+			{
+				int blockSize = this.ReadFrameHeader();
+				int numRead = _stream.Read(buffer, offset, Math.Min(count, blockSize));
+				if (blockSize > count)
+				{
+					_stream.Seek(blockSize - count, SeekOrigin.Current);
+				}
+				return numRead;
+			}
+
+			public override void Close()
+			{
+				_stream.Close();
+			}
+
+			private int ReadFrameHeader()
+			{
+				int channels, sampleRate, bitRate;
+				return this.ReadFrameHeader(out channels, out sampleRate, out bitRate);
+			}
+
+			private int ReadFrameHeader(out int channels, out int sampleRate, out int bitRate)
+			{
+				channels = 0;
+				sampleRate = 0;
+				bitRate = 0;
+
+				int b;
+				while (true)
+				{
+					if ((b = _stream.ReadByte()) == -1)
+					{
+						return 0;
+					}
+					else if (b != 0xff)
+					{
+						continue;
+					}
+
+					if ((b = _stream.ReadByte()) == -1)
+					{
+						return 0;
+					}
+					if ((b & 0xe0) != 0xe0)
+					{
+						continue;
+					}
+
+					int version = (b & 0x18) >> 3;
+					if (version == 1)
+					{
+						continue;
+					}
+					switch (version)
+					{
+						case 0:
+							version = 2;
+							break;
+						case 2:
+							version = 1;
+							break;
+						case 3:
+							version = 0;
+							break;
+					}
+					int layer = (b & 0x6) >> 1;
+					if (layer == 0)
+					{
+						continue;
+					}
+					switch (layer)
+					{
+						case 1:
+							layer = 2;
+							break;
+						case 2:
+							layer = 1;
+							break;
+						case 3:
+							layer = 0;
+							break;
+					}
+
+					if ((b = _stream.ReadByte()) == -1)
+					{
+						return 0;
+					}
+					bitRate = MpegBitRates[version > 0 ? 1 : 0, layer, (b >> 4)];
+					if (bitRate == 0)
+					{
+						continue;
+					}
+
+					sampleRate = MpegSampleRates[version, (b & 0xc) >> 2];
+					if (sampleRate == 0)
+					{
+						continue;
+					}
+					int padding = (b & 0x2) > 0 ? 1 : 0;
+
+					if ((b = _stream.ReadByte()) == -1)
+					{
+						return 0;
+					}
+					channels = ((b & 0xc0) >> 6) == 3 ? 1 : 2;
+
+					_stream.Seek(-4, SeekOrigin.Current);
+					return 144 * bitRate * 1000 / sampleRate + padding;
+				}
+			}
+		}
+
+		private class Expected
+		{
+			public int SampleRate, Channels, SamplesPerFrame;
+			public bool Variable;
+		}
+
+		public static void Run(string[] args)
+		{
+			int megabytes = args.Length > 0 ? int.Parse(args[0]) : 64;
+
+			var b = new Mp3Builder(1);
+			b.Id3(2, 0, 700, false);
+			for (int i = 0; i < 2000; i++)
+			{
+				b.Mpeg1Layer3(9, i % 3 == 0);
+			}
+			b.Id3v1();
+			CheckFile("ID3v2.2, constant bit rate", b, new Expected { SampleRate = 44100, Channels = 2, SamplesPerFrame = 1152 });
+
+			b = new Mp3Builder(2);
+			b.Id3(3, 0x40, 1500, false);
+			b.VbrHeader("Xing", true, 3000);
+			for (int i = 0; i < 3000; i++)
+			{
+				b.Mpeg1Layer3(1 + b.Next(14), b.Next(2) == 0);
+				if (i % 250 == 100)
+				{
+					b.Junk(37);
+				}
+			}
+			CheckFile("ID3v2.3 and Xing, with junk", b, new Expected { SampleRate = 44100, Channels = 2, SamplesPerFrame = 1152,
+				Variable = true });
+
+			b = new Mp3Builder(3);
+			b.Id3(3, 0, 200, false);
+			b.Id3(4, 0x10, 900, true);
+			b.VbrHeader("Info", false, 2500);
+			for (int i = 0; i < 2500; i++)
+			{
+				b.Mpeg2Layer3(8, i % 2 == 0);
+			}
+			CheckFile("two tags, ID3v2.4 and Info, MPEG-2", b, new Expected { SampleRate = 22050, Channels = 1,
+				SamplesPerFrame = 576 });
+
+			b = new Mp3Builder(4);
+			for (int i = 0; i < 1500; i++)
+			{
+				b.Mpeg1Layer2(10, false);
+			}
+			b.Id3v1();
+			CheckFile("layer II, no ID3v2", b, new Expected { SampleRate = 48000, Channels = 2, SamplesPerFrame = 1152 });
+
+			Measure(megabytes);
+		}
+
+		private static void CheckFile(string name, Mp3Builder b, Expected expected)
+		{
+			var bytes = b.ToArray();
+			string path = Path.GetTempFileName();
+			try
+			{
+				File.WriteAllBytes(path, bytes);
+				using (var reader = new Mp3Reader(path))
+				{
+					CheckReader(name, reader, b, bytes, expected);
+				}
+				using (var reader = new Mp3Reader(new MemoryStream(bytes)))
+				{
+					CheckReader(name + " from a stream", reader, b, bytes, expected);
+				}
+			}
+			finally
+			{
+				File.Delete(path);
+			}
+		}
+
+		private static void CheckReader(string name, Mp3Reader reader, Mp3Builder b, byte[] bytes, Expected expected)
+		{
+			int frames = b.Offsets.Count;
+			int bitRate = (int)(b.AudioBytes * 8 * expected.SampleRate / ((long)frames * expected.SamplesPerFrame));
+			int maxSize = 0;
+			b.Sizes.ForEach((size) => maxSize = Math.Max(maxSize, size));
+			Console.WriteLine("{0}: {1} frames, {2} Hz, {3} channels, {4} bit/s{5}", name, reader.Frames, reader.SampleRate,
+				reader.Channels, reader.BitRate, reader.IsVariableBitRate ? ", variable" : "");
+			Check.That(reader.Frames == frames, "{0}: {1} frames were found of {2}", name, reader.Frames, frames);
+			Check.That(reader.SampleRate == expected.SampleRate && reader.Channels == expected.Channels &&
+				reader.IsVariableBitRate == expected.Variable && reader.BitRate == bitRate && reader.MaxFrameSize == maxSize,
+				"{0}: the format was {1} Hz, {2} channels, {3} bit/s, frames up to {4} bytes", name, reader.SampleRate,
+				reader.Channels, reader.BitRate, reader.MaxFrameSize);
+			var duration = TimeSpan.FromTicks((long)frames * expected.SamplesPerFrame * TimeSpan.TicksPerSecond / expected.SampleRate);
+			Check.That(reader.Duration == duration, "{0}: the duration was {1} and not {2}", name, reader.Duration, duration);
+			if (reader.Frames != frames)
+			{
+				return;
+			}
+
+			int bufferSize = reader.GetBufferSize(BufferMilliseconds);
+			var buffer = Marshal.AllocHGlobal(bufferSize);
+			try
+			{
+				// Every read must be whole frames, in order.
+				var data = new byte[bufferSize];
+				int frame = 0, reads = 0;
+				while (true)
+				{
+					int size = reader.Read(buffer, bufferSize);
+					if (size == 0)
+					{
+						break;
+					}
+					reads++;
+					Marshal.Copy(buffer, data, 0, size);
+					int offset = 0;
+					while (offset < size && frame < frames && Same(data, offset, bytes, b.Offsets[frame], b.Sizes[frame]))
+					{
+						offset += b.Sizes[frame++];
+					}
+					if (offset != size)
+					{
+						Check.That(false, "{0}: read {1} did not hold whole frames from frame {2}", name, reads, frame);
+						return;
+					}
+				}
+				Check.That(frame == frames, "{0}: {1} of {2} frames were read", name, frame, frames);
+				Check.That(reads <= frames * expected.SamplesPerFrame * 1000L / expected.SampleRate / BufferMilliseconds + 2,
+					"{0}: {1} reads were needed for {2} frames", name, reads, frames);
+
+				// Seeking by frame, and by a time within a frame.
+				foreach (int target in new int[] { frames / 2, 7, frames - 1 })
+				{
+					reader.Frame = target;
+					int size = reader.Read(buffer, bufferSize);
+					Marshal.Copy(buffer, data, 0, size);
+					Check.That(size >= b.Sizes[target] && Same(data, 0, bytes, b.Offsets[target], b.Sizes[target]),
+						"{0}: seeking to frame {1} did not read it", name, target);
+
+					var time = TimeSpan.FromTicks(((long)target * expected.SamplesPerFrame + expected.SamplesPerFrame / 2) *
+						TimeSpan.TicksPerSecond / expected.SampleRate);
+					reader.Position = time;
+					Check.That(reader.Frame == target, "{0}: seeking to {1} went to frame {2}, not {3}", name, time, reader.Frame,
+						target);
+				}
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(buffer);
+			}
+		}
+
+		private static bool Same(byte[] a, int aOffset, byte[] b, int bOffset, int count)
+		{
+			if (aOffset + count > a.Length)
+			{
+				return false;
+			}
+			for (int i = 0; i < count; i++)
+			{
+				if (a[aOffset + i] != b[bOffset + i])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		private static void Measure(int megabytes)
+		{
+			var b = new Mp3Builder(5);
+			b.Id3(3, 0, 4000, false);
+			while (b.Length < megabytes << 20)
+			{
+				b.Mpeg1Layer3(1 + b.Next(14), b.Next(2) == 0);
+			}
+			var bytes = b.ToArray();
+			string path = Path.GetTempFileName();
+			try
+			{
+				File.WriteAllBytes(path, bytes);
+				double size = bytes.Length / 1e6;
+				var clock = Stopwatch.StartNew();
+				int frames;
+				using (var reader = new Mp3Reader(path))
+				{
+					frames = reader.Frames;
+				}
+				double mapped = clock.Elapsed.TotalSeconds;
+
+				clock = Stopwatch.StartNew();
+				using (var stream = new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read))
+				using (var reader = new Mp3Reader(stream))
+				{
+					Check.That(reader.Frames == frames, "the file had {0} frames through a stream and {1} mapped", reader.Frames,
+						frames);
+				}
+				double streamed = clock.Elapsed.TotalSeconds;
+
+				// Handing out every frame, 200 ms at a time.
+				long reads = 0;
+				double read;
+				using (var reader = new Mp3Reader(path))
+				{
+					int bufferSize = reader.GetBufferSize(BufferMilliseconds);
+					var buffer = Marshal.AllocHGlobal(bufferSize);
+					try
+					{
+						clock = Stopwatch.StartNew();
+						while (reader.Read(buffer, bufferSize) > 0)
+						{
+							reads++;
+						}
+						read = clock.Elapsed.TotalSeconds;
+					}
+					finally
+					{
+						Marshal.FreeHGlobal(buffer);
+					}
+				}
+
+				clock = Stopwatch.StartNew();
+				long oldReads = OldScan(path);
+				double old = clock.Elapsed.TotalSeconds;
+
+				Console.WriteLine("{0:F0} MB, {1} frames: opened mapped at {2:F0} MB/s, through a stream at {3:F0} MB/s", size, frames,
+					size / mapped, size / streamed);
+				Console.WriteLine("read in {0} buffers at {1:F0} MB/s; the old stream took {2} reads at {3:F0} MB/s", reads,
+					size / read, oldReads, size / old);
+				Check.That(frames == b.Offsets.Count, "the large file had {0} frames, and {1} were found", b.Offsets.Count, frames);
+				Check.That(mapped < old, "opening took {0:F2} s, and the old stream took {1:F2} s to step through", mapped, old);
+			}
+			finally
+			{
+				File.Delete(path);
+			}
+		}
+
+		// Reads a frame at a time through the old Mp3FileStream until it gives nothing, and returns the number of reads.
+		private static long OldScan(string path)
+		{
+			using (var stream = new OldMp3FileStream(new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.Read)))
+			{
+				var frame = new byte[2048];
+				long frames = 0;
+				while (stream.Read(frame, 0, frame.Length) > 0)
+				{
+					frames++;
+				}
+				return frames;
+			}
+		}
+	}
+}
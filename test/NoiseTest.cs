@@ -0,0 +1,216 @@
+﻿using System;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+using Floe.Interop;
+
+namespace test
+{
+	// Runs noise suppression and automatic gain control over a recording, as they run on the microphone in a voice
+	// session, and writes what comes out to another WAV file. The recording is read through WavReader, mixed down to mono,
+	// and processed a frame of four 128-sample blocks at a time: with the suppressor alone, with gain control alone, and
+	// with both, in that order, as VoiceIn does. The output file holds the last.
+	//
+	// Each stage does the same work whatever the microphone hears, so the cost of a frame is fixed: it must take a small
+	// part of the time the frame lasts, on average and at worst.
+	//
+	// With no files, a recording is made up first: a fan at about -45 dBFS throughout, and a quiet talker at about -35 dBFS
+	// from the third second of twenty. The suppressor alone must then take the fan down by at least 10 dB before the
+	// talker starts, and gain control must bring the talker to within 6 dB of its -20 dBFS target by the second half.
+	//
+	// usage: test noise [in.wav [out.wav]]
+	static class NoiseTest
+	{
+		private const int BlockSize = 128; // samples
+		private const int FrameBlocks = 4;
+		private const int FrameSize = BlockSize * FrameBlocks;
+		private const int SampleRate = 16000;
+		private const double TalkStart = 3.0; // seconds
+		private const double Length = 20.0;
+		private const double MinAttenuation = 10.0; // dB
+		private const double TargetLevel = -20.0; // dBFS, as in GainController
+		private const double MaxLoad = 0.02; // of the length of a frame, on average
+		private const double MaxFrameLoad = 0.5; // at worst
+
+		private class Result
+		{
+			public short[] Output;
+			public double AverageTime, MaxTime;
+			public float NoiseLevel, Gain;
+		}
+
+		public static void Run(string[] args)
+		{
+			if (args.Length > 0)
+			{
+				int rate;
+				var input = WavFile.Read(args[0], out rate);
+				var output = Process(input, rate, null);
+				WavFile.Write(args.Length > 1 ? args[1] : Path.ChangeExtension(args[0], ".out.wav"), rate, output);
+				return;
+			}
+
+			var random = new Random(1);
+			bool[] talking;
+			var made = MakeRecording(random, out talking);
+			string inPath = Path.GetTempFileName(), outPath = Path.GetTempFileName();
+			try
+			{
+				WavFile.Write(inPath, SampleRate, made);
+				int rate;
+				var input = WavFile.Read(inPath, out rate);
+				WavFile.Write(outPath, rate, Process(input, rate, talking));
+				var output = WavFile.Read(outPath, out rate);
+				Check.That(output.Length == input.Length, "{0} samples were written, and {1} read", output.Length, input.Length);
+			}
+			finally
+			{
+				File.Delete(inPath);
+				File.Delete(outPath);
+			}
+		}
+
+		// Runs the three configurations over the input, checks each, and returns the output of the last. The checks on
+		// levels are made only if it is known where the talker is.
+		private static short[] Process(short[] input, int rate, bool[] talking)
+		{
+			double frameTime = FrameSize * 1000.0 / rate;
+			int start = (int)(TalkStart * rate), half = input.Length / 2;
+			Console.WriteLine("{0,-12} {1,7} {2,7} {3,8} {4,7} {5,7} {6,9} {7,8} {8,8} {9,7}", "stages", "in dB", "out dB",
+				"noise dB", "gain dB", "fan dB", "talker dB", "avg ms", "max ms", "load %");
+
+			short[] output = null;
+			foreach (var stages in new bool[][] { new bool[] { true, false }, new bool[] { false, true }, new bool[] { true, true } })
+			{
+				string name = stages[0] && stages[1] ? "both" : stages[0] ? "suppression" : "gain";
+				var result = Process(input, rate, stages[0], stages[1]);
+				output = result.Output;
+
+				// The suppressor delays its output by a block. The fan is measured once the suppressor has had a second
+				// to learn it, and without gain control, which is free to raise what is left of it; the talker is
+				// measured in the second half, over the samples where it is talking.
+				int delay = stages[0] ? BlockSize : 0;
+				double attenuation = double.NaN, level = double.NaN;
+				if (talking != null && stages[0] && !stages[1])
+				{
+					attenuation = Level(input, rate, start, null, 0) - Level(output, rate + delay, start + delay, null, 0);
+					Check.That(attenuation >= MinAttenuation, "{0}: the fan was taken down by {1:F1} dB", name, attenuation);
+				}
+				if (talking != null && stages[1])
+				{
+					level = Level(output, half + delay, output.Length, talking, delay);
+					Check.That(Math.Abs(level - TargetLevel) < 6, "{0}: the talker came out at {1:F1} dBFS", name, level);
+				}
+
+				Console.WriteLine("{0,-12} {1,7:F1} {2,7:F1} {3,8:F1} {4,7:F1} {5,7:F1} {6,9:F1} {7,8:F3} {8,8:F3} {9,7:F2}", name,
+					Level(input, 0, input.Length, null, 0), Level(output, 0, output.Length, null, 0), result.NoiseLevel,
+					result.Gain, -attenuation, level, result.AverageTime, result.MaxTime, result.AverageTime / frameTime * 100);
+				Check.That(result.AverageTime < frameTime * MaxLoad, "{0}: a {1:F0} ms frame took {2:F3} ms on average", name,
+					frameTime, result.AverageTime);
+				Check.That(result.MaxTime < frameTime * MaxFrameLoad, "{0}: a {1:F0} ms frame took {2:F3} ms at worst", name,
+					frameTime, result.MaxTime);
+			}
+			return output;
+		}
+
+		private static Result Process(short[] input, int rate, bool suppress, bool control)
+		{
+			var output = new short[input.Length];
+			var buffer = Marshal.AllocHGlobal(FrameSize * 2);
+			var suppressor = suppress ? new NoiseSuppressor(rate, BlockSize) : null;
+			var gainControl = control ? new AutomaticGainControl(rate) : null;
+			try
+			{
+				int frames = 0;
+				long totalTicks = 0, maxTicks = 0;
+				for (int offset = 0; offset + FrameSize <= input.Length; offset += FrameSize)
+				{
+					Marshal.Copy(input, offset, buffer, FrameSize);
+					long start = Stopwatch.GetTimestamp();
+					if (suppressor != null)
+					{
+						suppressor.Process(buffer, FrameSize * 2);
+					}
+					if (gainControl != null)
+					{
+						gainControl.Process(buffer, FrameSize * 2);
+					}
+					long ticks = Stopwatch.GetTimestamp() - start;
+					totalTicks += ticks;
+					maxTicks = Math.Max(maxTicks, ticks);
+					frames++;
+					Marshal.Copy(buffer, output, offset, FrameSize);
+				}
+
+				return new Result
+				{
+					Output = output,
+					AverageTime = frames > 0 ? totalTicks * 1000.0 / Stopwatch.Frequency / frames : 0,
+					MaxTime = maxTicks * 1000.0 / Stopwatch.Frequency,
+					NoiseLevel = suppressor != null ? suppressor.NoiseLevel : float.NaN,
+					Gain = gainControl != null ? gainControl.Gain : float.NaN
+				};
+			}
+			finally
+			{
+				if (suppressor != null)
+				{
+					suppressor.Dispose();
+				}
+				if (gainControl != null)
+				{
+					gainControl.Dispose();
+				}
+				Marshal.FreeHGlobal(buffer);
+			}
+		}
+
+		// The level from start to end in dBFS, over the samples where the talker is talking if a mask is given. The mask is
+		// for the input, so it is shifted by however far the output has been delayed.
+		private static double Level(short[] samples, int start, int end, bool[] talking, int delay)
+		{
+			double energy = 0;
+			int count = 0;
+			for (int i = start; i < Math.Min(end, samples.Length); i++)
+			{
+				if (talking == null || (i >= delay && talking[i - delay]))
+				{
+					energy += (double)samples[i] * samples[i];
+					count++;
+				}
+			}
+			return count > 0 && energy > 0 ? 10 * Math.Log10(energy / count / (32768.0 * 32768.0)) : -96;
+		}
+
+		// A fan throughout, and talk spurts of noise shaped like speech from TalkStart on. The mask says where the talker
+		// is well under way, leaving out the rise and fall of each spurt.
+		private static short[] MakeRecording(Random random, out bool[] talking)
+		{
+			var samples = new short[(int)(SampleRate * Length)];
+			talking = new bool[samples.Length];
+			double fan = 0, y1 = 0, y2 = 0, envelope = 0, phase = 0;
+			bool on = false;
+			int left = (int)(SampleRate * TalkStart);
+			for (int i = 0; i < samples.Length; i++)
+			{
+				if (--left <= 0)
+				{
+					on = !on;
+					left = (int)(SampleRate * (on ? 0.3 + random.NextDouble() * 1.2 : 0.1 + random.NextDouble() * 0.4));
+				}
+				envelope += ((on ? 1.0 : 0.0) - envelope) * 0.002;
+				talking[i] = envelope > 0.9;
+
+				fan = 0.95 * fan + (random.NextDouble() * 2 - 1);
+				double x = random.NextDouble() * 2 - 1;
+				double y = x + 1.3 * y1 - 0.6 * y2;
+				y2 = y1;
+				y1 = y;
+				phase += 2 * Math.PI * (120 + 30 * Math.Sin(i * 2e-4)) / SampleRate;
+				double talk = envelope * 500 * (0.5 * y + 0.8 * Math.Sin(phase) * (1 + 0.3 * y));
+				samples[i] = (short)Math.Round(fan * 100 + talk);
+			}
+			return samples;
+		}
+	}
+}
@@ -0,0 +1,219 @@
+﻿using System;
+using System.Runtime.InteropServices;
+using Floe.Audio;
+using Floe.Interop;
+
+namespace test
+{
+	// Checks that Opus in-band forward error correction fills in lost packets when they are played the way JitterBuffer
+	// plays them. JitterBuffer is internal to Floe.Audio, so this does what its ReadPacket does, with a JitterRing, the
+	// codec from CodecInfo and a LossConcealer: when a packet is missing and the next one has arrived, the ring lends the
+	// next one and the codec recovers the missing frame from its redundant data, and when that fails the concealer fills
+	// the gap.
+	//
+	// Ten seconds of a speech-like signal are encoded with the settings that CodecInfo uses, except that DTX is off so that
+	// every frame is sent, and played on a simulated clock with a fixed pattern of losses, once with FEC and once without.
+	// Each played frame is compared with a decode of the same packets without losses. With FEC, most losses of a single
+	// packet should be recovered, and the lost frames should come out closer to the lossless decode than when they are
+	// concealed; without it, nothing should be recovered. A build without Opus support fails.
+	//
+	// usage: test opus [loss rate] [seed]
+	static class OpusFecTest
+	{
+		private const int SampleRate = 16000;
+		private const int Frames = 500;
+		private const int Capacity = 256;
+		private const int Delay = 2;
+		private const int SkipPackets = 5;
+
+		private class Outcome
+		{
+			public long Bytes;
+			public int Recovered, Concealed;
+			public double LostSnr;
+		}
+
+		public static void Run(string[] args)
+		{
+			double lossRate = args.Length > 0 ? double.Parse(args[0]) : 0.1;
+			int seed = args.Length > 1 ? int.Parse(args[1]) : 1;
+			if (!OpusCodec.IsAvailable)
+			{
+				Check.That(false, "this build has no Opus support; build Floe.Interop with OPUS_DIR set to libopus");
+				return;
+			}
+
+			var info = new CodecInfo(VoiceCodec.Opus, SampleRate);
+			var random = new Random(seed);
+			var lost = new bool[Frames];
+			int single = 0;
+			for (int i = SkipPackets; i < Frames; i++)
+			{
+				lost[i] = random.NextDouble() < lossRate;
+			}
+			for (int i = 0; i + 1 < Frames; i++)
+			{
+				single += lost[i] && !lost[i + 1] ? 1 : 0;
+			}
+
+			var signal = MakeSignal(info.SamplesPerPacket * Frames);
+			var with = Play(info, signal, lost, true);
+			var without = Play(info, signal, lost, false);
+
+			Console.WriteLine("{0} packets lost, {1} of them singly", Array.FindAll(lost, (l) => l).Length, single);
+			double seconds = (double)Frames * info.SamplesPerPacket / SampleRate;
+			foreach (var outcome in new Outcome[] { with, without })
+			{
+				Console.WriteLine("{0,-8} {1,5:F1} kbit/s, {2} recovered, {3} concealed, lost frames {4:F1} dB from lossless",
+					outcome == with ? "fec" : "no fec", outcome.Bytes * 8 / seconds / 1000, outcome.Recovered, outcome.Concealed,
+					outcome.LostSnr);
+			}
+			Check.That(with.Recovered >= single / 2 && with.Recovered <= single, "{0} of {1} single losses were recovered",
+				with.Recovered, single);
+			Check.That(without.Recovered == 0, "{0} packets were recovered without FEC", without.Recovered);
+			Check.That(with.LostSnr > without.LostSnr + 1.0, "lost frames were {0:F1} dB from lossless with FEC and {1:F1} dB without",
+				with.LostSnr, without.LostSnr);
+			Check.That(with.Bytes > without.Bytes, "the redundant data took no room");
+		}
+
+		// A pulse train with a gliding pitch through a formant filter that moves, with a little noise and a slow change in
+		// level, so that the encoder treats every frame as voice.
+		private static short[] MakeSignal(int count)
+		{
+			var samples = new short[count];
+			var random = new Random(0);
+			double phase = 0, y1 = 0, y2 = 0;
+			for (int i = 0; i < count; i++)
+			{
+				double t = (double)i / SampleRate;
+				phase += (110 + 40 * Math.Sin(2 * Math.PI * 0.5 * t)) / SampleRate;
+				if (phase >= 1)
+				{
+					phase -= 1;
+				}
+				double x = (phase < 0.05 ? 4000 : 0) + (random.NextDouble() - 0.5) * 50;
+				double r = 0.96, f = 700 + 200 * Math.Sin(2 * Math.PI * 0.3 * t);
+				double y = x + 2 * r * Math.Cos(2 * Math.PI * f / SampleRate) * y1 - r * r * y2;
+				y2 = y1;
+				y1 = y;
+				samples[i] = (short)Math.Max(-32768, Math.Min(32767, y * 0.3 * (0.7 + 0.3 * Math.Sin(2 * Math.PI * 2 * t))));
+			}
+			return samples;
+		}
+
+		private static Outcome Play(CodecInfo info, short[] signal, bool[] lost, bool fec)
+		{
+			var outcome = new Outcome();
+			int frameSize = info.SamplesPerPacket;
+			var encoder = (OpusCodec)info.GetCodec();
+			var reference = info.GetCodec();
+			var decoder = info.GetCodec();
+			var ring = new JitterRing(frameSize, info.SampleRate, info.EncodedBufferSize, Capacity, Delay);
+			var concealer = new LossConcealer(info.SampleRate);
+			var pcm = Marshal.AllocHGlobal(info.DecodedBufferSize);
+			var packet = Marshal.AllocHGlobal(info.EncodedBufferSize);
+			var played = Marshal.AllocHGlobal(info.DecodedBufferSize);
+			try
+			{
+				encoder.DiscontinuousTransmission = false;
+				encoder.ForwardErrorCorrection = fec;
+
+				var packets = new byte[Frames][];
+				var expected = new short[Frames][];
+				for (int i = 0; i < Frames; i++)
+				{
+					Marshal.Copy(signal, i * frameSize, pcm, frameSize);
+					int size = encoder.Encode(pcm, info.DecodedBufferSize, packet, info.EncodedBufferSize);
+					packets[i] = new byte[size];
+					Marshal.Copy(packet, packets[i], 0, size);
+					outcome.Bytes += size;
+
+					expected[i] = new short[frameSize];
+					if (reference.Decode(packet, size, pcm, info.DecodedBufferSize) == info.DecodedBufferSize)
+					{
+						Marshal.Copy(pcm, expected[i], 0, frameSize);
+					}
+				}
+
+				var output = new short[frameSize];
+				double snr = 0;
+				int lostCount = 0;
+				for (int t = 0; t < Frames + Delay; t++)
+				{
+					ring.SetClock((double)t * frameSize / info.SampleRate);
+					if (t < Frames && !lost[t])
+					{
+						ring.Insert(t * frameSize, packets[t], 0, packets[t].Length);
+					}
+
+					// As in JitterBuffer.ReadPacket.
+					ring.AdvanceClock(frameSize);
+					int size;
+					bool recovery;
+					var data = ring.Acquire(out size, out recovery);
+					if (data != IntPtr.Zero)
+					{
+						try
+						{
+							if (recovery)
+							{
+								size = decoder.Recover(data, size, played, info.DecodedBufferSize);
+								outcome.Recovered += size > 0 ? 1 : 0;
+							}
+							else
+							{
+								size = decoder.Decode(data, size, played, info.DecodedBufferSize);
+							}
+						}
+						finally
+						{
+							ring.Release();
+						}
+						if (size > 0)
+						{
+							concealer.Update(played, size);
+						}
+					}
+					int frame = t - Delay;
+					if (data == IntPtr.Zero || size <= 0)
+					{
+						size = concealer.Conceal(played, info.DecodedBufferSize);
+						outcome.Concealed += frame >= 0 ? 1 : 0;
+					}
+					if (frame >= 0 && lost[frame])
+					{
+						Array.Clear(output, 0, frameSize);
+						Marshal.Copy(played, output, 0, size / 2);
+						snr += Snr(expected[frame], output);
+						lostCount++;
+					}
+				}
+				outcome.LostSnr = lostCount > 0 ? snr / lostCount : 0;
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(pcm);
+				Marshal.FreeHGlobal(packet);
+				Marshal.FreeHGlobal(played);
+				concealer.Dispose();
+				ring.Dispose();
+				((IDisposable)decoder).Dispose();
+				((IDisposable)reference).Dispose();
+				encoder.Dispose();
+			}
+			return outcome;
+		}
+
+		// The ratio of the power of the expected frame to that of the difference, in dB.
+		private static double Snr(short[] expected, short[] actual)
+		{
+			double signal = 0, noise = 0;
+			for (int i = 0; i < expected.Length; i++)
+			{
+				signal += (double)expected[i] * expected[i];
+				noise += (double)(expected[i] - actual[i]) * (expected[i] - actual[i]);
+			}
+			return 10 * Math.Log10((signal + 1) / (noise + 1));
+		}
+	}
+}
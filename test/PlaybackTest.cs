@@ -0,0 +1,245 @@
+﻿using System;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+using Floe.Audio;
+using Floe.Interop;
+
+namespace test
+{
+	// Plays voice from 1 to 16 peers through a JitterBuffer each and an AudioMixer, as VoiceOut does, reading every mix
+	// into a native buffer as WaveOut has one filled for the device. The same packets are then played the way playback
+	// used to go: each peer's packet decoded into a buffer of its own and copied out into a managed array, the arrays
+	// mixed through the mixer's Stream inputs into another managed array, and that copied into the device buffer. The
+	// packets arrive on a simulated clock, one every packet time, so that both paths play exactly the same.
+	//
+	// Both must fill the device buffer with the same samples, every time. The table gives the bytes copied, the bytes
+	// allocated and the time taken for each buffer played. Decoding and mixing straight into the device buffer must copy
+	// nothing and allocate nothing.
+	//
+	// usage: test playback [seconds]
+	static class PlaybackTest
+	{
+		private const int SampleRate = 8000;
+		private const double MaxAllocation = 1; // bytes a buffer, on average
+
+		// The way JitterBuffer was read before it was a source: decoded apart, and copied out into the caller's array.
+		private class OldJitterStream : Stream
+		{
+			private JitterBuffer _buffer;
+			private IntPtr _decoded;
+
+			public long BytesCopied;
+
+			public OldJitterStream(JitterBuffer buffer, int size)
+			{
+				_buffer = buffer;
+				_decoded = Marshal.AllocHGlobal(size);
+			}
+
+			public override bool CanRead { get { return true; } }
+			public override bool CanSeek { get { return false; } }
+			public override bool CanWrite { get { return false; } }
+			public override long Length { get { throw new NotSupportedException(); } }
+			public override long Position { get { throw new NotSupportedException(); } set { throw new NotSupportedException(); } }
+			public override void Flush() { }
+			public override long Seek(long offset, SeekOrigin origin) { throw new NotSupportedException(); }
+			public override void SetLength(long value) { throw new NotSupportedException(); }
+			public override void Write(byte[] buffer, int offset, int count) { throw new NotSupportedException(); }
+
+			public override int Read(byte[] buffer, int offset, int count)
+			{
+				Array.Clear(buffer, offset, count);
+				int size = _buffer.Read(_decoded, count);
+				Marshal.Copy(_decoded, buffer, offset, size);
+				this.BytesCopied += size;
+				return count;
+			}
+
+			protected override void Dispose(bool disposing)
+			{
+				if (_decoded != IntPtr.Zero)
+				{
+					Marshal.FreeHGlobal(_decoded);
+					_decoded = IntPtr.Zero;
+				}
+				base.Dispose(disposing);
+			}
+		}
+
+		private class Result
+		{
+			public long Copied, Allocated, Ticks;
+		}
+
+		public static void Run(string[] args)
+		{
+			double seconds = args.Length > 0 ? double.Parse(args[0]) : 60.0;
+			AppDomain.MonitoringIsEnabled = true;
+			var codec = new CodecInfo(VoiceCodec.Gsm610, SampleRate);
+			int packets = (int)(seconds * codec.SampleRate / codec.SamplesPerPacket);
+
+			Console.WriteLine("{0,5} {1,-6} {2,10} {3,12} {4,10} {5,8}", "peers", "path", "buffers", "copied/buf",
+				"alloc/buf", "us/buf");
+			foreach (int peers in new int[] { 1, 4, 16 })
+			{
+				var payloads = MakePayloads(codec, peers, packets);
+				short[] played;
+				var now = Play(codec, payloads, false, out played);
+				short[] oldPlayed;
+				var old = Play(codec, payloads, true, out oldPlayed);
+				Print(peers, "source", packets, now);
+				Print(peers, "old", packets, old);
+
+				int differ = -1;
+				for (int i = 0; i < played.Length && differ < 0; i++)
+				{
+					differ = played[i] != oldPlayed[i] ? i : -1;
+				}
+				Check.That(differ < 0, "{0} peers: the two paths played {1} and {2} at sample {3}", peers,
+					differ >= 0 ? played[differ] : 0, differ >= 0 ? oldPlayed[differ] : 0, differ);
+				int silent = 0;
+				for (int i = played.Length / 2; i < played.Length; i++)
+				{
+					silent += played[i] == 0 ? 1 : 0;
+				}
+				Check.That(silent < played.Length / 20, "{0} peers: {1} of the last {2} samples were silent", peers, silent,
+					played.Length - played.Length / 2);
+				Check.That(now.Copied == 0, "{0} peers: {1} bytes were copied", peers, now.Copied);
+				Check.That(now.Allocated <= packets * MaxAllocation, "{0} peers: {1} bytes were allocated for {2} buffers",
+					peers, now.Allocated, packets);
+			}
+		}
+
+		// Plays the packets of every peer, a packet time apart, and returns what came out. Each packet arrives at the time
+		// it is due to be played, and the buffer holds it back by its fixed delay. The first packet time is left out of
+		// what is allocated and timed, while the buffers and the mixer settle.
+		private static Result Play(CodecInfo codec, byte[][][] payloads, bool old, out short[] played)
+		{
+			int peers = payloads.Length, packets = payloads[0].Length, size = codec.DecodedBufferSize;
+			var result = new Result();
+			var buffers = new JitterBuffer[peers];
+			var streams = new OldJitterStream[peers];
+			var mixer = new AudioMixer(size);
+			var device = Marshal.AllocHGlobal(size);
+			var mix = new byte[size];
+			played = new short[packets * codec.SamplesPerPacket];
+			try
+			{
+				for (int p = 0; p < peers; p++)
+				{
+					buffers[p] = new JitterBuffer(codec);
+					buffers[p].Adaptive = false;
+					if (old)
+					{
+						streams[p] = new OldJitterStream(buffers[p], size);
+						mixer.AddInput(streams[p]);
+					}
+					else
+					{
+						mixer.AddInput(buffers[p]);
+					}
+				}
+
+				double period = (double)codec.SamplesPerPacket / codec.SampleRate;
+				long allocated = 0, copied = 0;
+				for (int k = 0; k < packets; k++)
+				{
+					if (k == 1)
+					{
+						GC.Collect();
+						allocated = AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize;
+					}
+					for (int p = 0; p < peers; p++)
+					{
+						buffers[p].SetClock(k * period);
+						buffers[p].Enqueue(k * codec.SamplesPerPacket, payloads[p][k], 0, payloads[p][k].Length);
+					}
+
+					long start = Stopwatch.GetTimestamp();
+					if (old)
+					{
+						mixer.Read(mix, 0, size);
+						Marshal.Copy(mix, 0, device, size);
+						copied += size;
+					}
+					else
+					{
+						((IWaveSource)mixer).Read(device, size);
+					}
+					if (k > 0)
+					{
+						result.Ticks += Stopwatch.GetTimestamp() - start;
+					}
+					Marshal.Copy(device, played, k * codec.SamplesPerPacket, codec.SamplesPerPacket);
+				}
+				result.Allocated = AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize - allocated;
+
+				foreach (var stream in streams)
+				{
+					copied += stream != null ? stream.BytesCopied : 0;
+				}
+				result.Copied = copied;
+				return result;
+			}
+			finally
+			{
+				foreach (var stream in streams)
+				{
+					if (stream != null)
+					{
+						stream.Dispose();
+					}
+				}
+				foreach (var buffer in buffers)
+				{
+					buffer.Dispose();
+				}
+				mixer.Dispose();
+				Marshal.FreeHGlobal(device);
+			}
+		}
+
+		private static void Print(int peers, string path, int packets, Result result)
+		{
+			Console.WriteLine("{0,5} {1,-6} {2,10} {3,10:F1} {4,10:F1} {5,8:F2}", peers, path, packets,
+				(double)result.Copied / packets, (double)result.Allocated / Math.Max(1, packets - 1),
+				result.Ticks * 1e6 / Stopwatch.Frequency / Math.Max(1, packets - 1));
+		}
+
+		// A tone for each peer, of its own pitch and a little quieter than the one before, encoded a packet at a time.
+		private static byte[][][] MakePayloads(CodecInfo codec, int peers, int packets)
+		{
+			var payloads = new byte[peers][][];
+			var samples = Marshal.AllocHGlobal(codec.DecodedBufferSize);
+			var encoded = Marshal.AllocHGlobal(codec.EncodedBufferSize);
+			try
+			{
+				for (int p = 0; p < peers; p++)
+				{
+					var encoder = codec.GetCodec();
+					payloads[p] = new byte[packets][];
+					double phase = 0, step = 2 * Math.PI * (200 + 37 * p) / codec.SampleRate, level = 8000 * Math.Pow(0.9, p);
+					for (int k = 0; k < packets; k++)
+					{
+						for (int i = 0; i < codec.SamplesPerPacket; i++)
+						{
+							phase += step;
+							Marshal.WriteInt16(samples, i * 2, (short)Math.Round(level * Math.Sin(phase)));
+						}
+						int size = encoder.Encode(samples, codec.DecodedBufferSize, encoded, codec.EncodedBufferSize);
+						payloads[p][k] = new byte[size];
+						Marshal.Copy(encoded, payloads[p][k], 0, size);
+					}
+					((IDisposable)encoder).Dispose();
+				}
+				return payloads;
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(samples);
+				Marshal.FreeHGlobal(encoded);
+			}
+		}
+	}
+}
@@ -0,0 +1,188 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+using Floe.Interop;
+
+namespace test
+{
+	// Plays the same simulated conversations through a JitterRing with the fixed two-packet delay that JitterBuffer has
+	// always used, and with the adaptive delay, over a few kinds of network, to show what each costs in latency and in
+	// packets that arrive too late to be played.
+	//
+	// The sender talks in bursts of one to four seconds with silences of half a second to two seconds between them, and
+	// sends nothing while it is silent, as with DTX. Each packet takes the network's base delay plus a random amount of
+	// jitter, and now and then a spike holds up a run of packets, which then arrive all at once, as when a Wi-Fi link
+	// retries. Arrivals and playback buffers run on one simulated clock, and each packet carries its own number, so that
+	// the time from sending to playing can be measured for every packet that plays.
+	//
+	// On a quiet network the adaptive delay should come down to a single packet, which is less than the fixed delay, at
+	// no cost in late packets. Where there are spikes, it should lose fewer packets to lateness than the fixed delay does,
+	// and where the jitter is larger than a packet, fewer than half as many, in return for the extra latency.
+	//
+	// usage: test delay [seconds] [seed]
+	static class PlayoutDelayTest
+	{
+		private const int Span = 160;
+		private const int ClockRate = 8000;
+		private const int Capacity = 256;
+		private const int FixedDelay = 2;
+		private const double Period = (double)Span / ClockRate;
+
+		private class Network
+		{
+			public string Name;
+			public double Base, Jitter, SpikeChance, Spike, Loss;
+
+			public Network(string name, double baseMs, double jitterMs, double spikeChance, double spikeMs, double loss)
+			{
+				this.Name = name;
+				this.Base = baseMs / 1000;
+				this.Jitter = jitterMs / 1000;
+				this.SpikeChance = spikeChance;
+				this.Spike = spikeMs / 1000;
+				this.Loss = loss;
+			}
+		}
+
+		private class Outcome
+		{
+			public int Sent, Arrived, Played, Underruns;
+			public double MeanDelay, HighDelay, FinalDelay, Jitter;
+
+			public double LatePercent
+			{
+				get
+				{
+					return this.Arrived > 0 ? 100.0 * (this.Arrived - this.Played) / this.Arrived : 0;
+				}
+			}
+		}
+
+		public static void Run(string[] args)
+		{
+			double seconds = args.Length > 0 ? double.Parse(args[0]) : 300.0;
+			int seed = args.Length > 1 ? int.Parse(args[1]) : 1;
+			var networks = new Network[]
+			{
+				new Network("lan", 1, 0.5, 0, 0, 0),
+				new Network("wifi", 5, 8, 0.01, 120, 0.005),
+				new Network("congested", 40, 25, 0.02, 250, 0.03)
+			};
+
+			Console.WriteLine("{0,-10} {1,-9} {2,9} {3,9} {4,7} {5,9} {6,9} {7,9}", "network", "mode", "mean ms", "95% ms",
+				"late %", "underruns", "delay ms", "jitter ms");
+			foreach (var network in networks)
+			{
+				var fixedDelay = Play(network, seconds, seed, false);
+				var adaptive = Play(network, seconds, seed, true);
+				foreach (var outcome in new Outcome[] { fixedDelay, adaptive })
+				{
+					Console.WriteLine("{0,-10} {1,-9} {2,9:F1} {3,9:F1} {4,7:F2} {5,9} {6,9:F0} {7,9:F1}", network.Name,
+						outcome == adaptive ? "adaptive" : "fixed", outcome.MeanDelay * 1000, outcome.HighDelay * 1000,
+						outcome.LatePercent, outcome.Underruns, outcome.FinalDelay, outcome.Jitter);
+				}
+
+				if (network.Jitter < Period / 4 && network.SpikeChance == 0)
+				{
+					Check.That(adaptive.MeanDelay < fixedDelay.MeanDelay, "{0}: the adaptive delay was no shorter than the fixed one",
+						network.Name);
+					Check.That(adaptive.LatePercent <= fixedDelay.LatePercent + 0.1, "{0}: the adaptive delay lost {1:F2}% to lateness",
+						network.Name, adaptive.LatePercent);
+				}
+				else
+				{
+					double factor = network.Jitter > Period ? 0.5 : 1.0;
+					Check.That(adaptive.LatePercent < fixedDelay.LatePercent * factor, "{0}: {1:F2}% were late with the adaptive delay and {2:F2}% with the fixed one",
+						network.Name, adaptive.LatePercent, fixedDelay.LatePercent);
+				}
+			}
+		}
+
+		private static Outcome Play(Network network, double seconds, int seed, bool adaptive)
+		{
+			// The same conversation and the same network for both modes.
+			var random = new Random(seed);
+			var sendTimes = new List<double>();
+			var arrivals = new List<KeyValuePair<double, int>>();
+			double extra = 0;
+			int packet = 0, packets = (int)(seconds / Period);
+			while (packet < packets)
+			{
+				int talk = 50 + random.Next(151), silence = 25 + random.Next(76);
+				for (int i = 0; i < talk && packet < packets; i++, packet++)
+				{
+					double sent = packet * Period;
+					extra = random.NextDouble() < network.SpikeChance ? network.Spike : Math.Max(0, extra - Period);
+					double delay = network.Base + extra - network.Jitter * Math.Log(1 - random.NextDouble());
+					if (random.NextDouble() >= network.Loss)
+					{
+						arrivals.Add(new KeyValuePair<double, int>(sent + delay, sendTimes.Count));
+					}
+					sendTimes.Add(sent);
+				}
+				packet += silence;
+			}
+			arrivals.Sort((a, b) => a.Key.CompareTo(b.Key));
+
+			var outcome = new Outcome();
+			outcome.Sent = sendTimes.Count;
+			outcome.Arrived = arrivals.Count;
+			var delays = new List<double>();
+			var ring = new JitterRing(Span, ClockRate, 4, Capacity, FixedDelay);
+			var payload = new byte[4];
+			try
+			{
+				ring.Adaptive = adaptive;
+				double end = arrivals[arrivals.Count - 1].Key + 20 * Period;
+				int next = 0;
+				for (int tick = 0; tick * Period < end; tick++)
+				{
+					// Playback buffers are read half way between the times at which packets are sent.
+					double now = (tick + 0.5) * Period;
+					for (; next < arrivals.Count && arrivals[next].Key <= now; next++)
+					{
+						int index = arrivals[next].Value;
+						ring.SetClock(arrivals[next].Key);
+						BitConverter.GetBytes(index).CopyTo(payload, 0);
+						ring.Insert((int)Math.Round(sendTimes[index] / Period) * Span, payload, 0, payload.Length);
+					}
+
+					ring.SetClock(now);
+					ring.AdvanceClock(Span);
+					int size;
+					bool recovery;
+					var data = ring.Acquire(out size, out recovery);
+					if (data != IntPtr.Zero)
+					{
+						if (!recovery)
+						{
+							delays.Add(now - sendTimes[Marshal.ReadInt32(data)]);
+						}
+						ring.Release();
+					}
+				}
+				outcome.Underruns = ring.Underruns;
+				outcome.FinalDelay = ring.Delay;
+				outcome.Jitter = ring.Jitter;
+			}
+			finally
+			{
+				ring.Dispose();
+			}
+
+			outcome.Played = delays.Count;
+			if (delays.Count > 0)
+			{
+				double sum = 0;
+				foreach (double delay in delays)
+				{
+					sum += delay;
+				}
+				delays.Sort();
+				outcome.MeanDelay = sum / delays.Count;
+				outcome.HighDelay = delays[delays.Count * 95 / 100];
+			}
+			return outcome;
+		}
+	}
+}
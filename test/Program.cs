@@ -1,38 +1,59 @@
 ﻿using System;
-using System.Net;
-using System.Net.Sockets;
-using System.IO;
-using System.Runtime.InteropServices;
+using System.Collections.Generic;
 
 namespace test
 {
+	// Runs one of the test harnesses, chosen by name on the command line. Each harness prints what it measured, and the
+	// exit code is the number of checks that failed, so that a run can be scripted.
 	class Program
 	{
-		[Flags]
-		private enum KeyStates
+		private delegate void Harness(string[] args);
+
+		static int Main(string[] args)
 		{
-			None = 0,
-			Down = 1,
-			Toggled = 2
-		}
+			var harnesses = new Dictionary<string, Harness>(StringComparer.OrdinalIgnoreCase)
+			{
+				{ "call", CallTest.Run },
+				{ "capture", CaptureTest.Run },
+				{ "conceal", ConcealmentTest.Run },
+				{ "converter", AudioConverterTest.Run },
+				{ "delay", PlayoutDelayTest.Run },
+				{ "device", WaveDeviceTest.Run },
+				{ "drift", DriftTest.Run },
+				{ "dtx", DtxTest.Run },
+				{ "echo", EchoTest.Run },
+				{ "gain", GainKernelTest.Run },
+				{ "gsm", Gsm610Test.Run },
+				{ "hub", ConferenceHubTest.Run },
+				{ "jitter", JitterTraceTest.Run },
+				{ "mixer", MixerLoadTest.Run },
+				{ "mp3", Mp3ParseTest.Run },
+				{ "noise", NoiseTest.Run },
+				{ "opus", OpusFecTest.Run },
+				{ "playback", PlaybackTest.Run },
+				{ "receive", RtpReceiveTest.Run },
+				{ "relay", RelayLoadTest.Run },
+				{ "resample", SampleRateTest.Run },
+				{ "ring", AudioRingTest.Run },
+				{ "rtcp", RtcpLossTest.Run },
+				{ "send", RtpSendTest.Run },
+				{ "sounds", SoundMixerTest.Run },
+				{ "wav", WavReaderTest.Run }
+			};
 
-		[DllImport("user32.dll", CharSet = CharSet.Auto, ExactSpelling = true)]
-		private static extern short GetKeyState(int keyCode);
+			Harness harness;
+			if (args.Length < 1 || !harnesses.TryGetValue(args[0], out harness))
+			{
+				Console.WriteLine("usage: test <harness> [arguments]");
+				Console.WriteLine("harnesses: {0}", string.Join(", ", new List<string>(harnesses.Keys).ToArray()));
+				return -1;
+			}
 
-		static void Main(string[] args)
-		{
-			int sampleRate = 21760;
-			var client = new VoiceClient(new CodecInfo(VoiceCodec.Gsm610, sampleRate), null,
-				() =>
-				{
-					return true;
-					return (GetKeyState(0x41) & 0x8000) > 0;
-				});
-			client.AddPeer(VoiceCodec.Gsm610, sampleRate, new IPEndPoint(Dns.GetHostEntry("spoon.failurefiles.com").AddressList[0], 57222));
-			client.Open();
-			Console.ReadLine();
-			client.InputGain = 10;
-			Console.ReadLine();
+			var rest = new string[args.Length - 1];
+			Array.Copy(args, 1, rest, 0, rest.Length);
+			harness(rest);
+			Console.WriteLine(Check.Failures == 0 ? "passed" : string.Format("{0} checks failed", Check.Failures));
+			return Check.Failures;
 		}
 	}
 }
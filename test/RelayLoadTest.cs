@@ -0,0 +1,214 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Net;
+using System.Threading;
+using Floe.Net;
+
+namespace test
+{
+	// Runs an RtpRelay and many peers over loopback in one process, and reports the CPU time and bandwidth of each node.
+	//
+	// The peers take turns to talk, a few at a time, and send a comfort noise packet every tenth frame while they are
+	// silent, as VoiceIn does. Each turn has a pause in the middle that is longer than the relay's speaker timeout, so the
+	// talkers lose their places and the relay drops their comfort noise until they talk again, and when the turn passes
+	// the new talkers may have to wait for the old ones to time out. Either way, runs of packets are dropped from the
+	// middle of streams that are forwarded. Nothing is lost on loopback, so each peer should see every forwarded stream
+	// without gaps, and its RTCP statistics should show no loss.
+	//
+	// usage: test relay [seconds] [peers] [talkers]
+	static class RelayLoadTest
+	{
+		private const int FrameLength = 20; // milliseconds
+		private const int PayloadSize = 33; // one GSM 6.10 frame
+		private const int TurnLength = 4000; // milliseconds
+		private const int PauseStart = 1000; // milliseconds into the turn
+		private const int PauseLength = 1500; // milliseconds
+		private const int ComfortNoiseInterval = 10; // frames
+
+		// The threads that a node starts, found by comparing the threads of the process before and after it is opened.
+		private class Node
+		{
+			public string Name;
+			public int[] Threads;
+			public TimeSpan Cpu;
+			public long BytesSent, BytesReceived;
+			public int Lost, Duplicates, ReportedLost;
+		}
+
+		public static void Run(string[] args)
+		{
+			int seconds = args.Length > 0 ? int.Parse(args[0]) : 20;
+			int peerCount = args.Length > 1 ? int.Parse(args[1]) : 50;
+			int talkers = args.Length > 2 ? int.Parse(args[2]) : 3;
+
+			var relayNode = new Node { Name = "relay" };
+			var before = GetThreadIds();
+			var relay = new RtpRelay(new System.Net.Sockets.UdpClient(new IPEndPoint(IPAddress.Loopback, 0)));
+			relay.Open();
+			relayNode.Threads = GetNewThreads(before);
+
+			var peers = new TestPeer[peerCount];
+			var nodes = new Node[peerCount];
+			for (int i = 0; i < peerCount; i++)
+			{
+				peers[i] = new TestPeer(PayloadSize);
+				relay.AddMember(peers[i].LocalEndPoint);
+			}
+			for (int i = 0; i < peerCount; i++)
+			{
+				for (int j = 0; j < peerCount; j++)
+				{
+					if (i != j)
+					{
+						peers[i].AddPeer(peers[j].LocalEndPoint, relay.LocalEndPoint, peers[j].Ssrc);
+					}
+				}
+				before = GetThreadIds();
+				peers[i].Open();
+				nodes[i] = new Node { Name = "peer " + i, Threads = GetNewThreads(before) };
+			}
+
+			// Every peer sends one packet per frame, from this thread, on the frame clock.
+			Console.WriteLine("{0} peers, {1} talking at a time, for {2} seconds", peerCount, talkers, seconds);
+			var cpuStart = GetThreadTimes();
+			var clock = Stopwatch.StartNew();
+			int frames = seconds * 1000 / FrameLength;
+			for (int frame = 0; frame < frames; frame++)
+			{
+				int wait = frame * FrameLength - (int)clock.ElapsedMilliseconds;
+				if (wait > 0)
+				{
+					Thread.Sleep(wait);
+				}
+				int turn = frame * FrameLength / TurnLength;
+				int phase = frame * FrameLength % TurnLength;
+				bool pause = phase >= PauseStart && phase < PauseStart + PauseLength;
+				for (int i = 0; i < peerCount; i++)
+				{
+					bool talking = !pause && (i - turn * (talkers - 1) % peerCount + peerCount) % peerCount < talkers;
+					if (talking || frame % ComfortNoiseInterval == i % ComfortNoiseInterval)
+					{
+						peers[i].Send(frame * FrameLength * TestPeer.ClockRate / 1000, !talking);
+					}
+				}
+			}
+			Thread.Sleep(200);
+			double wall = clock.Elapsed.TotalSeconds;
+			var cpuEnd = GetThreadTimes();
+
+			relayNode.Cpu = GetCpu(relayNode.Threads, cpuStart, cpuEnd);
+			relayNode.BytesSent = relay.BytesSent;
+			relayNode.BytesReceived = relay.BytesReceived;
+			for (int i = 0; i < peerCount; i++)
+			{
+				var node = nodes[i];
+				node.Cpu = GetCpu(node.Threads, cpuStart, cpuEnd);
+				node.BytesSent = peers[i].BytesSent;
+				node.BytesReceived = peers[i].BytesReceived;
+				for (int j = 0; j < peerCount; j++)
+				{
+					var stream = i != j ? peers[i].GetStream(peers[j].LocalEndPoint) : null;
+					if (stream != null)
+					{
+						node.Lost += stream.Lost;
+						node.Duplicates += stream.Duplicates;
+						var stats = peers[i].GetPeerStatistics(peers[j].LocalEndPoint);
+						node.ReportedLost += stats != null ? stats.PacketsLost : 0;
+					}
+				}
+			}
+
+			Console.WriteLine("{0,-10} {1,8} {2,6} {3,10} {4,10} {5,6} {6,8}", "node", "cpu ms", "cpu %", "out kbit/s", "in kbit/s", "lost", "reported");
+			Print(relayNode, wall);
+			var peerCpu = new List<double>();
+			long peerOut = 0, peerIn = 0;
+			foreach (var node in nodes)
+			{
+				Print(node, wall);
+				peerCpu.Add(node.Cpu.TotalMilliseconds);
+				peerOut += node.BytesSent;
+				peerIn += node.BytesReceived;
+			}
+			peerCpu.Sort();
+			Console.WriteLine("peers: cpu ms median {0:F1}, max {1:F1}; mean out {2:F1} kbit/s, mean in {3:F1} kbit/s",
+				peerCpu[peerCpu.Count / 2], peerCpu[peerCpu.Count - 1],
+				peerOut * 8 / wall / 1000 / peerCount, peerIn * 8 / wall / 1000 / peerCount);
+			Console.WriteLine("relay: {0} received, {1} forwarded, {2} dropped", relay.PacketsReceived, relay.PacketsForwarded, relay.PacketsDropped);
+
+			Check.That(relay.PacketsDropped > 0, "the relay dropped nothing, so the renumbering was not exercised");
+			foreach (var node in nodes)
+			{
+				Check.That(node.Lost == 0 && node.Duplicates == 0, "{0} saw {1} packets missing and {2} repeated", node.Name, node.Lost, node.Duplicates);
+				Check.That(node.ReportedLost == 0, "{0} reported {1} packets lost", node.Name, node.ReportedLost);
+			}
+
+			foreach (var peer in peers)
+			{
+				peer.Dispose();
+			}
+			relay.Dispose();
+		}
+
+		private static void Print(Node node, double wall)
+		{
+			Console.WriteLine("{0,-10} {1,8:F1} {2,6:F2} {3,10:F1} {4,10:F1} {5,6} {6,8}", node.Name, node.Cpu.TotalMilliseconds,
+				node.Cpu.TotalSeconds * 100 / wall, node.BytesSent * 8 / wall / 1000, node.BytesReceived * 8 / wall / 1000,
+				node.Lost, node.ReportedLost);
+		}
+
+		private static HashSet<int> GetThreadIds()
+		{
+			var ids = new HashSet<int>();
+			foreach (ProcessThread thread in Process.GetCurrentProcess().Threads)
+			{
+				ids.Add(thread.Id);
+			}
+			return ids;
+		}
+
+		private static int[] GetNewThreads(HashSet<int> before)
+		{
+			var threads = new List<int>();
+			foreach (int id in GetThreadIds())
+			{
+				if (!before.Contains(id))
+				{
+					threads.Add(id);
+				}
+			}
+			return threads.ToArray();
+		}
+
+		private static Dictionary<int, TimeSpan> GetThreadTimes()
+		{
+			var times = new Dictionary<int, TimeSpan>();
+			foreach (ProcessThread thread in Process.GetCurrentProcess().Threads)
+			{
+				try
+				{
+					times[thread.Id] = thread.TotalProcessorTime;
+				}
+				catch (InvalidOperationException)
+				{
+					// The thread has exited since the list was taken.
+				}
+			}
+			return times;
+		}
+
+		private static TimeSpan GetCpu(int[] threads, Dictionary<int, TimeSpan> start, Dictionary<int, TimeSpan> end)
+		{
+			var cpu = TimeSpan.Zero;
+			foreach (int id in threads)
+			{
+				TimeSpan a, b;
+				if (end.TryGetValue(id, out b))
+				{
+					cpu += start.TryGetValue(id, out a) ? b - a : b;
+				}
+			}
+			return cpu;
+		}
+	}
+}
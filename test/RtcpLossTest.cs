@@ -0,0 +1,199 @@
+﻿using System;
+using System.Diagnostics;
+using System.Net;
+using System.Threading;
+using Floe.Net;
+
+namespace test
+{
+	// Checks the loss that RtpClient measures and reports over RTCP against loss injected by a LossyLink, with two clients
+	// talking directly, and with three talking through an RtpRelay. Through the relay, the talker pauses for longer than
+	// the relay's speaker timeout, so that the relay drops some of its packets, which must not be counted as lost.
+	//
+	// Last, one client sends each of two others a stream of its own, as a mixing hub does, with twice as many packets for
+	// one as for the other. The sender reports that each gets must count only the packets and bytes sent to it.
+	//
+	// usage: test rtcp [loss rate] [seed]
+	static class RtcpLossTest
+	{
+		private const int FrameLength = 20; // milliseconds
+		private const int PayloadSize = 33;
+		private const int ReportTimeout = 20000; // milliseconds; a report is due within 7.5 seconds
+		private const int ComfortNoiseInterval = 10; // frames
+
+		public static void Run(string[] args)
+		{
+			double lossRate = args.Length > 0 ? double.Parse(args[0]) : 0.05;
+			int seed = args.Length > 1 ? int.Parse(args[1]) : 1;
+			Direct(lossRate, seed);
+			Relayed(lossRate, seed);
+			Separate();
+		}
+
+		private static void Direct(double lossRate, int seed)
+		{
+			// B is behind the link, which drops some of what A sends it.
+			var a = new TestPeer(PayloadSize);
+			var b = new TestPeer(PayloadSize);
+			var link = new LossyLink(b.LocalEndPoint, a.LocalEndPoint, lossRate, seed);
+			a.AddPeer(link.Far);
+			b.AddPeer(link.Near);
+			a.Open();
+			b.Open();
+
+			for (int frame = 0; frame < 300; frame++)
+			{
+				a.Send(frame * FrameLength * TestPeer.ClockRate / 1000, false);
+				b.Send(frame * FrameLength * TestPeer.ClockRate / 1000, false);
+				Thread.Sleep(FrameLength);
+			}
+
+			int lost = link.GetLost(a.Ssrc);
+			var received = b.GetStream(link.Near);
+			var clock = Stopwatch.StartNew();
+			RtpPeerStatistics ab, ba;
+			do
+			{
+				Thread.Sleep(100);
+				ab = b.GetPeerStatistics(link.Near);
+				ba = a.GetPeerStatistics(link.Far);
+			}
+			while ((ab.PacketsLost != lost || ba.RemotePacketsLost != lost) && clock.ElapsedMilliseconds < ReportTimeout);
+
+			Console.WriteLine("direct: {0} dropped by the link; B measured {1} lost of {2}, A was told {3} ({4:F3} ms round trip)",
+				lost, ab.PacketsLost, ab.PacketsReceived + ab.PacketsLost, ba.RemotePacketsLost, ba.RoundTripTime);
+			Check.That(lost > 0, "the link dropped nothing");
+			Check.That(received != null, "B received nothing");
+			if (received != null)
+			{
+				Check.That(received.Lost == lost, "B had gaps for {0} packets, but the link dropped {1}", received.Lost, lost);
+				Check.That(ab.PacketsReceived == received.Received, "B counted {0} packets, but {1} were delivered",
+					ab.PacketsReceived, received.Received);
+			}
+			Check.That(ab.PacketsLost == lost, "B measured {0} lost, but the link dropped {1}", ab.PacketsLost, lost);
+			Check.That(ba.RemotePacketsLost == lost, "A was told {0} lost, but the link dropped {1}", ba.RemotePacketsLost, lost);
+			Check.That(ba.PacketsLost == 0 && ab.RemotePacketsLost == 0, "the lossless direction reported {0} and {1} lost",
+				ba.PacketsLost, ab.RemotePacketsLost);
+
+			a.Dispose();
+			b.Dispose();
+			link.Dispose();
+		}
+
+		private static void Relayed(double lossRate, int seed)
+		{
+			// A talks, pauses, and talks again; C only sends comfort noise, so the relay drops all of it. B is behind the
+			// link, between it and the relay.
+			var relay = new RtpRelay(new System.Net.Sockets.UdpClient(new IPEndPoint(IPAddress.Loopback, 0)));
+			var a = new TestPeer(PayloadSize);
+			var b = new TestPeer(PayloadSize);
+			var c = new TestPeer(PayloadSize);
+			var link = new LossyLink(b.LocalEndPoint, relay.LocalEndPoint, lossRate, seed);
+			relay.AddMember(a.LocalEndPoint);
+			relay.AddMember(link.Far);
+			relay.AddMember(c.LocalEndPoint);
+			a.AddPeer(b.LocalEndPoint, relay.LocalEndPoint, b.Ssrc);
+			a.AddPeer(c.LocalEndPoint, relay.LocalEndPoint, c.Ssrc);
+			b.AddPeer(a.LocalEndPoint, link.Near, a.Ssrc);
+			b.AddPeer(c.LocalEndPoint, link.Near, c.Ssrc);
+			c.AddPeer(a.LocalEndPoint, relay.LocalEndPoint, a.Ssrc);
+			c.AddPeer(b.LocalEndPoint, relay.LocalEndPoint, b.Ssrc);
+			relay.Open();
+			a.Open();
+			b.Open();
+			c.Open();
+
+			for (int frame = 0; frame < 250; frame++)
+			{
+				int timeStamp = frame * FrameLength * TestPeer.ClockRate / 1000;
+				bool talking = frame < 50 || frame >= 150;
+				if (talking || frame % ComfortNoiseInterval == 0)
+				{
+					a.Send(timeStamp, !talking);
+				}
+				if (frame % ComfortNoiseInterval == 5)
+				{
+					c.Send(timeStamp, true);
+				}
+				Thread.Sleep(FrameLength);
+			}
+
+			int lost = link.GetLost(a.Ssrc);
+			var clock = Stopwatch.StartNew();
+			RtpPeerStatistics ab, ac, ba;
+			do
+			{
+				Thread.Sleep(100);
+				ab = b.GetPeerStatistics(a.LocalEndPoint);
+				ac = c.GetPeerStatistics(a.LocalEndPoint);
+				ba = a.GetPeerStatistics(b.LocalEndPoint);
+			}
+			while ((ab.PacketsLost != lost || ba.RemotePacketsLost != lost) && clock.ElapsedMilliseconds < ReportTimeout);
+
+			Console.WriteLine("relayed: {0} dropped by the relay, {1} by the link; B measured {2} lost, A was told {3}, C measured {4}",
+				relay.PacketsDropped, lost, ab.PacketsLost, ba.RemotePacketsLost, ac.PacketsLost);
+			Check.That(relay.PacketsDropped > 0, "the relay dropped nothing");
+			Check.That(lost > 0, "the link dropped nothing");
+			Check.That(ab.PacketsLost == lost, "B measured {0} lost, but the link dropped {1}", ab.PacketsLost, lost);
+			Check.That(ba.RemotePacketsLost == lost, "A was told {0} lost, but the link dropped {1}", ba.RemotePacketsLost, lost);
+			Check.That(ac.PacketsLost == 0, "C measured {0} lost on a lossless path", ac.PacketsLost);
+			Check.That(a.GetStream(c.LocalEndPoint) == null && b.GetStream(c.LocalEndPoint) == null, "comfort noise from a member that never spoke was forwarded");
+
+			a.Dispose();
+			b.Dispose();
+			c.Dispose();
+			link.Dispose();
+			relay.Dispose();
+		}
+
+		private static void Separate()
+		{
+			// A sends B a packet every frame and C one every other frame, each through SendTo.
+			var a = new TestPeer(PayloadSize);
+			var b = new TestPeer(PayloadSize);
+			var c = new TestPeer(PayloadSize);
+			a.AddPeer(b.LocalEndPoint);
+			a.AddPeer(c.LocalEndPoint);
+			b.AddPeer(a.LocalEndPoint);
+			c.AddPeer(a.LocalEndPoint);
+			a.Open();
+			b.Open();
+			c.Open();
+
+			int toB = 0, toC = 0;
+			for (int frame = 0; frame < 200; frame++)
+			{
+				int timeStamp = frame * FrameLength * TestPeer.ClockRate / 1000;
+				toB += a.SendTo(b.LocalEndPoint, timeStamp) ? 1 : 0;
+				if (frame % 2 == 0)
+				{
+					toC += a.SendTo(c.LocalEndPoint, timeStamp) ? 1 : 0;
+				}
+				Thread.Sleep(FrameLength);
+			}
+
+			var clock = Stopwatch.StartNew();
+			RtpPeerStatistics ba, ca;
+			do
+			{
+				Thread.Sleep(100);
+				ba = b.GetPeerStatistics(a.LocalEndPoint);
+				ca = c.GetPeerStatistics(a.LocalEndPoint);
+			}
+			while ((ba.PacketsSent != toB || ca.PacketsSent != toC) && clock.ElapsedMilliseconds < ReportTimeout);
+
+			Console.WriteLine("separate: A sent B {0} and C {1}; B was told {2} ({3} bytes), C was told {4} ({5} bytes)",
+				toB, toC, ba.PacketsSent, ba.OctetsSent, ca.PacketsSent, ca.OctetsSent);
+			Check.That(ba.PacketsSent == toB && ba.OctetsSent == (long)toB * PayloadSize, "B was told of {0} packets and {1} " +
+				"bytes, but was sent {2}", ba.PacketsSent, ba.OctetsSent, toB);
+			Check.That(ca.PacketsSent == toC && ca.OctetsSent == (long)toC * PayloadSize, "C was told of {0} packets and {1} " +
+				"bytes, but was sent {2}", ca.PacketsSent, ca.OctetsSent, toC);
+			Check.That(ba.PacketsReceived == toB && ca.PacketsReceived == toC, "B received {0} of {1} and C {2} of {3}",
+				ba.PacketsReceived, toB, ca.PacketsReceived, toC);
+
+			a.Dispose();
+			b.Dispose();
+			c.Dispose();
+		}
+	}
+}
@@ -0,0 +1,261 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Net;
+using System.Net.Sockets;
+using System.Threading;
+
+namespace test
+{
+	// Floods an RtpClient over loopback from 1 to 16 sockets at once, and measures how many packets its receive loop can
+	// take in a second and how much it allocates for each.
+	//
+	// The senders take turns, so the sender of each packet differs from the one before it when there is more than one.
+	// The flood keeps a window of packets in flight and waits for the receiver to catch up before sending more, so that
+	// nothing is dropped for want of socket buffer and the rate is that of the receiver. The same flood is then sent to a
+	// copy of the loop that RtpClient used to run, with a BeginReceiveFrom, a new sender endpoint and a wait handle for
+	// every packet, and a set and two dictionary lookups to read it.
+	//
+	// Allocations are counted for the whole process while the flood runs, less what the sending alone allocates, which is
+	// measured first by flooding a socket that nobody reads. Every packet must reach OnReceived once and in order, with
+	// the sequence numbers carried past their 16 bits, and the loop must allocate less for each packet than it used to.
+	// It does not allocate nothing: ReceiveFrom makes a socket address for every datagram it reads.
+	//
+	// usage: test receive [seconds per row]
+	static class RtpReceiveTest
+	{
+		private const int PayloadSize = 33;
+		private const int PacketSize = TestPeer.HeaderSize + PayloadSize;
+		private const int Window = 64;
+
+		// The receive loop and packet parsing that RtpClient had before it drained the socket, reduced to counting.
+		private class OldReceiver : IDisposable
+		{
+			private Socket _socket;
+			private HashSet<IPEndPoint> _peers;
+			private Dictionary<IPEndPoint, int> _seq;
+			private byte[] _payload;
+			private ManualResetEvent _endEvent;
+			private Thread _thread;
+			private int _received;
+
+			public OldReceiver()
+			{
+				_socket = new Socket(AddressFamily.InterNetwork, SocketType.Dgram, ProtocolType.Udp);
+				_socket.Bind(new IPEndPoint(IPAddress.Loopback, 0));
+				_peers = new HashSet<IPEndPoint>();
+				_seq = new Dictionary<IPEndPoint, int>();
+				_payload = new byte[1024];
+				_endEvent = new ManualResetEvent(false);
+			}
+
+			public IPEndPoint EndPoint
+			{
+				get
+				{
+					return (IPEndPoint)_socket.LocalEndPoint;
+				}
+			}
+
+			public int Received
+			{
+				get
+				{
+					return Thread.VolatileRead(ref _received);
+				}
+			}
+
+			public void AddPeer(IPEndPoint endpoint)
+			{
+				_peers.Add(endpoint);
+			}
+
+			public void Open()
+			{
+				_thread = new Thread(this.Loop);
+				_thread.IsBackground = true;
+				_thread.Start();
+			}
+
+			public void Dispose()
+			{
+				_endEvent.Set();
+				if (_thread != null)
+				{
+					_thread.Join();
+				}
+				_socket.Close();
+				_endEvent.Close();
+			}
+
+			private void Loop()
+			{
+				var handles = new WaitHandle[] { null, _endEvent };
+				var buffer = new byte[1024 + TestPeer.HeaderSize];
+				while (true)
+				{
+					EndPoint sender = new IPEndPoint(IPAddress.Any, 0);
+					var arr = _socket.BeginReceiveFrom(buffer, 0, buffer.Length, SocketFlags.None, ref sender, null, null);
+					handles[0] = arr.AsyncWaitHandle;
+					if (WaitHandle.WaitAny(handles) != 0)
+					{
+						return;
+					}
+					int count = _socket.EndReceiveFrom(arr, ref sender);
+					var endpoint = (IPEndPoint)sender;
+					if (_peers.Contains(endpoint) && buffer[0] == 0x80 && count > TestPeer.HeaderSize)
+					{
+						int seq = buffer[2] << 8 | buffer[3];
+						Array.Copy(buffer, TestPeer.HeaderSize, _payload, 0, count - TestPeer.HeaderSize);
+						if (!_seq.ContainsKey(endpoint))
+						{
+							_seq.Add(endpoint, 0);
+						}
+						_seq[endpoint] = Math.Max(_seq[endpoint], seq);
+						Interlocked.Increment(ref _received);
+					}
+				}
+			}
+		}
+
+		private class Outcome
+		{
+			public long Packets;
+			public double PacketsPerSecond, BytesPerPacket;
+		}
+
+		public static void Run(string[] args)
+		{
+			double seconds = args.Length > 0 ? double.Parse(args[0]) : 1.0;
+			AppDomain.MonitoringIsEnabled = true;
+
+			Console.WriteLine("{0,7} {1,12} {2,12} {3,12} {4,12}", "senders", "packets/s", "bytes/packet", "old packets/s",
+				"old bytes");
+			foreach (int count in new int[] { 1, 4, 16 })
+			{
+				var senders = new Socket[count];
+				try
+				{
+					for (int i = 0; i < count; i++)
+					{
+						senders[i] = new Socket(AddressFamily.InterNetwork, SocketType.Dgram, ProtocolType.Udp);
+						senders[i].Bind(new IPEndPoint(IPAddress.Loopback, 0));
+					}
+
+					// What the flood allocates with nobody receiving it.
+					Outcome sending;
+					using (var sink = new Socket(AddressFamily.InterNetwork, SocketType.Dgram, ProtocolType.Udp))
+					{
+						sink.Bind(new IPEndPoint(IPAddress.Loopback, 0));
+						sending = Flood(senders, (IPEndPoint)sink.LocalEndPoint, seconds / 4, null);
+					}
+
+					var receiver = new TestPeer(PayloadSize);
+					Outcome outcome;
+					try
+					{
+						foreach (var sender in senders)
+						{
+							receiver.AddPeer((IPEndPoint)sender.LocalEndPoint);
+						}
+						receiver.Open();
+						outcome = Flood(senders, receiver.LocalEndPoint, seconds, () => receiver.BytesReceived / PacketSize);
+
+						long perSender = outcome.Packets / count;
+						foreach (var sender in senders)
+						{
+							var stream = receiver.GetStream((IPEndPoint)sender.LocalEndPoint);
+							Check.That(stream != null && stream.Received == perSender && stream.Lost == 0 && stream.Duplicates == 0,
+								"{0} senders: {1} of {2} packets from one reached OnReceived, {3} lost and {4} repeated", count,
+								stream != null ? stream.Received : 0, perSender, stream != null ? stream.Lost : 0,
+								stream != null ? stream.Duplicates : 0);
+						}
+						Check.That(receiver.Errors == 0, "{0} senders: the receive loop reported {1} errors", count, receiver.Errors);
+					}
+					finally
+					{
+						receiver.Dispose();
+					}
+
+					Outcome old;
+					using (var oldReceiver = new OldReceiver())
+					{
+						foreach (var sender in senders)
+						{
+							oldReceiver.AddPeer((IPEndPoint)sender.LocalEndPoint);
+						}
+						oldReceiver.Open();
+						old = Flood(senders, oldReceiver.EndPoint, seconds, () => oldReceiver.Received);
+					}
+
+					double bytes = Math.Max(0, outcome.BytesPerPacket - sending.BytesPerPacket);
+					double oldBytes = Math.Max(0, old.BytesPerPacket - sending.BytesPerPacket);
+					Console.WriteLine("{0,7} {1,12:F0} {2,12:F1} {3,12:F0} {4,12:F1}", count, outcome.PacketsPerSecond, bytes,
+						old.PacketsPerSecond, oldBytes);
+					Check.That(bytes < oldBytes, "{0} senders: {1:F1} bytes were allocated for each packet, and {2:F1} before", count,
+						bytes, oldBytes);
+				}
+				finally
+				{
+					foreach (var sender in senders)
+					{
+						if (sender != null)
+						{
+							sender.Close();
+						}
+					}
+				}
+			}
+		}
+
+		// Sends packets from each socket in turn for about the given time, never letting more than a window of them go
+		// unreceived, and then waits for the last of them. With no count of what was received, the packets are just sent.
+		private static Outcome Flood(Socket[] senders, IPEndPoint target, double seconds, Func<long> received)
+		{
+			var packets = new byte[senders.Length][];
+			for (int i = 0; i < senders.Length; i++)
+			{
+				senders[i].Connect(target);
+				packets[i] = new byte[PacketSize];
+				packets[i][0] = 0x80;
+				packets[i][1] = TestPeer.AudioPayloadType;
+				packets[i][11] = (byte)(i + 1);
+			}
+
+			GC.Collect();
+			long allocated = AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize;
+			long sent = 0;
+			int seq = 0, turn = 0;
+			var clock = Stopwatch.StartNew();
+			while (turn != 0 || clock.Elapsed.TotalSeconds < seconds)
+			{
+				if (received != null && sent - received() >= Window)
+				{
+					Thread.Yield();
+					continue;
+				}
+				if (turn == 0)
+				{
+					seq++;
+				}
+				var packet = packets[turn];
+				packet[2] = (byte)(seq >> 8);
+				packet[3] = (byte)seq;
+				packet[7] = (byte)seq;
+				senders[turn].Send(packet);
+				sent++;
+				turn = (turn + 1) % senders.Length;
+			}
+			while (received != null && received() < sent && clock.Elapsed.TotalSeconds < seconds + 2)
+			{
+				Thread.Sleep(1);
+			}
+
+			var outcome = new Outcome();
+			outcome.Packets = received != null ? received() : sent;
+			outcome.PacketsPerSecond = outcome.Packets / clock.Elapsed.TotalSeconds;
+			outcome.BytesPerPacket = (double)(AppDomain.CurrentDomain.MonitoringTotalAllocatedMemorySize - allocated) / sent;
+			return outcome;
+		}
+	}
+}
@@ -0,0 +1,346 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Net;
+using System.Net.Sockets;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace test
+{
+	// Sends packets from an RtpClient to 1 to 64 sockets over loopback, and measures how long each call to Send holds up
+	// the caller and how many packets the send thread can fan out in a second.
+	//
+	// For each number of peers, fifty packets are first sent in real time, one every 20 ms, and every socket must receive
+	// all of them in order. The same is then done the way RtpClient used to send, with a BeginSendTo per peer and a wait
+	// for all of them on the calling thread, to compare the time that the capture thread spends in Send. Last, packets are
+	// sent as fast as the send thread can take them, keeping its queue from filling up, and the number that went out to
+	// every peer in a second is reported.
+	//
+	// A peer that cannot be sent to, at the broadcast address, must have every send counted against it and nothing
+	// against the others, which must still receive everything.
+	//
+	// usage: test send [seconds]
+	static class RtpSendTest
+	{
+		private const int PayloadSize = 33;
+		private const int FrameLength = 20; // milliseconds
+		private const int RealTimePackets = 50;
+		private const int SendQueueLength = 8; // as in RtpClient
+
+		// Loopback sockets that count, on a thread of their own, what arrives at each.
+		private class Receivers : IDisposable
+		{
+			private Socket[] _sockets;
+			private int[] _received, _outOfOrder, _next;
+			private Thread _thread;
+			private volatile bool _stop;
+
+			public Receivers(int count)
+			{
+				_sockets = new Socket[count];
+				_received = new int[count];
+				_outOfOrder = new int[count];
+				_next = new int[count];
+				for (int i = 0; i < count; i++)
+				{
+					_sockets[i] = new Socket(AddressFamily.InterNetwork, SocketType.Dgram, ProtocolType.Udp);
+					_sockets[i].ReceiveBufferSize = 1 << 20;
+					_sockets[i].Bind(new IPEndPoint(IPAddress.Loopback, 0));
+				}
+				_thread = new Thread(this.Loop);
+				_thread.IsBackground = true;
+				_thread.Start();
+			}
+
+			public IPEndPoint GetEndPoint(int i)
+			{
+				return (IPEndPoint)_sockets[i].LocalEndPoint;
+			}
+
+			public int Count
+			{
+				get
+				{
+					return _sockets.Length;
+				}
+			}
+
+			public int GetReceived(int i)
+			{
+				return Thread.VolatileRead(ref _received[i]);
+			}
+
+			public int GetOutOfOrder(int i)
+			{
+				return Thread.VolatileRead(ref _outOfOrder[i]);
+			}
+
+			// Waits for anything still on its way, and then starts counting again from the next packet to arrive.
+			public void Reset()
+			{
+				Thread.Sleep(100);
+				for (int i = 0; i < _sockets.Length; i++)
+				{
+					Thread.VolatileWrite(ref _received[i], 0);
+					Thread.VolatileWrite(ref _outOfOrder[i], 0);
+					Thread.VolatileWrite(ref _next[i], -1);
+				}
+			}
+
+			public void Dispose()
+			{
+				_stop = true;
+				_thread.Join();
+				foreach (var socket in _sockets)
+				{
+					socket.Close();
+				}
+			}
+
+			private void Loop()
+			{
+				var buffer = new byte[2048];
+				var ready = new List<Socket>();
+				while (!_stop)
+				{
+					ready.Clear();
+					ready.AddRange(_sockets);
+					Socket.Select(ready, null, null, 50000);
+					foreach (var socket in ready)
+					{
+						int i = Array.IndexOf(_sockets, socket);
+						while (socket.Available > 0)
+						{
+							// The client's RTCP reports arrive on the same sockets, and are left out.
+							int size = socket.Receive(buffer);
+							if (size < 4 || (buffer[1] & 0x7f) != TestPeer.AudioPayloadType)
+							{
+								continue;
+							}
+							int sequence = buffer[2] << 8 | buffer[3];
+							if (_next[i] >= 0 && sequence != (_next[i] & 0xffff))
+							{
+								Interlocked.Increment(ref _outOfOrder[i]);
+							}
+							_next[i] = sequence + 1;
+							Interlocked.Increment(ref _received[i]);
+						}
+					}
+				}
+			}
+		}
+
+		private class Timing
+		{
+			public long Calls, Total, Max;
+
+			public void Add(long ticks)
+			{
+				this.Calls++;
+				this.Total += ticks;
+				this.Max = Math.Max(this.Max, ticks);
+			}
+
+			public double MeanMicroseconds
+			{
+				get
+				{
+					return this.Calls > 0 ? this.Total * 1e6 / Stopwatch.Frequency / this.Calls : 0;
+				}
+			}
+
+			public double MaxMicroseconds
+			{
+				get
+				{
+					return this.Max * 1e6 / Stopwatch.Frequency;
+				}
+			}
+		}
+
+		public static void Run(string[] args)
+		{
+			double seconds = args.Length > 0 ? double.Parse(args[0]) : 2.0;
+			var payload = Marshal.AllocHGlobal(PayloadSize);
+			try
+			{
+				Console.WriteLine("{0,6} {1,14} {2,14} {3,14} {4,14} {5,12} {6,12}", "peers", "send mean us", "send max us",
+					"old mean us", "old max us", "packets/s", "datagrams/s");
+				foreach (int peers in new int[] { 1, 4, 16, 64 })
+				{
+					using (var receivers = new Receivers(peers))
+					{
+						var sender = new TestPeer(PayloadSize);
+						try
+						{
+							for (int i = 0; i < peers; i++)
+							{
+								sender.AddPeer(receivers.GetEndPoint(i));
+							}
+							sender.Open();
+
+							receivers.Reset();
+							var timing = SendRealTime(sender, payload);
+							CheckReceived(receivers, string.Format("{0} peers", peers));
+							receivers.Reset();
+							var old = SendRealTimeAsBefore(receivers, payload);
+							CheckReceived(receivers, string.Format("{0} peers as before", peers));
+
+							// A packet is counted as sent just before its place in the queue is freed, so the queue is
+							// kept two short of full to be sure that nothing is dropped.
+							long sent = sender.PacketsSent, dropped = sender.PacketsDropped, queued = 0;
+							var clock = Stopwatch.StartNew();
+							for (int timeStamp = 0; clock.Elapsed.TotalSeconds < seconds; )
+							{
+								if (queued - (sender.PacketsSent - sent) < SendQueueLength - 2)
+								{
+									sender.Send(timeStamp, payload, PayloadSize);
+									timeStamp += 160;
+									queued++;
+								}
+								else
+								{
+									Thread.Yield();
+								}
+							}
+							double elapsed = clock.Elapsed.TotalSeconds;
+							sent = sender.PacketsSent - sent;
+							dropped = sender.PacketsDropped - dropped;
+
+							Console.WriteLine("{0,6} {1,14:F1} {2,14:F1} {3,14:F1} {4,14:F1} {5,12:F0} {6,12:F0}", peers,
+								timing.MeanMicroseconds, timing.MaxMicroseconds, old.MeanMicroseconds, old.MaxMicroseconds,
+								sent / elapsed, sent * peers / elapsed);
+							Check.That(timing.MeanMicroseconds < old.MeanMicroseconds, "{0} peers: Send took {1:F1} us, and {2:F1} us as before",
+								peers, timing.MeanMicroseconds, old.MeanMicroseconds);
+							Check.That(sender.Errors == 0 && dropped == 0, "{0} peers: {1} sends failed and {2} packets were dropped", peers,
+								sender.Errors, dropped);
+						}
+						finally
+						{
+							sender.Dispose();
+						}
+					}
+				}
+
+				CheckSendErrors(payload);
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(payload);
+			}
+		}
+
+		private static Timing SendRealTime(TestPeer sender, IntPtr payload)
+		{
+			var timing = new Timing();
+			var clock = Stopwatch.StartNew();
+			for (int i = 0; i < RealTimePackets; i++)
+			{
+				int wait = i * FrameLength - (int)clock.ElapsedMilliseconds;
+				if (wait > 0)
+				{
+					Thread.Sleep(wait);
+				}
+				long start = Stopwatch.GetTimestamp();
+				sender.Send(i * 160, payload, PayloadSize);
+				timing.Add(Stopwatch.GetTimestamp() - start);
+			}
+			return timing;
+		}
+
+		// Sends the way RtpClient.Send did before it had a send thread.
+		private static Timing SendRealTimeAsBefore(Receivers receivers, IntPtr payload)
+		{
+			var timing = new Timing();
+			var socket = new Socket(AddressFamily.InterNetwork, SocketType.Dgram, ProtocolType.Udp);
+			try
+			{
+				socket.Bind(new IPEndPoint(IPAddress.Loopback, 0));
+				var packet = new byte[12 + PayloadSize];
+				packet[0] = 0x80;
+				packet[1] = TestPeer.AudioPayloadType;
+				var clock = Stopwatch.StartNew();
+				for (int i = 0; i < RealTimePackets; i++)
+				{
+					int wait = i * FrameLength - (int)clock.ElapsedMilliseconds;
+					if (wait > 0)
+					{
+						Thread.Sleep(wait);
+					}
+					long start = Stopwatch.GetTimestamp();
+					packet[2] = (byte)(i >> 8);
+					packet[3] = (byte)i;
+					Marshal.Copy(payload, packet, 12, PayloadSize);
+					var results = new IAsyncResult[receivers.Count];
+					var handles = new WaitHandle[receivers.Count];
+					for (int j = 0; j < receivers.Count; j++)
+					{
+						results[j] = socket.BeginSendTo(packet, 0, packet.Length, SocketFlags.None, receivers.GetEndPoint(j), null, null);
+						handles[j] = results[j].AsyncWaitHandle;
+					}
+					WaitHandle.WaitAll(handles);
+					foreach (var result in results)
+					{
+						socket.EndSendTo(result);
+					}
+					timing.Add(Stopwatch.GetTimestamp() - start);
+				}
+			}
+			finally
+			{
+				socket.Close();
+			}
+			return timing;
+		}
+
+		private static void CheckReceived(Receivers receivers, string name)
+		{
+			Thread.Sleep(200);
+			for (int i = 0; i < receivers.Count; i++)
+			{
+				Check.That(receivers.GetReceived(i) == RealTimePackets && receivers.GetOutOfOrder(i) == 0,
+					"{0}: socket {1} received {2} of {3} packets, {4} out of order", name, i, receivers.GetReceived(i),
+					RealTimePackets, receivers.GetOutOfOrder(i));
+			}
+		}
+
+		private static void CheckSendErrors(IntPtr payload)
+		{
+			// Sending to the broadcast address fails when the socket has not been allowed to broadcast.
+			var broadcast = new IPEndPoint(IPAddress.Broadcast, 9);
+			using (var receivers = new Receivers(4))
+			{
+				var sender = new TestPeer(PayloadSize);
+				try
+				{
+					sender.AddPeer(receivers.GetEndPoint(0));
+					sender.AddPeer(receivers.GetEndPoint(1));
+					sender.AddPeer(broadcast);
+					sender.AddPeer(receivers.GetEndPoint(2));
+					sender.AddPeer(receivers.GetEndPoint(3));
+					sender.Open();
+					receivers.Reset();
+					SendRealTime(sender, payload);
+					CheckReceived(receivers, "with a failing peer");
+
+					int others = 0;
+					for (int i = 0; i < receivers.Count; i++)
+					{
+						others += sender.GetSendErrors(receivers.GetEndPoint(i));
+					}
+					Console.WriteLine("failing peer: {0} send errors, {1} against the others, {2} reported", sender.GetSendErrors(broadcast),
+						others, sender.Errors);
+					// RTCP reports to the failing peer fail too, and are reported, but are not counted against it.
+					Check.That(sender.GetSendErrors(broadcast) == RealTimePackets && others == 0 && sender.Errors >= RealTimePackets,
+						"{0} send errors were counted against the failing peer and {1} against the others, of {2} reported",
+						sender.GetSendErrors(broadcast), others, sender.Errors);
+				}
+				finally
+				{
+					sender.Dispose();
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,298 @@
+﻿using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using Floe.Interop;
+
+namespace test
+{
+	// Converts tones between the rates that Floe records and plays at, with each of the SampleRateConverter quality
+	// presets, and measures how close the output comes to the same tone made at the new rate, how well a tone above the
+	// new Nyquist frequency is kept out when downsampling, and how many times faster than real time the conversion runs.
+	//
+	// The converter lines its output up with its input, so output sample n is compared with the ideal tone at time n over
+	// the new rate, without any shift; a misplaced filter would show up as a poor SNR at the higher tones. The tones are at
+	// -10 dBFS and are placed at 5, 20 and 30% of the lower rate, inside the passband of every preset. Both input and output
+	// are 16-bit, which puts a ceiling of about 90 dB on what can be measured.
+	//
+	// The output must not depend on how it is taken: the same signal is converted in one call, in the blocks that VoiceIn
+	// records with 320-sample packets drawn as VoiceIn draws them, and in blocks of random size, and all must agree to the
+	// sample. Resetting must start the stream over, and input larger than the converter was made for must be refused.
+	//
+	// usage: test resample [seconds per row]
+	static class SampleRateTest
+	{
+		private const double Amplitude = 32768 * 0.316; // -10 dBFS
+		private const int PacketSamples = 320;
+		private const int PacketMilliseconds = 20;
+		private static readonly double[] Tones = { 0.05, 0.2, 0.3 };
+
+		private class Pair
+		{
+			public int From, To;
+
+			public Pair(int from, int to)
+			{
+				this.From = from;
+				this.To = to;
+			}
+		}
+
+		public static void Run(string[] args)
+		{
+			double seconds = args.Length > 0 ? double.Parse(args[0]) : 0.5;
+			var pairs = new Pair[]
+			{
+				new Pair(48000, 21760),
+				new Pair(44100, 21760),
+				new Pair(48000, 8000),
+				new Pair(8000, 48000),
+				new Pair(22050, 44100)
+			};
+			var qualities = new ResamplerQuality[] { ResamplerQuality.Low, ResamplerQuality.Medium, ResamplerQuality.High };
+			var floors = new double[] { 55.0, 70.0, 80.0 };
+
+			Console.WriteLine("{0,6} {1,6} {2,-7} {3,9} {4,9} {5,9} {6,9} {7,10}", "from", "to", "quality", "5% dB", "20% dB",
+				"30% dB", "alias dB", "x realtime");
+			var random = new Random(1);
+			foreach (var pair in pairs)
+			{
+				for (int q = 0; q < qualities.Length; q++)
+				{
+					var quality = qualities[q];
+					string name = string.Format("{0} to {1} at {2}", pair.From, pair.To, quality);
+					var snr = new double[Tones.Length];
+					int lower = Math.Min(pair.From, pair.To);
+					for (int i = 0; i < Tones.Length; i++)
+					{
+						snr[i] = MeasureSnr(pair, quality, Tones[i] * lower);
+						Check.That(snr[i] > floors[q], "{0}: a tone at {1:F0} Hz came out {2:F1} dB from the ideal", name,
+							Tones[i] * lower, snr[i]);
+					}
+
+					// When downsampling, a tone half way up the band between the new Nyquist frequency and the old one must
+					// be taken out, or it would fold back as a tone that was never there.
+					double alias = double.NaN;
+					if (pair.To < pair.From)
+					{
+						alias = MeasureAlias(pair, quality, (pair.To + pair.From) / 4.0);
+						Check.That(alias > floors[q], "{0}: a tone above the new Nyquist frequency was let through at -{1:F1} dB",
+							name, alias);
+					}
+
+					double speed = MeasureSpeed(pair, quality, seconds);
+					Console.WriteLine("{0,6} {1,6} {2,-7} {3,9:F1} {4,9:F1} {5,9:F1} {6,9} {7,10:F0}", pair.From, pair.To, quality,
+						snr[0], snr[1], snr[2], double.IsNaN(alias) ? "-" : alias.ToString("F1"), speed);
+					Check.That(speed > 100, "{0}: converted only {1:F0} times faster than real time", name, speed);
+
+					CheckBlocks(random, pair, quality, name);
+				}
+			}
+		}
+
+		private static short[] MakeTone(int rate, double frequency, int count)
+		{
+			var samples = new short[count];
+			for (int i = 0; i < count; i++)
+			{
+				samples[i] = (short)Math.Round(Amplitude * Math.Sin(2 * Math.PI * frequency * i / rate));
+			}
+			return samples;
+		}
+
+		// Converts the whole of the input in one call, and returns as much output as it gives.
+		private static short[] Convert(Pair pair, ResamplerQuality quality, short[] input)
+		{
+			using (var converter = new SampleRateConverter(pair.From, pair.To, quality, input.Length * 2))
+			{
+				int dstSize = converter.GetMaxDestSize(input.Length * 2);
+				var src = Marshal.AllocHGlobal(input.Length * 2);
+				var dst = Marshal.AllocHGlobal(dstSize);
+				try
+				{
+					Marshal.Copy(input, 0, src, input.Length);
+					int size = converter.Convert(src, input.Length * 2, dst, dstSize);
+					var output = new short[size / 2];
+					Marshal.Copy(dst, output, 0, output.Length);
+					return output;
+				}
+				finally
+				{
+					Marshal.FreeHGlobal(src);
+					Marshal.FreeHGlobal(dst);
+				}
+			}
+		}
+
+		// The ratio of the power of the ideal tone to that of the difference, in dB, over a second of output less 50 ms
+		// at each end, which is longer than any of the filters.
+		private static double MeasureSnr(Pair pair, ResamplerQuality quality, double frequency)
+		{
+			var output = Convert(pair, quality, MakeTone(pair.From, frequency, pair.From));
+			int skip = pair.To / 20;
+			double signal = 0, noise = 0;
+			for (int n = skip; n < output.Length - skip; n++)
+			{
+				double expected = Amplitude * Math.Sin(2 * Math.PI * frequency * n / pair.To);
+				signal += expected * expected;
+				noise += (output[n] - expected) * (output[n] - expected);
+			}
+			return 10 * Math.Log10(signal / noise);
+		}
+
+		// The ratio of the power of the input tone to that of what is left of it in the output, in dB.
+		private static double MeasureAlias(Pair pair, ResamplerQuality quality, double frequency)
+		{
+			var output = Convert(pair, quality, MakeTone(pair.From, frequency, pair.From));
+			int skip = pair.To / 20;
+			double power = 0;
+			for (int n = skip; n < output.Length - skip; n++)
+			{
+				power += (double)output[n] * output[n];
+			}
+			power /= output.Length - 2 * skip;
+			return 10 * Math.Log10(Amplitude * Amplitude / 2 / Math.Max(power, 1e-3));
+		}
+
+		// Converts a block of recorded length at a time, as VoiceIn does, for about the given time, and returns the
+		// number of seconds of input converted in each second.
+		private static double MeasureSpeed(Pair pair, ResamplerQuality quality, double seconds)
+		{
+			int blockSize = pair.From * PacketMilliseconds / 1000 * 2;
+			var input = MakeTone(pair.From, 0.1 * Math.Min(pair.From, pair.To), blockSize / 2);
+			using (var converter = new SampleRateConverter(pair.From, pair.To, quality, blockSize))
+			{
+				int dstSize = converter.GetMaxDestSize(blockSize);
+				var src = Marshal.AllocHGlobal(blockSize);
+				var dst = Marshal.AllocHGlobal(dstSize);
+				try
+				{
+					Marshal.Copy(input, 0, src, input.Length);
+					converter.Convert(src, blockSize, dst, dstSize);
+					long blocks = 0;
+					var clock = Stopwatch.StartNew();
+					do
+					{
+						for (int i = 0; i < 50; i++)
+						{
+							converter.Convert(src, blockSize, dst, dstSize);
+						}
+						blocks += 50;
+					}
+					while (clock.Elapsed.TotalSeconds < seconds);
+					return blocks * PacketMilliseconds / 1000.0 / clock.Elapsed.TotalSeconds;
+				}
+				finally
+				{
+					Marshal.FreeHGlobal(src);
+					Marshal.FreeHGlobal(dst);
+				}
+			}
+		}
+
+		private static void CheckBlocks(Random random, Pair pair, ResamplerQuality quality, string name)
+		{
+			// Speech-like noise: random samples, smoothed so that most of their power lies in the passband.
+			var input = new short[pair.From];
+			double smooth = 0;
+			for (int i = 0; i < input.Length; i++)
+			{
+				smooth = smooth * 0.7 + (random.NextDouble() * 2 - 1) * 0.3 * 20000;
+				input[i] = (short)smooth;
+			}
+			var expected = Convert(pair, quality, input);
+
+			int captureSize = (int)((long)PacketSamples * pair.From / pair.To) * 2;
+			var packets = ConvertInBlocks(pair, quality, input, captureSize, (offset) => captureSize, false);
+			CompareOutput(name + " in recorded blocks", expected, packets);
+
+			var odd = ConvertInBlocks(pair, quality, input, captureSize, (offset) => random.Next(1, captureSize / 2 + 1) * 2, true);
+			CompareOutput(name + " in random blocks", expected, odd);
+		}
+
+		// Feeds the input in blocks of the sizes given, and draws the output a packet at a time, taking more from what the
+		// converter has kept whenever a packet is filled, as VoiceIn does. Resets the converter half way through the first
+		// time, and starts over, if asked.
+		private static short[] ConvertInBlocks(Pair pair, ResamplerQuality quality, short[] input, int maxSize,
+			Func<int, int> nextSize, bool reset)
+		{
+			var output = new short[input.Length * 2 * pair.To / pair.From + PacketSamples];
+			int length = 0;
+			using (var converter = new SampleRateConverter(pair.From, pair.To, quality, maxSize))
+			{
+				var src = Marshal.AllocHGlobal(maxSize);
+				var packet = Marshal.AllocHGlobal(PacketSamples * 2);
+				try
+				{
+					Check.That(Refuses(converter, src, maxSize * 4, packet), "{0} to {1}: input too large was not refused",
+						pair.From, pair.To);
+					for (int offset = 0; offset < input.Length; )
+					{
+						int size = Math.Min(nextSize(offset), (input.Length - offset) * 2);
+						Marshal.Copy(input, offset, src, size / 2);
+						offset += size / 2;
+
+						int packetLength = length % PacketSamples * 2;
+						int written = converter.Convert(src, size, packet + packetLength, PacketSamples * 2 - packetLength);
+						while (true)
+						{
+							Marshal.Copy(packet + packetLength, output, length, written / 2);
+							length += written / 2;
+							packetLength += written;
+							if (packetLength < PacketSamples * 2)
+							{
+								break;
+							}
+							packetLength = 0;
+							written = converter.Convert(IntPtr.Zero, 0, packet, PacketSamples * 2);
+						}
+
+						if (reset && offset >= input.Length / 2)
+						{
+							converter.Reset();
+							offset = 0;
+							length = 0;
+							reset = false;
+						}
+					}
+				}
+				finally
+				{
+					Marshal.FreeHGlobal(src);
+					Marshal.FreeHGlobal(packet);
+				}
+			}
+			Array.Resize(ref output, length);
+			return output;
+		}
+
+		private static bool Refuses(SampleRateConverter converter, IntPtr src, int size, IntPtr dst)
+		{
+			// The converter has room for twice what it was made for, to hold what it keeps from one call to the next, so
+			// four times that is sure to be refused. It is refused before any of it is read, so src need not be that large.
+			try
+			{
+				converter.Convert(src, size, dst, 0);
+				return false;
+			}
+			catch (InteropException)
+			{
+				converter.Reset();
+				return true;
+			}
+		}
+
+		private static void CompareOutput(string name, short[] expected, short[] actual)
+		{
+			Check.That(actual.Length == expected.Length, "{0}: {1} samples came out, and {2} in one call", name, actual.Length,
+				expected.Length);
+			for (int i = 0; i < Math.Min(expected.Length, actual.Length); i++)
+			{
+				if (actual[i] != expected[i])
+				{
+					Check.That(false, "{0}: sample {1} was {2}, and {3} in one call", name, i, actual[i], expected[i]);
+					return;
+				}
+			}
+		}
+	}
+}
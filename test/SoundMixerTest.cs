@@ -0,0 +1,328 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Threading;
+using Floe.Interop;
+
+namespace test
+{
+	// Plays sounds through a SoundMixer that is read on a thread of its own every 20 ms, as the WaveOut that SoundCache
+	// keeps open reads it, and measures the time from each call to Play until the read that holds the sound's first
+	// sample. The device has two more buffers queued by then, which adds 40 ms before the sound is heard; that part is
+	// fixed and is not measured here.
+	//
+	// The plays come at random times, one at a time, and each sound must start at the very beginning of the first read
+	// after its Play, which bounds the latency by one buffer and a little scheduling. The mixer's own MaxLatency must agree
+	// with what the test measured.
+	//
+	// Before that, the mix is checked against a sum in C#; 20 sounds played at once must fill the 16 voices and take the
+	// four longest-playing ones, with Finished raised once for every play; and a full mixer must drop the sounds played
+	// least recently, never one that is playing or waiting to play.
+	//
+	// usage: test sounds [plays]
+	static class SoundMixerTest
+	{
+		private const int SampleRate = 44100; // as in SoundCache
+		private const int Channels = 2;
+		private const int BufferLength = 20; // milliseconds
+		private const int BufferCount = 3;
+		private const int BufferFrames = SampleRate * BufferLength / 1000;
+		private const int BufferSize = BufferFrames * Channels * 2;
+		private const int MaxVoices = 16; // as in SoundBank
+
+		// Reads from a source every period on a thread of its own, as a device does when it finishes with a buffer, and
+		// says when each read began.
+		private class Device : IDisposable
+		{
+			private IWaveSource _source;
+			private Action<long, short[]> _onRead;
+			private Thread _thread;
+			private volatile bool _stop;
+
+			public Device(IWaveSource source, Action<long, short[]> onRead)
+			{
+				_source = source;
+				_onRead = onRead;
+				_thread = new Thread(this.Loop);
+				_thread.IsBackground = true;
+				_thread.Priority = ThreadPriority.Highest;
+				_thread.Start();
+			}
+
+			public void Dispose()
+			{
+				_stop = true;
+				_thread.Join();
+			}
+
+			private void Loop()
+			{
+				var buffer = Marshal.AllocHGlobal(BufferSize);
+				var samples = new short[BufferSize / 2];
+				try
+				{
+					var clock = Stopwatch.StartNew();
+					for (long i = 0; !_stop; i++)
+					{
+						int wait = (int)(i * BufferLength - clock.ElapsedMilliseconds);
+						if (wait > 0)
+						{
+							Thread.Sleep(wait);
+						}
+						long start = Stopwatch.GetTimestamp();
+						_source.Read(buffer, BufferSize);
+						Marshal.Copy(buffer, samples, 0, samples.Length);
+						_onRead(start, samples);
+					}
+				}
+				finally
+				{
+					Marshal.FreeHGlobal(buffer);
+				}
+			}
+		}
+
+		public static void Run(string[] args)
+		{
+			int plays = args.Length > 0 ? int.Parse(args[0]) : 200;
+			var random = new Random(1);
+
+			CheckMix(random);
+			CheckVoices(random);
+			CheckEviction(random);
+			MeasureLatency(random, plays);
+		}
+
+		private static byte[] MakeSound(Random random, int frames, int amplitude)
+		{
+			// Even samples, so that half gain is exact.
+			var samples = new short[frames * Channels];
+			for (int i = 0; i < samples.Length; i++)
+			{
+				samples[i] = (short)(random.Next(-amplitude / 2, amplitude / 2 + 1) * 2);
+			}
+			var bytes = new byte[samples.Length * 2];
+			Buffer.BlockCopy(samples, 0, bytes, 0, bytes.Length);
+			return bytes;
+		}
+
+		private static short Sample(byte[] sound, int i)
+		{
+			return i * 2 < sound.Length ? BitConverter.ToInt16(sound, i * 2) : (short)0;
+		}
+
+		private static void CheckMix(Random random)
+		{
+			// One sound ends part way through the first read, and the other in the second; two loud ones saturate.
+			using (var mixer = new SoundMixer(Channels, 1 << 20, BufferSize))
+			{
+				var sounds = new byte[][]
+				{
+					MakeSound(random, BufferFrames / 3, 20000),
+					MakeSound(random, BufferFrames * 3 / 2, 20000),
+					MakeSound(random, BufferFrames, 32000)
+				};
+				var gains = new float[] { 1f, 0.5f, 1f };
+				var tokens = new List<long>();
+				var finished = new List<long>();
+				mixer.Finished += (sender, e) => finished.Add(e.Token);
+				for (int i = 0; i < sounds.Length; i++)
+				{
+					tokens.Add(mixer.Play(mixer.Add(sounds[i], sounds[i].Length), gains[i]));
+				}
+				Check.That(!tokens.Contains(0) && mixer.Active == 3, "three plays gave tokens {0} with {1} active",
+					string.Join(", ", tokens), mixer.Active);
+
+				var buffer = Marshal.AllocHGlobal(BufferSize);
+				try
+				{
+					var output = new short[BufferSize / 2];
+					for (int read = 0; read < 3; read++)
+					{
+						Check.That(mixer.Read(buffer, BufferSize) == BufferSize, "read {0} of the mix was short", read);
+						Marshal.Copy(buffer, output, 0, output.Length);
+						for (int i = 0; i < output.Length; i++)
+						{
+							int n = read * output.Length + i;
+							long sum = 0;
+							for (int j = 0; j < sounds.Length; j++)
+							{
+								sum += (long)Math.Round(Sample(sounds[j], n) * gains[j]);
+							}
+							sum = Math.Max(short.MinValue, Math.Min(short.MaxValue, sum));
+							if (output[i] != sum)
+							{
+								Check.That(false, "sample {0} of the mix was {1}, expected {2}", n, output[i], sum);
+								return;
+							}
+						}
+					}
+				}
+				finally
+				{
+					Marshal.FreeHGlobal(buffer);
+				}
+				Check.That(finished.Count == 3 && finished.Contains(tokens[0]) && finished.Contains(tokens[1]) &&
+					finished.Contains(tokens[2]) && mixer.Active == 0, "Finished was raised for {0} of 3 plays, with {1} still active",
+					finished.Count, mixer.Active);
+			}
+		}
+
+		private static void CheckVoices(Random random)
+		{
+			using (var mixer = new SoundMixer(Channels, 1 << 24, BufferSize))
+			{
+				var tokens = new List<long>();
+				var finished = new Dictionary<long, int>();
+				mixer.Finished += (sender, e) => finished[e.Token] = finished.ContainsKey(e.Token) ? finished[e.Token] + 1 : 1;
+
+				// The first sixteen start one read apart, so that the first four are the ones that have played longest.
+				var buffer = Marshal.AllocHGlobal(BufferSize);
+				try
+				{
+					for (int i = 0; i < MaxVoices + 4; i++)
+					{
+						var sound = MakeSound(random, BufferFrames * 40, 1000);
+						tokens.Add(mixer.Play(mixer.Add(sound, sound.Length), 1f));
+						if (i < MaxVoices)
+						{
+							mixer.Read(buffer, BufferSize);
+						}
+					}
+					mixer.Read(buffer, BufferSize);
+					Check.That(mixer.Steals == 4 && mixer.Active == MaxVoices && finished.Count == 4 &&
+						finished.ContainsKey(tokens[0]) && finished.ContainsKey(tokens[3]),
+						"20 plays left {0} active with {1} taken, and the first four did not finish", mixer.Active, mixer.Steals);
+
+					for (int i = 0; i < 50 && mixer.Active > 0; i++)
+					{
+						mixer.Read(buffer, BufferSize);
+					}
+				}
+				finally
+				{
+					Marshal.FreeHGlobal(buffer);
+				}
+				int once = 0;
+				tokens.ForEach((token) => once += finished.ContainsKey(token) && finished[token] == 1 ? 1 : 0);
+				Check.That(mixer.Active == 0 && once == tokens.Count, "{0} of {1} plays finished exactly once, with {2} still active",
+					once, tokens.Count, mixer.Active);
+			}
+		}
+
+		private static void CheckEviction(Random random)
+		{
+			// Room for four sounds of one read each. The first is long and is played without ever being read, so that it
+			// stays waiting to play throughout.
+			int size = BufferSize;
+			using (var mixer = new SoundMixer(Channels, size * 4, BufferSize))
+			{
+				var buffer = Marshal.AllocHGlobal(BufferSize);
+				try
+				{
+					var a = mixer.Add(MakeSound(random, BufferFrames, 1000), size);
+					var b = mixer.Add(MakeSound(random, BufferFrames / 2, 1000), size / 2);
+					var c = mixer.Add(MakeSound(random, BufferFrames, 1000), size);
+					var d = mixer.Add(MakeSound(random, BufferFrames, 1000), size);
+					Check.That(mixer.Add(new byte[size * 4 + 4], size * 4 + 4) == 0, "a sound larger than the mixer was added");
+					Check.That(mixer.Count == 4 && mixer.Bytes == size * 3 + size / 2 && mixer.Evictions == 0,
+						"four sounds left {0} in the mixer, taking {1} bytes", mixer.Count, mixer.Bytes);
+
+					// b is played to the end, and is then the most recently used of those not playing.
+					mixer.Play(b, 1f);
+					mixer.Read(buffer, BufferSize);
+					mixer.Play(a, 1f);
+
+					var e = mixer.Add(MakeSound(random, BufferFrames, 1000), size);
+					Check.That(e != 0 && !mixer.Contains(c) && mixer.Contains(d) && mixer.Contains(b),
+						"a new sound did not take the place of the least recently used");
+					var f = mixer.Add(MakeSound(random, BufferFrames, 1000), size);
+					Check.That(f != 0 && !mixer.Contains(d) && mixer.Contains(b), "the second new sound did not take the next oldest");
+					var g = mixer.Add(MakeSound(random, BufferFrames, 1000), size);
+					Check.That(g != 0 && !mixer.Contains(b) && mixer.Contains(a), "the third new sound took one that was waiting to play");
+					Check.That(!mixer.Remove(a) && mixer.Play(c, 1f) == 0, "a sound waiting to play was removed, or a dropped one played");
+					Check.That(mixer.Evictions == 3 && mixer.Bytes <= size * 4, "{0} sounds were dropped, leaving {1} bytes",
+						mixer.Evictions, mixer.Bytes);
+
+					// Once a has played, it can go.
+					mixer.Read(buffer, BufferSize);
+					Check.That(mixer.Remove(a), "a sound that had played could not be removed");
+				}
+				finally
+				{
+					Marshal.FreeHGlobal(buffer);
+				}
+			}
+		}
+
+		private static void MeasureLatency(Random random, int plays)
+		{
+			// A short click, which never lasts into the next play.
+			var click = new byte[SampleRate / 100 * Channels * 2];
+			for (int i = 0; i < click.Length; i += 2)
+			{
+				click[i + 1] = 0x10;
+			}
+
+			var heard = new List<Tuple<long, bool>>();
+			var latencies = new double[plays];
+			double playMicroseconds = 0;
+			using (var mixer = new SoundMixer(Channels, 1 << 20, BufferSize))
+			{
+				int id = mixer.Add(click, click.Length);
+				short last = 0;
+				using (new Device(mixer, (start, samples) =>
+					{
+						// Note each read in which a click starts, and whether it starts at the read's first sample. Clicks
+						// may come in reads one after the other, but each is followed by silence in its own read.
+						for (int i = 0; i < samples.Length; i += Channels)
+						{
+							if (samples[i] != 0 && last == 0)
+							{
+								lock (heard)
+								{
+									heard.Add(Tuple.Create(start, i == 0));
+								}
+							}
+							last = samples[i];
+						}
+					}))
+				{
+					Thread.Sleep(100);
+					var played = new long[plays];
+					for (int i = 0; i < plays; i++)
+					{
+						Thread.Sleep(random.Next(30, 71));
+						played[i] = Stopwatch.GetTimestamp();
+						mixer.Play(id, 1f);
+						playMicroseconds += (Stopwatch.GetTimestamp() - played[i]) * 1e6 / Stopwatch.Frequency / plays;
+					}
+					Thread.Sleep(100);
+
+					lock (heard)
+					{
+						Check.That(heard.Count == plays, "{0} of {1} clicks were heard", heard.Count, plays);
+						for (int i = 0; i < Math.Min(plays, heard.Count); i++)
+						{
+							latencies[i] = (heard[i].Item1 - played[i]) * 1000.0 / Stopwatch.Frequency;
+							Check.That(heard[i].Item2, "click {0} did not start at the beginning of its read", i);
+						}
+					}
+				}
+
+				Array.Sort(latencies);
+				double mean = 0;
+				Array.ForEach(latencies, (l) => mean += l / plays);
+				double max = latencies[plays - 1];
+				Console.WriteLine("{0} plays: Play took {1:F1} us; first sample read after {2:F1} ms on average, {3:F1} ms at the " +
+					"95th percentile and {4:F1} ms at most ({5:F1} ms by the mixer), and heard {6} ms after that", plays,
+					playMicroseconds, mean, latencies[plays * 95 / 100], max, mixer.MaxLatency, (BufferCount - 1) * BufferLength);
+				Check.That(latencies[0] >= 0 && max < BufferLength * 2, "the first sample was read from {0:F1} to {1:F1} ms after Play",
+					latencies[0], max);
+				Check.That(Math.Abs(max - mixer.MaxLatency) < 1, "the mixer reported {0:F1} ms at most, and {1:F1} ms was measured",
+					mixer.MaxLatency, max);
+			}
+		}
+	}
+}
@@ -0,0 +1,137 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Net;
+using System.Net.Sockets;
+using System.Runtime.InteropServices;
+using System.Threading;
+using Floe.Net;
+
+namespace test
+{
+	// An RTP session that sends made-up payloads and keeps its own count of what it receives from each peer, so that the
+	// statistics that RtpClient reports can be checked against what actually arrived.
+	class TestPeer : RtpClient
+	{
+		public const byte AudioPayloadType = 3;
+		public const byte ComfortNoisePayloadType = 13;
+		public const int ClockRate = 8000;
+		public const int HeaderSize = 12;
+
+		public class Stream
+		{
+			public int FirstSequence, HighestSequence, Received, Duplicates;
+			public long Bytes;
+
+			public int Lost { get { return this.HighestSequence - this.FirstSequence + 1 - this.Received; } }
+
+			public Stream Copy()
+			{
+				return (Stream)this.MemberwiseClone();
+			}
+		}
+
+		private IntPtr _payload;
+		private Dictionary<IPEndPoint, Stream> _streams;
+		private object _sync;
+		private long _bytesSent, _bytesReceived;
+		private int _errors;
+
+		public TestPeer(int payloadSize, UdpClient client = null)
+			: base(AudioPayloadType, payloadSize, ClockRate, new IPEndPoint(IPAddress.Loopback, 9), client ?? new UdpClient(new IPEndPoint(IPAddress.Loopback, 0)))
+		{
+			_payload = Marshal.AllocHGlobal(payloadSize);
+			for (int i = 0; i < payloadSize; i++)
+			{
+				Marshal.WriteByte(_payload, i, (byte)i);
+			}
+			_streams = new Dictionary<IPEndPoint, Stream>();
+			_sync = new object();
+		}
+
+		public long BytesSent { get { return Interlocked.Read(ref _bytesSent); } }
+
+		public long BytesReceived { get { return Interlocked.Read(ref _bytesReceived); } }
+
+		public int Errors { get { return _errors; } }
+
+		public void AddPeer(IPEndPoint endpoint)
+		{
+			base.AddPeer(endpoint, ClockRate);
+		}
+
+		public void AddPeer(IPEndPoint endpoint, IPEndPoint relay, int ssrc)
+		{
+			base.AddPeer(endpoint, ClockRate, relay, ssrc);
+		}
+
+		// Sends one packet of audio, or a single byte of comfort noise.
+		public void Send(int timeStamp, bool comfortNoise)
+		{
+			int count = comfortNoise ? 1 : this.PayloadSize;
+			this.Send(timeStamp, _payload, count, comfortNoise ? ComfortNoisePayloadType : AudioPayloadType, false);
+			Interlocked.Add(ref _bytesSent, HeaderSize + count);
+		}
+
+		// Sends one packet of audio to a single peer, numbered and counted apart from those sent to the others.
+		public bool SendTo(IPEndPoint endpoint, int timeStamp)
+		{
+			if (!this.SendTo(endpoint, timeStamp, _payload, this.PayloadSize))
+			{
+				return false;
+			}
+			Interlocked.Add(ref _bytesSent, HeaderSize + this.PayloadSize);
+			return true;
+		}
+
+		// Returns a copy of the counts for the stream from a peer, or null if nothing has arrived from it.
+		public Stream GetStream(IPEndPoint endpoint)
+		{
+			lock (_sync)
+			{
+				Stream stream;
+				if (!_streams.TryGetValue(endpoint, out stream))
+				{
+					return null;
+				}
+				return stream.Copy();
+			}
+		}
+
+		public override void Dispose()
+		{
+			base.Dispose();
+			if (_payload != IntPtr.Zero)
+			{
+				Marshal.FreeHGlobal(_payload);
+				_payload = IntPtr.Zero;
+			}
+		}
+
+		protected override void OnReceived(IPEndPoint peer, short payloadType, int seqNumber, int timeStamp, byte[] payload, int offset, int count)
+		{
+			Interlocked.Add(ref _bytesReceived, HeaderSize + count);
+			lock (_sync)
+			{
+				Stream stream;
+				if (!_streams.TryGetValue(peer, out stream))
+				{
+					_streams.Add(peer, stream = new Stream { FirstSequence = seqNumber, HighestSequence = seqNumber });
+				}
+				else if (seqNumber <= stream.HighestSequence)
+				{
+					// Nothing here reorders, so an old number can only be a repeat.
+					stream.Duplicates++;
+					return;
+				}
+				stream.HighestSequence = seqNumber;
+				stream.Received++;
+				stream.Bytes += HeaderSize + count;
+			}
+		}
+
+		protected override void OnError(Exception ex)
+		{
+			Interlocked.Increment(ref _errors);
+		}
+	}
+}
@@ -0,0 +1,67 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Runtime.InteropServices;
+using Floe.Interop;
+
+namespace test
+{
+	// Reads and writes the mono 16-bit WAV files that the processing harnesses take and give. Files are read through
+	// WavReader, so that a recording in any format it accepts can be used.
+	static class WavFile
+	{
+		private const int ReadFrames = 4096;
+
+		// Reads a whole file, mixed down to mono, at its own rate.
+		public static short[] Read(string path, out int sampleRate)
+		{
+			var reader = new WavReader(path);
+			var buffer = Marshal.AllocHGlobal(ReadFrames * 2);
+			try
+			{
+				sampleRate = reader.Format.SampleRate;
+				reader.SetOutputFormat(sampleRate, 1, ResamplerQuality.High);
+				var samples = new List<short>();
+				var block = new short[ReadFrames];
+				int count;
+				while ((count = reader.Read(buffer, ReadFrames * 2)) > 0)
+				{
+					Marshal.Copy(buffer, block, 0, count / 2);
+					for (int i = 0; i < count / 2; i++)
+					{
+						samples.Add(block[i]);
+					}
+				}
+				return samples.ToArray();
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(buffer);
+				reader.Dispose();
+			}
+		}
+
+		public static void Write(string path, int sampleRate, short[] samples)
+		{
+			using (var writer = new BinaryWriter(new FileStream(path, FileMode.Create, FileAccess.Write)))
+			{
+				writer.Write(new char[] { 'R', 'I', 'F', 'F' });
+				writer.Write(36 + samples.Length * 2);
+				writer.Write(new char[] { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+				writer.Write(16);
+				writer.Write((short)1); // PCM
+				writer.Write((short)1);
+				writer.Write(sampleRate);
+				writer.Write(sampleRate * 2);
+				writer.Write((short)2);
+				writer.Write((short)16);
+				writer.Write(new char[] { 'd', 'a', 't', 'a' });
+				writer.Write(samples.Length * 2);
+				foreach (var sample in samples)
+				{
+					writer.Write(sample);
+				}
+			}
+		}
+	}
+}
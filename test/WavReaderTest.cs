@@ -0,0 +1,352 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+using Floe.Interop;
+
+namespace test
+{
+	// Writes short WAV files of the same sine wave in every sample format that WavReader accepts, reads each of them to the
+	// end through a WavReader, both at the file's own rate and resampled to mono, and checks what comes out. Reads use a
+	// buffer that does not divide the output, so that the last reads before the end are partly filled from the file and
+	// partly flushed out of the resamplers, and the shortest file is used up before the resamplers have made anything.
+	//
+	// Every format should play the same as the 16-bit file, within what its own resolution allows, and the output should
+	// have the length of the file at the output rate, after which reads return nothing.
+	//
+	// Then a long file in each of the formats that most recordings come in is read as it would be read for playback, in
+	// quarter-second buffers, both at its own rate and resampled, and must be read many times faster than it plays. With a
+	// file, only that file is timed, at its own rate or at the rate and number of channels given.
+	//
+	// usage: test wav [file.wav [rate [channels]]]
+	static class WavReaderTest
+	{
+		private const int SampleRate = 22050;
+		private const int OutputRate = 48000;
+		private const int ReadFrames = 997;
+		private const double Frequency = 440.0;
+		private const short FormatPcm = 1;
+		private const short FormatFloat = 3;
+		private const ushort FormatExtensible = 0xfffe;
+		private const int TimingLength = 120; // seconds
+		private const int TimingRate = 48000;
+		private const int ReadBufferLength = 250; // milliseconds, as a file is read for playback
+		private const double MinSpeed = 50.0; // times real time
+
+		private class Format
+		{
+			public string Name;
+			public short Tag;
+			public int Bits, Size;
+			public bool Extensible;
+			public int Tolerance;
+
+			public Format(string name, short tag, int bits, int size, bool extensible, int tolerance)
+			{
+				this.Name = name;
+				this.Tag = tag;
+				this.Bits = bits;
+				this.Size = size;
+				this.Extensible = extensible;
+				this.Tolerance = tolerance;
+			}
+		}
+
+		public static void Run(string[] args)
+		{
+			if (args.Length > 0)
+			{
+				PrintTimingHeader();
+				TimeRead(Path.GetFileName(args[0]), args[0], args.Length > 1 ? int.Parse(args[1]) : 0,
+					args.Length > 2 ? int.Parse(args[2]) : 0);
+				return;
+			}
+
+			// The 16-bit format comes first, as the one that the others are compared with. 8-bit samples are only good
+			// to within half a step of 256, and a little more once the resampler has spread the error out.
+			var formats = new Format[]
+			{
+				new Format("16-bit", FormatPcm, 16, 2, false, 0),
+				new Format("8-bit", FormatPcm, 8, 1, false, 192),
+				new Format("24-bit", FormatPcm, 24, 3, false, 2),
+				new Format("32-bit", FormatPcm, 32, 4, false, 2),
+				new Format("float", FormatFloat, 32, 4, false, 2),
+				new Format("double", FormatFloat, 64, 8, false, 2),
+				new Format("24-bit ext", FormatPcm, 24, 3, true, 2),
+				new Format("float ext", FormatFloat, 32, 4, true, 2)
+			};
+
+			foreach (int frames in new int[] { 5, 1000, 2 * 4096 + 123 })
+			{
+				foreach (int channels in new int[] { 1, 2 })
+				{
+					short[] native = null, resampled = null;
+					foreach (var format in formats)
+					{
+						string name = string.Format("{0} {1} ch {2} frames", format.Name, channels, frames);
+						string path = WriteFile(format, channels, SampleRate, MakeSine(frames, channels, SampleRate), -1);
+						try
+						{
+							var output = ReadFile(name, path, channels, SampleRate, frames);
+							native = native ?? output;
+							Compare(name, output, native, format.Tolerance);
+
+							output = ReadFile(name + " mono at " + OutputRate, path, 1, OutputRate, frames);
+							resampled = resampled ?? output;
+							Compare(name + " mono at " + OutputRate, output, resampled, format.Tolerance);
+						}
+						finally
+						{
+							File.Delete(path);
+						}
+					}
+				}
+			}
+
+			// Float samples that are not numbers play as silence, as long as nothing is resampled to spread them out.
+			foreach (var format in new Format[] { formats[4], formats[5] })
+			{
+				var samples = MakeSine(100, 1, SampleRate);
+				string path = WriteFile(format, 1, SampleRate, samples, 40);
+				try
+				{
+					var output = ReadFile(format.Name + " with NaN", path, 1, SampleRate, samples.Length);
+					Check.That(output.Length == samples.Length && output[40] == 0 && output[41] != 0,
+						"{0}: a NaN sample was read as {1}", format.Name, output.Length > 40 ? output[40] : 0);
+				}
+				finally
+				{
+					File.Delete(path);
+				}
+			}
+
+			PrintTimingHeader();
+			var sine = MakeSine(TimingLength * TimingRate, 2, TimingRate);
+			foreach (var format in new Format[] { formats[0], formats[2], formats[4] })
+			{
+				string path = WriteFile(format, 2, TimingRate, sine, -1);
+				try
+				{
+					foreach (int rate in new int[] { 0, 44100 })
+					{
+						string name = string.Format("{0} 2 ch at {1}", format.Name, rate > 0 ? rate : TimingRate);
+						double speed = TimeRead(name, path, rate, 0);
+						Check.That(speed >= MinSpeed, "{0}: read at {1:F0} times real time", name, speed);
+					}
+				}
+				finally
+				{
+					File.Delete(path);
+				}
+			}
+		}
+
+		private static void PrintTimingHeader()
+		{
+			Console.WriteLine("{0,-24} {1,8} {2,8} {3,8} {4,8} {5,8}", "file", "MB", "open ms", "read ms", "MB/s", "speed x");
+		}
+
+		// Opens a file and reads it to the end, at the given rate and number of channels where they are not zero, and
+		// returns how many times faster than real time it was read.
+		private static double TimeRead(string name, string path, int sampleRate, int channels)
+		{
+			long start = Stopwatch.GetTimestamp();
+			var reader = new WavReader(path);
+			try
+			{
+				int fileRate = reader.Format.SampleRate;
+				if (sampleRate > 0 || channels > 0)
+				{
+					reader.SetOutputFormat(sampleRate > 0 ? sampleRate : fileRate, channels > 0 ? channels : reader.Format.Channels,
+						ResamplerQuality.Medium);
+				}
+				long openTicks = Stopwatch.GetTimestamp() - start;
+
+				int bufferSize = reader.GetBufferSize(ReadBufferLength);
+				var buffer = Marshal.AllocHGlobal(bufferSize);
+				try
+				{
+					while (reader.Read(buffer, bufferSize) > 0)
+					{
+					}
+				}
+				finally
+				{
+					Marshal.FreeHGlobal(buffer);
+				}
+
+				double seconds = (double)(Stopwatch.GetTimestamp() - start) / Stopwatch.Frequency;
+				double megabytes = new FileInfo(path).Length / 1048576.0;
+				double speed = seconds > 0 ? reader.Frames / (double)fileRate / seconds : 0;
+				Console.WriteLine("{0,-24} {1,8:F1} {2,8:F2} {3,8:F1} {4,8:F0} {5,8:F0}", name, megabytes,
+					openTicks * 1000.0 / Stopwatch.Frequency, seconds * 1000.0, seconds > 0 ? megabytes / seconds : 0, speed);
+				return speed;
+			}
+			finally
+			{
+				reader.Dispose();
+			}
+		}
+
+		private static double[] MakeSine(int frames, int channels, int sampleRate)
+		{
+			// The second channel is the first at half the level and upside down, so that mixing them down is checked too.
+			var samples = new double[frames * channels];
+			for (int i = 0; i < frames; i++)
+			{
+				double value = 0.5 * Math.Sin(2.0 * Math.PI * Frequency * i / sampleRate);
+				samples[i * channels] = value;
+				if (channels > 1)
+				{
+					samples[i * channels + 1] = -0.5 * value;
+				}
+			}
+			return samples;
+		}
+
+		// Writes the samples to a temporary file in the given format, with a sample that is not a number at nanIndex if it
+		// is not negative, and returns its name.
+		private static string WriteFile(Format format, int channels, int sampleRate, double[] samples, int nanIndex)
+		{
+			var stream = new MemoryStream();
+			var writer = new BinaryWriter(stream);
+			int frameSize = format.Size * channels;
+			int dataSize = samples.Length * format.Size;
+
+			writer.Write(new char[] { 'R', 'I', 'F', 'F' });
+			writer.Write(0);
+			writer.Write(new char[] { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+			writer.Write(format.Extensible ? 40 : 18);
+			writer.Write(format.Extensible ? unchecked((short)FormatExtensible) : format.Tag);
+			writer.Write((short)channels);
+			writer.Write(sampleRate);
+			writer.Write(sampleRate * frameSize);
+			writer.Write((short)frameSize);
+			writer.Write((short)(format.Size * 8));
+			writer.Write((short)(format.Extensible ? 22 : 0));
+			if (format.Extensible)
+			{
+				writer.Write((short)format.Bits);
+				writer.Write(channels == 1 ? 4 : 3);
+				writer.Write(format.Tag);
+				writer.Write(new byte[] { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 });
+			}
+			writer.Write(new char[] { 'd', 'a', 't', 'a' });
+			writer.Write(dataSize);
+
+			for (int i = 0; i < samples.Length; i++)
+			{
+				double value = samples[i];
+				if (i == nanIndex)
+				{
+					value = double.NaN;
+				}
+				if (format.Tag == FormatFloat)
+				{
+					if (format.Bits == 32)
+					{
+						writer.Write((float)value);
+					}
+					else
+					{
+						writer.Write(value);
+					}
+					continue;
+				}
+				long sample = (long)Math.Round(value * (1L << (format.Bits - 1)));
+				switch (format.Bits)
+				{
+					case 8:
+						writer.Write((byte)(sample + 128));
+						break;
+					case 16:
+						writer.Write((short)sample);
+						break;
+					case 24:
+						writer.Write((byte)sample);
+						writer.Write((short)(sample >> 8));
+						break;
+					case 32:
+						writer.Write((int)sample);
+						break;
+				}
+			}
+			if ((dataSize & 1) != 0)
+			{
+				writer.Write((byte)0);
+			}
+
+			writer.Flush();
+			var bytes = stream.ToArray();
+			BitConverter.GetBytes(bytes.Length - 8).CopyTo(bytes, 4);
+			string path = Path.GetTempFileName();
+			File.WriteAllBytes(path, bytes);
+			return path;
+		}
+
+		// Reads a file to the end in the given output format, checks the length of what came out and that reading again
+		// from the start gives the same, and returns it.
+		private static short[] ReadFile(string name, string path, int channels, int sampleRate, int frames)
+		{
+			var reader = new WavReader(path);
+			var buffer = Marshal.AllocHGlobal(ReadFrames * channels * 2);
+			try
+			{
+				reader.SetOutputFormat(sampleRate, channels, ResamplerQuality.Medium);
+				var output = ReadAll(reader, buffer, channels);
+				long expected = ((long)frames * sampleRate + SampleRate - 1) / SampleRate;
+				Check.That(output.Length == expected * channels, "{0}: read {1} frames, expected {2}", name,
+					output.Length / channels, expected);
+				Check.That(reader.Read(buffer, ReadFrames * channels * 2) == 0, "{0}: read more after the end", name);
+
+				reader.Frame = 0;
+				var again = ReadAll(reader, buffer, channels);
+				Check.That(again.Length == output.Length && Difference(again, output) == 0,
+					"{0}: reading again from the start gave different output", name);
+				return output;
+			}
+			finally
+			{
+				Marshal.FreeHGlobal(buffer);
+				reader.Dispose();
+			}
+		}
+
+		private static short[] ReadAll(WavReader reader, IntPtr buffer, int channels)
+		{
+			var output = new List<short>();
+			var block = new short[ReadFrames * channels];
+			int count;
+			while ((count = reader.Read(buffer, block.Length * 2)) > 0)
+			{
+				Marshal.Copy(buffer, block, 0, count / 2);
+				for (int i = 0; i < count / 2; i++)
+				{
+					output.Add(block[i]);
+				}
+			}
+			return output.ToArray();
+		}
+
+		private static void Compare(string name, short[] output, short[] reference, int tolerance)
+		{
+			if (output.Length != reference.Length)
+			{
+				return;
+			}
+			int difference = Difference(output, reference);
+			Check.That(difference <= tolerance, "{0}: differs from 16-bit by up to {1}", name, difference);
+		}
+
+		private static int Difference(short[] a, short[] b)
+		{
+			int max = 0;
+			for (int i = 0; i < a.Length && i < b.Length; i++)
+			{
+				max = Math.Max(max, Math.Abs(a[i] - b[i]));
+			}
+			return max;
+		}
+	}
+}
@@ -0,0 +1,209 @@
+﻿using System;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Threading;
+using Floe.Audio;
+using Floe.Interop;
+
+namespace test
+{
+	// Runs the WaveOut and WaveIn buffer loops against the null device, which hands every buffer back as soon as it is
+	// given one, with rings of two to eight buffers, and checks what passes through them: every buffer a source fills is
+	// played once and then the end of the stream is reported, every buffer recorded reaches the sink whole, bytes are only
+	// copied when a stream is used instead of a source or sink, and no underruns or overruns are counted, as a device
+	// that never holds anything back cannot run dry. The rate at which each loop turns buffers over is printed too.
+	//
+	// Then the number of buffers that CodecInfo asks the devices for is checked for each codec: enough to hold 60 ms,
+	// and no more than that needs, but never fewer than two.
+	//
+	// usage: test device [packets]
+	static class WaveDeviceTest
+	{
+		private const int SampleRate = 8000;
+		private const int BufferSize = 640; // bytes, a 40 ms packet
+		private const int MinDeviceLength = 60; // milliseconds, as in CodecInfo
+		private const int Timeout = 10000; // milliseconds
+
+		// Fills each buffer with its own number, and then has nothing more.
+		private class CountingSource : IWaveSource
+		{
+			public int Packets, Reads, ShortReads;
+
+			public int Read(IntPtr buffer, int count)
+			{
+				if (this.Reads >= this.Packets)
+				{
+					return 0;
+				}
+				if (count != BufferSize)
+				{
+					this.ShortReads++;
+				}
+				for (int i = 0; i + 1 < count; i += 2)
+				{
+					Marshal.WriteInt16(buffer, i, (short)this.Reads);
+				}
+				this.Reads++;
+				return count;
+			}
+		}
+
+		// Counts what is recorded, and says when it has had enough.
+		private class CountingSink : IWaveSink
+		{
+			public int Packets, Writes, ShortWrites, NoisyWrites;
+			public ManualResetEvent Done = new ManualResetEvent(false);
+
+			public void Write(IntPtr buffer, int count)
+			{
+				if (count != BufferSize)
+				{
+					this.ShortWrites++;
+				}
+				for (int i = 0; i + 1 < count; i += 2)
+				{
+					if (Marshal.ReadInt16(buffer, i) != 0)
+					{
+						this.NoisyWrites++;
+						break;
+					}
+				}
+				if (++this.Writes == this.Packets)
+				{
+					this.Done.Set();
+				}
+			}
+		}
+
+		public static void Run(string[] args)
+		{
+			int packets = args.Length > 0 ? int.Parse(args[0]) : 5000;
+			var format = new WaveFormatPcm(SampleRate, 16, 1);
+
+			Console.WriteLine("{0,-12} {1,7} {2,8} {3,8} {4,10} {5,10}", "loop", "buffers", "packets", "errors", "copied", "packets/s");
+			foreach (int bufferCount in new int[] { 2, 3, 4, 8 })
+			{
+				PlaySource(format, bufferCount, packets);
+				PlayStream(format, bufferCount, packets);
+				RecordSink(format, bufferCount, packets);
+				RecordStream(format, bufferCount, packets);
+			}
+
+			CheckCodecs();
+		}
+
+		private static void PlaySource(WaveFormat format, int bufferCount, int packets)
+		{
+			var source = new CountingSource { Packets = packets };
+			var ended = new ManualResetEvent(false);
+			var waveOut = new WaveOut(source, format, BufferSize, bufferCount, WaveDeviceKind.Null);
+			waveOut.EndOfStream += (sender, e) => ended.Set();
+			long start = DateTime.UtcNow.Ticks;
+			waveOut.Start();
+			bool done = ended.WaitOne(Timeout);
+			double seconds = (DateTime.UtcNow.Ticks - start) / 1e7;
+			waveOut.Dispose();
+
+			string name = string.Format("out source x{0}", bufferCount);
+			Print("out source", bufferCount, source.Reads, waveOut.Underruns, waveOut.BytesCopied, seconds);
+			Check.That(done, "{0}: the end of the stream was not reported", name);
+			Check.That(source.Reads == packets, "{0}: {1} of {2} packets were read", name, source.Reads, packets);
+			Check.That(source.ShortReads == 0, "{0}: {1} reads were not for a whole buffer", name, source.ShortReads);
+			Check.That(waveOut.Underruns == 0, "{0}: the null device ran dry {1} times", name, waveOut.Underruns);
+			Check.That(waveOut.BytesCopied == 0, "{0}: {1} bytes were copied from a source", name, waveOut.BytesCopied);
+		}
+
+		private static void PlayStream(WaveFormat format, int bufferCount, int packets)
+		{
+			var stream = new MemoryStream(new byte[(long)packets * BufferSize]);
+			var ended = new ManualResetEvent(false);
+			var waveOut = new WaveOut(stream, format, BufferSize, bufferCount, WaveDeviceKind.Null);
+			waveOut.EndOfStream += (sender, e) => ended.Set();
+			long start = DateTime.UtcNow.Ticks;
+			waveOut.Start();
+			bool done = ended.WaitOne(Timeout);
+			double seconds = (DateTime.UtcNow.Ticks - start) / 1e7;
+			waveOut.Dispose();
+
+			string name = string.Format("out stream x{0}", bufferCount);
+			Print("out stream", bufferCount, (int)(stream.Position / BufferSize), waveOut.Underruns, waveOut.BytesCopied, seconds);
+			Check.That(done, "{0}: the end of the stream was not reported", name);
+			Check.That(stream.Position == stream.Length, "{0}: {1} of {2} bytes were read", name, stream.Position, stream.Length);
+			Check.That(waveOut.Underruns == 0, "{0}: the null device ran dry {1} times", name, waveOut.Underruns);
+			Check.That(waveOut.BytesCopied == stream.Length, "{0}: {1} bytes were copied, and {2} read", name,
+				waveOut.BytesCopied, stream.Length);
+		}
+
+		private static void RecordSink(WaveFormat format, int bufferCount, int packets)
+		{
+			var sink = new CountingSink { Packets = packets };
+			var waveIn = new WaveIn(sink, format, BufferSize, bufferCount, WaveDeviceKind.Null);
+			long start = DateTime.UtcNow.Ticks;
+			waveIn.Start();
+			bool done = sink.Done.WaitOne(Timeout);
+			double seconds = (DateTime.UtcNow.Ticks - start) / 1e7;
+			waveIn.Dispose();
+
+			string name = string.Format("in sink x{0}", bufferCount);
+			Print("in sink", bufferCount, sink.Writes, waveIn.Overruns, waveIn.BytesCopied, seconds);
+			Check.That(done, "{0}: only {1} of {2} packets were recorded", name, sink.Writes, packets);
+			Check.That(sink.ShortWrites == 0, "{0}: {1} writes were not a whole buffer", name, sink.ShortWrites);
+			Check.That(sink.NoisyWrites == 0, "{0}: {1} writes from the null device were not silent", name, sink.NoisyWrites);
+			Check.That(waveIn.Overruns == 0, "{0}: the null device overran {1} times", name, waveIn.Overruns);
+			Check.That(waveIn.BytesCopied == 0, "{0}: {1} bytes were copied to a sink", name, waveIn.BytesCopied);
+		}
+
+		private static void RecordStream(WaveFormat format, int bufferCount, int packets)
+		{
+			var stream = new MemoryStream();
+			var waveIn = new WaveIn(stream, format, BufferSize, bufferCount, WaveDeviceKind.Null);
+			long start = DateTime.UtcNow.Ticks;
+			waveIn.Start();
+			while (waveIn.BytesCopied < (long)packets * BufferSize && (DateTime.UtcNow.Ticks - start) / 10000 < Timeout)
+			{
+				Thread.Sleep(1);
+			}
+			double seconds = (DateTime.UtcNow.Ticks - start) / 1e7;
+			waveIn.Dispose();
+
+			string name = string.Format("in stream x{0}", bufferCount);
+			Print("in stream", bufferCount, (int)(stream.Length / BufferSize), waveIn.Overruns, waveIn.BytesCopied, seconds);
+			Check.That(stream.Length >= (long)packets * BufferSize, "{0}: only {1} bytes were recorded", name, stream.Length);
+			Check.That(stream.Length % BufferSize == 0, "{0}: {1} bytes is not a whole number of buffers", name, stream.Length);
+			Check.That(waveIn.Overruns == 0, "{0}: the null device overran {1} times", name, waveIn.Overruns);
+			Check.That(waveIn.BytesCopied == stream.Length, "{0}: {1} bytes were copied, and {2} written", name,
+				waveIn.BytesCopied, stream.Length);
+		}
+
+		private static void Print(string loop, int bufferCount, int packets, int errors, long copied, double seconds)
+		{
+			Console.WriteLine("{0,-12} {1,7} {2,8} {3,8} {4,10} {5,10:F0}", loop, bufferCount, packets, errors, copied,
+				seconds > 0 ? packets / seconds : 0);
+		}
+
+		private static void CheckCodecs()
+		{
+			Console.WriteLine();
+			Console.WriteLine("{0,-6} {1,6} {2,9} {3,7} {4,8}", "codec", "rate", "packet ms", "buffers", "queued ms");
+			foreach (var codec in new VoiceCodec[] { VoiceCodec.Gsm610, VoiceCodec.Opus })
+			{
+				if (codec == VoiceCodec.Opus && !OpusCodec.IsAvailable)
+				{
+					continue;
+				}
+				foreach (int rate in codec == VoiceCodec.Opus ? new int[] { 8000, 16000, 48000 } : new int[] { 8000, 16000, 44100 })
+				{
+					var info = new CodecInfo(codec, rate);
+					double packetTime = info.SamplesPerPacket * 1000.0 / info.SampleRate;
+					int count = info.DeviceBufferCount;
+					Console.WriteLine("{0,-6} {1,6} {2,9:F1} {3,7} {4,8:F1}", codec, rate, packetTime, count, count * packetTime);
+					Check.That(count >= 2, "{0} at {1}: {2} device buffers", codec, rate, count);
+					Check.That(count * packetTime >= MinDeviceLength, "{0} at {1}: {2} device buffers hold only {3:F1} ms", codec,
+						rate, count, count * packetTime);
+					Check.That(count == 2 || (count - 1) * packetTime < MinDeviceLength, "{0} at {1}: {2} device buffers are " +
+						"more than 60 ms needs", codec, rate, count);
+				}
+			}
+		}
+	}
+}